@@ -0,0 +1,761 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "hierarchy_snapshot.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <abseil/absl/container/flat_hash_map.h>
+#include <abseil/absl/strings/string_view.h>
+#include <abseil/absl/types/optional.h>
+#include <abseil/absl/types/span.h>
+#include "typedefs.h"
+
+namespace gtx {
+
+namespace {
+
+constexpr char kSnapshotMagic[4] = {'G', 'T', 'X', 'S'};
+constexpr uint32_t kSnapshotVersion = 1;
+
+static_assert(std::is_trivially_copyable<SnapshotElement>::value,
+              "SnapshotElement must be trivially copyable");
+static_assert(sizeof(SnapshotElement) == 192,
+              "SnapshotElement layout changed, bump kSnapshotVersion");
+static_assert(sizeof(SnapshotCheckResult) == 40,
+              "SnapshotCheckResult layout changed, bump kSnapshotVersion");
+static_assert(sizeof(SnapshotMetadataEntry) == 48,
+              "SnapshotMetadataEntry layout changed, bump kSnapshotVersion");
+static_assert(sizeof(SnapshotHeader) == 104,
+              "SnapshotHeader layout changed, bump kSnapshotVersion");
+
+SnapshotRect RectFromProto(const RectProto &rect) {
+  return {rect.origin().x(), rect.origin().y(), rect.size().width(),
+          rect.size().height()};
+}
+
+RectProto RectToProto(const SnapshotRect &rect) {
+  RectProto proto;
+  proto.mutable_origin()->set_x(rect.x);
+  proto.mutable_origin()->set_y(rect.y);
+  proto.mutable_size()->set_width(rect.width);
+  proto.mutable_size()->set_height(rect.height);
+  return proto;
+}
+
+SnapshotColor ColorFromProto(const ColorProto &color) {
+  return {color.r(), color.g(), color.b(), color.a()};
+}
+
+ColorProto ColorToProto(const SnapshotColor &color) {
+  ColorProto proto;
+  proto.set_r(color.r);
+  proto.set_g(color.g);
+  proto.set_b(color.b);
+  proto.set_a(color.a);
+  return proto;
+}
+
+template <typename T>
+uint64_t BitsOf(T value) {
+  static_assert(sizeof(T) <= sizeof(uint64_t), "value does not fit");
+  uint64_t bits = 0;
+  memcpy(&bits, &value, sizeof(T));
+  return bits;
+}
+
+template <typename T>
+T FromBits(uint64_t bits) {
+  T value;
+  memcpy(&value, &bits, sizeof(T));
+  return value;
+}
+
+// Accumulates the sections of a snapshot and writes them out.
+class SnapshotBuilder {
+ public:
+  SnapshotString AddString(const std::string &string) {
+    auto existing = string_refs_.find(string);
+    if (existing != string_refs_.end()) {
+      return existing->second;
+    }
+    SnapshotString ref = {static_cast<uint32_t>(strings_.size()),
+                          static_cast<uint32_t>(string.size())};
+    strings_.append(string);
+    string_refs_.emplace(string, ref);
+    return ref;
+  }
+
+  SnapshotRange AddStringList(const std::vector<std::string> &strings) {
+    SnapshotRange range = {static_cast<uint32_t>(string_lists_.size()),
+                           static_cast<uint32_t>(strings.size())};
+    for (const std::string &string : strings) {
+      string_lists_.push_back(AddString(string));
+    }
+    return range;
+  }
+
+  SnapshotRange AddInt32s(const std::vector<int32_t> &values) {
+    SnapshotRange range = {static_cast<uint32_t>(int32s_.size()),
+                           static_cast<uint32_t>(values.size())};
+    int32s_.insert(int32s_.end(), values.begin(), values.end());
+    return range;
+  }
+
+  void AddHierarchy(const AccessibilityHierarchyProto &hierarchy);
+  void AddResult(const CheckResultProto &result);
+  std::string Build();
+
+ private:
+  void AddElement(const UIElementProto &element);
+  SnapshotMetadataEntry MetadataEntry(const std::string &key,
+                                      const TypedValueProto &value);
+
+  SnapshotHeader header_ = {};
+  std::vector<SnapshotElement> elements_;
+  std::vector<SnapshotCheckResult> results_;
+  std::vector<SnapshotMetadataEntry> metadata_entries_;
+  std::vector<SnapshotString> string_lists_;
+  std::vector<int32_t> int32s_;
+  std::string strings_;
+  // Strings already in strings_, so repeated strings such as class names are
+  // only stored once.
+  absl::flat_hash_map<std::string, SnapshotString> string_refs_;
+};
+
+void SnapshotBuilder::AddHierarchy(
+    const AccessibilityHierarchyProto &hierarchy) {
+  header_.present |= 1u << SnapshotHeader::kHierarchy;
+  if (hierarchy.has_device_state()) {
+    const DeviceStateProto &device_state = hierarchy.device_state();
+    header_.present |= 1u << SnapshotHeader::kDeviceState;
+    if (device_state.has_display_metrics()) {
+      const DisplayMetricsProto &metrics = device_state.display_metrics();
+      header_.present |= 1u << SnapshotHeader::kDisplayMetrics;
+      header_.present |= metrics.has_screen_width()
+                             ? 1u << SnapshotHeader::kScreenWidth
+                             : 0;
+      header_.present |= metrics.has_screen_height()
+                             ? 1u << SnapshotHeader::kScreenHeight
+                             : 0;
+      header_.present |= metrics.has_screen_scale()
+                             ? 1u << SnapshotHeader::kScreenScale
+                             : 0;
+      header_.screen_width = metrics.screen_width();
+      header_.screen_height = metrics.screen_height();
+      header_.screen_scale = metrics.screen_scale();
+    }
+    if (device_state.has_ios_version()) {
+      header_.present |= 1u << SnapshotHeader::kIOSVersion;
+      header_.ios_version = AddString(device_state.ios_version());
+    }
+  }
+  elements_.reserve(hierarchy.elements_size());
+  for (const UIElementProto &element : hierarchy.elements()) {
+    AddElement(element);
+  }
+}
+
+void SnapshotBuilder::AddElement(const UIElementProto &element) {
+  SnapshotElement record = {};
+  auto set_present = [&record](SnapshotElement::Field field, bool has) {
+    record.present |= static_cast<uint64_t>(has) << field;
+  };
+  auto set_bool = [&record, &set_present](SnapshotElement::Field field,
+                                          bool has, bool value) {
+    set_present(field, has);
+    record.bool_values |= static_cast<uint64_t>(value) << field;
+  };
+
+  set_present(SnapshotElement::kId, element.has_id());
+  record.id = element.id();
+  set_present(SnapshotElement::kParentId, element.has_parent_id());
+  record.parent_id = element.parent_id();
+  set_present(SnapshotElement::kChildIds, element.has_child_ids());
+  record.child_ids = AddInt32s(element.child_ids());
+  set_bool(SnapshotElement::kIsAXElement, element.has_is_ax_element(),
+           element.is_ax_element());
+  set_present(SnapshotElement::kAXTraits, element.has_ax_traits());
+  record.ax_traits = element.ax_traits();
+  set_present(SnapshotElement::kAXLabel, element.has_ax_label());
+  record.ax_label = AddString(element.ax_label());
+  set_present(SnapshotElement::kAXHint, element.has_ax_hint());
+  record.ax_hint = AddString(element.ax_hint());
+  set_present(SnapshotElement::kAXFrame, element.has_ax_frame());
+  record.ax_frame = RectFromProto(element.ax_frame());
+  set_present(SnapshotElement::kAXIdentifier, element.has_ax_identifier());
+  record.ax_identifier = AddString(element.ax_identifier());
+  set_bool(SnapshotElement::kHittable, element.has_hittable(),
+           element.hittable());
+  set_bool(SnapshotElement::kExists, element.has_exists(), element.exists());
+  set_bool(SnapshotElement::kXCSelected, element.has_xc_selected(),
+           element.xc_selected());
+  set_bool(SnapshotElement::kXCEnabled, element.has_xc_enabled(),
+           element.xc_enabled());
+  set_present(SnapshotElement::kElementType, element.has_element_type());
+  record.element_type = element.element_type();
+  set_present(SnapshotElement::kClassNamesHierarchy,
+              element.has_class_names_hierarchy());
+  record.class_names_hierarchy =
+      AddStringList(element.class_names_hierarchy());
+  set_present(SnapshotElement::kBackgroundColor,
+              element.has_background_color());
+  record.background_color = ColorFromProto(element.background_color());
+  set_bool(SnapshotElement::kHidden, element.has_hidden(), element.hidden());
+  set_present(SnapshotElement::kAlpha, element.has_alpha());
+  record.alpha = element.alpha();
+  set_bool(SnapshotElement::kOpaque, element.has_opaque(), element.opaque());
+  set_present(SnapshotElement::kTintColor, element.has_tint_color());
+  record.tint_color = ColorFromProto(element.tint_color());
+  set_bool(SnapshotElement::kClipsToBounds, element.has_clips_to_bounds(),
+           element.clips_to_bounds());
+  set_bool(SnapshotElement::kUserInteractionEnabled,
+           element.has_user_interaction_enabled(),
+           element.user_interaction_enabled());
+  set_bool(SnapshotElement::kMultipleTouchEnabled,
+           element.has_multiple_touch_enabled(),
+           element.multiple_touch_enabled());
+  set_bool(SnapshotElement::kExclusiveTouch, element.has_exclusive_touch(),
+           element.exclusive_touch());
+  set_present(SnapshotElement::kFrame, element.has_frame());
+  record.frame = RectFromProto(element.frame());
+  set_present(SnapshotElement::kBounds, element.has_bounds());
+  record.bounds = RectFromProto(element.bounds());
+  set_present(SnapshotElement::kControlState, element.has_control_state());
+  record.control_state = element.control_state();
+  set_bool(SnapshotElement::kEnabled, element.has_enabled(),
+           element.enabled());
+  set_bool(SnapshotElement::kSelected, element.has_selected(),
+           element.selected());
+  set_bool(SnapshotElement::kHighlighted, element.has_highlighted(),
+           element.highlighted());
+  set_present(SnapshotElement::kTitle, element.has_title());
+  record.title = AddString(element.title());
+  set_present(SnapshotElement::kText, element.has_text());
+  record.text = AddString(element.text());
+  set_bool(SnapshotElement::kOn, element.has_on(), element.on());
+  set_present(SnapshotElement::kValue, element.has_value());
+  record.value = element.value();
+  elements_.push_back(record);
+}
+
+void SnapshotBuilder::AddResult(const CheckResultProto &result) {
+  SnapshotCheckResult record = {};
+  auto set_present = [&record](SnapshotCheckResult::Field field, bool has) {
+    record.present |= static_cast<uint32_t>(has) << field;
+  };
+  set_present(SnapshotCheckResult::kSourceCheckClass,
+              result.has_source_check_class());
+  record.source_check_class = AddString(result.source_check_class());
+  set_present(SnapshotCheckResult::kResultId, result.has_result_id());
+  record.result_id = result.result_id();
+  set_present(SnapshotCheckResult::kHierarchySourceId,
+              result.has_hierarchy_source_id());
+  record.hierarchy_source_id = result.hierarchy_source_id();
+  set_present(SnapshotCheckResult::kResultType, result.has_result_type());
+  record.result_type = result.result_type();
+  set_present(SnapshotCheckResult::kMetadata, result.has_metadata());
+  const std::map<std::string, TypedValueProto> &metadata_map =
+      result.metadata().metadata_map();
+  record.metadata = {static_cast<uint32_t>(metadata_entries_.size()),
+                     static_cast<uint32_t>(metadata_map.size())};
+  for (const auto &entry : metadata_map) {
+    metadata_entries_.push_back(MetadataEntry(entry.first, entry.second));
+  }
+  results_.push_back(record);
+}
+
+SnapshotMetadataEntry SnapshotBuilder::MetadataEntry(
+    const std::string &key, const TypedValueProto &value) {
+  SnapshotMetadataEntry entry = {};
+  entry.key = AddString(key);
+  entry.has_type = value.has_type();
+  entry.type = value.type();
+  entry.value_case = TypedValueProto::VALUE_NOT_SET;
+  // value_case() is not initialized for values that were never set, so the
+  // value is determined from the has-bits instead.
+  if (value.has_boolean_value()) {
+    entry.value_case = TypedValueProto::kBooleanValue;
+    entry.scalar_value = value.boolean_value();
+  } else if (value.has_byte_value()) {
+    entry.value_case = TypedValueProto::kByteValue;
+    entry.string_value = AddString(value.byte_value());
+  } else if (value.has_short_value()) {
+    entry.value_case = TypedValueProto::kShortValue;
+    entry.string_value = AddString(value.short_value());
+  } else if (value.has_char_value()) {
+    entry.value_case = TypedValueProto::kCharValue;
+    entry.string_value = AddString(value.char_value());
+  } else if (value.has_int_value()) {
+    entry.value_case = TypedValueProto::kIntValue;
+    entry.scalar_value = BitsOf(value.int_value());
+  } else if (value.has_float_value()) {
+    entry.value_case = TypedValueProto::kFloatValue;
+    entry.scalar_value = BitsOf(value.float_value());
+  } else if (value.has_long_value()) {
+    entry.value_case = TypedValueProto::kLongValue;
+    entry.scalar_value = BitsOf(value.long_value());
+  } else if (value.has_double_value()) {
+    entry.value_case = TypedValueProto::kDoubleValue;
+    entry.scalar_value = BitsOf(value.double_value());
+  } else if (value.has_string_value()) {
+    entry.value_case = TypedValueProto::kStringValue;
+    entry.string_value = AddString(value.string_value());
+  } else if (value.has_string_list_value()) {
+    entry.value_case = TypedValueProto::kStringListValue;
+    entry.list_value = AddStringList(value.string_list_value().values());
+  } else if (value.has_int_list_value()) {
+    entry.value_case = TypedValueProto::kIntListValue;
+    entry.list_value = AddInt32s(value.int_list_value().values());
+  }
+  return entry;
+}
+
+// Returns @c offset rounded up to a multiple of 8.
+uint64_t AlignOffset(uint64_t offset) { return (offset + 7) & ~uint64_t{7}; }
+
+std::string SnapshotBuilder::Build() {
+  memcpy(header_.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+  header_.version = kSnapshotVersion;
+  header_.element_count = static_cast<uint32_t>(elements_.size());
+  header_.result_count = static_cast<uint32_t>(results_.size());
+  header_.metadata_entry_count =
+      static_cast<uint32_t>(metadata_entries_.size());
+  header_.string_list_count = static_cast<uint32_t>(string_lists_.size());
+  header_.int32_count = static_cast<uint32_t>(int32s_.size());
+  header_.string_bytes = static_cast<uint32_t>(strings_.size());
+
+  uint64_t offset = sizeof(SnapshotHeader);
+  auto place = [&offset](uint64_t *section_offset, size_t section_size) {
+    offset = AlignOffset(offset);
+    *section_offset = offset;
+    offset += section_size;
+  };
+  place(&header_.elements_offset, elements_.size() * sizeof(SnapshotElement));
+  place(&header_.results_offset,
+        results_.size() * sizeof(SnapshotCheckResult));
+  place(&header_.metadata_entries_offset,
+        metadata_entries_.size() * sizeof(SnapshotMetadataEntry));
+  place(&header_.string_lists_offset,
+        string_lists_.size() * sizeof(SnapshotString));
+  place(&header_.int32s_offset, int32s_.size() * sizeof(int32_t));
+  place(&header_.strings_offset, strings_.size());
+
+  std::string snapshot(offset, '\0');
+  auto write = [&snapshot](uint64_t section_offset, const void *data,
+                           size_t size) {
+    if (size > 0) {
+      memcpy(&snapshot[section_offset], data, size);
+    }
+  };
+  write(0, &header_, sizeof(SnapshotHeader));
+  write(header_.elements_offset, elements_.data(),
+        elements_.size() * sizeof(SnapshotElement));
+  write(header_.results_offset, results_.data(),
+        results_.size() * sizeof(SnapshotCheckResult));
+  write(header_.metadata_entries_offset, metadata_entries_.data(),
+        metadata_entries_.size() * sizeof(SnapshotMetadataEntry));
+  write(header_.string_lists_offset, string_lists_.data(),
+        string_lists_.size() * sizeof(SnapshotString));
+  write(header_.int32s_offset, int32s_.data(),
+        int32s_.size() * sizeof(int32_t));
+  write(header_.strings_offset, strings_.data(), strings_.size());
+  return snapshot;
+}
+
+// Returns true if the @c count records of @c record_size bytes at
+// @c section_offset lie within a buffer of @c size bytes.
+bool IsSectionInBounds(uint64_t section_offset, uint64_t count,
+                       uint64_t record_size, uint64_t size) {
+  if (section_offset % 8 != 0 || section_offset > size) {
+    return false;
+  }
+  // count is at most 32 bits and record_size is small, so this can't overflow.
+  return count * record_size <= size - section_offset;
+}
+
+}  // namespace
+
+std::string SnapshotFromEvaluation(
+    const AccessibilityEvaluationProto &evaluation) {
+  SnapshotBuilder builder;
+  if (evaluation.has_hierarchy()) {
+    builder.AddHierarchy(evaluation.hierarchy());
+  }
+  for (const CheckResultProto &result : evaluation.results()) {
+    builder.AddResult(result);
+  }
+  return builder.Build();
+}
+
+std::string SnapshotFromHierarchy(
+    const AccessibilityHierarchyProto &hierarchy) {
+  SnapshotBuilder builder;
+  builder.AddHierarchy(hierarchy);
+  return builder.Build();
+}
+
+absl::optional<HierarchySnapshot> HierarchySnapshot::FromBuffer(
+    const void *data, size_t size) {
+  if (reinterpret_cast<uintptr_t>(data) % 8 != 0 ||
+      size < sizeof(SnapshotHeader)) {
+    return absl::nullopt;
+  }
+  const char *bytes = static_cast<const char *>(data);
+  const SnapshotHeader *header = reinterpret_cast<const SnapshotHeader *>(data);
+  if (memcmp(header->magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 ||
+      header->version != kSnapshotVersion) {
+    return absl::nullopt;
+  }
+  if (!IsSectionInBounds(header->elements_offset, header->element_count,
+                         sizeof(SnapshotElement), size) ||
+      !IsSectionInBounds(header->results_offset, header->result_count,
+                         sizeof(SnapshotCheckResult), size) ||
+      !IsSectionInBounds(header->metadata_entries_offset,
+                         header->metadata_entry_count,
+                         sizeof(SnapshotMetadataEntry), size) ||
+      !IsSectionInBounds(header->string_lists_offset,
+                         header->string_list_count, sizeof(SnapshotString),
+                         size) ||
+      !IsSectionInBounds(header->int32s_offset, header->int32_count,
+                         sizeof(int32_t), size) ||
+      !IsSectionInBounds(header->strings_offset, header->string_bytes, 1,
+                         size)) {
+    return absl::nullopt;
+  }
+
+  HierarchySnapshot snapshot;
+  snapshot.header_ = header;
+  snapshot.elements_ = absl::MakeConstSpan(
+      reinterpret_cast<const SnapshotElement *>(bytes +
+                                                header->elements_offset),
+      header->element_count);
+  snapshot.results_ = absl::MakeConstSpan(
+      reinterpret_cast<const SnapshotCheckResult *>(bytes +
+                                                    header->results_offset),
+      header->result_count);
+  snapshot.metadata_entries_ = absl::MakeConstSpan(
+      reinterpret_cast<const SnapshotMetadataEntry *>(
+          bytes + header->metadata_entries_offset),
+      header->metadata_entry_count);
+  snapshot.string_lists_ = absl::MakeConstSpan(
+      reinterpret_cast<const SnapshotString *>(bytes +
+                                               header->string_lists_offset),
+      header->string_list_count);
+  snapshot.int32s_ = absl::MakeConstSpan(
+      reinterpret_cast<const int32_t *>(bytes + header->int32s_offset),
+      header->int32_count);
+  snapshot.strings_ =
+      absl::string_view(bytes + header->strings_offset, header->string_bytes);
+  if (!snapshot.ValidateReferences()) {
+    return absl::nullopt;
+  }
+  return snapshot;
+}
+
+bool HierarchySnapshot::ValidateReferences() const {
+  auto is_valid_string = [this](const SnapshotString &string) {
+    return string.offset <= strings_.size() &&
+           string.size <= strings_.size() - string.offset;
+  };
+  auto is_valid_range = [](const SnapshotRange &range, size_t size) {
+    return range.begin <= size && range.count <= size - range.begin;
+  };
+  if (!is_valid_string(header_->ios_version)) {
+    return false;
+  }
+  for (const SnapshotString &string : string_lists_) {
+    if (!is_valid_string(string)) {
+      return false;
+    }
+  }
+  for (const SnapshotElement &element : elements_) {
+    if (!is_valid_range(element.child_ids, int32s_.size()) ||
+        !is_valid_range(element.class_names_hierarchy, string_lists_.size()) ||
+        !is_valid_string(element.ax_label) ||
+        !is_valid_string(element.ax_hint) ||
+        !is_valid_string(element.ax_identifier) ||
+        !is_valid_string(element.title) || !is_valid_string(element.text)) {
+      return false;
+    }
+  }
+  for (const SnapshotCheckResult &result : results_) {
+    if (!is_valid_string(result.source_check_class) ||
+        !is_valid_range(result.metadata, metadata_entries_.size())) {
+      return false;
+    }
+  }
+  for (const SnapshotMetadataEntry &entry : metadata_entries_) {
+    if (!is_valid_string(entry.key) || !is_valid_string(entry.string_value)) {
+      return false;
+    }
+    if (entry.value_case == TypedValueProto::kStringListValue &&
+        !is_valid_range(entry.list_value, string_lists_.size())) {
+      return false;
+    }
+    if (entry.value_case == TypedValueProto::kIntListValue &&
+        !is_valid_range(entry.list_value, int32s_.size())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+UIElementProto HierarchySnapshot::ElementProto(int index) const {
+  const SnapshotElement &record = elements_[index];
+  UIElementProto element;
+  auto string_of = [this](const SnapshotString &string) {
+    return std::string(String(string));
+  };
+  if (record.has(SnapshotElement::kId)) {
+    element.set_id(record.id);
+  }
+  if (record.has(SnapshotElement::kParentId)) {
+    element.set_parent_id(record.parent_id);
+  }
+  for (int32_t child_id : Int32s(record.child_ids)) {
+    element.add_child_ids(child_id);
+  }
+  if (record.has(SnapshotElement::kIsAXElement)) {
+    element.set_is_ax_element(record.bool_value(SnapshotElement::kIsAXElement));
+  }
+  if (record.has(SnapshotElement::kAXTraits)) {
+    element.set_ax_traits(record.ax_traits);
+  }
+  if (record.has(SnapshotElement::kAXLabel)) {
+    element.set_ax_label(string_of(record.ax_label));
+  }
+  if (record.has(SnapshotElement::kAXHint)) {
+    element.set_ax_hint(string_of(record.ax_hint));
+  }
+  if (record.has(SnapshotElement::kAXFrame)) {
+    element.set_ax_frame(RectToProto(record.ax_frame));
+  }
+  if (record.has(SnapshotElement::kAXIdentifier)) {
+    element.set_ax_identifier(string_of(record.ax_identifier));
+  }
+  if (record.has(SnapshotElement::kHittable)) {
+    element.set_hittable(record.bool_value(SnapshotElement::kHittable));
+  }
+  if (record.has(SnapshotElement::kExists)) {
+    element.set_exists(record.bool_value(SnapshotElement::kExists));
+  }
+  if (record.has(SnapshotElement::kXCSelected)) {
+    element.set_xc_selected(record.bool_value(SnapshotElement::kXCSelected));
+  }
+  if (record.has(SnapshotElement::kXCEnabled)) {
+    element.set_xc_enabled(record.bool_value(SnapshotElement::kXCEnabled));
+  }
+  if (record.has(SnapshotElement::kElementType)) {
+    element.set_element_type(
+        static_cast<ElementTypeProto>(record.element_type));
+  }
+  for (const SnapshotString &class_name :
+       StringList(record.class_names_hierarchy)) {
+    element.add_class_names_hierarchy(string_of(class_name));
+  }
+  if (record.has(SnapshotElement::kBackgroundColor)) {
+    element.set_background_color(ColorToProto(record.background_color));
+  }
+  if (record.has(SnapshotElement::kHidden)) {
+    element.set_hidden(record.bool_value(SnapshotElement::kHidden));
+  }
+  if (record.has(SnapshotElement::kAlpha)) {
+    element.set_alpha(record.alpha);
+  }
+  if (record.has(SnapshotElement::kOpaque)) {
+    element.set_opaque(record.bool_value(SnapshotElement::kOpaque));
+  }
+  if (record.has(SnapshotElement::kTintColor)) {
+    element.set_tint_color(ColorToProto(record.tint_color));
+  }
+  if (record.has(SnapshotElement::kClipsToBounds)) {
+    element.set_clips_to_bounds(
+        record.bool_value(SnapshotElement::kClipsToBounds));
+  }
+  if (record.has(SnapshotElement::kUserInteractionEnabled)) {
+    element.set_user_interaction_enabled(
+        record.bool_value(SnapshotElement::kUserInteractionEnabled));
+  }
+  if (record.has(SnapshotElement::kMultipleTouchEnabled)) {
+    element.set_multiple_touch_enabled(
+        record.bool_value(SnapshotElement::kMultipleTouchEnabled));
+  }
+  if (record.has(SnapshotElement::kExclusiveTouch)) {
+    element.set_exclusive_touch(
+        record.bool_value(SnapshotElement::kExclusiveTouch));
+  }
+  if (record.has(SnapshotElement::kFrame)) {
+    element.set_frame(RectToProto(record.frame));
+  }
+  if (record.has(SnapshotElement::kBounds)) {
+    element.set_bounds(RectToProto(record.bounds));
+  }
+  if (record.has(SnapshotElement::kControlState)) {
+    element.set_control_state(record.control_state);
+  }
+  if (record.has(SnapshotElement::kEnabled)) {
+    element.set_enabled(record.bool_value(SnapshotElement::kEnabled));
+  }
+  if (record.has(SnapshotElement::kSelected)) {
+    element.set_selected(record.bool_value(SnapshotElement::kSelected));
+  }
+  if (record.has(SnapshotElement::kHighlighted)) {
+    element.set_highlighted(record.bool_value(SnapshotElement::kHighlighted));
+  }
+  if (record.has(SnapshotElement::kTitle)) {
+    element.set_title(string_of(record.title));
+  }
+  if (record.has(SnapshotElement::kText)) {
+    element.set_text(string_of(record.text));
+  }
+  if (record.has(SnapshotElement::kOn)) {
+    element.set_on(record.bool_value(SnapshotElement::kOn));
+  }
+  if (record.has(SnapshotElement::kValue)) {
+    element.set_value(record.value);
+  }
+  return element;
+}
+
+CheckResultProto HierarchySnapshot::CheckResult(int index) const {
+  const SnapshotCheckResult &record = results_[index];
+  CheckResultProto result;
+  if (record.has(SnapshotCheckResult::kSourceCheckClass)) {
+    result.set_source_check_class(
+        std::string(String(record.source_check_class)));
+  }
+  if (record.has(SnapshotCheckResult::kResultId)) {
+    result.set_result_id(record.result_id);
+  }
+  if (record.has(SnapshotCheckResult::kHierarchySourceId)) {
+    result.set_hierarchy_source_id(record.hierarchy_source_id);
+  }
+  if (record.has(SnapshotCheckResult::kResultType)) {
+    result.set_result_type(
+        static_cast<gtxilib::oopclasses::protos::ResultType>(
+            record.result_type));
+  }
+  if (!record.has(SnapshotCheckResult::kMetadata)) {
+    return result;
+  }
+  std::map<std::string, TypedValueProto> &metadata_map =
+      *result.mutable_metadata()->mutable_metadata_map();
+  for (const SnapshotMetadataEntry &entry : MetadataEntries(record.metadata)) {
+    TypedValueProto value;
+    if (entry.has_type) {
+      value.set_type(static_cast<TypedValueProto::TypeProto>(entry.type));
+    }
+    switch (entry.value_case) {
+      case TypedValueProto::kBooleanValue:
+        value.set_boolean_value(entry.scalar_value != 0);
+        break;
+      case TypedValueProto::kByteValue:
+        value.set_byte_value(std::string(String(entry.string_value)));
+        break;
+      case TypedValueProto::kShortValue:
+        value.set_short_value(std::string(String(entry.string_value)));
+        break;
+      case TypedValueProto::kCharValue:
+        value.set_char_value(std::string(String(entry.string_value)));
+        break;
+      case TypedValueProto::kIntValue:
+        value.set_int_value(FromBits<int32_t>(entry.scalar_value));
+        break;
+      case TypedValueProto::kFloatValue:
+        value.set_float_value(FromBits<float>(entry.scalar_value));
+        break;
+      case TypedValueProto::kLongValue:
+        value.set_long_value(FromBits<int64_t>(entry.scalar_value));
+        break;
+      case TypedValueProto::kDoubleValue:
+        value.set_double_value(FromBits<double>(entry.scalar_value));
+        break;
+      case TypedValueProto::kStringValue:
+        value.set_string_value(std::string(String(entry.string_value)));
+        break;
+      // The mutable accessors of list values clear them, so lists are built
+      // separately and set at once.
+      case TypedValueProto::kStringListValue: {
+        gtxilib::oopclasses::protos::StringListProto string_list;
+        for (const SnapshotString &string : StringList(entry.list_value)) {
+          string_list.add_values(std::string(String(string)));
+        }
+        value.set_string_list_value(string_list);
+        break;
+      }
+      case TypedValueProto::kIntListValue: {
+        gtxilib::oopclasses::protos::IntListProto int_list;
+        for (int32_t int_value : Int32s(entry.list_value)) {
+          int_list.add_values(int_value);
+        }
+        value.set_int_list_value(int_list);
+        break;
+      }
+      default:
+        break;
+    }
+    metadata_map.emplace(std::string(String(entry.key)), value);
+  }
+  return result;
+}
+
+AccessibilityHierarchyProto HierarchySnapshot::ToHierarchyProto() const {
+  AccessibilityHierarchyProto hierarchy;
+  const SnapshotHeader &header = *header_;
+  if (header.has(SnapshotHeader::kDeviceState)) {
+    DeviceStateProto *device_state = hierarchy.mutable_device_state();
+    if (header.has(SnapshotHeader::kDisplayMetrics)) {
+      DisplayMetricsProto *metrics = device_state->mutable_display_metrics();
+      if (header.has(SnapshotHeader::kScreenWidth)) {
+        metrics->set_screen_width(header.screen_width);
+      }
+      if (header.has(SnapshotHeader::kScreenHeight)) {
+        metrics->set_screen_height(header.screen_height);
+      }
+      if (header.has(SnapshotHeader::kScreenScale)) {
+        metrics->set_screen_scale(header.screen_scale);
+      }
+    }
+    if (header.has(SnapshotHeader::kIOSVersion)) {
+      device_state->set_ios_version(std::string(String(header.ios_version)));
+    }
+  }
+  for (int i = 0; i < static_cast<int>(elements_.size()); i++) {
+    *hierarchy.add_elements() = ElementProto(i);
+  }
+  return hierarchy;
+}
+
+AccessibilityEvaluationProto HierarchySnapshot::ToEvaluationProto() const {
+  AccessibilityEvaluationProto evaluation;
+  if (header_->has(SnapshotHeader::kHierarchy)) {
+    evaluation.set_hierarchy(ToHierarchyProto());
+  }
+  for (int i = 0; i < static_cast<int>(results_.size()); i++) {
+    *evaluation.add_results() = CheckResult(i);
+  }
+  return evaluation;
+}
+
+}  // namespace gtx
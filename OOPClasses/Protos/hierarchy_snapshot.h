@@ -0,0 +1,281 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_PROTOS_HIERARCHY_SNAPSHOT_H_
+#define GTXILIB_OOPCLASSES_PROTOS_HIERARCHY_SNAPSHOT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <abseil/absl/strings/string_view.h>
+#include <abseil/absl/types/optional.h>
+#include <abseil/absl/types/span.h>
+#include "typedefs.h"
+
+namespace gtx {
+
+// A hierarchy snapshot is a flat, offset-based encoding of an
+// AccessibilityEvaluationProto that can be read in place, for example from a
+// memory mapped file, without parsing or allocating. A snapshot consists of a
+// SnapshotHeader followed by the sections it points to:
+//
+//   SnapshotElement[element_count]
+//   SnapshotCheckResult[result_count]
+//   SnapshotMetadataEntry[metadata_entry_count]
+//   SnapshotString[string_list_count]  (class names and string list values)
+//   int32_t[int32_count]               (child ids and int list values)
+//   char[string_bytes]                 (the contents of all strings)
+//
+// Records refer to each other by index and to strings by offset, so sections
+// can be accessed directly. All values are stored in the byte order of the
+// host, which is little-endian on every platform GTXiLib supports.
+
+// A string stored in the string section of a snapshot.
+struct SnapshotString {
+  uint32_t offset;
+  uint32_t size;
+};
+
+// A range of records in one of the list sections of a snapshot.
+struct SnapshotRange {
+  uint32_t begin;
+  uint32_t count;
+};
+
+struct SnapshotRect {
+  float x, y, width, height;
+};
+
+struct SnapshotColor {
+  float r, g, b, a;
+};
+
+// A UIElementProto. Fields that are not set have zero values.
+struct alignas(8) SnapshotElement {
+  // Bit positions of fields in present and of boolean fields in bool_values.
+  enum Field : int {
+    kId = 0,
+    kParentId,
+    kChildIds,
+    kIsAXElement,
+    kAXTraits,
+    kAXLabel,
+    kAXHint,
+    kAXFrame,
+    kAXIdentifier,
+    kHittable,
+    kExists,
+    kXCSelected,
+    kXCEnabled,
+    kElementType,
+    kClassNamesHierarchy,
+    kBackgroundColor,
+    kHidden,
+    kAlpha,
+    kOpaque,
+    kTintColor,
+    kClipsToBounds,
+    kUserInteractionEnabled,
+    kMultipleTouchEnabled,
+    kExclusiveTouch,
+    kFrame,
+    kBounds,
+    kControlState,
+    kEnabled,
+    kSelected,
+    kHighlighted,
+    kTitle,
+    kText,
+    kOn,
+    kValue,
+  };
+
+  // Returns true if @c field is set.
+  bool has(Field field) const { return (present >> field) & 1; }
+
+  // Returns the value of the boolean field @c field.
+  bool bool_value(Field field) const { return (bool_values >> field) & 1; }
+
+  uint64_t present;
+  uint64_t bool_values;
+  uint64_t ax_traits;
+  uint64_t control_state;
+  int32_t id;
+  int32_t parent_id;
+  int32_t element_type;
+  float alpha;
+  float value;
+  SnapshotRange child_ids;
+  SnapshotRange class_names_hierarchy;
+  SnapshotString ax_label;
+  SnapshotString ax_hint;
+  SnapshotString ax_identifier;
+  SnapshotString title;
+  SnapshotString text;
+  SnapshotRect ax_frame;
+  SnapshotRect frame;
+  SnapshotRect bounds;
+  SnapshotColor background_color;
+  SnapshotColor tint_color;
+};
+
+// A CheckResultProto. Fields that are not set have zero values.
+struct alignas(8) SnapshotCheckResult {
+  // Bit positions of fields in present.
+  enum Field : int {
+    kSourceCheckClass = 0,
+    kResultId,
+    kHierarchySourceId,
+    kResultType,
+    kMetadata,
+  };
+
+  // Returns true if @c field is set.
+  bool has(Field field) const { return (present >> field) & 1; }
+
+  uint32_t present;
+  int32_t result_id;
+  int64_t hierarchy_source_id;
+  int32_t result_type;
+  SnapshotString source_check_class;
+  SnapshotRange metadata;
+};
+
+// An entry of the metadata map of a CheckResultProto.
+struct alignas(8) SnapshotMetadataEntry {
+  SnapshotString key;
+  // True if the value's type is set.
+  uint32_t has_type;
+  int32_t type;
+  // The TypedValueProto::ValueCase of the value.
+  int32_t value_case;
+  // The bits of boolean, int, float, long and double values, zero extended.
+  uint64_t scalar_value;
+  // The value of byte, short, char and string values.
+  SnapshotString string_value;
+  // The values of string list values, in the string list section, or int list
+  // values, in the int32 section.
+  SnapshotRange list_value;
+};
+
+// The first bytes of a snapshot.
+struct alignas(8) SnapshotHeader {
+  // Bit positions of fields in present.
+  enum Field : int {
+    kHierarchy = 0,
+    kDeviceState,
+    kDisplayMetrics,
+    kScreenWidth,
+    kScreenHeight,
+    kScreenScale,
+    kIOSVersion,
+  };
+
+  // Returns true if @c field is set.
+  bool has(Field field) const { return (present >> field) & 1; }
+
+  char magic[4];
+  uint32_t version;
+  uint32_t present;
+  int32_t screen_width;
+  int32_t screen_height;
+  float screen_scale;
+  SnapshotString ios_version;
+  uint32_t element_count;
+  uint32_t result_count;
+  uint32_t metadata_entry_count;
+  uint32_t string_list_count;
+  uint32_t int32_count;
+  uint32_t string_bytes;
+  uint64_t elements_offset;
+  uint64_t results_offset;
+  uint64_t metadata_entries_offset;
+  uint64_t string_lists_offset;
+  uint64_t int32s_offset;
+  uint64_t strings_offset;
+};
+
+// Encodes @c evaluation as a snapshot.
+std::string SnapshotFromEvaluation(
+    const AccessibilityEvaluationProto &evaluation);
+
+// Encodes @c hierarchy as a snapshot of an evaluation without results.
+std::string SnapshotFromHierarchy(const AccessibilityHierarchyProto &hierarchy);
+
+// A read-only view of a snapshot. HierarchySnapshot does not own the bytes of
+// the snapshot, which must outlive it and all views returned by it.
+class HierarchySnapshot {
+ public:
+  // Returns a view of the snapshot in the @c size bytes at @c data, or
+  // absl::nullopt if they are not a valid snapshot. @c data must be aligned to
+  // 8 bytes, which is always the case for memory mapped files. Validation
+  // checks that all offsets and ranges are in bounds in a single pass over the
+  // records and does not allocate.
+  static absl::optional<HierarchySnapshot> FromBuffer(const void *data,
+                                                      size_t size);
+
+  const SnapshotHeader &header() const { return *header_; }
+
+  absl::Span<const SnapshotElement> elements() const { return elements_; }
+  absl::Span<const SnapshotCheckResult> results() const { return results_; }
+
+  // Returns the contents of @c string. The returned view points into the
+  // snapshot.
+  absl::string_view String(const SnapshotString &string) const {
+    return strings_.substr(string.offset, string.size);
+  }
+
+  // Returns the records in @c range of the corresponding section.
+  absl::Span<const SnapshotString> StringList(
+      const SnapshotRange &range) const {
+    return string_lists_.subspan(range.begin, range.count);
+  }
+  absl::Span<const int32_t> Int32s(const SnapshotRange &range) const {
+    return int32s_.subspan(range.begin, range.count);
+  }
+  absl::Span<const SnapshotMetadataEntry> MetadataEntries(
+      const SnapshotRange &range) const {
+    return metadata_entries_.subspan(range.begin, range.count);
+  }
+
+  // Converters to the protos the snapshot was created from. Nested messages
+  // such as frames and colors are restored with all of their fields set.
+  UIElementProto ElementProto(int index) const;
+  CheckResultProto CheckResult(int index) const;
+  AccessibilityHierarchyProto ToHierarchyProto() const;
+  AccessibilityEvaluationProto ToEvaluationProto() const;
+
+ private:
+  HierarchySnapshot() {}
+
+  // Returns true if all references of the records in this snapshot are in
+  // bounds.
+  bool ValidateReferences() const;
+
+  const SnapshotHeader *header_ = nullptr;
+  absl::Span<const SnapshotElement> elements_;
+  absl::Span<const SnapshotCheckResult> results_;
+  absl::Span<const SnapshotMetadataEntry> metadata_entries_;
+  absl::Span<const SnapshotString> string_lists_;
+  absl::Span<const int32_t> int32s_;
+  absl::string_view strings_;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_PROTOS_HIERARCHY_SNAPSHOT_H_
@@ -0,0 +1,438 @@
+#include <map>
+#include <string>
+#include <stdlib.h>
+#include <vector>
+
+#include "metrics.pb.h"
+namespace gtxilib {
+namespace oopclasses {
+namespace protos {
+
+
+std::string CheckMetrics::check_name() const {
+  return check_name_;
+}
+bool CheckMetrics::has_check_name() const {
+  return has_check_name_;
+}
+void CheckMetrics::clear_check_name() {
+  check_name_ = std::string();
+  has_check_name_ = false;
+}
+void CheckMetrics::set_check_name(std::string new_check_name) {
+  check_name_ = new_check_name;
+  has_check_name_ = true;
+}
+std::string* CheckMetrics::mutable_check_name() {
+  has_check_name_ = true;
+  return &check_name_;
+}
+
+uint64_t CheckMetrics::invocations() const {
+  return invocations_;
+}
+bool CheckMetrics::has_invocations() const {
+  return has_invocations_;
+}
+void CheckMetrics::clear_invocations() {
+  invocations_ = uint64_t();
+  has_invocations_ = false;
+}
+void CheckMetrics::set_invocations(uint64_t new_invocations) {
+  invocations_ = new_invocations;
+  has_invocations_ = true;
+}
+uint64_t* CheckMetrics::mutable_invocations() {
+  has_invocations_ = true;
+  return &invocations_;
+}
+
+uint64_t CheckMetrics::skips() const {
+  return skips_;
+}
+bool CheckMetrics::has_skips() const {
+  return has_skips_;
+}
+void CheckMetrics::clear_skips() {
+  skips_ = uint64_t();
+  has_skips_ = false;
+}
+void CheckMetrics::set_skips(uint64_t new_skips) {
+  skips_ = new_skips;
+  has_skips_ = true;
+}
+uint64_t* CheckMetrics::mutable_skips() {
+  has_skips_ = true;
+  return &skips_;
+}
+
+uint64_t CheckMetrics::failures() const {
+  return failures_;
+}
+bool CheckMetrics::has_failures() const {
+  return has_failures_;
+}
+void CheckMetrics::clear_failures() {
+  failures_ = uint64_t();
+  has_failures_ = false;
+}
+void CheckMetrics::set_failures(uint64_t new_failures) {
+  failures_ = new_failures;
+  has_failures_ = true;
+}
+uint64_t* CheckMetrics::mutable_failures() {
+  has_failures_ = true;
+  return &failures_;
+}
+
+uint64_t CheckMetrics::total_nanoseconds() const {
+  return total_nanoseconds_;
+}
+bool CheckMetrics::has_total_nanoseconds() const {
+  return has_total_nanoseconds_;
+}
+void CheckMetrics::clear_total_nanoseconds() {
+  total_nanoseconds_ = uint64_t();
+  has_total_nanoseconds_ = false;
+}
+void CheckMetrics::set_total_nanoseconds(uint64_t new_total_nanoseconds) {
+  total_nanoseconds_ = new_total_nanoseconds;
+  has_total_nanoseconds_ = true;
+}
+uint64_t* CheckMetrics::mutable_total_nanoseconds() {
+  has_total_nanoseconds_ = true;
+  return &total_nanoseconds_;
+}
+
+uint64_t CheckMetrics::max_nanoseconds() const {
+  return max_nanoseconds_;
+}
+bool CheckMetrics::has_max_nanoseconds() const {
+  return has_max_nanoseconds_;
+}
+void CheckMetrics::clear_max_nanoseconds() {
+  max_nanoseconds_ = uint64_t();
+  has_max_nanoseconds_ = false;
+}
+void CheckMetrics::set_max_nanoseconds(uint64_t new_max_nanoseconds) {
+  max_nanoseconds_ = new_max_nanoseconds;
+  has_max_nanoseconds_ = true;
+}
+uint64_t* CheckMetrics::mutable_max_nanoseconds() {
+  has_max_nanoseconds_ = true;
+  return &max_nanoseconds_;
+}
+
+uint64_t CheckMetrics::latency_histogram(int index) const {
+  return latency_histogram_[index];
+}
+const std::vector<uint64_t>& CheckMetrics::latency_histogram() const {
+  return latency_histogram_;
+}
+bool CheckMetrics::has_latency_histogram() const {
+  return has_latency_histogram_;
+}
+void CheckMetrics::clear_latency_histogram() {
+  latency_histogram_.clear();
+  has_latency_histogram_ = false;
+}
+void CheckMetrics::set_latency_histogram(int index, uint64_t new_latency_histogram) {
+  latency_histogram_[index] = new_latency_histogram;
+  has_latency_histogram_ = true;
+}
+uint64_t* CheckMetrics::mutable_latency_histogram(int index) {
+  has_latency_histogram_ = true;
+  return &latency_histogram_[index];
+}
+void CheckMetrics::add_latency_histogram(uint64_t new_latency_histogram) {
+  latency_histogram_.push_back(new_latency_histogram);
+  has_latency_histogram_ = true;
+}
+int CheckMetrics::latency_histogram_size() const {
+  return latency_histogram_.size();
+}
+
+uint64_t CheckMetrics::allocations() const {
+  return allocations_;
+}
+bool CheckMetrics::has_allocations() const {
+  return has_allocations_;
+}
+void CheckMetrics::clear_allocations() {
+  allocations_ = uint64_t();
+  has_allocations_ = false;
+}
+void CheckMetrics::set_allocations(uint64_t new_allocations) {
+  allocations_ = new_allocations;
+  has_allocations_ = true;
+}
+uint64_t* CheckMetrics::mutable_allocations() {
+  has_allocations_ = true;
+  return &allocations_;
+}
+
+uint64_t CheckMetrics::allocated_bytes() const {
+  return allocated_bytes_;
+}
+bool CheckMetrics::has_allocated_bytes() const {
+  return has_allocated_bytes_;
+}
+void CheckMetrics::clear_allocated_bytes() {
+  allocated_bytes_ = uint64_t();
+  has_allocated_bytes_ = false;
+}
+void CheckMetrics::set_allocated_bytes(uint64_t new_allocated_bytes) {
+  allocated_bytes_ = new_allocated_bytes;
+  has_allocated_bytes_ = true;
+}
+uint64_t* CheckMetrics::mutable_allocated_bytes() {
+  has_allocated_bytes_ = true;
+  return &allocated_bytes_;
+}
+
+uint64_t CheckMetrics::max_peak_bytes() const {
+  return max_peak_bytes_;
+}
+bool CheckMetrics::has_max_peak_bytes() const {
+  return has_max_peak_bytes_;
+}
+void CheckMetrics::clear_max_peak_bytes() {
+  max_peak_bytes_ = uint64_t();
+  has_max_peak_bytes_ = false;
+}
+void CheckMetrics::set_max_peak_bytes(uint64_t new_max_peak_bytes) {
+  max_peak_bytes_ = new_max_peak_bytes;
+  has_max_peak_bytes_ = true;
+}
+uint64_t* CheckMetrics::mutable_max_peak_bytes() {
+  has_max_peak_bytes_ = true;
+  return &max_peak_bytes_;
+}
+
+
+std::string PhaseMetrics::phase() const {
+  return phase_;
+}
+bool PhaseMetrics::has_phase() const {
+  return has_phase_;
+}
+void PhaseMetrics::clear_phase() {
+  phase_ = std::string();
+  has_phase_ = false;
+}
+void PhaseMetrics::set_phase(std::string new_phase) {
+  phase_ = new_phase;
+  has_phase_ = true;
+}
+std::string* PhaseMetrics::mutable_phase() {
+  has_phase_ = true;
+  return &phase_;
+}
+
+uint64_t PhaseMetrics::count() const {
+  return count_;
+}
+bool PhaseMetrics::has_count() const {
+  return has_count_;
+}
+void PhaseMetrics::clear_count() {
+  count_ = uint64_t();
+  has_count_ = false;
+}
+void PhaseMetrics::set_count(uint64_t new_count) {
+  count_ = new_count;
+  has_count_ = true;
+}
+uint64_t* PhaseMetrics::mutable_count() {
+  has_count_ = true;
+  return &count_;
+}
+
+uint64_t PhaseMetrics::total_nanoseconds() const {
+  return total_nanoseconds_;
+}
+bool PhaseMetrics::has_total_nanoseconds() const {
+  return has_total_nanoseconds_;
+}
+void PhaseMetrics::clear_total_nanoseconds() {
+  total_nanoseconds_ = uint64_t();
+  has_total_nanoseconds_ = false;
+}
+void PhaseMetrics::set_total_nanoseconds(uint64_t new_total_nanoseconds) {
+  total_nanoseconds_ = new_total_nanoseconds;
+  has_total_nanoseconds_ = true;
+}
+uint64_t* PhaseMetrics::mutable_total_nanoseconds() {
+  has_total_nanoseconds_ = true;
+  return &total_nanoseconds_;
+}
+
+uint64_t PhaseMetrics::max_nanoseconds() const {
+  return max_nanoseconds_;
+}
+bool PhaseMetrics::has_max_nanoseconds() const {
+  return has_max_nanoseconds_;
+}
+void PhaseMetrics::clear_max_nanoseconds() {
+  max_nanoseconds_ = uint64_t();
+  has_max_nanoseconds_ = false;
+}
+void PhaseMetrics::set_max_nanoseconds(uint64_t new_max_nanoseconds) {
+  max_nanoseconds_ = new_max_nanoseconds;
+  has_max_nanoseconds_ = true;
+}
+uint64_t* PhaseMetrics::mutable_max_nanoseconds() {
+  has_max_nanoseconds_ = true;
+  return &max_nanoseconds_;
+}
+
+uint64_t PhaseMetrics::allocations() const {
+  return allocations_;
+}
+bool PhaseMetrics::has_allocations() const {
+  return has_allocations_;
+}
+void PhaseMetrics::clear_allocations() {
+  allocations_ = uint64_t();
+  has_allocations_ = false;
+}
+void PhaseMetrics::set_allocations(uint64_t new_allocations) {
+  allocations_ = new_allocations;
+  has_allocations_ = true;
+}
+uint64_t* PhaseMetrics::mutable_allocations() {
+  has_allocations_ = true;
+  return &allocations_;
+}
+
+uint64_t PhaseMetrics::allocated_bytes() const {
+  return allocated_bytes_;
+}
+bool PhaseMetrics::has_allocated_bytes() const {
+  return has_allocated_bytes_;
+}
+void PhaseMetrics::clear_allocated_bytes() {
+  allocated_bytes_ = uint64_t();
+  has_allocated_bytes_ = false;
+}
+void PhaseMetrics::set_allocated_bytes(uint64_t new_allocated_bytes) {
+  allocated_bytes_ = new_allocated_bytes;
+  has_allocated_bytes_ = true;
+}
+uint64_t* PhaseMetrics::mutable_allocated_bytes() {
+  has_allocated_bytes_ = true;
+  return &allocated_bytes_;
+}
+
+uint64_t PhaseMetrics::max_peak_bytes() const {
+  return max_peak_bytes_;
+}
+bool PhaseMetrics::has_max_peak_bytes() const {
+  return has_max_peak_bytes_;
+}
+void PhaseMetrics::clear_max_peak_bytes() {
+  max_peak_bytes_ = uint64_t();
+  has_max_peak_bytes_ = false;
+}
+void PhaseMetrics::set_max_peak_bytes(uint64_t new_max_peak_bytes) {
+  max_peak_bytes_ = new_max_peak_bytes;
+  has_max_peak_bytes_ = true;
+}
+uint64_t* PhaseMetrics::mutable_max_peak_bytes() {
+  has_max_peak_bytes_ = true;
+  return &max_peak_bytes_;
+}
+
+
+const CheckMetrics& EvaluationMetrics::checks(int index) const {
+  return checks_[index];
+}
+const std::vector<CheckMetrics>& EvaluationMetrics::checks() const {
+  return checks_;
+}
+bool EvaluationMetrics::has_checks() const {
+  return has_checks_;
+}
+void EvaluationMetrics::clear_checks() {
+  checks_.clear();
+  has_checks_ = false;
+}
+void EvaluationMetrics::set_checks(int index, const CheckMetrics& new_checks) {
+  checks_[index] = new_checks;
+  has_checks_ = true;
+}
+CheckMetrics* EvaluationMetrics::mutable_checks(int index) {
+  has_checks_ = true;
+  return &checks_[index];
+}
+CheckMetrics* EvaluationMetrics::add_checks() {
+  checks_.emplace_back();
+  has_checks_ = true;
+  return &checks_.back();
+}
+int EvaluationMetrics::checks_size() const {
+  return checks_.size();
+}
+
+const PhaseMetrics& EvaluationMetrics::phases(int index) const {
+  return phases_[index];
+}
+const std::vector<PhaseMetrics>& EvaluationMetrics::phases() const {
+  return phases_;
+}
+bool EvaluationMetrics::has_phases() const {
+  return has_phases_;
+}
+void EvaluationMetrics::clear_phases() {
+  phases_.clear();
+  has_phases_ = false;
+}
+void EvaluationMetrics::set_phases(int index, const PhaseMetrics& new_phases) {
+  phases_[index] = new_phases;
+  has_phases_ = true;
+}
+PhaseMetrics* EvaluationMetrics::mutable_phases(int index) {
+  has_phases_ = true;
+  return &phases_[index];
+}
+PhaseMetrics* EvaluationMetrics::add_phases() {
+  phases_.emplace_back();
+  has_phases_ = true;
+  return &phases_.back();
+}
+int EvaluationMetrics::phases_size() const {
+  return phases_.size();
+}
+
+uint64_t EvaluationMetrics::latency_bucket_bounds_nanoseconds(int index) const {
+  return latency_bucket_bounds_nanoseconds_[index];
+}
+const std::vector<uint64_t>& EvaluationMetrics::latency_bucket_bounds_nanoseconds() const {
+  return latency_bucket_bounds_nanoseconds_;
+}
+bool EvaluationMetrics::has_latency_bucket_bounds_nanoseconds() const {
+  return has_latency_bucket_bounds_nanoseconds_;
+}
+void EvaluationMetrics::clear_latency_bucket_bounds_nanoseconds() {
+  latency_bucket_bounds_nanoseconds_.clear();
+  has_latency_bucket_bounds_nanoseconds_ = false;
+}
+void EvaluationMetrics::set_latency_bucket_bounds_nanoseconds(int index, uint64_t new_latency_bucket_bounds_nanoseconds) {
+  latency_bucket_bounds_nanoseconds_[index] = new_latency_bucket_bounds_nanoseconds;
+  has_latency_bucket_bounds_nanoseconds_ = true;
+}
+uint64_t* EvaluationMetrics::mutable_latency_bucket_bounds_nanoseconds(int index) {
+  has_latency_bucket_bounds_nanoseconds_ = true;
+  return &latency_bucket_bounds_nanoseconds_[index];
+}
+void EvaluationMetrics::add_latency_bucket_bounds_nanoseconds(uint64_t new_latency_bucket_bounds_nanoseconds) {
+  latency_bucket_bounds_nanoseconds_.push_back(new_latency_bucket_bounds_nanoseconds);
+  has_latency_bucket_bounds_nanoseconds_ = true;
+}
+int EvaluationMetrics::latency_bucket_bounds_nanoseconds_size() const {
+  return latency_bucket_bounds_nanoseconds_.size();
+}
+
+}  // GTXiLib
+}  // OOPClasses
+}  // Protos
@@ -0,0 +1,217 @@
+#ifndef THIRD_PARTY_OBJECTIVE_C_GTXILIB_OOPCLASSES_PROTOS_METRICS_PB_H
+#define THIRD_PARTY_OBJECTIVE_C_GTXILIB_OOPCLASSES_PROTOS_METRICS_PB_H
+
+#include <map>
+#include <string>
+#include <stdlib.h>
+#include <vector>
+
+namespace gtxilib {
+namespace oopclasses {
+namespace protos {
+
+
+
+class CheckMetrics {
+
+public:
+
+
+  std::string check_name() const;
+  bool has_check_name() const;
+  void clear_check_name();
+  void set_check_name(std::string new_check_name);
+  std::string* mutable_check_name();
+
+  uint64_t invocations() const;
+  bool has_invocations() const;
+  void clear_invocations();
+  void set_invocations(uint64_t new_invocations);
+  uint64_t* mutable_invocations();
+
+  uint64_t skips() const;
+  bool has_skips() const;
+  void clear_skips();
+  void set_skips(uint64_t new_skips);
+  uint64_t* mutable_skips();
+
+  uint64_t failures() const;
+  bool has_failures() const;
+  void clear_failures();
+  void set_failures(uint64_t new_failures);
+  uint64_t* mutable_failures();
+
+  uint64_t total_nanoseconds() const;
+  bool has_total_nanoseconds() const;
+  void clear_total_nanoseconds();
+  void set_total_nanoseconds(uint64_t new_total_nanoseconds);
+  uint64_t* mutable_total_nanoseconds();
+
+  uint64_t max_nanoseconds() const;
+  bool has_max_nanoseconds() const;
+  void clear_max_nanoseconds();
+  void set_max_nanoseconds(uint64_t new_max_nanoseconds);
+  uint64_t* mutable_max_nanoseconds();
+
+  uint64_t latency_histogram(int index) const;
+  const std::vector<uint64_t>& latency_histogram() const;
+  bool has_latency_histogram() const;
+  void clear_latency_histogram();
+  void set_latency_histogram(int index, uint64_t new_latency_histogram);
+  uint64_t* mutable_latency_histogram(int index);
+  void add_latency_histogram(uint64_t new_latency_histogram);
+  int latency_histogram_size() const;
+
+  uint64_t allocations() const;
+  bool has_allocations() const;
+  void clear_allocations();
+  void set_allocations(uint64_t new_allocations);
+  uint64_t* mutable_allocations();
+
+  uint64_t allocated_bytes() const;
+  bool has_allocated_bytes() const;
+  void clear_allocated_bytes();
+  void set_allocated_bytes(uint64_t new_allocated_bytes);
+  uint64_t* mutable_allocated_bytes();
+
+  uint64_t max_peak_bytes() const;
+  bool has_max_peak_bytes() const;
+  void clear_max_peak_bytes();
+  void set_max_peak_bytes(uint64_t new_max_peak_bytes);
+  uint64_t* mutable_max_peak_bytes();
+
+private:
+  std::string check_name_ = std::string();
+  bool has_check_name_ = false;
+  uint64_t invocations_ = uint64_t();
+  bool has_invocations_ = false;
+  uint64_t skips_ = uint64_t();
+  bool has_skips_ = false;
+  uint64_t failures_ = uint64_t();
+  bool has_failures_ = false;
+  uint64_t total_nanoseconds_ = uint64_t();
+  bool has_total_nanoseconds_ = false;
+  uint64_t max_nanoseconds_ = uint64_t();
+  bool has_max_nanoseconds_ = false;
+  std::vector<uint64_t> latency_histogram_ = std::vector<uint64_t>();
+  bool has_latency_histogram_ = false;
+  uint64_t allocations_ = uint64_t();
+  bool has_allocations_ = false;
+  uint64_t allocated_bytes_ = uint64_t();
+  bool has_allocated_bytes_ = false;
+  uint64_t max_peak_bytes_ = uint64_t();
+  bool has_max_peak_bytes_ = false;
+};
+
+
+class PhaseMetrics {
+
+public:
+
+
+  std::string phase() const;
+  bool has_phase() const;
+  void clear_phase();
+  void set_phase(std::string new_phase);
+  std::string* mutable_phase();
+
+  uint64_t count() const;
+  bool has_count() const;
+  void clear_count();
+  void set_count(uint64_t new_count);
+  uint64_t* mutable_count();
+
+  uint64_t total_nanoseconds() const;
+  bool has_total_nanoseconds() const;
+  void clear_total_nanoseconds();
+  void set_total_nanoseconds(uint64_t new_total_nanoseconds);
+  uint64_t* mutable_total_nanoseconds();
+
+  uint64_t max_nanoseconds() const;
+  bool has_max_nanoseconds() const;
+  void clear_max_nanoseconds();
+  void set_max_nanoseconds(uint64_t new_max_nanoseconds);
+  uint64_t* mutable_max_nanoseconds();
+
+  uint64_t allocations() const;
+  bool has_allocations() const;
+  void clear_allocations();
+  void set_allocations(uint64_t new_allocations);
+  uint64_t* mutable_allocations();
+
+  uint64_t allocated_bytes() const;
+  bool has_allocated_bytes() const;
+  void clear_allocated_bytes();
+  void set_allocated_bytes(uint64_t new_allocated_bytes);
+  uint64_t* mutable_allocated_bytes();
+
+  uint64_t max_peak_bytes() const;
+  bool has_max_peak_bytes() const;
+  void clear_max_peak_bytes();
+  void set_max_peak_bytes(uint64_t new_max_peak_bytes);
+  uint64_t* mutable_max_peak_bytes();
+
+private:
+  std::string phase_ = std::string();
+  bool has_phase_ = false;
+  uint64_t count_ = uint64_t();
+  bool has_count_ = false;
+  uint64_t total_nanoseconds_ = uint64_t();
+  bool has_total_nanoseconds_ = false;
+  uint64_t max_nanoseconds_ = uint64_t();
+  bool has_max_nanoseconds_ = false;
+  uint64_t allocations_ = uint64_t();
+  bool has_allocations_ = false;
+  uint64_t allocated_bytes_ = uint64_t();
+  bool has_allocated_bytes_ = false;
+  uint64_t max_peak_bytes_ = uint64_t();
+  bool has_max_peak_bytes_ = false;
+};
+
+
+class EvaluationMetrics {
+
+public:
+
+
+  const CheckMetrics& checks(int index) const;
+  const std::vector<CheckMetrics>& checks() const;
+  bool has_checks() const;
+  void clear_checks();
+  void set_checks(int index, const CheckMetrics& new_checks);
+  CheckMetrics* mutable_checks(int index);
+  CheckMetrics* add_checks();
+  int checks_size() const;
+
+  const PhaseMetrics& phases(int index) const;
+  const std::vector<PhaseMetrics>& phases() const;
+  bool has_phases() const;
+  void clear_phases();
+  void set_phases(int index, const PhaseMetrics& new_phases);
+  PhaseMetrics* mutable_phases(int index);
+  PhaseMetrics* add_phases();
+  int phases_size() const;
+
+  uint64_t latency_bucket_bounds_nanoseconds(int index) const;
+  const std::vector<uint64_t>& latency_bucket_bounds_nanoseconds() const;
+  bool has_latency_bucket_bounds_nanoseconds() const;
+  void clear_latency_bucket_bounds_nanoseconds();
+  void set_latency_bucket_bounds_nanoseconds(int index, uint64_t new_latency_bucket_bounds_nanoseconds);
+  uint64_t* mutable_latency_bucket_bounds_nanoseconds(int index);
+  void add_latency_bucket_bounds_nanoseconds(uint64_t new_latency_bucket_bounds_nanoseconds);
+  int latency_bucket_bounds_nanoseconds_size() const;
+
+private:
+  std::vector<CheckMetrics> checks_ = std::vector<CheckMetrics>();
+  bool has_checks_ = false;
+  std::vector<PhaseMetrics> phases_ = std::vector<PhaseMetrics>();
+  bool has_phases_ = false;
+  std::vector<uint64_t> latency_bucket_bounds_nanoseconds_ = std::vector<uint64_t>();
+  bool has_latency_bucket_bounds_nanoseconds_ = false;
+};
+
+}  // GTXiLib
+}  // OOPClasses
+}  // Protos
+
+#endif
@@ -0,0 +1,1226 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "proto_serialization.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <abseil/absl/strings/string_view.h>
+#include "typedefs.h"
+
+namespace gtx {
+
+namespace {
+
+using gtxilib::oopclasses::protos::IntListProto;
+using gtxilib::oopclasses::protos::ResultType;
+using gtxilib::oopclasses::protos::StringListProto;
+using gtxilib::oopclasses::protos::TypedValueProto_TypeProto;
+
+// Wire types of the protocol buffer encoding.
+enum WireType : int {
+  kVarint = 0,
+  kFixed64 = 1,
+  kLengthDelimited = 2,
+  kStartGroup = 3,
+  kEndGroup = 4,
+  kFixed32 = 5,
+};
+
+// The maximum nesting depth of messages the parser accepts.
+constexpr int kMaxNestingDepth = 64;
+
+#pragma mark - Serialization
+
+void AppendTag(int field, WireType wire_type, std::string *output) {
+  AppendVarint((static_cast<uint64_t>(field) << 3) | wire_type, output);
+}
+
+void AppendVarintField(int field, uint64_t value, std::string *output) {
+  AppendTag(field, kVarint, output);
+  AppendVarint(value, output);
+}
+
+// Negative int32 values are sign extended to 64 bits, as protobuf does.
+void AppendInt32Field(int field, int32_t value, std::string *output) {
+  AppendVarintField(field, static_cast<uint64_t>(static_cast<int64_t>(value)),
+                    output);
+}
+
+void AppendFixed32Field(int field, uint32_t value, std::string *output) {
+  AppendTag(field, kFixed32, output);
+  for (int i = 0; i < 4; i++) {
+    output->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+void AppendFixed64Field(int field, uint64_t value, std::string *output) {
+  AppendTag(field, kFixed64, output);
+  for (int i = 0; i < 8; i++) {
+    output->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+void AppendFloatField(int field, float value, std::string *output) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  AppendFixed32Field(field, bits, output);
+}
+
+void AppendDoubleField(int field, double value, std::string *output) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  AppendFixed64Field(field, bits, output);
+}
+
+void AppendBytesField(int field, absl::string_view value,
+                      std::string *output) {
+  AppendTag(field, kLengthDelimited, output);
+  AppendVarint(value.size(), output);
+  output->append(value.data(), value.size());
+}
+
+void AppendMessage(const PointProto &point, std::string *output) {
+  if (point.has_x()) AppendFloatField(1, point.x(), output);
+  if (point.has_y()) AppendFloatField(2, point.y(), output);
+}
+
+void AppendMessage(const SizeProto &size, std::string *output) {
+  if (size.has_width()) AppendFloatField(1, size.width(), output);
+  if (size.has_height()) AppendFloatField(2, size.height(), output);
+}
+
+template <typename Message>
+void AppendMessageField(int field, const Message &message,
+                        std::string *output);
+
+void AppendMessage(const RectProto &rect, std::string *output) {
+  if (rect.has_origin()) AppendMessageField(1, rect.origin(), output);
+  if (rect.has_size()) AppendMessageField(2, rect.size(), output);
+}
+
+void AppendMessage(const ColorProto &color, std::string *output) {
+  if (color.has_r()) AppendFloatField(1, color.r(), output);
+  if (color.has_g()) AppendFloatField(2, color.g(), output);
+  if (color.has_b()) AppendFloatField(3, color.b(), output);
+  if (color.has_a()) AppendFloatField(4, color.a(), output);
+}
+
+void AppendMessage(const DisplayMetricsProto &metrics, std::string *output) {
+  if (metrics.has_screen_width()) {
+    AppendInt32Field(1, metrics.screen_width(), output);
+  }
+  if (metrics.has_screen_height()) {
+    AppendInt32Field(2, metrics.screen_height(), output);
+  }
+  if (metrics.has_screen_scale()) {
+    AppendFloatField(3, metrics.screen_scale(), output);
+  }
+}
+
+void AppendMessage(const DeviceStateProto &device_state,
+                   std::string *output) {
+  if (device_state.has_display_metrics()) {
+    AppendMessageField(1, device_state.display_metrics(), output);
+  }
+  if (device_state.has_ios_version()) {
+    AppendBytesField(2, device_state.ios_version(), output);
+  }
+}
+
+// Appends the packed encoding of @c values as field @c field.
+void AppendPackedInt32sField(int field, const std::vector<int32_t> &values,
+                             std::string *output) {
+  std::string packed;
+  for (int32_t value : values) {
+    AppendVarint(static_cast<uint64_t>(static_cast<int64_t>(value)), &packed);
+  }
+  AppendBytesField(field, packed, output);
+}
+
+void AppendMessage(const UIElementProto &element, std::string *output) {
+  if (element.has_id()) AppendInt32Field(1, element.id(), output);
+  if (element.has_parent_id()) {
+    AppendInt32Field(2, element.parent_id(), output);
+  }
+  if (element.child_ids_size() > 0) {
+    AppendPackedInt32sField(3, element.child_ids(), output);
+  }
+  if (element.has_is_ax_element()) {
+    AppendVarintField(4, element.is_ax_element(), output);
+  }
+  if (element.has_ax_traits()) {
+    AppendVarintField(5, element.ax_traits(), output);
+  }
+  if (element.has_ax_label()) AppendBytesField(6, element.ax_label(), output);
+  if (element.has_ax_hint()) AppendBytesField(7, element.ax_hint(), output);
+  if (element.has_ax_frame()) {
+    AppendMessageField(8, element.ax_frame(), output);
+  }
+  if (element.has_ax_identifier()) {
+    AppendBytesField(9, element.ax_identifier(), output);
+  }
+  if (element.has_hittable()) {
+    AppendVarintField(10, element.hittable(), output);
+  }
+  if (element.has_exists()) AppendVarintField(11, element.exists(), output);
+  if (element.has_xc_selected()) {
+    AppendVarintField(12, element.xc_selected(), output);
+  }
+  if (element.has_xc_enabled()) {
+    AppendVarintField(13, element.xc_enabled(), output);
+  }
+  if (element.has_element_type()) {
+    AppendInt32Field(14, element.element_type(), output);
+  }
+  for (const std::string &class_name : element.class_names_hierarchy()) {
+    AppendBytesField(15, class_name, output);
+  }
+  if (element.has_background_color()) {
+    AppendMessageField(16, element.background_color(), output);
+  }
+  if (element.has_hidden()) AppendVarintField(17, element.hidden(), output);
+  if (element.has_alpha()) AppendFloatField(18, element.alpha(), output);
+  if (element.has_opaque()) AppendVarintField(20, element.opaque(), output);
+  if (element.has_tint_color()) {
+    AppendMessageField(21, element.tint_color(), output);
+  }
+  if (element.has_clips_to_bounds()) {
+    AppendVarintField(22, element.clips_to_bounds(), output);
+  }
+  if (element.has_user_interaction_enabled()) {
+    AppendVarintField(23, element.user_interaction_enabled(), output);
+  }
+  if (element.has_multiple_touch_enabled()) {
+    AppendVarintField(24, element.multiple_touch_enabled(), output);
+  }
+  if (element.has_exclusive_touch()) {
+    AppendVarintField(25, element.exclusive_touch(), output);
+  }
+  if (element.has_frame()) AppendMessageField(26, element.frame(), output);
+  if (element.has_bounds()) AppendMessageField(27, element.bounds(), output);
+  if (element.has_control_state()) {
+    AppendVarintField(28, element.control_state(), output);
+  }
+  if (element.has_enabled()) AppendVarintField(29, element.enabled(), output);
+  if (element.has_selected()) {
+    AppendVarintField(30, element.selected(), output);
+  }
+  if (element.has_highlighted()) {
+    AppendVarintField(31, element.highlighted(), output);
+  }
+  if (element.has_title()) AppendBytesField(32, element.title(), output);
+  if (element.has_text()) AppendBytesField(33, element.text(), output);
+  if (element.has_on()) AppendVarintField(34, element.on(), output);
+  if (element.has_value()) AppendFloatField(35, element.value(), output);
+}
+
+void AppendMessage(const AccessibilityHierarchyProto &hierarchy,
+                   std::string *output) {
+  if (hierarchy.has_device_state()) {
+    AppendMessageField(1, hierarchy.device_state(), output);
+  }
+  for (const UIElementProto &element : hierarchy.elements()) {
+    AppendMessageField(2, element, output);
+  }
+}
+
+void AppendMessage(const StringListProto &string_list, std::string *output) {
+  for (const std::string &value : string_list.values()) {
+    AppendBytesField(1, value, output);
+  }
+}
+
+void AppendMessage(const IntListProto &int_list, std::string *output) {
+  if (int_list.values_size() > 0) {
+    AppendPackedInt32sField(1, int_list.values(), output);
+  }
+}
+
+void AppendMessage(const TypedValueProto &value, std::string *output) {
+  if (value.has_type()) AppendInt32Field(1, value.type(), output);
+  // value_case() is not initialized for values that were never set, so the
+  // value is determined from the has-bits instead.
+  if (value.has_boolean_value()) {
+    AppendVarintField(2, value.boolean_value(), output);
+  } else if (value.has_byte_value()) {
+    AppendBytesField(3, value.byte_value(), output);
+  } else if (value.has_short_value()) {
+    AppendBytesField(4, value.short_value(), output);
+  } else if (value.has_char_value()) {
+    AppendBytesField(5, value.char_value(), output);
+  } else if (value.has_int_value()) {
+    AppendInt32Field(6, value.int_value(), output);
+  } else if (value.has_float_value()) {
+    AppendFloatField(7, value.float_value(), output);
+  } else if (value.has_long_value()) {
+    AppendVarintField(8, static_cast<uint64_t>(value.long_value()), output);
+  } else if (value.has_double_value()) {
+    AppendDoubleField(9, value.double_value(), output);
+  } else if (value.has_string_value()) {
+    AppendBytesField(10, value.string_value(), output);
+  } else if (value.has_string_list_value()) {
+    AppendMessageField(11, value.string_list_value(), output);
+  } else if (value.has_int_list_value()) {
+    AppendMessageField(12, value.int_list_value(), output);
+  }
+}
+
+void AppendMessage(const MetadataProto &metadata, std::string *output) {
+  // Map fields are encoded as repeated entry messages with the key as field 1
+  // and the value as field 2.
+  for (const auto &entry : metadata.metadata_map()) {
+    std::string entry_bytes;
+    AppendBytesField(1, entry.first, &entry_bytes);
+    AppendMessageField(2, entry.second, &entry_bytes);
+    AppendBytesField(1, entry_bytes, output);
+  }
+}
+
+void AppendMessage(const CheckResultProto &result, std::string *output) {
+  if (result.has_source_check_class()) {
+    AppendBytesField(1, result.source_check_class(), output);
+  }
+  if (result.has_result_id()) {
+    AppendInt32Field(2, result.result_id(), output);
+  }
+  if (result.has_hierarchy_source_id()) {
+    AppendVarintField(3, static_cast<uint64_t>(result.hierarchy_source_id()),
+                      output);
+  }
+  if (result.has_result_type()) {
+    AppendInt32Field(4, result.result_type(), output);
+  }
+  if (result.has_metadata()) {
+    AppendMessageField(5, result.metadata(), output);
+  }
+}
+
+void AppendMessage(const AccessibilityEvaluationProto &evaluation,
+                   std::string *output) {
+  if (evaluation.has_hierarchy()) {
+    AppendMessageField(1, evaluation.hierarchy(), output);
+  }
+  for (const CheckResultProto &result : evaluation.results()) {
+    AppendMessageField(2, result, output);
+  }
+}
+
+// Appends the packed encoding of @c values as field @c field.
+void AppendPackedVarintsField(int field, const std::vector<uint64_t> &values,
+                              std::string *output) {
+  std::string packed;
+  for (uint64_t value : values) {
+    AppendVarint(value, &packed);
+  }
+  AppendBytesField(field, packed, output);
+}
+
+void AppendMessage(const CheckMetricsProto &metrics, std::string *output) {
+  if (metrics.has_check_name()) {
+    AppendBytesField(1, metrics.check_name(), output);
+  }
+  if (metrics.has_invocations()) {
+    AppendVarintField(2, metrics.invocations(), output);
+  }
+  if (metrics.has_skips()) {
+    AppendVarintField(3, metrics.skips(), output);
+  }
+  if (metrics.has_failures()) {
+    AppendVarintField(4, metrics.failures(), output);
+  }
+  if (metrics.has_total_nanoseconds()) {
+    AppendVarintField(5, metrics.total_nanoseconds(), output);
+  }
+  if (metrics.has_max_nanoseconds()) {
+    AppendVarintField(6, metrics.max_nanoseconds(), output);
+  }
+  if (metrics.latency_histogram_size() > 0) {
+    AppendPackedVarintsField(7, metrics.latency_histogram(), output);
+  }
+  if (metrics.has_allocations()) {
+    AppendVarintField(8, metrics.allocations(), output);
+  }
+  if (metrics.has_allocated_bytes()) {
+    AppendVarintField(9, metrics.allocated_bytes(), output);
+  }
+  if (metrics.has_max_peak_bytes()) {
+    AppendVarintField(10, metrics.max_peak_bytes(), output);
+  }
+}
+
+void AppendMessage(const PhaseMetricsProto &metrics, std::string *output) {
+  if (metrics.has_phase()) {
+    AppendBytesField(1, metrics.phase(), output);
+  }
+  if (metrics.has_count()) {
+    AppendVarintField(2, metrics.count(), output);
+  }
+  if (metrics.has_total_nanoseconds()) {
+    AppendVarintField(3, metrics.total_nanoseconds(), output);
+  }
+  if (metrics.has_max_nanoseconds()) {
+    AppendVarintField(4, metrics.max_nanoseconds(), output);
+  }
+  if (metrics.has_allocations()) {
+    AppendVarintField(5, metrics.allocations(), output);
+  }
+  if (metrics.has_allocated_bytes()) {
+    AppendVarintField(6, metrics.allocated_bytes(), output);
+  }
+  if (metrics.has_max_peak_bytes()) {
+    AppendVarintField(7, metrics.max_peak_bytes(), output);
+  }
+}
+
+void AppendMessage(const EvaluationMetricsProto &metrics,
+                   std::string *output) {
+  for (const CheckMetricsProto &check : metrics.checks()) {
+    AppendMessageField(1, check, output);
+  }
+  for (const PhaseMetricsProto &phase : metrics.phases()) {
+    AppendMessageField(2, phase, output);
+  }
+  if (metrics.latency_bucket_bounds_nanoseconds_size() > 0) {
+    AppendPackedVarintsField(3, metrics.latency_bucket_bounds_nanoseconds(),
+                             output);
+  }
+}
+
+template <typename Message>
+void AppendMessageField(int field, const Message &message,
+                        std::string *output) {
+  std::string message_bytes;
+  AppendMessage(message, &message_bytes);
+  AppendBytesField(field, message_bytes, output);
+}
+
+#pragma mark - Parsing
+
+// Reads the fields of a serialized message one at a time. Any method returning
+// false indicates that the data is malformed.
+class WireReader {
+ public:
+  WireReader(absl::string_view data, int depth) : data_(data), depth_(depth) {}
+
+  // Reads the tag of the next field. Returns false if there are no more fields
+  // or the tag is malformed, which can be distinguished with ok().
+  bool Next(int *field, int *wire_type) {
+    if (data_.empty()) {
+      return false;
+    }
+    uint64_t tag;
+    if (!ConsumeVarint(&data_, &tag) || (tag >> 3) == 0 ||
+        (tag >> 3) > INT32_MAX) {
+      ok_ = false;
+      return false;
+    }
+    *field = static_cast<int>(tag >> 3);
+    *wire_type = static_cast<int>(tag & 7);
+    return true;
+  }
+
+  bool ok() const { return ok_; }
+
+  // The nesting depth of the message being read.
+  int depth() const { return depth_; }
+
+  bool ReadVarint(int wire_type, uint64_t *value) {
+    return wire_type == kVarint && ConsumeVarint(&data_, value);
+  }
+
+  bool ReadInt32(int wire_type, int32_t *value) {
+    uint64_t varint;
+    if (!ReadVarint(wire_type, &varint)) {
+      return false;
+    }
+    *value = static_cast<int32_t>(varint);
+    return true;
+  }
+
+  bool ReadBool(int wire_type, bool *value) {
+    uint64_t varint;
+    if (!ReadVarint(wire_type, &varint)) {
+      return false;
+    }
+    *value = varint != 0;
+    return true;
+  }
+
+  bool ReadFloat(int wire_type, float *value) {
+    if (wire_type != kFixed32 || data_.size() < 4) {
+      return false;
+    }
+    uint32_t bits = 0;
+    for (int i = 0; i < 4; i++) {
+      bits |= static_cast<uint32_t>(static_cast<uint8_t>(data_[i])) << (8 * i);
+    }
+    data_.remove_prefix(4);
+    memcpy(value, &bits, sizeof(bits));
+    return true;
+  }
+
+  bool ReadDouble(int wire_type, double *value) {
+    if (wire_type != kFixed64 || data_.size() < 8) {
+      return false;
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++) {
+      bits |= static_cast<uint64_t>(static_cast<uint8_t>(data_[i])) << (8 * i);
+    }
+    data_.remove_prefix(8);
+    memcpy(value, &bits, sizeof(bits));
+    return true;
+  }
+
+  bool ReadBytes(int wire_type, absl::string_view *value) {
+    uint64_t size;
+    if (wire_type != kLengthDelimited || !ConsumeVarint(&data_, &size) ||
+        size > data_.size()) {
+      return false;
+    }
+    *value = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return true;
+  }
+
+  bool ReadString(int wire_type, std::string *value) {
+    absl::string_view bytes;
+    if (!ReadBytes(wire_type, &bytes)) {
+      return false;
+    }
+    value->assign(bytes.data(), bytes.size());
+    return true;
+  }
+
+  // Reads a repeated int32 field in either packed or unpacked encoding and
+  // calls @c add with each value.
+  template <typename AddFunction>
+  bool ReadInt32s(int wire_type, AddFunction add) {
+    if (wire_type == kVarint) {
+      int32_t value;
+      if (!ReadInt32(wire_type, &value)) {
+        return false;
+      }
+      add(value);
+      return true;
+    }
+    absl::string_view packed;
+    if (!ReadBytes(wire_type, &packed)) {
+      return false;
+    }
+    while (!packed.empty()) {
+      uint64_t value;
+      if (!ConsumeVarint(&packed, &value)) {
+        return false;
+      }
+      add(static_cast<int32_t>(value));
+    }
+    return true;
+  }
+
+  // Reads a repeated uint64 field in either packed or unpacked encoding and
+  // calls @c add with each value.
+  template <typename AddFunction>
+  bool ReadVarints(int wire_type, AddFunction add) {
+    uint64_t value;
+    if (wire_type == kVarint) {
+      if (!ReadVarint(wire_type, &value)) {
+        return false;
+      }
+      add(value);
+      return true;
+    }
+    absl::string_view packed;
+    if (!ReadBytes(wire_type, &packed)) {
+      return false;
+    }
+    while (!packed.empty()) {
+      if (!ConsumeVarint(&packed, &value)) {
+        return false;
+      }
+      add(value);
+    }
+    return true;
+  }
+
+  // Skips the value of a field that is not known.
+  bool Skip(int wire_type) {
+    uint64_t varint;
+    absl::string_view bytes;
+    switch (wire_type) {
+      case kVarint:
+        return ConsumeVarint(&data_, &varint);
+      case kFixed64:
+        return Advance(8);
+      case kLengthDelimited:
+        return ReadBytes(wire_type, &bytes);
+      case kFixed32:
+        return Advance(4);
+      default:
+        // Groups are deprecated and not used by any GTXiLib proto.
+        return false;
+    }
+  }
+
+ private:
+  bool Advance(size_t size) {
+    if (data_.size() < size) {
+      return false;
+    }
+    data_.remove_prefix(size);
+    return true;
+  }
+
+  absl::string_view data_;
+  int depth_;
+  bool ok_ = true;
+};
+
+// Parses the fields of a message with @c parse_field, which is called with the
+// reader, field number and wire type of each field and returns false if the
+// field is malformed.
+template <typename ParseFieldFunction>
+bool ParseFields(absl::string_view data, int depth,
+                 ParseFieldFunction parse_field) {
+  if (depth > kMaxNestingDepth) {
+    return false;
+  }
+  WireReader reader(data, depth);
+  int field;
+  int wire_type;
+  while (reader.Next(&field, &wire_type)) {
+    if (!parse_field(reader, field, wire_type)) {
+      return false;
+    }
+  }
+  return reader.ok();
+}
+
+bool ParseMessage(absl::string_view data, int depth, PointProto *point) {
+  return ParseFields(data, depth, [point](WireReader &reader, int field,
+                                          int wire_type) {
+    float value;
+    switch (field) {
+      case 1:
+        return reader.ReadFloat(wire_type, &value) &&
+               (point->set_x(value), true);
+      case 2:
+        return reader.ReadFloat(wire_type, &value) &&
+               (point->set_y(value), true);
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth, SizeProto *size) {
+  return ParseFields(data, depth, [size](WireReader &reader, int field,
+                                         int wire_type) {
+    float value;
+    switch (field) {
+      case 1:
+        return reader.ReadFloat(wire_type, &value) &&
+               (size->set_width(value), true);
+      case 2:
+        return reader.ReadFloat(wire_type, &value) &&
+               (size->set_height(value), true);
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+// Parsers of the messages that can be nested in other messages.
+bool ParseMessage(absl::string_view data, int depth, RectProto *rect);
+bool ParseMessage(absl::string_view data, int depth, ColorProto *color);
+bool ParseMessage(absl::string_view data, int depth,
+                  DisplayMetricsProto *metrics);
+bool ParseMessage(absl::string_view data, int depth,
+                  DeviceStateProto *device_state);
+bool ParseMessage(absl::string_view data, int depth, UIElementProto *element);
+bool ParseMessage(absl::string_view data, int depth,
+                  AccessibilityHierarchyProto *hierarchy);
+bool ParseMessage(absl::string_view data, int depth,
+                  StringListProto *string_list);
+bool ParseMessage(absl::string_view data, int depth, IntListProto *int_list);
+bool ParseMessage(absl::string_view data, int depth, TypedValueProto *value);
+bool ParseMessage(absl::string_view data, int depth, MetadataProto *metadata);
+bool ParseMessage(absl::string_view data, int depth, CheckResultProto *result);
+bool ParseMessage(absl::string_view data, int depth,
+                  CheckMetricsProto *metrics);
+bool ParseMessage(absl::string_view data, int depth,
+                  PhaseMetricsProto *metrics);
+
+// Parses a length-delimited field into @c message.
+template <typename Message>
+bool ParseMessageField(WireReader &reader, int wire_type, Message *message) {
+  absl::string_view bytes;
+  return reader.ReadBytes(wire_type, &bytes) &&
+         ParseMessage(bytes, reader.depth() + 1, message);
+}
+
+bool ParseMessage(absl::string_view data, int depth, RectProto *rect) {
+  return ParseFields(data, depth, [rect](WireReader &reader, int field,
+                                         int wire_type) {
+    switch (field) {
+      case 1:
+        return ParseMessageField(reader, wire_type, rect->mutable_origin());
+      case 2:
+        return ParseMessageField(reader, wire_type, rect->mutable_size());
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth, ColorProto *color) {
+  return ParseFields(data, depth, [color](WireReader &reader, int field,
+                                          int wire_type) {
+    float value;
+    switch (field) {
+      case 1:
+        return reader.ReadFloat(wire_type, &value) &&
+               (color->set_r(value), true);
+      case 2:
+        return reader.ReadFloat(wire_type, &value) &&
+               (color->set_g(value), true);
+      case 3:
+        return reader.ReadFloat(wire_type, &value) &&
+               (color->set_b(value), true);
+      case 4:
+        return reader.ReadFloat(wire_type, &value) &&
+               (color->set_a(value), true);
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth,
+                  DisplayMetricsProto *metrics) {
+  return ParseFields(data, depth, [metrics](WireReader &reader, int field,
+                                            int wire_type) {
+    int32_t int_value;
+    float float_value;
+    switch (field) {
+      case 1:
+        return reader.ReadInt32(wire_type, &int_value) &&
+               (metrics->set_screen_width(int_value), true);
+      case 2:
+        return reader.ReadInt32(wire_type, &int_value) &&
+               (metrics->set_screen_height(int_value), true);
+      case 3:
+        return reader.ReadFloat(wire_type, &float_value) &&
+               (metrics->set_screen_scale(float_value), true);
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth,
+                  DeviceStateProto *device_state) {
+  return ParseFields(data, depth, [device_state](WireReader &reader, int field,
+                                                 int wire_type) {
+    std::string string_value;
+    switch (field) {
+      case 1:
+        return ParseMessageField(reader, wire_type,
+                                 device_state->mutable_display_metrics());
+      case 2:
+        return reader.ReadString(wire_type, &string_value) &&
+               (device_state->set_ios_version(string_value), true);
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth, UIElementProto *element) {
+  return ParseFields(data, depth, [element](WireReader &reader, int field,
+                                            int wire_type) {
+    int32_t int_value;
+    uint64_t varint;
+    bool bool_value;
+    float float_value;
+    std::string string_value;
+    switch (field) {
+      case 1:
+        return reader.ReadInt32(wire_type, &int_value) &&
+               (element->set_id(int_value), true);
+      case 2:
+        return reader.ReadInt32(wire_type, &int_value) &&
+               (element->set_parent_id(int_value), true);
+      case 3:
+        return reader.ReadInt32s(wire_type, [element](int32_t child_id) {
+          element->add_child_ids(child_id);
+        });
+      case 4:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_is_ax_element(bool_value), true);
+      case 5:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (element->set_ax_traits(varint), true);
+      case 6:
+        return reader.ReadString(wire_type, &string_value) &&
+               (element->set_ax_label(string_value), true);
+      case 7:
+        return reader.ReadString(wire_type, &string_value) &&
+               (element->set_ax_hint(string_value), true);
+      case 8:
+        return ParseMessageField(reader, wire_type,
+                                 element->mutable_ax_frame());
+      case 9:
+        return reader.ReadString(wire_type, &string_value) &&
+               (element->set_ax_identifier(string_value), true);
+      case 10:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_hittable(bool_value), true);
+      case 11:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_exists(bool_value), true);
+      case 12:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_xc_selected(bool_value), true);
+      case 13:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_xc_enabled(bool_value), true);
+      case 14:
+        return reader.ReadInt32(wire_type, &int_value) &&
+               (element->set_element_type(
+                    static_cast<ElementTypeProto>(int_value)),
+                true);
+      case 15:
+        return reader.ReadString(wire_type, &string_value) &&
+               (element->add_class_names_hierarchy(string_value), true);
+      case 16:
+        return ParseMessageField(reader, wire_type,
+                                 element->mutable_background_color());
+      case 17:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_hidden(bool_value), true);
+      case 18:
+        return reader.ReadFloat(wire_type, &float_value) &&
+               (element->set_alpha(float_value), true);
+      case 20:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_opaque(bool_value), true);
+      case 21:
+        return ParseMessageField(reader, wire_type,
+                                 element->mutable_tint_color());
+      case 22:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_clips_to_bounds(bool_value), true);
+      case 23:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_user_interaction_enabled(bool_value), true);
+      case 24:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_multiple_touch_enabled(bool_value), true);
+      case 25:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_exclusive_touch(bool_value), true);
+      case 26:
+        return ParseMessageField(reader, wire_type, element->mutable_frame());
+      case 27:
+        return ParseMessageField(reader, wire_type, element->mutable_bounds());
+      case 28:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (element->set_control_state(varint), true);
+      case 29:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_enabled(bool_value), true);
+      case 30:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_selected(bool_value), true);
+      case 31:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_highlighted(bool_value), true);
+      case 32:
+        return reader.ReadString(wire_type, &string_value) &&
+               (element->set_title(string_value), true);
+      case 33:
+        return reader.ReadString(wire_type, &string_value) &&
+               (element->set_text(string_value), true);
+      case 34:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (element->set_on(bool_value), true);
+      case 35:
+        return reader.ReadFloat(wire_type, &float_value) &&
+               (element->set_value(float_value), true);
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth,
+                  AccessibilityHierarchyProto *hierarchy) {
+  return ParseFields(data, depth, [hierarchy](WireReader &reader, int field,
+                                              int wire_type) {
+    switch (field) {
+      case 1:
+        return ParseMessageField(reader, wire_type,
+                                 hierarchy->mutable_device_state());
+      case 2:
+        return ParseMessageField(reader, wire_type, hierarchy->add_elements());
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth,
+                  StringListProto *string_list) {
+  return ParseFields(data, depth, [string_list](WireReader &reader, int field,
+                                                int wire_type) {
+    std::string value;
+    if (field == 1) {
+      return reader.ReadString(wire_type, &value) &&
+             (string_list->add_values(value), true);
+    }
+    return reader.Skip(wire_type);
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth, IntListProto *int_list) {
+  return ParseFields(data, depth, [int_list](WireReader &reader, int field,
+                                             int wire_type) {
+    if (field == 1) {
+      return reader.ReadInt32s(wire_type, [int_list](int32_t value) {
+        int_list->add_values(value);
+      });
+    }
+    return reader.Skip(wire_type);
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth, TypedValueProto *value) {
+  return ParseFields(data, depth, [value](WireReader &reader, int field,
+                                          int wire_type) {
+    int32_t int_value;
+    uint64_t varint;
+    bool bool_value;
+    float float_value;
+    double double_value;
+    std::string string_value;
+    // The mutable accessors of list values clear them, so lists are parsed
+    // separately and set at once.
+    StringListProto string_list;
+    IntListProto int_list;
+    switch (field) {
+      case 1:
+        return reader.ReadInt32(wire_type, &int_value) &&
+               (value->set_type(
+                    static_cast<TypedValueProto_TypeProto>(int_value)),
+                true);
+      case 2:
+        return reader.ReadBool(wire_type, &bool_value) &&
+               (value->set_boolean_value(bool_value), true);
+      case 3:
+        return reader.ReadString(wire_type, &string_value) &&
+               (value->set_byte_value(string_value), true);
+      case 4:
+        return reader.ReadString(wire_type, &string_value) &&
+               (value->set_short_value(string_value), true);
+      case 5:
+        return reader.ReadString(wire_type, &string_value) &&
+               (value->set_char_value(string_value), true);
+      case 6:
+        return reader.ReadInt32(wire_type, &int_value) &&
+               (value->set_int_value(int_value), true);
+      case 7:
+        return reader.ReadFloat(wire_type, &float_value) &&
+               (value->set_float_value(float_value), true);
+      case 8:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (value->set_long_value(static_cast<int64_t>(varint)), true);
+      case 9:
+        return reader.ReadDouble(wire_type, &double_value) &&
+               (value->set_double_value(double_value), true);
+      case 10:
+        return reader.ReadString(wire_type, &string_value) &&
+               (value->set_string_value(string_value), true);
+      case 11:
+        return ParseMessageField(reader, wire_type, &string_list) &&
+               (value->set_string_list_value(string_list), true);
+      case 12:
+        return ParseMessageField(reader, wire_type, &int_list) &&
+               (value->set_int_list_value(int_list), true);
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+// Parses an entry of the metadata map and inserts it into @c metadata_map.
+bool ParseMetadataEntry(absl::string_view data, int depth,
+                        std::map<std::string, TypedValueProto> *metadata_map) {
+  std::string key;
+  TypedValueProto value;
+  value.clear_value();
+  bool parsed = ParseFields(data, depth, [&key, &value](WireReader &reader,
+                                                        int field,
+                                                        int wire_type) {
+    switch (field) {
+      case 1:
+        return reader.ReadString(wire_type, &key);
+      case 2:
+        return ParseMessageField(reader, wire_type, &value);
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+  if (!parsed) {
+    return false;
+  }
+  (*metadata_map)[key] = value;
+  return true;
+}
+
+bool ParseMessage(absl::string_view data, int depth, MetadataProto *metadata) {
+  return ParseFields(data, depth, [metadata](WireReader &reader, int field,
+                                             int wire_type) {
+    absl::string_view entry;
+    if (field == 1) {
+      return reader.ReadBytes(wire_type, &entry) &&
+             ParseMetadataEntry(entry, reader.depth() + 1,
+                                metadata->mutable_metadata_map());
+    }
+    return reader.Skip(wire_type);
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth, CheckResultProto *result) {
+  return ParseFields(data, depth, [result](WireReader &reader, int field,
+                                           int wire_type) {
+    int32_t int_value;
+    uint64_t varint;
+    std::string string_value;
+    switch (field) {
+      case 1:
+        return reader.ReadString(wire_type, &string_value) &&
+               (result->set_source_check_class(string_value), true);
+      case 2:
+        return reader.ReadInt32(wire_type, &int_value) &&
+               (result->set_result_id(int_value), true);
+      case 3:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (result->set_hierarchy_source_id(static_cast<int64_t>(varint)),
+                true);
+      case 4:
+        return reader.ReadInt32(wire_type, &int_value) &&
+               (result->set_result_type(static_cast<ResultType>(int_value)),
+                true);
+      case 5:
+        return ParseMessageField(reader, wire_type, result->mutable_metadata());
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth,
+                  AccessibilityEvaluationProto *evaluation) {
+  return ParseFields(data, depth, [evaluation](WireReader &reader, int field,
+                                               int wire_type) {
+    switch (field) {
+      case 1:
+        return ParseMessageField(reader, wire_type,
+                                 evaluation->mutable_hierarchy());
+      case 2:
+        return ParseMessageField(reader, wire_type, evaluation->add_results());
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth,
+                  CheckMetricsProto *metrics) {
+  return ParseFields(data, depth, [metrics](WireReader &reader, int field,
+                                            int wire_type) {
+    uint64_t varint;
+    std::string string_value;
+    switch (field) {
+      case 1:
+        return reader.ReadString(wire_type, &string_value) &&
+               (metrics->set_check_name(string_value), true);
+      case 2:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_invocations(varint), true);
+      case 3:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_skips(varint), true);
+      case 4:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_failures(varint), true);
+      case 5:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_total_nanoseconds(varint), true);
+      case 6:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_max_nanoseconds(varint), true);
+      case 7:
+        return reader.ReadVarints(wire_type, [metrics](uint64_t count) {
+          metrics->add_latency_histogram(count);
+        });
+      case 8:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_allocations(varint), true);
+      case 9:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_allocated_bytes(varint), true);
+      case 10:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_max_peak_bytes(varint), true);
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth,
+                  PhaseMetricsProto *metrics) {
+  return ParseFields(data, depth, [metrics](WireReader &reader, int field,
+                                            int wire_type) {
+    uint64_t varint;
+    std::string string_value;
+    switch (field) {
+      case 1:
+        return reader.ReadString(wire_type, &string_value) &&
+               (metrics->set_phase(string_value), true);
+      case 2:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_count(varint), true);
+      case 3:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_total_nanoseconds(varint), true);
+      case 4:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_max_nanoseconds(varint), true);
+      case 5:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_allocations(varint), true);
+      case 6:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_allocated_bytes(varint), true);
+      case 7:
+        return reader.ReadVarint(wire_type, &varint) &&
+               (metrics->set_max_peak_bytes(varint), true);
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+bool ParseMessage(absl::string_view data, int depth,
+                  EvaluationMetricsProto *metrics) {
+  return ParseFields(data, depth, [metrics](WireReader &reader, int field,
+                                            int wire_type) {
+    switch (field) {
+      case 1:
+        return ParseMessageField(reader, wire_type, metrics->add_checks());
+      case 2:
+        return ParseMessageField(reader, wire_type, metrics->add_phases());
+      case 3:
+        return reader.ReadVarints(wire_type, [metrics](uint64_t bound) {
+          metrics->add_latency_bucket_bounds_nanoseconds(bound);
+        });
+      default:
+        return reader.Skip(wire_type);
+    }
+  });
+}
+
+}  // namespace
+
+void AppendVarint(uint64_t value, std::string *output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+bool ConsumeVarint(absl::string_view *data, uint64_t *value) {
+  uint64_t result = 0;
+  for (size_t i = 0; i < data->size() && i < 10; i++) {
+    uint8_t byte = static_cast<uint8_t>((*data)[i]);
+    result |= static_cast<uint64_t>(byte & 0x7f) << (7 * i);
+    if ((byte & 0x80) == 0) {
+      data->remove_prefix(i + 1);
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+void AppendSerializedProto(const UIElementProto &element,
+                           std::string *output) {
+  AppendMessage(element, output);
+}
+
+void AppendSerializedProto(const AccessibilityHierarchyProto &hierarchy,
+                           std::string *output) {
+  AppendMessage(hierarchy, output);
+}
+
+void AppendSerializedProto(const CheckResultProto &result,
+                           std::string *output) {
+  AppendMessage(result, output);
+}
+
+void AppendSerializedProto(const AccessibilityEvaluationProto &evaluation,
+                           std::string *output) {
+  AppendMessage(evaluation, output);
+}
+
+bool ParseProto(absl::string_view data, UIElementProto *element) {
+  return ParseMessage(data, 0, element);
+}
+
+bool ParseProto(absl::string_view data,
+                AccessibilityHierarchyProto *hierarchy) {
+  return ParseMessage(data, 0, hierarchy);
+}
+
+bool ParseProto(absl::string_view data, CheckResultProto *result) {
+  return ParseMessage(data, 0, result);
+}
+
+bool ParseProto(absl::string_view data,
+                AccessibilityEvaluationProto *evaluation) {
+  return ParseMessage(data, 0, evaluation);
+}
+
+void AppendSerializedProto(const EvaluationMetricsProto &metrics,
+                           std::string *output) {
+  AppendMessage(metrics, output);
+}
+
+bool ParseProto(absl::string_view data, EvaluationMetricsProto *metrics) {
+  return ParseMessage(data, 0, metrics);
+}
+
+}  // namespace gtx
@@ -0,0 +1,72 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_PROTOS_PROTO_SERIALIZATION_H_
+#define GTXILIB_OOPCLASSES_PROTOS_PROTO_SERIALIZATION_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include <abseil/absl/strings/string_view.h>
+#include "typedefs.h"
+
+namespace gtx {
+
+// Serialization of the protos in gtx.proto, result.proto and metrics.proto in
+// the protocol buffer wire format, compatible with the serialization of the
+// generated protobuf classes. Fields are written if their has-bit is set, and
+// unknown fields are skipped when parsing.
+
+// Appends the serialized bytes of the given message to @c output.
+void AppendSerializedProto(const UIElementProto &element, std::string *output);
+void AppendSerializedProto(const AccessibilityHierarchyProto &hierarchy,
+                           std::string *output);
+void AppendSerializedProto(const CheckResultProto &result,
+                           std::string *output);
+void AppendSerializedProto(const AccessibilityEvaluationProto &evaluation,
+                           std::string *output);
+void AppendSerializedProto(const EvaluationMetricsProto &metrics,
+                           std::string *output);
+
+// Returns the serialized bytes of @c message.
+template <typename Message>
+std::string SerializeProto(const Message &message) {
+  std::string output;
+  AppendSerializedProto(message, &output);
+  return output;
+}
+
+// Parses @c data into the given message, which must be empty. Returns false if
+// @c data is not a valid serialization of the message, in which case the
+// contents of the message are unspecified.
+bool ParseProto(absl::string_view data, UIElementProto *element);
+bool ParseProto(absl::string_view data, AccessibilityHierarchyProto *hierarchy);
+bool ParseProto(absl::string_view data, CheckResultProto *result);
+bool ParseProto(absl::string_view data,
+                AccessibilityEvaluationProto *evaluation);
+bool ParseProto(absl::string_view data, EvaluationMetricsProto *metrics);
+
+// Appends @c value to @c output as a base 128 varint.
+void AppendVarint(uint64_t value, std::string *output);
+
+// Reads a base 128 varint from the front of @c data into @c value and removes
+// it from @c data. Returns false if @c data does not start with a valid varint.
+bool ConsumeVarint(absl::string_view *data, uint64_t *value);
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_PROTOS_PROTO_SERIALIZATION_H_
@@ -19,6 +19,7 @@
 
 #include "enums.pb.h"
 #include "gtx.pb.h"
+#include "metrics.pb.h"
 #include "result.pb.h"
 
 typedef gtxilib::oopclasses::protos::Point PointProto;
@@ -43,5 +44,11 @@ typedef gtxilib::oopclasses::protos::CheckResultProto
     CheckResultProto;
 typedef gtxilib::oopclasses::protos::
     AccessibilityEvaluation AccessibilityEvaluationProto;
+typedef gtxilib::oopclasses::protos::CheckMetrics
+    CheckMetricsProto;
+typedef gtxilib::oopclasses::protos::PhaseMetrics
+    PhaseMetricsProto;
+typedef gtxilib::oopclasses::protos::EvaluationMetrics
+    EvaluationMetricsProto;
 
 #endif  // GTXILIB_OOPCLASSES_PROTOS_TYPEDEFS_H_
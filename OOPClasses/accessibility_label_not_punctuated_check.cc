@@ -16,14 +16,21 @@
 
 #include "accessibility_label_not_punctuated_check.h"
 
+#include <stdint.h>
+
 #include <string>
+#include <utility>
+#include <vector>
 
+#include <abseil/absl/strings/string_view.h>
 #include <abseil/absl/strings/substitute.h>
 #include <abseil/absl/types/optional.h>
+#include <abseil/absl/types/span.h>
 #include "metadata_map.h"
 #include "proto_utils.h"
 #include "typedefs.h"
 #include "check.h"
+#include "hierarchy_table.h"
 #include "localized_string_ids.h"
 #include "localized_strings_manager.h"
 #include "parameters.h"
@@ -49,19 +56,40 @@ AccessibilityLabelNotPunctuatedCheck::CheckElement(
     // hold static text that can be punctuated and formatted like a string.
     return absl::nullopt;
   }
-  std::string accessibility_label = TrimWhitespace(element.ax_label());
-  // This check is not applicable for container elements that combine individual
-  // labels joined with commas.
-  if (accessibility_label.find(',') != std::string::npos) {
-    return absl::nullopt;
+  return CheckLabel(element.id(), element.ax_label());
+}
+
+bool AccessibilityLabelNotPunctuatedCheck::CheckElementCompact(
+    const UIElementProto &element, const Parameters &params,
+    CompactCheckResult *result) const {
+  if (IsTextDisplayingElement(element) ||
+      !IsPunctuated(TrimWhitespaceView(element.ax_label()))) {
+    return false;
   }
-  if (!EndsWithInvalidPunctuation(accessibility_label)) {
-    return absl::nullopt;
+  result->result_id = RESULT_ID_ENDS_WITH_INVALID_PUNCTUATION;
+  return true;
+}
+
+CheckResultProto AccessibilityLabelNotPunctuatedCheck::ExpandCompactResult(
+    const CompactCheckResult &result, const UIElementProto &element,
+    const Parameters &params) const {
+  const std::string accessibility_label = element.ax_label();
+  return LabelResult(element.id(), TrimWhitespaceView(accessibility_label));
+}
+
+void AccessibilityLabelNotPunctuatedCheck::CheckElementsInTable(
+    const HierarchyTable &table, absl::Span<const int> element_indices,
+    const Parameters &params, std::vector<IndexedCheckResult> &results) const {
+  for (int index : element_indices) {
+    if (table.IsTextDisplayingElement(index)) {
+      continue;
+    }
+    absl::optional<CheckResultProto> check_result =
+        CheckLabel(table.ids()[index], table.ax_label(index));
+    if (check_result.has_value()) {
+      results.push_back({index, *std::move(check_result)});
+    }
   }
-  MetadataMap metadata;
-  metadata.SetString(KEY_ACCESSIBILITY_LABEL, accessibility_label);
-  return CheckResult(RESULT_ID_ENDS_WITH_INVALID_PUNCTUATION, element,
-                     metadata);
 }
 
 std::string AccessibilityLabelNotPunctuatedCheck::GetRichShortMessage(
@@ -89,8 +117,36 @@ std::string AccessibilityLabelNotPunctuatedCheck::GetDefaultMessage(
   return absl::Substitute(format, original_accessibility_label);
 }
 
+absl::optional<CheckResultProto>
+AccessibilityLabelNotPunctuatedCheck::CheckLabel(
+    int32_t element_id, absl::string_view accessibility_label) const {
+  absl::string_view trimmed_label = TrimWhitespaceView(accessibility_label);
+  if (!IsPunctuated(trimmed_label)) {
+    return absl::nullopt;
+  }
+  return LabelResult(element_id, trimmed_label);
+}
+
+bool AccessibilityLabelNotPunctuatedCheck::IsPunctuated(
+    absl::string_view trimmed_label) const {
+  // This check is not applicable for container elements that combine individual
+  // labels joined with commas.
+  if (trimmed_label.find(',') != absl::string_view::npos) {
+    return false;
+  }
+  return EndsWithInvalidPunctuation(trimmed_label);
+}
+
+CheckResultProto AccessibilityLabelNotPunctuatedCheck::LabelResult(
+    int32_t element_id, absl::string_view trimmed_label) const {
+  MetadataMap metadata;
+  metadata.SetString(KEY_ACCESSIBILITY_LABEL, std::string(trimmed_label));
+  return CheckResult(RESULT_ID_ENDS_WITH_INVALID_PUNCTUATION, element_id,
+                     metadata);
+}
+
 bool AccessibilityLabelNotPunctuatedCheck::EndsWithInvalidPunctuation(
-    const std::string &str) const {
+    absl::string_view str) const {
   // TODO: Account for all punctuation once it is confirmed that
   // this is Apple's intention.
   return !str.empty() && str.back() == '.';
@@ -18,11 +18,15 @@
 #define GTXILIB_OOPCLASSES_ACCESSIBILITY_LABEL_NOT_PUNCTUATED_CHECK_H_
 
 #include <string>
+#include <vector>
 
+#include <abseil/absl/strings/string_view.h>
 #include <abseil/absl/types/optional.h>
+#include <abseil/absl/types/span.h>
 #include "metadata_map.h"
 #include "typedefs.h"
 #include "check.h"
+#include "hierarchy_table.h"
 #include "localized_strings_manager.h"
 #include "parameters.h"
 
@@ -42,6 +46,21 @@ class AccessibilityLabelNotPunctuatedCheck : public Check {
   absl::optional<CheckResultProto> CheckElement(
       const UIElementProto &element, const Parameters &params) const override;
 
+  void CheckElementsInTable(
+      const HierarchyTable &table, absl::Span<const int> element_indices,
+      const Parameters &params,
+      std::vector<IndexedCheckResult> &results) const override;
+
+  bool CheckElementCompact(const UIElementProto &element,
+                           const Parameters &params,
+                           CompactCheckResult *result) const override;
+
+  // Trims the label of @c element again, as compact results do not hold
+  // strings.
+  CheckResultProto ExpandCompactResult(
+      const CompactCheckResult &result, const UIElementProto &element,
+      const Parameters &params) const override;
+
   std::string GetRichShortMessage(
       Locale locale, int result_id, const MetadataMap &metadata,
       const LocalizedStringsManager &string_manager) const override;
@@ -56,9 +75,24 @@ class AccessibilityLabelNotPunctuatedCheck : public Check {
       const LocalizedStringsManager &string_manager) const override;
 
  private:
+  // Returns a result for the element with the given id if the given
+  // accessibility label is punctuated, absl::nullopt otherwise. Must only be
+  // called for elements that do not display text.
+  absl::optional<CheckResultProto> CheckLabel(
+      int32_t element_id, absl::string_view accessibility_label) const;
+
+  // Returns true if the given accessibility label, with leading and trailing
+  // whitespace removed, is punctuated.
+  bool IsPunctuated(absl::string_view trimmed_label) const;
+
+  // Returns the result for the element with the given id, whose trimmed
+  // accessibility label is punctuated.
+  CheckResultProto LabelResult(int32_t element_id,
+                               absl::string_view trimmed_label) const;
+
   // Returns true if str ends with a punctuation mark, false otherwise. Only '.'
   // is currently recognized as a punctuation mark.
-  bool EndsWithInvalidPunctuation(const std::string &str) const;
+  bool EndsWithInvalidPunctuation(absl::string_view str) const;
 };
 
 }  // namespace gtx
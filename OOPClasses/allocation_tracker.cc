@@ -0,0 +1,104 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "allocation_tracker.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+namespace gtx {
+
+namespace {
+
+std::atomic<bool> allocation_tracking_enabled{false};
+
+// The allocations of a thread since it started. Trivially constructible, so
+// that the shim can use it before static initialization and without
+// allocating.
+struct ThreadAllocations {
+  uint64_t allocations;
+  uint64_t bytes;
+  // Memory freed by a thread may have been allocated by another one, so live
+  // bytes can be negative.
+  int64_t live_bytes;
+  // The most live bytes since the innermost ScopedAllocationCounter started.
+  int64_t peak_live_bytes;
+};
+thread_local ThreadAllocations thread_allocations;
+
+}  // namespace
+
+void EnableAllocationTracking() {
+  allocation_tracking_enabled.store(true, std::memory_order_relaxed);
+}
+
+bool AllocationTrackingEnabled() {
+  return allocation_tracking_enabled.load(std::memory_order_relaxed);
+}
+
+void RecordAllocation(size_t bytes) {
+  ThreadAllocations &allocations = thread_allocations;
+  allocations.allocations++;
+  allocations.bytes += bytes;
+  allocations.live_bytes += bytes;
+  if (allocations.live_bytes > allocations.peak_live_bytes) {
+    allocations.peak_live_bytes = allocations.live_bytes;
+  }
+}
+
+void RecordDeallocation(size_t bytes) {
+  thread_allocations.live_bytes -= bytes;
+}
+
+ScopedAllocationCounter::ScopedAllocationCounter(bool active)
+    : active_(active) {
+  if (!active_) {
+    return;
+  }
+  ThreadAllocations &allocations = thread_allocations;
+  start_allocations_ = allocations.allocations;
+  start_bytes_ = allocations.bytes;
+  start_live_bytes_ = allocations.live_bytes;
+  enclosing_peak_live_bytes_ = allocations.peak_live_bytes;
+  allocations.peak_live_bytes = allocations.live_bytes;
+}
+
+ScopedAllocationCounter::~ScopedAllocationCounter() {
+  if (!active_) {
+    return;
+  }
+  ThreadAllocations &allocations = thread_allocations;
+  if (enclosing_peak_live_bytes_ > allocations.peak_live_bytes) {
+    allocations.peak_live_bytes = enclosing_peak_live_bytes_;
+  }
+}
+
+AllocationCounts ScopedAllocationCounter::Counts() const {
+  AllocationCounts counts;
+  if (!active_) {
+    return counts;
+  }
+  const ThreadAllocations &allocations = thread_allocations;
+  counts.allocations = allocations.allocations - start_allocations_;
+  counts.bytes = allocations.bytes - start_bytes_;
+  counts.peak_bytes = static_cast<uint64_t>(allocations.peak_live_bytes -
+                                            start_live_bytes_);
+  return counts;
+}
+
+}  // namespace gtx
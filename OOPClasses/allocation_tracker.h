@@ -0,0 +1,83 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_ALLOCATION_TRACKER_H_
+#define GTXILIB_OOPCLASSES_ALLOCATION_TRACKER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gtx {
+
+// Heap allocations counted by ScopedAllocationCounter.
+struct AllocationCounts {
+  // The number of allocations.
+  uint64_t allocations = 0;
+  // The total size of the allocations, in bytes.
+  uint64_t bytes = 0;
+  // The most memory held at once, in bytes, above the memory held when
+  // counting started. Memory allocated before counting started and freed
+  // during it is not subtracted.
+  uint64_t peak_bytes = 0;
+};
+
+// Allocations are counted per thread by an allocator shim, such as
+// OOPTools/gtx_allocation_shim.cc, that replaces the global operator new and
+// operator delete and calls RecordAllocation and RecordDeallocation. The
+// library itself does not replace the allocator, so nothing is counted unless
+// a shim is linked into the executable.
+
+// Called by the shim once, before counting, to enable counting by toolkits.
+void EnableAllocationTracking();
+
+// Returns true if a shim has enabled counting.
+bool AllocationTrackingEnabled();
+
+// Records an allocation of @c bytes on the calling thread. Must not allocate.
+void RecordAllocation(size_t bytes);
+
+// Records that @c bytes were freed on the calling thread. Must not allocate.
+void RecordDeallocation(size_t bytes);
+
+// Counts the allocations of the calling thread from its construction. Counters
+// can be nested, but must be destroyed in the reverse order of construction on
+// the thread that constructed them.
+class ScopedAllocationCounter {
+ public:
+  // If @c active is false, nothing is counted and Counts returns zeros.
+  explicit ScopedAllocationCounter(bool active = AllocationTrackingEnabled());
+  ~ScopedAllocationCounter();
+
+  ScopedAllocationCounter(const ScopedAllocationCounter &) = delete;
+  ScopedAllocationCounter &operator=(const ScopedAllocationCounter &) = delete;
+
+  bool active() const { return active_; }
+
+  // Returns the allocations made so far.
+  AllocationCounts Counts() const;
+
+ private:
+  const bool active_;
+  uint64_t start_allocations_ = 0;
+  uint64_t start_bytes_ = 0;
+  int64_t start_live_bytes_ = 0;
+  // The peak of the enclosing counter, restored on destruction.
+  int64_t enclosing_peak_live_bytes_ = 0;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_ALLOCATION_TRACKER_H_
@@ -0,0 +1,627 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "banded_screenshot.h"
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <abseil/absl/strings/string_view.h>
+#include "gtx_types.h"
+#include "mapped_file.h"
+
+namespace gtx {
+
+namespace {
+
+// The largest width or height, and the most pixels, a decoded screenshot may
+// have, well above those of any screen (an 8K display has 7680 by 4320
+// pixels). The header of a small file may declare any size, and the bands
+// and rows the decoder allocates grow with it.
+constexpr int64_t kMaxDimension = 16384;
+constexpr int64_t kMaxPixelCount = int64_t{1} << 25;
+
+// The most bytes deflate can inflate each compressed byte to, so that PNGs
+// whose data is too short for the size their header declares are rejected
+// before any of it is decoded.
+constexpr int64_t kMaxDeflateRatio = 1032;
+
+constexpr char kPngSignature[] = "\x89PNG\r\n\x1a\n";
+constexpr size_t kPngSignatureSize = 8;
+
+// PNG color types.
+constexpr int kPngGray = 0;
+constexpr int kPngRgb = 2;
+constexpr int kPngPalette = 3;
+constexpr int kPngGrayAlpha = 4;
+constexpr int kPngRgba = 6;
+
+// PNG scanline filter types.
+constexpr int kPngFilterNone = 0;
+constexpr int kPngFilterSub = 1;
+constexpr int kPngFilterUp = 2;
+constexpr int kPngFilterAverage = 3;
+constexpr int kPngFilterPaeth = 4;
+
+uint32_t ReadBigEndian32(const char *bytes) {
+  const unsigned char *data = reinterpret_cast<const unsigned char *>(bytes);
+  return (static_cast<uint32_t>(data[0]) << 24) |
+         (static_cast<uint32_t>(data[1]) << 16) |
+         (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+Pixel MakePixel(unsigned char red, unsigned char green, unsigned char blue,
+                unsigned char alpha) {
+  Pixel pixel;
+  pixel.red = red;
+  pixel.green = green;
+  pixel.blue = blue;
+  pixel.alpha = alpha;
+  return pixel;
+}
+
+bool IsValidSize(int64_t width, int64_t height) {
+  return width > 0 && height > 0 && width <= kMaxDimension &&
+         height <= kMaxDimension && width * height <= kMaxPixelCount;
+}
+
+// Decodes binary PPMs, whose rows can be read in any order.
+class PpmRowDecoder : public ScreenshotRowDecoder {
+ public:
+  static std::unique_ptr<PpmRowDecoder> Create(absl::string_view data) {
+    if (data.size() < 2 || data[0] != 'P' || data[1] != '6') {
+      return nullptr;
+    }
+    size_t position = 2;
+    int64_t values[3];
+    for (int64_t &value : values) {
+      // Skip whitespace and comments, which run to the end of the line.
+      while (position < data.size() &&
+             (isspace(static_cast<unsigned char>(data[position])) ||
+              data[position] == '#')) {
+        if (data[position] == '#') {
+          while (position < data.size() && data[position] != '\n') {
+            position++;
+          }
+        } else {
+          position++;
+        }
+      }
+      if (position == data.size() ||
+          !isdigit(static_cast<unsigned char>(data[position]))) {
+        return nullptr;
+      }
+      value = 0;
+      while (position < data.size() &&
+             isdigit(static_cast<unsigned char>(data[position])) &&
+             value <= kMaxPixelCount) {
+        value = value * 10 + (data[position] - '0');
+        position++;
+      }
+    }
+    const int64_t width = values[0];
+    const int64_t height = values[1];
+    // A single whitespace character separates the header from the pixels.
+    if (!IsValidSize(width, height) || values[2] != 255 ||
+        position == data.size() ||
+        !isspace(static_cast<unsigned char>(data[position]))) {
+      return nullptr;
+    }
+    position++;
+    if (data.size() - position < static_cast<size_t>(width * height * 3)) {
+      return nullptr;
+    }
+    return std::unique_ptr<PpmRowDecoder>(new PpmRowDecoder(
+        reinterpret_cast<const unsigned char *>(data.data() + position),
+        static_cast<int>(width), static_cast<int>(height)));
+  }
+
+  int width() const override { return width_; }
+  int height() const override { return height_; }
+
+  bool DecodeRows(int first_row, int row_count, Pixel *pixels) override {
+    const unsigned char *rgb =
+        pixels_ + static_cast<size_t>(first_row) * width_ * 3;
+    const size_t count = static_cast<size_t>(row_count) * width_;
+    for (size_t i = 0; i < count; i++, rgb += 3) {
+      pixels[i] = MakePixel(rgb[0], rgb[1], rgb[2], 255);
+    }
+    return true;
+  }
+
+ private:
+  PpmRowDecoder(const unsigned char *pixels, int width, int height)
+      : pixels_(pixels), width_(width), height_(height) {}
+
+  const unsigned char *pixels_;
+  const int width_;
+  const int height_;
+};
+
+// Decodes PNGs with 8 bits per channel and no interlacing. Rows are
+// compressed as one stream and filtered against the row above, so they are
+// decoded in order, resuming from the nearest checkpoint at or before the
+// first row asked for.
+class PngRowDecoder : public ScreenshotRowDecoder {
+ public:
+  static std::unique_ptr<PngRowDecoder> Create(absl::string_view data,
+                                               int checkpoint_rows);
+
+  int width() const override { return width_; }
+  int height() const override { return height_; }
+
+  bool DecodeRows(int first_row, int row_count, Pixel *pixels) override;
+
+ private:
+  // The state of decoding at the start of row @c next_row.
+  struct State {
+    State() { memset(&stream, 0, sizeof(stream)); }
+    ~State() {
+      if (initialized) {
+        inflateEnd(&stream);
+      }
+    }
+
+    z_stream stream;
+    bool initialized = false;
+    // The IDAT chunk that stream.next_in points into.
+    size_t chunk = 0;
+    int next_row = 0;
+    // The unfiltered scanline above next_row, zeros above the first.
+    std::vector<unsigned char> previous;
+  };
+
+  PngRowDecoder() {}
+
+  // Returns the state at the first row, or nullptr if zlib fails.
+  std::unique_ptr<State> NewState() const;
+
+  // Returns a copy of @c state, or nullptr if zlib fails.
+  std::unique_ptr<State> CopyState(const State &state) const;
+
+  // Inflates and unfilters the scanline of row state->next_row into
+  // state->previous. Returns false if the data is corrupt.
+  bool DecodeScanline(State *state);
+
+  // Converts the unfiltered @c scanline to @c pixels.
+  void ConvertScanline(const unsigned char *scanline, Pixel *pixels) const;
+
+  int width_ = 0;
+  int height_ = 0;
+  int color_type_ = 0;
+  int channels_ = 0;
+  // The size of an unfiltered scanline, without its filter type byte.
+  size_t scanline_size_ = 0;
+  std::vector<Pixel> palette_;
+  // The gray or RGB sample that is transparent, or -1 if none is.
+  int32_t transparent_sample_ = -1;
+  std::vector<absl::string_view> chunks_;
+  int checkpoint_rows_ = 1;
+  std::unique_ptr<State> state_;
+  // The state at every checkpoint_rows_-th row decoded so far.
+  std::vector<std::unique_ptr<State>> checkpoints_;
+  // The filter type byte and the filtered scanline being decoded.
+  std::vector<unsigned char> filtered_;
+  bool failed_ = false;
+};
+
+std::unique_ptr<PngRowDecoder> PngRowDecoder::Create(absl::string_view data,
+                                                     int checkpoint_rows) {
+  if (data.size() < kPngSignatureSize ||
+      memcmp(data.data(), kPngSignature, kPngSignatureSize) != 0) {
+    return nullptr;
+  }
+  std::unique_ptr<PngRowDecoder> decoder(new PngRowDecoder());
+  decoder->checkpoint_rows_ = std::max(1, checkpoint_rows);
+  bool has_header = false;
+  int bit_depth = 0;
+  size_t position = kPngSignatureSize;
+  while (data.size() - position >= 12) {
+    const uint32_t length = ReadBigEndian32(data.data() + position);
+    absl::string_view type = data.substr(position + 4, 4);
+    if (data.size() - position - 12 < length) {
+      return nullptr;
+    }
+    absl::string_view chunk = data.substr(position + 8, length);
+    position += 12 + static_cast<size_t>(length);
+    if (type == "IHDR") {
+      if (length != 13) {
+        return nullptr;
+      }
+      const int64_t width = ReadBigEndian32(chunk.data());
+      const int64_t height = ReadBigEndian32(chunk.data() + 4);
+      bit_depth = static_cast<unsigned char>(chunk[8]);
+      decoder->color_type_ = static_cast<unsigned char>(chunk[9]);
+      // Compression, filter and interlace methods must be 0.
+      if (!IsValidSize(width, height) || chunk[10] != 0 || chunk[11] != 0 ||
+          chunk[12] != 0) {
+        return nullptr;
+      }
+      decoder->width_ = static_cast<int>(width);
+      decoder->height_ = static_cast<int>(height);
+      has_header = true;
+    } else if (type == "PLTE") {
+      for (size_t i = 0; i + 3 <= chunk.size(); i += 3) {
+        decoder->palette_.push_back(
+            MakePixel(chunk[i], chunk[i + 1], chunk[i + 2], 255));
+      }
+    } else if (type == "tRNS") {
+      if (decoder->color_type_ == kPngPalette) {
+        for (size_t i = 0; i < chunk.size() && i < decoder->palette_.size();
+             i++) {
+          decoder->palette_[i].alpha = static_cast<unsigned char>(chunk[i]);
+        }
+      } else if (decoder->color_type_ == kPngGray && chunk.size() == 2) {
+        decoder->transparent_sample_ = static_cast<unsigned char>(chunk[1]);
+      } else if (decoder->color_type_ == kPngRgb && chunk.size() == 6) {
+        decoder->transparent_sample_ =
+            (static_cast<unsigned char>(chunk[1]) << 16) |
+            (static_cast<unsigned char>(chunk[3]) << 8) |
+            static_cast<unsigned char>(chunk[5]);
+      }
+    } else if (type == "IDAT") {
+      decoder->chunks_.push_back(chunk);
+    } else if (type == "IEND") {
+      break;
+    }
+  }
+  switch (decoder->color_type_) {
+    case kPngGray:
+    case kPngPalette:
+      decoder->channels_ = 1;
+      break;
+    case kPngGrayAlpha:
+      decoder->channels_ = 2;
+      break;
+    case kPngRgb:
+      decoder->channels_ = 3;
+      break;
+    case kPngRgba:
+      decoder->channels_ = 4;
+      break;
+    default:
+      return nullptr;
+  }
+  if (!has_header || bit_depth != 8 || decoder->chunks_.empty() ||
+      (decoder->color_type_ == kPngPalette && decoder->palette_.empty())) {
+    return nullptr;
+  }
+  decoder->scanline_size_ =
+      static_cast<size_t>(decoder->width_) * decoder->channels_;
+  int64_t compressed_size = 0;
+  for (absl::string_view chunk : decoder->chunks_) {
+    compressed_size += chunk.size();
+  }
+  // Each row is a filter type byte and its samples.
+  const int64_t filtered_size =
+      static_cast<int64_t>(decoder->scanline_size_ + 1) * decoder->height_;
+  if (compressed_size * kMaxDeflateRatio < filtered_size) {
+    return nullptr;
+  }
+  decoder->filtered_.resize(decoder->scanline_size_ + 1);
+  return decoder;
+}
+
+std::unique_ptr<PngRowDecoder::State> PngRowDecoder::NewState() const {
+  auto state = std::make_unique<State>();
+  if (inflateInit(&state->stream) != Z_OK) {
+    return nullptr;
+  }
+  state->initialized = true;
+  state->stream.next_in =
+      reinterpret_cast<Bytef *>(const_cast<char *>(chunks_[0].data()));
+  state->stream.avail_in = static_cast<uInt>(chunks_[0].size());
+  state->previous.assign(scanline_size_, 0);
+  return state;
+}
+
+std::unique_ptr<PngRowDecoder::State> PngRowDecoder::CopyState(
+    const State &state) const {
+  auto copy = std::make_unique<State>();
+  if (inflateCopy(&copy->stream, const_cast<z_stream *>(&state.stream)) !=
+      Z_OK) {
+    return nullptr;
+  }
+  copy->initialized = true;
+  copy->chunk = state.chunk;
+  copy->next_row = state.next_row;
+  copy->previous = state.previous;
+  return copy;
+}
+
+bool PngRowDecoder::DecodeScanline(State *state) {
+  z_stream &stream = state->stream;
+  stream.next_out = filtered_.data();
+  stream.avail_out = static_cast<uInt>(filtered_.size());
+  while (stream.avail_out > 0) {
+    if (stream.avail_in == 0) {
+      if (state->chunk + 1 >= chunks_.size()) {
+        return false;
+      }
+      state->chunk++;
+      const absl::string_view chunk = chunks_[state->chunk];
+      stream.next_in =
+          reinterpret_cast<Bytef *>(const_cast<char *>(chunk.data()));
+      stream.avail_in = static_cast<uInt>(chunk.size());
+      continue;
+    }
+    const int status = inflate(&stream, Z_NO_FLUSH);
+    if (status == Z_STREAM_END) {
+      if (stream.avail_out > 0) {
+        return false;
+      }
+      break;
+    }
+    if (status != Z_OK && status != Z_BUF_ERROR) {
+      return false;
+    }
+  }
+  // Unfilter in place: bytes to the left are already unfiltered.
+  unsigned char *current = filtered_.data() + 1;
+  const unsigned char *above = state->previous.data();
+  const size_t size = scanline_size_;
+  const size_t left = static_cast<size_t>(channels_);
+  switch (filtered_[0]) {
+    case kPngFilterNone:
+      break;
+    case kPngFilterSub:
+      for (size_t i = left; i < size; i++) {
+        current[i] += current[i - left];
+      }
+      break;
+    case kPngFilterUp:
+      for (size_t i = 0; i < size; i++) {
+        current[i] += above[i];
+      }
+      break;
+    case kPngFilterAverage:
+      for (size_t i = 0; i < size; i++) {
+        const int a = i >= left ? current[i - left] : 0;
+        current[i] += static_cast<unsigned char>((a + above[i]) / 2);
+      }
+      break;
+    case kPngFilterPaeth:
+      for (size_t i = 0; i < size; i++) {
+        const int a = i >= left ? current[i - left] : 0;
+        const int b = above[i];
+        const int c = i >= left ? above[i - left] : 0;
+        const int pa = abs(b - c);
+        const int pb = abs(a - c);
+        const int pc = abs(a + b - 2 * c);
+        const int predictor = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+        current[i] += static_cast<unsigned char>(predictor);
+      }
+      break;
+    default:
+      return false;
+  }
+  memcpy(state->previous.data(), current, size);
+  return true;
+}
+
+void PngRowDecoder::ConvertScanline(const unsigned char *scanline,
+                                    Pixel *pixels) const {
+  for (int x = 0; x < width_; x++) {
+    const unsigned char *sample = scanline + static_cast<size_t>(x) * channels_;
+    switch (color_type_) {
+      case kPngGray:
+        pixels[x] = MakePixel(sample[0], sample[0], sample[0],
+                              sample[0] == transparent_sample_ ? 0 : 255);
+        break;
+      case kPngRgb: {
+        const int32_t rgb = (sample[0] << 16) | (sample[1] << 8) | sample[2];
+        pixels[x] = MakePixel(sample[0], sample[1], sample[2],
+                              rgb == transparent_sample_ ? 0 : 255);
+        break;
+      }
+      case kPngPalette:
+        pixels[x] = sample[0] < palette_.size() ? palette_[sample[0]]
+                                                : MakePixel(0, 0, 0, 0);
+        break;
+      case kPngGrayAlpha:
+        pixels[x] = MakePixel(sample[0], sample[0], sample[0], sample[1]);
+        break;
+      case kPngRgba:
+        pixels[x] = MakePixel(sample[0], sample[1], sample[2], sample[3]);
+        break;
+    }
+  }
+}
+
+bool PngRowDecoder::DecodeRows(int first_row, int row_count, Pixel *pixels) {
+  if (failed_) {
+    return false;
+  }
+  // Resume from the nearest checkpoint unless the current state is between
+  // it and the first row.
+  const int checkpoint = std::min(first_row / checkpoint_rows_,
+                                  static_cast<int>(checkpoints_.size()) - 1);
+  if (state_ == nullptr || state_->next_row > first_row ||
+      (checkpoint >= 0 &&
+       checkpoints_[checkpoint]->next_row > state_->next_row)) {
+    state_ = checkpoint >= 0 ? CopyState(*checkpoints_[checkpoint])
+                             : NewState();
+    if (state_ == nullptr) {
+      failed_ = true;
+      return false;
+    }
+  }
+  const int end_row = first_row + row_count;
+  while (state_->next_row < end_row) {
+    const int row = state_->next_row;
+    if (row % checkpoint_rows_ == 0 &&
+        row / checkpoint_rows_ == static_cast<int>(checkpoints_.size())) {
+      std::unique_ptr<State> copy = CopyState(*state_);
+      if (copy == nullptr) {
+        failed_ = true;
+        return false;
+      }
+      checkpoints_.push_back(std::move(copy));
+    }
+    if (!DecodeScanline(state_.get())) {
+      failed_ = true;
+      return false;
+    }
+    state_->next_row++;
+    if (row >= first_row) {
+      ConvertScanline(state_->previous.data(),
+                      pixels + static_cast<size_t>(row - first_row) * width_);
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+std::unique_ptr<ScreenshotRowDecoder> NewScreenshotRowDecoder(
+    absl::string_view data, int checkpoint_rows) {
+  std::unique_ptr<ScreenshotRowDecoder> decoder =
+      PngRowDecoder::Create(data, checkpoint_rows);
+  if (decoder == nullptr) {
+    decoder = PpmRowDecoder::Create(data);
+  }
+  return decoder;
+}
+
+constexpr int BandedScreenshot::kDefaultBandHeight;
+constexpr int BandedScreenshot::kDefaultMaxCachedBands;
+
+std::unique_ptr<BandedScreenshot> BandedScreenshot::Open(
+    const std::string &path, int band_height, int max_cached_bands) {
+  std::unique_ptr<MappedFile> file = MappedFile::Open(path);
+  if (file == nullptr || file->data() == nullptr) {
+    return nullptr;
+  }
+  std::unique_ptr<BandedScreenshot> screenshot = FromData(
+      absl::string_view(static_cast<const char *>(file->data()), file->size()),
+      band_height, max_cached_bands);
+  if (screenshot != nullptr) {
+    screenshot->file_ = std::move(file);
+  }
+  return screenshot;
+}
+
+std::unique_ptr<BandedScreenshot> BandedScreenshot::FromData(
+    absl::string_view data, int band_height, int max_cached_bands) {
+  band_height = std::max(1, band_height);
+  std::unique_ptr<ScreenshotRowDecoder> decoder =
+      NewScreenshotRowDecoder(data, band_height);
+  if (decoder == nullptr) {
+    return nullptr;
+  }
+  return std::make_unique<BandedScreenshot>(std::move(decoder), band_height,
+                                            max_cached_bands);
+}
+
+BandedScreenshot::BandedScreenshot(
+    std::unique_ptr<ScreenshotRowDecoder> decoder, int band_height,
+    int max_cached_bands)
+    : decoder_(std::move(decoder)),
+      width_(decoder_->width()),
+      height_(decoder_->height()),
+      band_height_(std::max(1, band_height)),
+      max_cached_bands_(std::max(1, max_cached_bands)) {}
+
+ScreenshotRows BandedScreenshot::Rows(int first_row, int end_row) const {
+  first_row = std::max(0, first_row);
+  end_row = std::min(height_, end_row);
+  if (first_row >= end_row) {
+    return ScreenshotRows();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int first_band = first_row / band_height_;
+  const int last_band = (end_row - 1) / band_height_;
+  if (first_band == last_band) {
+    const size_t offset =
+        static_cast<size_t>(first_row - first_band * band_height_) * width_;
+    return ScreenshotRows(GetBand(first_band), width_, first_row,
+                          end_row - first_row, offset);
+  }
+  auto pixels = std::make_shared<std::vector<Pixel>>(
+      static_cast<size_t>(end_row - first_row) * width_);
+  for (int band = first_band; band <= last_band; band++) {
+    std::shared_ptr<std::vector<Pixel>> band_pixels = GetBand(band);
+    const int band_first_row = band * band_height_;
+    const int copy_first_row = std::max(first_row, band_first_row);
+    const int copy_end_row =
+        std::min(end_row, band_first_row + band_height_);
+    std::copy(band_pixels->begin() +
+                  static_cast<size_t>(copy_first_row - band_first_row) *
+                      width_,
+              band_pixels->begin() +
+                  static_cast<size_t>(copy_end_row - band_first_row) * width_,
+              pixels->begin() +
+                  static_cast<size_t>(copy_first_row - first_row) * width_);
+  }
+  return ScreenshotRows(std::move(pixels), width_, first_row,
+                        end_row - first_row);
+}
+
+std::shared_ptr<std::vector<Pixel>> BandedScreenshot::GetBand(
+    int index) const {
+  for (auto band = bands_.begin(); band != bands_.end(); ++band) {
+    if (band->index == index) {
+      bands_.splice(bands_.begin(), bands_, band);
+      return band->pixels;
+    }
+  }
+  const int first_row = index * band_height_;
+  const int row_count = std::min(band_height_, height_ - first_row);
+  auto pixels = std::make_shared<std::vector<Pixel>>(
+      static_cast<size_t>(row_count) * width_);
+  if (!decoder_->DecodeRows(first_row, row_count, pixels->data())) {
+    ok_ = false;
+    std::fill(pixels->begin(), pixels->end(), Pixel());
+  }
+  decoded_band_count_++;
+  while (bands_.size() >= max_cached_bands_) {
+    cached_bytes_ -= bands_.back().pixels->size() * sizeof(Pixel);
+    bands_.pop_back();
+  }
+  bands_.push_front(Band{index, pixels});
+  cached_bytes_ += pixels->size() * sizeof(Pixel);
+  peak_cached_bytes_ = std::max(peak_cached_bytes_, cached_bytes_);
+  return pixels;
+}
+
+bool BandedScreenshot::ok() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ok_;
+}
+
+int64_t BandedScreenshot::decoded_band_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return decoded_band_count_;
+}
+
+size_t BandedScreenshot::peak_cached_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return peak_cached_bytes_;
+}
+
+}  // namespace gtx
@@ -0,0 +1,156 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_BANDED_SCREENSHOT_H_
+#define GTXILIB_OOPCLASSES_BANDED_SCREENSHOT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <abseil/absl/strings/string_view.h>
+#include "gtx_types.h"
+#include "mapped_file.h"
+
+namespace gtx {
+
+// Decodes rows of an encoded screenshot on demand.
+class ScreenshotRowDecoder {
+ public:
+  virtual ~ScreenshotRowDecoder() {}
+
+  virtual int width() const = 0;
+  virtual int height() const = 0;
+
+  // Decodes the @c row_count rows from @c first_row into @c pixels, which
+  // holds width() * row_count pixels. Rows may be decoded in any order.
+  // Returns false if the encoded data is corrupt. Not thread safe.
+  virtual bool DecodeRows(int first_row, int row_count, Pixel *pixels) = 0;
+};
+
+// Returns a decoder of @c data, a PNG or a binary PPM (P6) file, or nullptr
+// if it is neither or uses features not supported. PNGs must have 8 bits
+// per channel and no interlacing; their checksums are not verified. PNG rows
+// can only be decoded in order, so the decoder keeps its state every
+// @c checkpoint_rows rows, to decode earlier rows again from the nearest
+// checkpoint rather than from the start. @c data must outlive the decoder.
+std::unique_ptr<ScreenshotRowDecoder> NewScreenshotRowDecoder(
+    absl::string_view data, int checkpoint_rows);
+
+// Contiguous decoded rows of a BandedScreenshot, which stay valid as long as
+// this object does.
+class ScreenshotRows {
+ public:
+  ScreenshotRows() {}
+  ScreenshotRows(std::shared_ptr<std::vector<Pixel>> pixels, int width,
+                 int first_row, int row_count, size_t offset = 0)
+      : pixels_(std::move(pixels)),
+        image_(pixels_->data() + offset, width, row_count),
+        first_row_(first_row) {}
+
+  // The rows, as an image as wide as the screenshot.
+  const Image &image() const { return image_; }
+
+  // The row of the screenshot that is the first row of image().
+  int first_row() const { return first_row_; }
+
+ private:
+  std::shared_ptr<std::vector<Pixel>> pixels_;
+  Image image_ = Image(nullptr, 0, 0);
+  int first_row_ = 0;
+};
+
+// A screenshot decoded in bands of rows when they are first read, for
+// screenshots received encoded, such as PNG files on Linux, of which image
+// checks read only the rows under a few elements. At most
+// @c max_cached_bands bands are kept decoded; the least recently read is
+// discarded for a new one. Thread safe: decoding is serialized.
+class BandedScreenshot {
+ public:
+  static constexpr int kDefaultBandHeight = 64;
+  static constexpr int kDefaultMaxCachedBands = 16;
+
+  // Opens the PNG or binary PPM file at @c path. Returns nullptr if the file
+  // cannot be read or NewScreenshotRowDecoder does not support it.
+  static std::unique_ptr<BandedScreenshot> Open(
+      const std::string &path, int band_height = kDefaultBandHeight,
+      int max_cached_bands = kDefaultMaxCachedBands);
+
+  // Like Open, but decodes @c data, which must outlive the screenshot.
+  static std::unique_ptr<BandedScreenshot> FromData(
+      absl::string_view data, int band_height = kDefaultBandHeight,
+      int max_cached_bands = kDefaultMaxCachedBands);
+
+  BandedScreenshot(std::unique_ptr<ScreenshotRowDecoder> decoder,
+                   int band_height, int max_cached_bands);
+
+  BandedScreenshot(const BandedScreenshot &) = delete;
+  BandedScreenshot &operator=(const BandedScreenshot &) = delete;
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  int band_height() const { return band_height_; }
+
+  // Returns the rows from @c first_row up to @c end_row, which are clipped to
+  // the screenshot. Rows within one band are returned without copying.
+  ScreenshotRows Rows(int first_row, int end_row) const;
+
+  // False if the encoded data was found corrupt. The rows of bands that
+  // could not be decoded are transparent black.
+  bool ok() const;
+
+  // The number of bands decoded so far, counting bands decoded again after
+  // being discarded.
+  int64_t decoded_band_count() const;
+
+  // The most bytes of decoded pixels held at once by the band cache.
+  size_t peak_cached_bytes() const;
+
+ private:
+  struct Band {
+    int index;
+    std::shared_ptr<std::vector<Pixel>> pixels;
+  };
+
+  // Returns band @c index, decoding it if it is not cached. Requires mutex_.
+  std::shared_ptr<std::vector<Pixel>> GetBand(int index) const;
+
+  // Set if the screenshot was opened from a file, whose mapping the decoder
+  // reads.
+  std::unique_ptr<MappedFile> file_;
+  const std::unique_ptr<ScreenshotRowDecoder> decoder_;
+  const int width_;
+  const int height_;
+  const int band_height_;
+  const size_t max_cached_bands_;
+  mutable std::mutex mutex_;
+  // Most recently read first.
+  mutable std::list<Band> bands_;
+  mutable bool ok_ = true;
+  mutable int64_t decoded_band_count_ = 0;
+  mutable size_t cached_bytes_ = 0;
+  mutable size_t peak_cached_bytes_ = 0;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_BANDED_SCREENSHOT_H_
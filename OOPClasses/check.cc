@@ -23,10 +23,13 @@
 
 #include <abseil/absl/strings/str_cat.h>
 #include <abseil/absl/types/optional.h>
+#include <abseil/absl/types/span.h>
 #include "metadata_map.h"
 #include "result.pb.h"
 #include "typedefs.h"
+#include "hierarchy_table.h"
 #include "localized_strings_manager.h"
+#include "tracer.h"
 #include "xml_utils.h"
 #include "tinyxml2.h"
 
@@ -54,12 +57,20 @@ absl::optional<std::string> RemoveFormatting(absl::string_view string) {
 }
 }  // namespace
 
+constexpr int CompactCheckResult::kMaxValues;
+constexpr int CompactCheckResult::kMaxColors;
+
 CheckResultProto Check::CheckResult(int result_id,
                                     const UIElementProto &element,
                                     const MetadataMap &metadata) const {
+  return CheckResult(result_id, element.id(), metadata);
+}
+
+CheckResultProto Check::CheckResult(int result_id, int32_t element_id,
+                                    const MetadataMap &metadata) const {
   CheckResultProto check_result;
   check_result.set_source_check_class(name());
-  check_result.set_hierarchy_source_id(element.id());
+  check_result.set_hierarchy_source_id(element_id);
   check_result.set_result_id(result_id);
   check_result.set_result_type(
       gtxilib::oopclasses::protos::RESULT_TYPE_ERROR);
@@ -67,9 +78,53 @@ CheckResultProto Check::CheckResult(int result_id,
   return check_result;
 }
 
+bool Check::CheckElementCompact(const UIElementProto &element,
+                                const Parameters &params,
+                                CompactCheckResult *result) const {
+  absl::optional<CheckResultProto> check_result =
+      CheckElement(element, params);
+  if (!check_result.has_value()) {
+    return false;
+  }
+  result->result_id = check_result->result_id();
+  return true;
+}
+
+CheckResultProto Check::ExpandCompactResult(const CompactCheckResult &result,
+                                            const UIElementProto &element,
+                                            const Parameters &params) const {
+  absl::optional<CheckResultProto> check_result =
+      CheckElement(element, params);
+  if (!check_result.has_value()) {
+    // Only checks that depend on more than the element and the parameters
+    // can pass now, in which case the result has no metadata.
+    return CheckResult(result.result_id, element.id(), MetadataMap());
+  }
+  return *std::move(check_result);
+}
+
+void Check::CheckElementsInTable(
+    const HierarchyTable &table, absl::Span<const int> element_indices,
+    const Parameters &params, std::vector<IndexedCheckResult> &results) const {
+  const AccessibilityHierarchyProto *hierarchy = table.hierarchy();
+  for (int index : element_indices) {
+    // Tables constructed from snapshots have no protos to pass to
+    // CheckElement, so elements are copied out of the snapshot one at a time.
+    absl::optional<CheckResultProto> check_result =
+        hierarchy != nullptr
+            ? CheckElement(hierarchy->elements(index), params)
+            : CheckElement(table.ElementProto(index), params);
+    if (check_result.has_value()) {
+      results.push_back({index, *std::move(check_result)});
+    }
+  }
+}
+
 std::string Check::GetRichMessage(
     Locale locale, int result_id, const MetadataMap &metadata,
     const LocalizedStringsManager &string_manager) const {
+  ScopedTraceSpan span(Tracer::Current(), "Check::GetRichMessage", "render",
+                       "result_id", result_id);
   std::string message =
       GetDefaultMessage(locale, result_id, metadata, string_manager);
   for (const MessageProvider &message_provider : message_providers_) {
@@ -22,10 +22,12 @@
 #include <vector>
 
 #include <abseil/absl/types/optional.h>
+#include <abseil/absl/types/span.h>
 #include "metadata_map.h"
 #include "typedefs.h"
 #include "error_message.h"
 #include "gtx_types.h"
+#include "hierarchy_table.h"
 #include "localized_strings_manager.h"
 #include "parameters.h"
 
@@ -50,12 +52,48 @@ enum class CheckCategory {
   kLowContrast
 };
 
+// How expensive a Check is to run on an element. Toolkit uses it to schedule
+// checks.
+enum class CheckCostClass {
+  // Inspects the properties of elements only, in about a microsecond.
+  kMetadata,
+  // Reads the pixels of the screenshot under elements, in time that grows
+  // with their area.
+  kImage
+};
+
 // Converts a string returned by Check::GetRichMessage to a new string.
 using MessageProvider =
     std::function<std::string(std::string old_string, Locale locale,
                               int result_id, const MetadataMap &metadata,
                               const LocalizedStringsManager &string_manager)>;
 
+// A CheckResultProto and the index of the element it was produced for in a
+// HierarchyTable.
+struct IndexedCheckResult {
+  int element_index;
+  CheckResultProto check_result;
+};
+
+// A check result as plain data, without the strings and the metadata map of a
+// CheckResultProto, for evaluations that only count or store results. The
+// metadata is a few numbers and colors whose meaning the producing check
+// defines, and Check::ExpandCompactResult converts the result to the
+// CheckResultProto CheckElement would have returned.
+struct CompactCheckResult {
+  static constexpr int kMaxValues = 4;
+  static constexpr int kMaxColors = 2;
+
+  // The index of the producing check among the checks of a Toolkit.
+  int32_t check_index = 0;
+  int32_t result_id = 0;
+  // The id and the index in its hierarchy of the element.
+  int32_t element_id = 0;
+  int32_t element_index = 0;
+  float values[kMaxValues] = {};
+  Color colors[kMaxColors] = {};
+};
+
 // Check can be used for encapsulating checking logic. To execute a check, it
 // must be registers with a @c gtx::Toolkit object and executed through it.
 class Check {
@@ -70,12 +108,49 @@ class Check {
   // The category of accessibility issue this Check is checking for.
   virtual CheckCategory Category() const = 0;
 
+  // How expensive this check is. Toolkit can run checks of class kImage
+  // after the other checks and on several threads, see
+  // Toolkit::set_image_check_executor, and does not run them if the
+  // screenshot has no pixels. Defaults to kMetadata.
+  virtual CheckCostClass CostClass() const {
+    return CheckCostClass::kMetadata;
+  }
+
   // Performs the check, and returns a CheckResultProto describing an
   // accessibility issue of element. Returns std:nullopt if this check doesn't
   // apply to element or if element passes the check.
   virtual absl::optional<CheckResultProto> CheckElement(
       const UIElementProto &element, const Parameters &params) const = 0;
 
+  // Performs the check on the elements at @c element_indices in @c table and
+  // appends a result for each accessibility issue found to @c results, in the
+  // order of @c element_indices. Produces the same results as CheckElement
+  // would for the corresponding elements. The default implementation calls
+  // CheckElement on each element of the hierarchy or snapshot the table was
+  // created from, checks can override it to process the table's columns in
+  // bulk instead.
+  virtual void CheckElementsInTable(
+      const HierarchyTable &table, absl::Span<const int> element_indices,
+      const Parameters &params, std::vector<IndexedCheckResult> &results) const;
+
+  // Performs the check like CheckElement, but describes the accessibility
+  // issue, if any, in the result id and metadata of @c result instead of
+  // building a CheckResultProto. Returns false if element passes the check or
+  // the check doesn't apply to it. The caller sets the other fields of
+  // @c result. The default implementation calls CheckElement and keeps only
+  // the result id, checks override it together with ExpandCompactResult to
+  // avoid building protos.
+  virtual bool CheckElementCompact(const UIElementProto &element,
+                                   const Parameters &params,
+                                   CompactCheckResult *result) const;
+
+  // Returns the CheckResultProto CheckElement returns for @c element, given
+  // the @c result CheckElementCompact described for it with the same
+  // @c params. The default implementation calls CheckElement again.
+  virtual CheckResultProto ExpandCompactResult(
+      const CompactCheckResult &result, const UIElementProto &element,
+      const Parameters &params) const;
+
   // Returns a human readable description of a check result produced by this
   // check with the given result_id and metadata in the given locale. This
   // message may contain rich text formatting.
@@ -133,6 +208,11 @@ class Check {
   CheckResultProto CheckResult(int result_id, const UIElementProto &element,
                                const MetadataMap &metadata) const;
 
+  // Constructs a CheckResultProto associated with this check for the element
+  // with the given id.
+  CheckResultProto CheckResult(int result_id, int32_t element_id,
+                               const MetadataMap &metadata) const;
+
  private:
   // The result of GetDefaultMessage is passed to the first element of
   // message_providers_, the result of which is passed to the second element,
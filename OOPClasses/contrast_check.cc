@@ -16,21 +16,30 @@
 
 #include "contrast_check.h"
 
+#include <stdint.h>
+
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <abseil/absl/strings/str_format.h>
 #include <abseil/absl/strings/substitute.h>
 #include <abseil/absl/types/optional.h>
+#include <abseil/absl/types/span.h>
 #include "metadata_map.h"
 #include "proto_utils.h"
 #include "typedefs.h"
+#include "banded_screenshot.h"
 #include "check.h"
 #include "contrast_swatch.h"
 #include "gtx_types.h"
+#include "hierarchy_table.h"
 #include "image_color_utils.h"
 #include "localized_string_ids.h"
 #include "localized_strings_manager.h"
+#include "palette_image.h"
 #include "parameters.h"
+#include "rle_image.h"
 
 namespace gtx {
 
@@ -45,6 +54,40 @@ std::string StringFromColor(const Color &color) {
   return absl::StrFormat("(%d, %d, %d, %d)", color.red, color.green, color.blue,
                          color.alpha);
 }
+
+// Extracts the swatch of @c bounds from the cheapest representation of the
+// screenshot that @c params has.
+ContrastSwatch ExtractSwatch(const Parameters &params, const Rect &bounds) {
+  if (params.rle_screenshot() != nullptr) {
+    return ContrastSwatch::Extract(*params.rle_screenshot(), bounds);
+  }
+  if (params.palette_screenshot() != nullptr) {
+    return ContrastSwatch::Extract(*params.palette_screenshot(), bounds);
+  }
+  if (params.banded_screenshot() != nullptr) {
+    return ContrastSwatch::Extract(*params.banded_screenshot(), bounds);
+  }
+  return ContrastSwatch::Extract(params.screenshot(), bounds);
+}
+
+// Like ExtractSwatch, but estimates the swatch from every @c stride-th pixel
+// of every @c stride-th row.
+absl::optional<ContrastSwatch> EstimateSwatch(const Parameters &params,
+                                              const Rect &bounds,
+                                              int stride) {
+  if (params.rle_screenshot() != nullptr) {
+    return ContrastSwatch::Estimate(*params.rle_screenshot(), bounds, stride);
+  }
+  if (params.palette_screenshot() != nullptr) {
+    return ContrastSwatch::Estimate(*params.palette_screenshot(), bounds,
+                                    stride);
+  }
+  if (params.banded_screenshot() != nullptr) {
+    return ContrastSwatch::Estimate(*params.banded_screenshot(), bounds,
+                                    stride);
+  }
+  return ContrastSwatch::Estimate(params.screenshot(), bounds, stride);
+}
 }  // namespace
 
 /**
@@ -58,29 +101,121 @@ CheckCategory ContrastCheck::Category() const {
   return CheckCategory::kLowContrast;
 }
 
+CheckCostClass ContrastCheck::CostClass() const {
+  return CheckCostClass::kImage;
+}
+
 absl::optional<CheckResultProto> ContrastCheck::CheckElement(
     const UIElementProto &element, const Parameters &params) const {
   if (!IsStaticTextElement(element)) {
     return absl::nullopt;
   }
-  Rect frame(element.ax_frame());
+  return CheckFrame(element.id(), Rect(element.ax_frame()), params);
+}
+
+void ContrastCheck::CheckElementsInTable(
+    const HierarchyTable &table, absl::Span<const int> element_indices,
+    const Parameters &params, std::vector<IndexedCheckResult> &results) const {
+  for (int index : element_indices) {
+    if (!table.IsStaticTextElement(index)) {
+      continue;
+    }
+    const Float4 &frame = table.ax_frames()[index];
+    absl::optional<CheckResultProto> check_result =
+        CheckFrame(table.ids()[index],
+                   Rect(frame.x, frame.y, frame.width, frame.height), params);
+    if (check_result.has_value()) {
+      results.push_back({index, *std::move(check_result)});
+    }
+  }
+}
+
+bool ContrastCheck::CheckElementCompact(const UIElementProto &element,
+                                        const Parameters &params,
+                                        CompactCheckResult *result) const {
+  if (!IsStaticTextElement(element) ||
+      !FindInsufficientContrast(Rect(element.ax_frame()), params,
+                                &result->values[0], &result->colors[0],
+                                &result->colors[1])) {
+    return false;
+  }
+  result->result_id = RESULT_ID_INSUFFICIENT_CONTRAST_RATIO;
+  return true;
+}
+
+CheckResultProto ContrastCheck::ExpandCompactResult(
+    const CompactCheckResult &result, const UIElementProto &element,
+    const Parameters &params) const {
+  return ContrastResult(element.id(), result.values[0], result.colors[0],
+                        result.colors[1]);
+}
+
+absl::optional<CheckResultProto> ContrastCheck::CheckFrame(
+    int32_t element_id, const Rect &frame, const Parameters &params) const {
+  float contrast_ratio;
+  Color foreground;
+  Color background;
+  if (!FindInsufficientContrast(frame, params, &contrast_ratio, &foreground,
+                                &background)) {
+    return absl::nullopt;
+  }
+  return ContrastResult(element_id, contrast_ratio, foreground, background);
+}
+
+bool ContrastCheck::FindInsufficientContrast(const Rect &frame,
+                                             const Parameters &params,
+                                             float *contrast_ratio,
+                                             Color *foreground,
+                                             Color *background) const {
   Rect screenshot_bounds = params.ConvertRectToScreenshotSpace(frame);
-  ContrastSwatch swatch =
-      ContrastSwatch::Extract(params.screenshot(), screenshot_bounds);
-  float contrast_ratio = image_color_utils::ContrastRatio(
+  if (approximation_.has_value() &&
+      EstimatePasses(screenshot_bounds, params)) {
+    return false;
+  }
+  ContrastSwatch swatch = ExtractSwatch(params, screenshot_bounds);
+  if (swatch.empty()) {
+    // The text is not in the screenshot, so its contrast is unknown.
+    return false;
+  }
+  *contrast_ratio = image_color_utils::ContrastRatio(
       swatch.foreground().Luminance(), swatch.background().Luminance());
-  if (contrast_ratio >= kMinContrastRatioForAccessibleText) {
-    return absl::nullopt;
+  if (*contrast_ratio >= kMinContrastRatioForAccessibleText) {
+    return false;
   }
+  *foreground = swatch.foreground();
+  *background = swatch.background();
+  return true;
+}
+
+CheckResultProto ContrastCheck::ContrastResult(int32_t element_id,
+                                               float contrast_ratio,
+                                               const Color &foreground,
+                                               const Color &background) const {
   MetadataMap metadata;
   metadata.SetFloat(KEY_EXPECTED_CONTRAST_RATIO,
                     kMinContrastRatioForAccessibleText);
   metadata.SetFloat(KEY_ACTUAL_CONTRAST_RATIO, contrast_ratio);
-  metadata.SetString(KEY_FOREGROUND_COLOR,
-                     StringFromColor(swatch.foreground()));
-  metadata.SetString(KEY_BACKGROUND_COLOR,
-                     StringFromColor(swatch.background()));
-  return CheckResult(RESULT_ID_INSUFFICIENT_CONTRAST_RATIO, element, metadata);
+  metadata.SetString(KEY_FOREGROUND_COLOR, StringFromColor(foreground));
+  metadata.SetString(KEY_BACKGROUND_COLOR, StringFromColor(background));
+  return CheckResult(RESULT_ID_INSUFFICIENT_CONTRAST_RATIO, element_id,
+                     metadata);
+}
+
+bool ContrastCheck::EstimatePasses(const Rect &screenshot_bounds,
+                                   const Parameters &params) const {
+  if (screenshot_bounds.size.width * screenshot_bounds.size.height <
+      approximation_->min_pixel_count) {
+    return false;
+  }
+  absl::optional<ContrastSwatch> estimate =
+      EstimateSwatch(params, screenshot_bounds, approximation_->stride);
+  if (!estimate.has_value()) {
+    return false;
+  }
+  float contrast_ratio = image_color_utils::ContrastRatio(
+      estimate->foreground().Luminance(), estimate->background().Luminance());
+  return contrast_ratio >=
+         kMinContrastRatioForAccessibleText + approximation_->margin;
 }
 
 std::string ContrastCheck::GetRichShortMessage(
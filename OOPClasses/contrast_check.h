@@ -18,18 +18,38 @@
 #define GTXILIB_OOPCLASSES_CONTRAST_CHECK_H_
 
 #include <string>
+#include <vector>
 
 #include <abseil/absl/types/optional.h>
+#include <abseil/absl/types/span.h>
 #include "metadata_map.h"
 #include "typedefs.h"
 #include "check.h"
 #include "contrast_swatch.h"
+#include "hierarchy_table.h"
 #include "image_color_utils.h"
 #include "localized_strings_manager.h"
 #include "parameters.h"
 
 namespace gtx {
 
+// Lets ContrastCheck decide large elements from a sample of their pixels.
+// Elements whose estimated contrast ratio is at least the margin above the
+// minimum pass without a full scan. All others are scanned exactly, so that
+// the results of elements that fail report their exact colors and ratio.
+struct ContrastApproximation {
+  // Elements are sampled at every stride-th pixel of every stride-th row,
+  // 1/16th of their pixels by default.
+  int stride = 4;
+
+  // How far above the minimum contrast ratio an estimate must be to pass.
+  float margin = 0.5f;
+
+  // Elements with fewer pixels than this are always scanned exactly, since
+  // their samples are too small to be decisive.
+  int min_pixel_count = 4096;
+};
+
 // Check for detecting low contrast text elements.
 class ContrastCheck : public Check {
  public:
@@ -42,13 +62,38 @@ class ContrastCheck : public Check {
   static constexpr char KEY_FOREGROUND_COLOR[] = "KEY_FOREGROUND_COLOR";
   static constexpr char KEY_BACKGROUND_COLOR[] = "KEY_BACKGROUND_COLOR";
 
+  // Constructs a check that scans the pixels of every element.
+  ContrastCheck() {}
+
+  // Constructs a check that estimates the contrast of large elements first,
+  // as @c approximation configures.
+  explicit ContrastCheck(const ContrastApproximation &approximation)
+      : approximation_(approximation) {}
+
   std::string name() const override;
 
   CheckCategory Category() const override;
 
+  CheckCostClass CostClass() const override;
+
   absl::optional<CheckResultProto> CheckElement(
       const UIElementProto &element, const Parameters &params) const override;
 
+  void CheckElementsInTable(
+      const HierarchyTable &table, absl::Span<const int> element_indices,
+      const Parameters &params,
+      std::vector<IndexedCheckResult> &results) const override;
+
+  // Describes the contrast ratio in the first value of @c result and the
+  // foreground and background colors in its colors, in that order.
+  bool CheckElementCompact(const UIElementProto &element,
+                           const Parameters &params,
+                           CompactCheckResult *result) const override;
+
+  CheckResultProto ExpandCompactResult(
+      const CompactCheckResult &result, const UIElementProto &element,
+      const Parameters &params) const override;
+
   std::string GetRichShortMessage(
       Locale locale, int result_id, const MetadataMap &metadata,
       const LocalizedStringsManager &string_manager) const override;
@@ -61,6 +106,33 @@ class ContrastCheck : public Check {
   std::string GetDefaultMessage(
       Locale locale, int result_id, const MetadataMap &metadata,
       const LocalizedStringsManager &string_manager) const override;
+
+ private:
+  // Returns a result for the element with the given id if the text in the
+  // given frame, in device coordinates, has insufficient contrast.
+  absl::optional<CheckResultProto> CheckFrame(int32_t element_id,
+                                              const Rect &frame,
+                                              const Parameters &params) const;
+
+  // Returns true if the text in the given frame, in device coordinates, has
+  // insufficient contrast, and sets @c contrast_ratio, @c foreground and
+  // @c background to the measured values.
+  bool FindInsufficientContrast(const Rect &frame, const Parameters &params,
+                                float *contrast_ratio, Color *foreground,
+                                Color *background) const;
+
+  // Returns the result for the element with the given id, whose text has the
+  // given colors and insufficient contrast ratio.
+  CheckResultProto ContrastResult(int32_t element_id, float contrast_ratio,
+                                  const Color &foreground,
+                                  const Color &background) const;
+
+  // Returns true if an estimate of the contrast of @c screenshot_bounds
+  // passes by more than the margin of the approximation.
+  bool EstimatePasses(const Rect &screenshot_bounds,
+                      const Parameters &params) const;
+
+  absl::optional<ContrastApproximation> approximation_;
 };
 
 }  // namespace gtx
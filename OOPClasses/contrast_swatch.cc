@@ -16,13 +16,23 @@
 
 #include "contrast_swatch.h"
 
+#include <math.h>
 #include <stdint.h>
 
+#include <algorithm>
+#include <functional>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include <abseil/absl/container/flat_hash_map.h>
 #include <abseil/absl/types/optional.h>
+#include "banded_screenshot.h"
 #include "gtx_types.h"
+#include "palette_image.h"
+#include "rle_image.h"
+#include "scratch_arena.h"
+#include "tracer.h"
 
 namespace gtx {
 
@@ -32,45 +42,351 @@ ContrastSwatch::ContrastSwatch(const Color &foreground,
   background_ = background;
 }
 
-ContrastSwatch ContrastSwatch::Extract(const Image &image,
-                                       const Rect &sub_image_bounds) {
-  // Extract a histogram of the colors in the given image (in the given bounds).
-  // To determine the most dominant colors.
-  std::unordered_map<int32_t, int> color_histogram;
-  const int max_index = image.width * image.height;
-  for (int x = 0; x < sub_image_bounds.size.width; x++) {
-    for (int y = 0; y < sub_image_bounds.size.height; y++) {
+ContrastSwatch::ContrastSwatch()
+    : foreground_(Color::UnpackedColor(0)),
+      background_(Color::UnpackedColor(0)),
+      empty_(true) {}
+
+namespace {
+
+// The fewest pixels a sample must have, and the fewest of them the second
+// most frequent color must cover, for ProminentColors::IsDecisive.
+constexpr int kMinDecisiveSampleCount = 64;
+constexpr int kMinDecisiveColorCount = 4;
+
+// Histograms of packed colors, allocated from the scratch arena of the
+// evaluation.
+using ColorHistogram =
+    std::unordered_map<int32_t, int, std::hash<int32_t>,
+                       std::equal_to<int32_t>,
+                       ArenaAllocator<std::pair<const int32_t, int>>>;
+using RunColorHistogram =
+    absl::flat_hash_map<int32_t, int, absl::Hash<int32_t>,
+                        std::equal_to<int32_t>,
+                        ArenaAllocator<std::pair<const int32_t, int>>>;
+
+// Finds the two most frequent colors of a histogram, given the count of each
+// color in turn.
+class ProminentColors {
+ public:
+  void Add(int32_t packed_color, int count) {
+    color_count_++;
+    total_count_ += count;
+    if (color_count_ == 1 ||
+        Precedes(packed_color, count, top_color_, top_count_)) {
+      third_count_ = penultimate_count_;
+      penultimate_color_ = top_color_;
+      penultimate_count_ = top_count_;
+      top_color_ = packed_color;
+      top_count_ = count;
+    } else if (color_count_ == 2 ||
+               Precedes(packed_color, count, penultimate_color_,
+                        penultimate_count_)) {
+      third_count_ = penultimate_count_;
+      penultimate_color_ = packed_color;
+      penultimate_count_ = count;
+    } else if (count > third_count_) {
+      third_count_ = count;
+    }
+  }
+
+  // Returns true if the two most frequent colors of a sample of pixels are
+  // clearly the two most frequent colors of all the pixels: the second is
+  // much more frequent than the third, and frequent enough that a stride did
+  // not simply happen to land on it.
+  bool IsDecisive() const {
+    if (total_count_ < kMinDecisiveSampleCount) {
+      return false;
+    }
+    if (color_count_ < 2) {
+      return true;
+    }
+    return penultimate_count_ >= kMinDecisiveColorCount &&
+           penultimate_count_ >= 2 * third_count_;
+  }
+
+  // The most frequent color is the background and the second most frequent
+  // the foreground. If only one color exists, it is considered both the
+  // foreground and the background color. If none exists, the swatch is
+  // empty.
+  ContrastSwatch Swatch() const {
+    if (color_count_ == 0) {
+      return ContrastSwatch();
+    }
+    if (color_count_ < 2) {
+      Color color = Color::UnpackedColor(top_color_);
+      return ContrastSwatch(color, color);
+    }
+    return ContrastSwatch(Color::UnpackedColor(penultimate_color_),
+                          Color::UnpackedColor(top_color_));
+  }
+
+ private:
+  // Orders colors by count, and colors of equal count by packed color, so
+  // that the swatch does not depend on the order of the histogram.
+  static bool Precedes(int32_t packed_color, int count,
+                       int32_t other_packed_color, int other_count) {
+    return count > other_count ||
+           (count == other_count && packed_color < other_packed_color);
+  }
+
+  size_t color_count_ = 0;
+  int64_t total_count_ = 0;
+  int32_t top_color_ = 0;
+  int top_count_ = 0;
+  int32_t penultimate_color_ = 0;
+  int penultimate_count_ = 0;
+  int third_count_ = 0;
+};
+
+// Calls @c visit with the index of each pixel of @c sub_image_bounds in an
+// image of @c width by @c height pixels, row by row. With a @c stride above
+// 1, visits only every stride-th pixel of every stride-th row.
+template <typename PixelVisitor>
+void ForEachPixelIndex(int width, int height, const Rect &sub_image_bounds,
+                       PixelVisitor visit, int stride = 1) {
+  const int max_index = width * height;
+  for (int y = 0; y < sub_image_bounds.size.height; y += stride) {
+    for (int x = 0; x < sub_image_bounds.size.width; x += stride) {
       int index = (x + sub_image_bounds.origin.x) +
-                  (y + sub_image_bounds.origin.y) * image.width;
+                  (y + sub_image_bounds.origin.y) * width;
       if (index >= 0 && index < max_index) {
-        int32_t packed_color = image.pixels[index].PackedColor();
-        color_histogram[packed_color] += 1;
+        visit(index);
       }
     }
   }
+}
 
-  // If only one color exists, it is considered both the foreground and the
-  // background color.
-  if (color_histogram.size() < 2) {
-    Color color = Color::UnpackedColor(color_histogram.cbegin()->first);
-    return ContrastSwatch(color, color);
+// Calls @c visit with the range of pixel indices, as ForEachPixelIndex
+// visits them, of each row of @c sub_image_bounds that is in an image of
+// @c width by @c height pixels. With a @c row_stride above 1, visits only
+// every row_stride-th row.
+template <typename RangeVisitor>
+void ForEachPixelIndexRange(int width, int height,
+                            const Rect &sub_image_bounds, RangeVisitor visit,
+                            int row_stride = 1) {
+  const int max_index = width * height;
+  const int row_length =
+      sub_image_bounds.size.width > 0
+          ? static_cast<int>(ceilf(sub_image_bounds.size.width))
+          : 0;
+  for (int y = 0; y < sub_image_bounds.size.height; y += row_stride) {
+    int begin = (0 + sub_image_bounds.origin.x) +
+                (y + sub_image_bounds.origin.y) * width;
+    int end = std::min(max_index, begin + row_length);
+    begin = std::max(0, begin);
+    if (begin < end) {
+      visit(begin, end);
+    }
   }
-  absl::optional<int> top_key = absl::nullopt;
-  absl::optional<int> penultimate_key = absl::nullopt;
-  for (auto const &[key, value] : color_histogram) {
-    if (!top_key || value > color_histogram[*top_key]) {
-      penultimate_key = top_key;
-      top_key = key;
-    } else if (!penultimate_key || value > color_histogram[*penultimate_key]) {
-      penultimate_key = key;
+}
+
+// Returns the prominent colors of the pixels of @c sub_image_bounds in
+// @c image, visited with @c stride, by counting their palette indices in
+// @c counts, which holds a zero for each color of the palette.
+template <typename Index>
+ProminentColors ColorsFromIndices(const PaletteImage &image,
+                                  const std::vector<Index> &indices,
+                                  const Rect &sub_image_bounds, int stride,
+                                  int *counts) {
+  ForEachPixelIndex(
+      image.width(), image.height(), sub_image_bounds,
+      [&indices, counts](int index) { counts[indices[index]]++; }, stride);
+  ProminentColors colors;
+  const std::vector<int32_t> &palette = image.palette();
+  for (size_t i = 0; i < palette.size(); i++) {
+    if (counts[i] > 0) {
+      colors.Add(palette[i], counts[i]);
     }
   }
+  return colors;
+}
+
+// Returns the prominent colors of the pixels of @c sub_image_bounds in
+// @c image, visited with @c stride.
+ProminentColors ColorsFromPixels(const Image &image,
+                                 const Rect &sub_image_bounds, int stride) {
+  ProminentColors colors;
+  if (image.pixels == nullptr) {
+    return colors;
+  }
+  // Extract a histogram of the colors in the given image (in the given bounds).
+  // To determine the most dominant colors.
+  ColorHistogram color_histogram;
+  ForEachPixelIndex(
+      image.width, image.height, sub_image_bounds,
+      [&image, &color_histogram](int index) {
+        color_histogram[image.pixels[index].PackedColor()] += 1;
+      },
+      stride);
+  for (const auto &color : color_histogram) {
+    colors.Add(color.first, color.second);
+  }
+  return colors;
+}
+
+// Returns the prominent colors of the pixels of @c sub_image_bounds in
+// @c image, visited with @c stride, decoding only the rows that contain
+// them.
+ProminentColors ColorsFromBands(const BandedScreenshot &image,
+                                const Rect &sub_image_bounds, int stride) {
+  ProminentColors colors;
+  const int width = image.width();
+  const int max_index = width * image.height();
+  if (sub_image_bounds.size.width <= 0 || sub_image_bounds.size.height <= 0 ||
+      max_index == 0) {
+    return colors;
+  }
+  // ForEachPixelIndex visits indices that grow with x and y, so the rows it
+  // reads are those of its first and last indices.
+  const int last_x = static_cast<int>(ceilf(sub_image_bounds.size.width)) - 1;
+  const int last_y = static_cast<int>(ceilf(sub_image_bounds.size.height)) - 1;
+  const int first_index =
+      sub_image_bounds.origin.x + sub_image_bounds.origin.y * width;
+  const int last_index = (last_x + sub_image_bounds.origin.x) +
+                         (last_y + sub_image_bounds.origin.y) * width;
+  if (last_index < 0 || first_index >= max_index) {
+    return colors;
+  }
+  const int first_row = std::max(0, first_index) / width;
+  const int last_row = std::min(max_index - 1, last_index) / width;
+  const ScreenshotRows rows = image.Rows(first_row, last_row + 1);
+  const Pixel *pixels = rows.image().pixels;
+  const int offset = first_row * width;
+  ColorHistogram color_histogram;
+  ForEachPixelIndex(
+      width, image.height(), sub_image_bounds,
+      [pixels, offset, &color_histogram](int index) {
+        color_histogram[pixels[index - offset].PackedColor()] += 1;
+      },
+      stride);
+  for (const auto &color : color_histogram) {
+    colors.Add(color.first, color.second);
+  }
+  return colors;
+}
+
+// Returns the prominent colors of the pixels of @c sub_image_bounds in
+// @c image, visited with @c stride, by counting their palette indices if
+// the image is indexed.
+ProminentColors ColorsFromPalette(const PaletteImage &image,
+                                  const Rect &sub_image_bounds, int stride) {
+  switch (image.encoding()) {
+    case PaletteImage::Encoding::kIndexed8: {
+      int counts[256] = {};
+      return ColorsFromIndices(image, image.indices8(), sub_image_bounds,
+                               stride, counts);
+    }
+    case PaletteImage::Encoding::kIndexed16: {
+      ScratchVector<int> counts(image.palette().size());
+      return ColorsFromIndices(image, image.indices16(), sub_image_bounds,
+                               stride, counts.data());
+    }
+    case PaletteImage::Encoding::kRgba:
+      break;
+  }
+  return ColorsFromPixels(image.RgbaImage(), sub_image_bounds, stride);
+}
+
+// Returns the prominent colors of the pixels of @c sub_image_bounds in
+// @c image, in every @c row_stride-th row, by counting the pixels of each
+// run at once.
+ProminentColors ColorsFromRuns(const RleImage &image,
+                               const Rect &sub_image_bounds, int row_stride) {
+  RunColorHistogram color_histogram;
+  ForEachPixelIndexRange(
+      image.width(), image.height(), sub_image_bounds,
+      [&image, &color_histogram](int begin, int end) {
+        image.ForEachRunInRange(begin, end,
+                                [&color_histogram](int32_t packed_color,
+                                                   int length) {
+                                  color_histogram[packed_color] += length;
+                                });
+      },
+      row_stride);
+  ProminentColors colors;
+  for (const auto &color : color_histogram) {
+    colors.Add(color.first, color.second);
+  }
+  return colors;
+}
+
+// Returns the swatch of @c colors, a sample of the pixels of a sub-image, or
+// nullopt if the sample does not decide the prominent colors of the
+// sub-image.
+absl::optional<ContrastSwatch> DecisiveSwatch(const ProminentColors &colors) {
+  if (!colors.IsDecisive()) {
+    return absl::nullopt;
+  }
+  return colors.Swatch();
+}
+
+// The number of pixels of @c sub_image_bounds, for tracing.
+int64_t PixelCount(const Rect &sub_image_bounds) {
+  return static_cast<int64_t>(sub_image_bounds.size.width *
+                              sub_image_bounds.size.height);
+}
+
+}  // namespace
+
+ContrastSwatch ContrastSwatch::Extract(const Image &image,
+                                       const Rect &sub_image_bounds) {
+  ScopedTraceSpan span(Tracer::Current(), "ContrastSwatch::Extract", "image",
+                       "pixels", PixelCount(sub_image_bounds));
+  return ColorsFromPixels(image, sub_image_bounds, 1).Swatch();
+}
+
+ContrastSwatch ContrastSwatch::Extract(const PaletteImage &image,
+                                       const Rect &sub_image_bounds) {
+  ScopedTraceSpan span(Tracer::Current(), "ContrastSwatch::Extract", "image",
+                       "pixels", PixelCount(sub_image_bounds));
+  return ColorsFromPalette(image, sub_image_bounds, 1).Swatch();
+}
+
+ContrastSwatch ContrastSwatch::Extract(const RleImage &image,
+                                       const Rect &sub_image_bounds) {
+  ScopedTraceSpan span(Tracer::Current(), "ContrastSwatch::Extract", "image",
+                       "pixels", PixelCount(sub_image_bounds));
+  return ColorsFromRuns(image, sub_image_bounds, 1).Swatch();
+}
+
+ContrastSwatch ContrastSwatch::Extract(const BandedScreenshot &image,
+                                       const Rect &sub_image_bounds) {
+  ScopedTraceSpan span(Tracer::Current(), "ContrastSwatch::Extract", "image",
+                       "pixels", PixelCount(sub_image_bounds));
+  return ColorsFromBands(image, sub_image_bounds, 1).Swatch();
+}
+
+absl::optional<ContrastSwatch> ContrastSwatch::Estimate(
+    const Image &image, const Rect &sub_image_bounds, int stride) {
+  ScopedTraceSpan span(Tracer::Current(), "ContrastSwatch::Estimate", "image",
+                       "pixels", PixelCount(sub_image_bounds));
+  return DecisiveSwatch(
+      ColorsFromPixels(image, sub_image_bounds, std::max(1, stride)));
+}
+
+absl::optional<ContrastSwatch> ContrastSwatch::Estimate(
+    const PaletteImage &image, const Rect &sub_image_bounds, int stride) {
+  ScopedTraceSpan span(Tracer::Current(), "ContrastSwatch::Estimate", "image",
+                       "pixels", PixelCount(sub_image_bounds));
+  return DecisiveSwatch(
+      ColorsFromPalette(image, sub_image_bounds, std::max(1, stride)));
+}
+
+absl::optional<ContrastSwatch> ContrastSwatch::Estimate(
+    const RleImage &image, const Rect &sub_image_bounds, int stride) {
+  ScopedTraceSpan span(Tracer::Current(), "ContrastSwatch::Estimate", "image",
+                       "pixels", PixelCount(sub_image_bounds));
+  return DecisiveSwatch(
+      ColorsFromRuns(image, sub_image_bounds, std::max(1, stride)));
+}
 
-  // Histogram is guaranteed to have 2 colors, so both top_key and
-  // penultimate_key will have been set.
-  Color background = Color::UnpackedColor(*top_key);
-  Color foreground = Color::UnpackedColor(*penultimate_key);
-  return ContrastSwatch(foreground, background);
+absl::optional<ContrastSwatch> ContrastSwatch::Estimate(
+    const BandedScreenshot &image, const Rect &sub_image_bounds, int stride) {
+  ScopedTraceSpan span(Tracer::Current(), "ContrastSwatch::Estimate", "image",
+                       "pixels", PixelCount(sub_image_bounds));
+  return DecisiveSwatch(
+      ColorsFromBands(image, sub_image_bounds, std::max(1, stride)));
 }
 
 }  // namespace gtx
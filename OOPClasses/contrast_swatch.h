@@ -17,8 +17,12 @@
 #ifndef GTXILIB_OOPCLASSES_CONTRAST_SWATCH_H_
 #define GTXILIB_OOPCLASSES_CONTRAST_SWATCH_H_
 
+#include <abseil/absl/types/optional.h>
+#include "banded_screenshot.h"
 #include "contrast_check.h"
 #include "gtx_types.h"
+#include "palette_image.h"
+#include "rle_image.h"
 
 namespace gtx {
 
@@ -28,11 +32,50 @@ class ContrastSwatch {
  public:
   ContrastSwatch(const Color &foreground, const Color &background);
 
+  // Constructs an empty swatch, of a sub-image without pixels.
+  ContrastSwatch();
+
   // Extracts prominent colors (foreground and background) from the given
-  // sub-image.
+  // sub-image. Returns an empty swatch if the sub-image has no pixels in the
+  // image, or the image has none.
   static ContrastSwatch Extract(const Image &image,
                                 const Rect &sub_image_bounds);
 
+  // Like Extract on the decoded image, but counts the colors of indexed
+  // images by their palette index, in an array instead of a hash map.
+  static ContrastSwatch Extract(const PaletteImage &image,
+                                const Rect &sub_image_bounds);
+
+  // Like Extract on the decoded image, but counts the pixels of each run
+  // that overlaps the sub-image at once, so that it takes time proportional
+  // to the number of runs rather than to the area.
+  static ContrastSwatch Extract(const RleImage &image,
+                                const Rect &sub_image_bounds);
+
+  // Like Extract on the decoded image, but decodes only the bands of rows
+  // that the sub-image covers.
+  static ContrastSwatch Extract(const BandedScreenshot &image,
+                                const Rect &sub_image_bounds);
+
+  // Estimates the swatch of the sub-image from every @c stride-th pixel of
+  // every @c stride-th row, or from every @c stride-th row of run length
+  // encoded images. Returns nullopt if the sample is too small, or if its
+  // second most frequent color is not clearly more frequent than the third,
+  // in which case the prominent colors of the sample may not be those of the
+  // sub-image.
+  static absl::optional<ContrastSwatch> Estimate(const Image &image,
+                                                 const Rect &sub_image_bounds,
+                                                 int stride);
+  static absl::optional<ContrastSwatch> Estimate(const PaletteImage &image,
+                                                 const Rect &sub_image_bounds,
+                                                 int stride);
+  static absl::optional<ContrastSwatch> Estimate(const RleImage &image,
+                                                 const Rect &sub_image_bounds,
+                                                 int stride);
+  static absl::optional<ContrastSwatch> Estimate(const BandedScreenshot &image,
+                                                 const Rect &sub_image_bounds,
+                                                 int stride);
+
   // The background color in the image. Will be black if no background color
   // could be identified.
   const Color &background() { return background_; }
@@ -41,8 +84,13 @@ class ContrastSwatch {
   // could be identified.
   const Color &foreground() { return foreground_; }
 
+  // True if no pixels were sampled, in which case both colors are black but
+  // describe nothing, and the contrast of the sub-image is unknown.
+  bool empty() const { return empty_; }
+
  private:
   Color foreground_, background_;
+  bool empty_ = false;
 };
 
 }  // namespace gtx
@@ -0,0 +1,559 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "corpus_replay.h"
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "proto_serialization.h"
+#include "typedefs.h"
+#include "check_lookup.h"
+#include "evaluation_metrics.h"
+#include "gtx_types.h"
+#include "hierarchy_table.h"
+#include "palette_image.h"
+#include "parameters.h"
+#include "record_stream.h"
+#include "rle_image.h"
+#include "toolkit.h"
+#include "tracer.h"
+
+namespace gtx {
+
+namespace {
+
+// The checks of Toolkit::ToolkitWithAllDefaultChecks, in registration order.
+constexpr const char *kDefaultCheckNames[] = {
+    "NoLabelCheck",
+    "MinimumTappableAreaCheck",
+    "ContrastCheck",
+    "AccessibilityLabelNotPunctuatedCheck",
+};
+
+// The extension of screenshot files.
+constexpr char kScreenshotExtension[] = ".rgba";
+
+// Returns true if the check named @c check_name reads the screenshot.
+bool NeedsScreenshot(const std::string &check_name) {
+  return check_name == "ContrastCheck";
+}
+
+// A screenshot read from a file of raw RGBA pixels. Unless
+// ReplayOptions::screenshot_encoding is kRgba, the pixels are held by the
+// image of that encoding and @c pixels is empty.
+struct Screenshot {
+  std::vector<Pixel> pixels;
+  PaletteImage palette_image;
+  RleImage rle_image;
+  int width = 0;
+  int height = 0;
+};
+
+// A hierarchy to evaluate.
+struct ReplayItem {
+  AccessibilityEvaluationProto evaluation;
+  std::shared_ptr<const Screenshot> screenshot;
+};
+
+// A queue between the reader and the evaluation threads. Push blocks while the
+// queue is full, so that reading cannot get arbitrarily far ahead.
+class ItemQueue {
+ public:
+  explicit ItemQueue(size_t capacity) : capacity_(capacity) {}
+
+  void Push(ReplayItem item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return items_.size() < capacity_; });
+    items_.push_back(std::move(item));
+    changed_.notify_all();
+  }
+
+  // Removes the item at the front of the queue into @c item. Returns false if
+  // the queue is closed and empty.
+  bool Pop(ReplayItem *item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      return false;
+    }
+    *item = std::move(items_.front());
+    items_.pop_front();
+    changed_.notify_all();
+    return true;
+  }
+
+  // Indicates that no more items will be pushed.
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    changed_.notify_all();
+  }
+
+ private:
+  const size_t capacity_;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<ReplayItem> items_;
+  bool closed_ = false;
+};
+
+// Reads a file into @c contents. Returns false if it cannot be read.
+bool ReadFile(const std::string &path, std::string *contents) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  *contents = buffer.str();
+  return !file.bad();
+}
+
+bool IsDirectory(const std::string &path) {
+  struct stat path_stat;
+  return stat(path.c_str(), &path_stat) == 0 && S_ISDIR(path_stat.st_mode);
+}
+
+bool FileExists(const std::string &path) {
+  struct stat path_stat;
+  return stat(path.c_str(), &path_stat) == 0 && S_ISREG(path_stat.st_mode);
+}
+
+bool HasSuffix(const std::string &string, const std::string &suffix) {
+  return string.size() >= suffix.size() &&
+         string.compare(string.size() - suffix.size(), suffix.size(),
+                        suffix) == 0;
+}
+
+// Returns @c path with its extension, if any, replaced by @c extension.
+std::string ReplaceExtension(const std::string &path,
+                             const std::string &extension) {
+  size_t slash = path.find_last_of('/');
+  size_t dot = path.find_last_of('.');
+  if (dot == std::string::npos ||
+      (slash != std::string::npos && dot < slash)) {
+    return path + extension;
+  }
+  return path.substr(0, dot) + extension;
+}
+
+// Reads the corpora at the given paths and passes each hierarchy to a sink.
+class CorpusReader {
+ public:
+  CorpusReader(std::function<void(ReplayItem)> sink,
+               std::vector<std::string> *errors,
+               ReplayScreenshotEncoding screenshot_encoding)
+      : sink_(std::move(sink)),
+        errors_(errors),
+        screenshot_encoding_(screenshot_encoding) {}
+
+  void ReadPath(const std::string &path) {
+    if (IsDirectory(path)) {
+      ReadDirectory(path);
+      return;
+    }
+    std::unique_ptr<RecordReader> reader = RecordReader::Open(path);
+    if (reader != nullptr) {
+      ReadRecordStream(path, reader.get());
+    } else {
+      ReadEvaluationFile(path);
+    }
+  }
+
+ private:
+  void ReadDirectory(const std::string &path) {
+    DIR *directory = opendir(path.c_str());
+    if (directory == nullptr) {
+      errors_->push_back("cannot open directory " + path);
+      return;
+    }
+    std::vector<std::string> file_paths;
+    while (struct dirent *entry = readdir(directory)) {
+      std::string name = entry->d_name;
+      std::string file_path = path + "/" + name;
+      if (name[0] == '.' || HasSuffix(name, kScreenshotExtension) ||
+          !FileExists(file_path)) {
+        continue;
+      }
+      file_paths.push_back(std::move(file_path));
+    }
+    closedir(directory);
+    std::sort(file_paths.begin(), file_paths.end());
+    for (const std::string &file_path : file_paths) {
+      ReadPath(file_path);
+    }
+  }
+
+  void ReadRecordStream(const std::string &path, RecordReader *reader) {
+    if (reader->record_type() != RecordType::kEvaluation) {
+      errors_->push_back(path + " is not a record stream of evaluations");
+      return;
+    }
+    std::string screenshot_directory = path + ".screenshots";
+    bool has_screenshots = IsDirectory(screenshot_directory);
+    ReplayItem item;
+    for (int64_t i = 0; reader->ReadEvaluation(&item.evaluation); i++) {
+      if (has_screenshots) {
+        item.screenshot = ReadScreenshot(
+            screenshot_directory + "/" + std::to_string(i) +
+                kScreenshotExtension,
+            item.evaluation.hierarchy());
+      }
+      sink_(std::move(item));
+      item = ReplayItem();
+    }
+    if (!reader->ok()) {
+      errors_->push_back(path + " is corrupt");
+    }
+  }
+
+  void ReadEvaluationFile(const std::string &path) {
+    std::string bytes;
+    ReplayItem item;
+    if (!ReadFile(path, &bytes)) {
+      errors_->push_back("cannot read " + path);
+      return;
+    }
+    if (!ParseProto(bytes, &item.evaluation)) {
+      errors_->push_back(path + " is not an evaluation");
+      return;
+    }
+    item.screenshot = ReadScreenshot(
+        ReplaceExtension(path, kScreenshotExtension),
+        item.evaluation.hierarchy());
+    sink_(std::move(item));
+  }
+
+  // Returns the screenshot at @c path of @c hierarchy, or nullptr if there is
+  // none or it does not have the dimensions of the device.
+  std::shared_ptr<const Screenshot> ReadScreenshot(
+      const std::string &path, const AccessibilityHierarchyProto &hierarchy) {
+    if (!FileExists(path)) {
+      return nullptr;
+    }
+    const DisplayMetricsProto &metrics =
+        hierarchy.device_state().display_metrics();
+    float scale = metrics.screen_scale() > 0 ? metrics.screen_scale() : 1;
+    auto screenshot = std::make_shared<Screenshot>();
+    screenshot->width = static_cast<int>(metrics.screen_width() * scale);
+    screenshot->height = static_cast<int>(metrics.screen_height() * scale);
+    size_t size = static_cast<size_t>(screenshot->width) *
+                  screenshot->height * sizeof(Pixel);
+    std::string pixels;
+    if (size == 0 || !ReadFile(path, &pixels) || pixels.size() != size) {
+      errors_->push_back(path + " is not a " +
+                         std::to_string(screenshot->width) + "x" +
+                         std::to_string(screenshot->height) +
+                         " RGBA image");
+      return nullptr;
+    }
+    screenshot->pixels.resize(size / sizeof(Pixel));
+    memcpy(screenshot->pixels.data(), pixels.data(), size);
+    Image image(screenshot->pixels.data(), screenshot->width,
+                screenshot->height);
+    switch (screenshot_encoding_) {
+      case ReplayScreenshotEncoding::kRgba:
+        return screenshot;
+      case ReplayScreenshotEncoding::kPalette:
+        screenshot->palette_image = PaletteImage::Encode(image);
+        break;
+      case ReplayScreenshotEncoding::kRunLength:
+        screenshot->rle_image = RleImage::Encode(image);
+        break;
+    }
+    screenshot->pixels = std::vector<Pixel>();
+    return screenshot;
+  }
+
+  std::function<void(ReplayItem)> sink_;
+  std::vector<std::string> *errors_;
+  ReplayScreenshotEncoding screenshot_encoding_;
+};
+
+// Evaluates hierarchies on one thread and accumulates their statistics.
+class ReplayWorker {
+ public:
+  explicit ReplayWorker(const ReplayOptions &options) : options_(options) {
+    toolkit_ = CreateToolkit(/*with_screenshot_checks=*/true);
+    toolkit_without_screenshot_checks_ =
+        CreateToolkit(/*with_screenshot_checks=*/false);
+  }
+
+  void Evaluate(const ReplayItem &item) {
+    const AccessibilityHierarchyProto &hierarchy = item.evaluation.hierarchy();
+    const Screenshot *screenshot = item.screenshot.get();
+    Parameters params;
+    Toolkit *toolkit = toolkit_without_screenshot_checks_.get();
+    if (screenshot != nullptr) {
+      switch (options_.screenshot_encoding) {
+        case ReplayScreenshotEncoding::kRgba:
+          params.set_screenshot(
+              Image(const_cast<Pixel *>(screenshot->pixels.data()),
+                    screenshot->width, screenshot->height));
+          break;
+        case ReplayScreenshotEncoding::kPalette:
+          params.set_screenshot(
+              Image(nullptr, screenshot->width, screenshot->height));
+          params.set_palette_screenshot(&screenshot->palette_image);
+          break;
+        case ReplayScreenshotEncoding::kRunLength:
+          params.set_screenshot(
+              Image(nullptr, screenshot->width, screenshot->height));
+          params.set_rle_screenshot(&screenshot->rle_image);
+          break;
+      }
+      params.set_device_bounds(DeviceBoundsOfHierarchy(
+          hierarchy, screenshot->width, screenshot->height));
+      toolkit = toolkit_.get();
+      screenshots_++;
+    } else {
+      params.set_screenshot(Image(nullptr, 0, 0));
+      params.set_device_bounds(DeviceBoundsOfHierarchy(hierarchy, 0, 0));
+    }
+    uint64_t start_nanoseconds = TraceClockNanoseconds();
+    std::vector<CheckResultProto> results;
+    switch (options_.evaluation_path) {
+      case ReplayEvaluationPath::kProto:
+        results = toolkit->CheckElements(hierarchy, params);
+        break;
+      case ReplayEvaluationPath::kHierarchyTable:
+        results = toolkit->CheckElements(HierarchyTable::FromProto(hierarchy),
+                                         params);
+        break;
+    }
+    latencies_.push_back(TraceClockNanoseconds() - start_nanoseconds);
+    hierarchies_++;
+    elements_ += hierarchy.elements_size();
+    results_ += results.size();
+  }
+
+  // Adds the statistics of this worker to @c report and its latencies to
+  // @c latencies.
+  void AddTo(ReplayReport *report, std::vector<uint64_t> *latencies) const {
+    report->hierarchies += hierarchies_;
+    report->elements += elements_;
+    report->results += results_;
+    report->screenshots += screenshots_;
+    latencies->insert(latencies->end(), latencies_.begin(), latencies_.end());
+  }
+
+ private:
+  std::unique_ptr<Toolkit> CreateToolkit(bool with_screenshot_checks) const {
+    std::vector<std::string> check_names = options_.check_names;
+    if (check_names.empty()) {
+      check_names.assign(std::begin(kDefaultCheckNames),
+                         std::end(kDefaultCheckNames));
+    }
+    auto toolkit = std::make_unique<Toolkit>();
+    for (const std::string &check_name : check_names) {
+      if (!with_screenshot_checks && NeedsScreenshot(check_name)) {
+        continue;
+      }
+      std::unique_ptr<Check> check = CheckForName(check_name);
+      toolkit->RegisterCheck(check);
+    }
+    toolkit->set_skips_invisible_elements(options_.skips_invisible_elements);
+    toolkit->set_metrics(options_.metrics);
+    toolkit->set_tracer(options_.tracer);
+    return toolkit;
+  }
+
+  const ReplayOptions &options_;
+  std::unique_ptr<Toolkit> toolkit_;
+  std::unique_ptr<Toolkit> toolkit_without_screenshot_checks_;
+  std::vector<uint64_t> latencies_;
+  int64_t hierarchies_ = 0;
+  int64_t elements_ = 0;
+  int64_t results_ = 0;
+  int64_t screenshots_ = 0;
+};
+
+// Returns the latency at quantile @c quantile of the sorted @c latencies, by
+// the nearest rank method.
+uint64_t Percentile(const std::vector<uint64_t> &latencies, double quantile) {
+  if (latencies.empty()) {
+    return 0;
+  }
+  size_t rank = static_cast<size_t>(quantile * latencies.size() + 0.999999);
+  return latencies[std::min(latencies.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+}  // namespace
+
+std::unique_ptr<CorpusReplay> CorpusReplay::Create(
+    const ReplayOptions &options) {
+  for (const std::string &check_name : options.check_names) {
+    if (CheckForName(check_name) == nullptr) {
+      return nullptr;
+    }
+  }
+  std::unique_ptr<CorpusReplay> replay(new CorpusReplay(options));
+  if (replay->options_.threads <= 0) {
+    replay->options_.threads =
+        std::max(1u, std::thread::hardware_concurrency());
+  }
+  replay->options_.repeat_count = std::max(1, replay->options_.repeat_count);
+  return replay;
+}
+
+ReplayReport CorpusReplay::Replay(const std::vector<std::string> &paths) {
+  ReplayReport report;
+  std::vector<std::unique_ptr<ReplayWorker>> workers;
+  for (int i = 0; i < options_.threads; i++) {
+    workers.push_back(std::make_unique<ReplayWorker>(options_));
+  }
+
+  std::vector<ReplayItem> preloaded_items;
+  if (options_.preloads_corpus) {
+    CorpusReader reader(
+        [&preloaded_items](ReplayItem item) {
+          preloaded_items.push_back(std::move(item));
+        },
+        &report.errors, options_.screenshot_encoding);
+    for (const std::string &path : paths) {
+      reader.ReadPath(path);
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (int repeat = 0; repeat < options_.repeat_count; repeat++) {
+    std::vector<std::thread> threads;
+    if (options_.preloads_corpus) {
+      std::atomic<size_t> next_item{0};
+      for (auto &worker : workers) {
+        threads.emplace_back([&worker, &preloaded_items, &next_item] {
+          for (size_t i = next_item++; i < preloaded_items.size();
+               i = next_item++) {
+            worker->Evaluate(preloaded_items[i]);
+          }
+        });
+      }
+      for (std::thread &thread : threads) {
+        thread.join();
+      }
+      continue;
+    }
+    ItemQueue queue(2 * workers.size());
+    for (auto &worker : workers) {
+      threads.emplace_back([&worker, &queue] {
+        ReplayItem item;
+        while (queue.Pop(&item)) {
+          worker->Evaluate(item);
+        }
+      });
+    }
+    // Errors are only reported for the first pass over the corpus.
+    std::vector<std::string> errors;
+    CorpusReader reader(
+        [&queue](ReplayItem item) { queue.Push(std::move(item)); },
+        repeat == 0 ? &report.errors : &errors, options_.screenshot_encoding);
+    for (const std::string &path : paths) {
+      reader.ReadPath(path);
+    }
+    queue.Close();
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+  }
+  report.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  std::vector<uint64_t> latencies;
+  for (const auto &worker : workers) {
+    worker->AddTo(&report, &latencies);
+  }
+  std::sort(latencies.begin(), latencies.end());
+  report.p50_latency_nanoseconds = Percentile(latencies, 0.5);
+  report.p99_latency_nanoseconds = Percentile(latencies, 0.99);
+  report.max_latency_nanoseconds = latencies.empty() ? 0 : latencies.back();
+  if (report.seconds > 0) {
+    report.hierarchies_per_second = report.hierarchies / report.seconds;
+    report.elements_per_second = report.elements / report.seconds;
+  }
+  report.peak_rss_bytes = PeakResidentSetSizeBytes();
+  return report;
+}
+
+std::string ReplayReport::ToString() const {
+  char summary[512];
+  snprintf(summary, sizeof(summary),
+           "%lld hierarchies (%lld with screenshots), %lld elements, %lld "
+           "results in %.3f s\n"
+           "  %.1f hierarchies/s, %.1f elements/s\n"
+           "  latency per hierarchy: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n"
+           "  peak RSS: %.1f MB\n",
+           static_cast<long long>(hierarchies),
+           static_cast<long long>(screenshots),
+           static_cast<long long>(elements), static_cast<long long>(results),
+           seconds, hierarchies_per_second, elements_per_second,
+           p50_latency_nanoseconds / 1e6, p99_latency_nanoseconds / 1e6,
+           max_latency_nanoseconds / 1e6, peak_rss_bytes / 1e6);
+  std::string text = summary;
+  for (const std::string &error : errors) {
+    text += "  error: " + error + "\n";
+  }
+  return text;
+}
+
+Rect DeviceBoundsOfHierarchy(const AccessibilityHierarchyProto &hierarchy,
+                             int screenshot_width, int screenshot_height) {
+  const DisplayMetricsProto &metrics =
+      hierarchy.device_state().display_metrics();
+  if (metrics.has_screen_width() && metrics.has_screen_height()) {
+    return Rect(0, 0, metrics.screen_width(), metrics.screen_height());
+  }
+  float scale = metrics.has_screen_scale() && metrics.screen_scale() > 0
+                    ? metrics.screen_scale()
+                    : 1;
+  return Rect(0, 0, screenshot_width / scale, screenshot_height / scale);
+}
+
+uint64_t PeakResidentSetSizeBytes() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  // ru_maxrss is in bytes on Apple platforms.
+  return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+  // and in kilobytes elsewhere.
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+}  // namespace gtx
@@ -0,0 +1,161 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_CORPUS_REPLAY_H_
+#define GTXILIB_OOPCLASSES_CORPUS_REPLAY_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "typedefs.h"
+#include "evaluation_metrics.h"
+#include "gtx_types.h"
+#include "tracer.h"
+
+namespace gtx {
+
+// A corpus is a set of recorded AccessibilityEvaluationProtos, optionally with
+// screenshots, that CorpusReplay evaluates to measure throughput on
+// production-shaped data. A corpus path is either
+//
+// - a record stream of evaluations. The screenshot of record N, if any, is
+//   the file "N.rgba" in the directory named like the stream with
+//   ".screenshots" appended;
+// - a file holding a single serialized evaluation. Its screenshot, if any,
+//   is the file named like it with its extension replaced by ".rgba";
+// - a directory, whose files are read as above in name order, skipping
+//   screenshots.
+//
+// Screenshots are raw RGBA pixels in device pixels, so their dimensions are
+// those of the display metrics of the hierarchy multiplied by its screen
+// scale.
+
+// How CorpusReplay evaluates each hierarchy.
+enum class ReplayEvaluationPath {
+  // Toolkit::CheckElements on the AccessibilityHierarchyProto.
+  kProto,
+  // Toolkit::CheckElements on a HierarchyTable built from the hierarchy. The
+  // time to build the table is included in the latency of the hierarchy.
+  kHierarchyTable,
+};
+
+// How CorpusReplay keeps screenshots in memory.
+enum class ReplayScreenshotEncoding {
+  // As read, 4 bytes per pixel.
+  kRgba,
+  // As PaletteImages, 1 or 2 bytes per pixel for most screenshots.
+  kPalette,
+  // As RleImages, a few bytes per run of pixels of the same color.
+  kRunLength,
+};
+
+struct ReplayOptions {
+  // The number of evaluation threads. 0 uses one per core.
+  int threads = 0;
+
+  // The names of the checks to run, as accepted by CheckForName. Empty runs
+  // the default checks of Toolkit::ToolkitWithAllDefaultChecks. Checks that
+  // need a screenshot are not run on hierarchies without one.
+  std::vector<std::string> check_names;
+
+  // See Toolkit::skips_invisible_elements.
+  bool skips_invisible_elements = false;
+
+  ReplayEvaluationPath evaluation_path = ReplayEvaluationPath::kProto;
+
+  // If true, the whole corpus is read into memory before the replay is timed,
+  // so that only evaluation is measured. Otherwise the corpus is streamed
+  // with bounded memory and reading overlaps evaluation, as in production.
+  bool preloads_corpus = false;
+
+  // How screenshots are encoded when they are read. Encoded screenshots take
+  // less memory, and contrast checks read them without hashing every pixel.
+  ReplayScreenshotEncoding screenshot_encoding =
+      ReplayScreenshotEncoding::kRgba;
+
+  // The number of times the corpus is evaluated. Repeats only read the corpus
+  // once if it is preloaded.
+  int repeat_count = 1;
+
+  // If not nullptr, the toolkits record their metrics and spans into these.
+  // They must outlive the replay.
+  EvaluationMetrics *metrics = nullptr;
+  Tracer *tracer = nullptr;
+};
+
+// The throughput and latency of a replay.
+struct ReplayReport {
+  int64_t hierarchies = 0;
+  int64_t elements = 0;
+  int64_t results = 0;
+  // The number of hierarchies that had a screenshot.
+  int64_t screenshots = 0;
+
+  // The wall time of the replay, and the throughput it implies.
+  double seconds = 0;
+  double hierarchies_per_second = 0;
+  double elements_per_second = 0;
+
+  // Percentiles of the time taken to evaluate a single hierarchy.
+  uint64_t p50_latency_nanoseconds = 0;
+  uint64_t p99_latency_nanoseconds = 0;
+  uint64_t max_latency_nanoseconds = 0;
+
+  // The peak resident set size of the process since it started, in bytes, or
+  // 0 if it is not known.
+  uint64_t peak_rss_bytes = 0;
+
+  // Inputs that could not be read, for example because they are corrupt.
+  // They do not stop the replay.
+  std::vector<std::string> errors;
+
+  // Returns a human readable summary of this report.
+  std::string ToString() const;
+};
+
+// Evaluates corpora with a configurable toolkit and reports throughput.
+class CorpusReplay {
+ public:
+  // Returns nullptr if @c options names a check that does not exist.
+  static std::unique_ptr<CorpusReplay> Create(const ReplayOptions &options);
+
+  // Evaluates the corpora at @c paths and returns the report of the replay.
+  ReplayReport Replay(const std::vector<std::string> &paths);
+
+ private:
+  explicit CorpusReplay(const ReplayOptions &options) : options_(options) {}
+
+  ReplayOptions options_;
+};
+
+// Returns the bounds of the device that captured @c hierarchy, in the
+// coordinates of its element frames. If the display metrics of the hierarchy
+// have no screen size, the bounds are derived from the size of its screenshot
+// of @c screenshot_width by @c screenshot_height pixels, or are empty if both
+// are 0.
+Rect DeviceBoundsOfHierarchy(const AccessibilityHierarchyProto &hierarchy,
+                             int screenshot_width, int screenshot_height);
+
+// Returns the peak resident set size of the process since it started, in
+// bytes, or 0 if it is not known.
+uint64_t PeakResidentSetSizeBytes();
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_CORPUS_REPLAY_H_
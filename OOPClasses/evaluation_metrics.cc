@@ -0,0 +1,374 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "evaluation_metrics.h"
+
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "typedefs.h"
+#include "allocation_tracker.h"
+
+namespace gtx {
+
+const std::array<uint64_t, kLatencyBucketCount - 1>
+    kLatencyBucketBoundsNanoseconds = {
+        1000,     4000,     16000,     64000,     256000,
+        1024000,  4096000,  16384000,  65536000,  262144000,
+};
+
+namespace {
+
+// Returns the index of the latency bucket of @c nanoseconds.
+int LatencyBucket(uint64_t nanoseconds) {
+  int bucket = 0;
+  while (bucket < kLatencyBucketCount - 1 &&
+         nanoseconds > kLatencyBucketBoundsNanoseconds[bucket]) {
+    bucket++;
+  }
+  return bucket;
+}
+
+// Sets @c max to @c value if @c value is greater.
+void UpdateMax(std::atomic<uint64_t> &max, uint64_t value) {
+  uint64_t current = max.load(std::memory_order_relaxed);
+  while (value > current &&
+         !max.compare_exchange_weak(current, value,
+                                    std::memory_order_relaxed)) {
+  }
+}
+
+// Returns @c value escaped as a Prometheus label value.
+std::string EscapeLabelValue(const std::string &value) {
+  std::string escaped;
+  for (char c : value) {
+    switch (c) {
+      case '\\':
+        escaped += "\\\\";
+        break;
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\n':
+        escaped += "\\n";
+        break;
+      default:
+        escaped += c;
+    }
+  }
+  return escaped;
+}
+
+// Returns @c nanoseconds in seconds, formatted for Prometheus.
+std::string Seconds(uint64_t nanoseconds) {
+  std::ostringstream stream;
+  stream.precision(9);
+  stream << nanoseconds / 1e9;
+  return stream.str();
+}
+
+// Appends the HELP and TYPE lines of a metric to @c stream.
+void AppendMetricHeader(std::ostringstream &stream, const char *name,
+                        const char *type, const char *help) {
+  stream << "# HELP " << name << " " << help << "\n";
+  stream << "# TYPE " << name << " " << type << "\n";
+}
+
+}  // namespace
+
+const char *EvaluationPhaseName(EvaluationPhase phase) {
+  switch (phase) {
+    case EvaluationPhase::kParse:
+      return "parse";
+    case EvaluationPhase::kClassify:
+      return "classify";
+    case EvaluationPhase::kCheck:
+      return "check";
+    case EvaluationPhase::kRender:
+      return "render";
+  }
+  return "unknown";
+}
+
+void CheckCounters::RecordInvocation(uint64_t nanoseconds, bool failed) {
+  invocations_.fetch_add(1, std::memory_order_relaxed);
+  if (failed) {
+    failures_.fetch_add(1, std::memory_order_relaxed);
+  }
+  total_nanoseconds_.fetch_add(nanoseconds, std::memory_order_relaxed);
+  UpdateMax(max_nanoseconds_, nanoseconds);
+  latency_histogram_[LatencyBucket(nanoseconds)].fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+void CheckCounters::RecordBatch(uint64_t count, uint64_t nanoseconds,
+                                uint64_t failures) {
+  if (count == 0) {
+    return;
+  }
+  invocations_.fetch_add(count, std::memory_order_relaxed);
+  failures_.fetch_add(failures, std::memory_order_relaxed);
+  total_nanoseconds_.fetch_add(nanoseconds, std::memory_order_relaxed);
+  uint64_t average_nanoseconds = nanoseconds / count;
+  UpdateMax(max_nanoseconds_, average_nanoseconds);
+  latency_histogram_[LatencyBucket(average_nanoseconds)].fetch_add(
+      count, std::memory_order_relaxed);
+}
+
+void CheckCounters::RecordAllocations(const AllocationCounts &counts) {
+  allocations_.fetch_add(counts.allocations, std::memory_order_relaxed);
+  allocated_bytes_.fetch_add(counts.bytes, std::memory_order_relaxed);
+  UpdateMax(max_peak_bytes_, counts.peak_bytes);
+}
+
+CheckMetricsSnapshot CheckCounters::Snapshot() const {
+  CheckMetricsSnapshot snapshot;
+  snapshot.check_name = check_name_;
+  snapshot.invocations = invocations_.load(std::memory_order_relaxed);
+  snapshot.skips = skips_.load(std::memory_order_relaxed);
+  snapshot.failures = failures_.load(std::memory_order_relaxed);
+  snapshot.total_nanoseconds =
+      total_nanoseconds_.load(std::memory_order_relaxed);
+  snapshot.max_nanoseconds = max_nanoseconds_.load(std::memory_order_relaxed);
+  for (int i = 0; i < kLatencyBucketCount; i++) {
+    snapshot.latency_histogram[i] =
+        latency_histogram_[i].load(std::memory_order_relaxed);
+  }
+  snapshot.allocations = allocations_.load(std::memory_order_relaxed);
+  snapshot.allocated_bytes = allocated_bytes_.load(std::memory_order_relaxed);
+  snapshot.max_peak_bytes = max_peak_bytes_.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+CheckCounters *EvaluationMetrics::CountersForCheck(
+    const std::string &check_name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = counters_by_name_.find(check_name);
+  if (it != counters_by_name_.end()) {
+    return it->second;
+  }
+  check_counters_.emplace_back(check_name);
+  CheckCounters *counters = &check_counters_.back();
+  counters_by_name_[check_name] = counters;
+  return counters;
+}
+
+void EvaluationMetrics::RecordPhase(EvaluationPhase phase,
+                                    uint64_t nanoseconds) {
+  PhaseCounters &counters = phases_[static_cast<int>(phase)];
+  counters.count.fetch_add(1, std::memory_order_relaxed);
+  counters.total_nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+  UpdateMax(counters.max_nanoseconds, nanoseconds);
+}
+
+void EvaluationMetrics::RecordPhaseAllocations(EvaluationPhase phase,
+                                               const AllocationCounts &counts) {
+  PhaseCounters &counters = phases_[static_cast<int>(phase)];
+  counters.allocations.fetch_add(counts.allocations,
+                                 std::memory_order_relaxed);
+  counters.allocated_bytes.fetch_add(counts.bytes, std::memory_order_relaxed);
+  UpdateMax(counters.max_peak_bytes, counts.peak_bytes);
+}
+
+EvaluationMetricsSnapshot EvaluationMetrics::Snapshot() const {
+  EvaluationMetricsSnapshot snapshot;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const CheckCounters &counters : check_counters_) {
+      snapshot.checks.push_back(counters.Snapshot());
+    }
+  }
+  if (times_phases_) {
+    for (int i = 0; i < kEvaluationPhaseCount; i++) {
+      PhaseMetricsSnapshot phase;
+      phase.phase = static_cast<EvaluationPhase>(i);
+      phase.count = phases_[i].count.load(std::memory_order_relaxed);
+      phase.total_nanoseconds =
+          phases_[i].total_nanoseconds.load(std::memory_order_relaxed);
+      phase.max_nanoseconds =
+          phases_[i].max_nanoseconds.load(std::memory_order_relaxed);
+      phase.allocations =
+          phases_[i].allocations.load(std::memory_order_relaxed);
+      phase.allocated_bytes =
+          phases_[i].allocated_bytes.load(std::memory_order_relaxed);
+      phase.max_peak_bytes =
+          phases_[i].max_peak_bytes.load(std::memory_order_relaxed);
+      snapshot.phases.push_back(phase);
+    }
+  }
+  return snapshot;
+}
+
+EvaluationMetricsProto EvaluationMetricsSnapshot::ToProto() const {
+  EvaluationMetricsProto proto;
+  for (const CheckMetricsSnapshot &check : checks) {
+    CheckMetricsProto *check_proto = proto.add_checks();
+    check_proto->set_check_name(check.check_name);
+    check_proto->set_invocations(check.invocations);
+    check_proto->set_skips(check.skips);
+    check_proto->set_failures(check.failures);
+    check_proto->set_total_nanoseconds(check.total_nanoseconds);
+    check_proto->set_max_nanoseconds(check.max_nanoseconds);
+    for (uint64_t count : check.latency_histogram) {
+      check_proto->add_latency_histogram(count);
+    }
+    check_proto->set_allocations(check.allocations);
+    check_proto->set_allocated_bytes(check.allocated_bytes);
+    check_proto->set_max_peak_bytes(check.max_peak_bytes);
+  }
+  for (const PhaseMetricsSnapshot &phase : phases) {
+    PhaseMetricsProto *phase_proto = proto.add_phases();
+    phase_proto->set_phase(EvaluationPhaseName(phase.phase));
+    phase_proto->set_count(phase.count);
+    phase_proto->set_total_nanoseconds(phase.total_nanoseconds);
+    phase_proto->set_max_nanoseconds(phase.max_nanoseconds);
+    phase_proto->set_allocations(phase.allocations);
+    phase_proto->set_allocated_bytes(phase.allocated_bytes);
+    phase_proto->set_max_peak_bytes(phase.max_peak_bytes);
+  }
+  for (uint64_t bound : kLatencyBucketBoundsNanoseconds) {
+    proto.add_latency_bucket_bounds_nanoseconds(bound);
+  }
+  return proto;
+}
+
+std::string EvaluationMetricsSnapshot::ToPrometheusText() const {
+  std::ostringstream stream;
+  std::vector<std::string> check_labels;
+  for (const CheckMetricsSnapshot &check : checks) {
+    check_labels.push_back("check=\"" + EscapeLabelValue(check.check_name) +
+                           "\"");
+  }
+  if (!checks.empty()) {
+    AppendMetricHeader(stream, "gtx_check_invocations_total", "counter",
+                       "Number of elements a check was run on.");
+    for (size_t i = 0; i < checks.size(); i++) {
+      stream << "gtx_check_invocations_total{" << check_labels[i] << "} "
+             << checks[i].invocations << "\n";
+    }
+    AppendMetricHeader(stream, "gtx_check_skips_total", "counter",
+                       "Number of elements a check was not run on.");
+    for (size_t i = 0; i < checks.size(); i++) {
+      stream << "gtx_check_skips_total{" << check_labels[i] << "} "
+             << checks[i].skips << "\n";
+    }
+    AppendMetricHeader(stream, "gtx_check_failures_total", "counter",
+                       "Number of check results a check produced.");
+    for (size_t i = 0; i < checks.size(); i++) {
+      stream << "gtx_check_failures_total{" << check_labels[i] << "} "
+             << checks[i].failures << "\n";
+    }
+    AppendMetricHeader(stream, "gtx_check_max_latency_seconds", "gauge",
+                       "Longest time a check took on an element.");
+    for (size_t i = 0; i < checks.size(); i++) {
+      stream << "gtx_check_max_latency_seconds{" << check_labels[i] << "} "
+             << Seconds(checks[i].max_nanoseconds) << "\n";
+    }
+    AppendMetricHeader(stream, "gtx_check_latency_seconds", "histogram",
+                       "Time a check took on an element.");
+    for (size_t i = 0; i < checks.size(); i++) {
+      uint64_t cumulative_count = 0;
+      for (int bucket = 0; bucket < kLatencyBucketCount; bucket++) {
+        cumulative_count += checks[i].latency_histogram[bucket];
+        std::string bound =
+            bucket < kLatencyBucketCount - 1
+                ? Seconds(kLatencyBucketBoundsNanoseconds[bucket])
+                : "+Inf";
+        stream << "gtx_check_latency_seconds_bucket{" << check_labels[i]
+               << ",le=\"" << bound << "\"} " << cumulative_count << "\n";
+      }
+      stream << "gtx_check_latency_seconds_sum{" << check_labels[i] << "} "
+             << Seconds(checks[i].total_nanoseconds) << "\n";
+      stream << "gtx_check_latency_seconds_count{" << check_labels[i] << "} "
+             << checks[i].invocations << "\n";
+    }
+    if (AllocationTrackingEnabled()) {
+      AppendMetricHeader(stream, "gtx_check_allocations_total", "counter",
+                         "Number of heap allocations made by a check.");
+      for (size_t i = 0; i < checks.size(); i++) {
+        stream << "gtx_check_allocations_total{" << check_labels[i] << "} "
+               << checks[i].allocations << "\n";
+      }
+      AppendMetricHeader(stream, "gtx_check_allocated_bytes_total", "counter",
+                         "Bytes of heap allocations made by a check.");
+      for (size_t i = 0; i < checks.size(); i++) {
+        stream << "gtx_check_allocated_bytes_total{" << check_labels[i]
+               << "} " << checks[i].allocated_bytes << "\n";
+      }
+      AppendMetricHeader(stream, "gtx_check_max_peak_bytes", "gauge",
+                         "Most heap memory a check held at once.");
+      for (size_t i = 0; i < checks.size(); i++) {
+        stream << "gtx_check_max_peak_bytes{" << check_labels[i] << "} "
+               << checks[i].max_peak_bytes << "\n";
+      }
+    }
+  }
+  if (!phases.empty()) {
+    AppendMetricHeader(stream, "gtx_phase_runs_total", "counter",
+                       "Number of times a phase of evaluation ran.");
+    for (const PhaseMetricsSnapshot &phase : phases) {
+      stream << "gtx_phase_runs_total{phase=\""
+             << EvaluationPhaseName(phase.phase) << "\"} " << phase.count
+             << "\n";
+    }
+    AppendMetricHeader(stream, "gtx_phase_seconds_total", "counter",
+                       "Total time spent in a phase of evaluation.");
+    for (const PhaseMetricsSnapshot &phase : phases) {
+      stream << "gtx_phase_seconds_total{phase=\""
+             << EvaluationPhaseName(phase.phase) << "\"} "
+             << Seconds(phase.total_nanoseconds) << "\n";
+    }
+    AppendMetricHeader(stream, "gtx_phase_max_seconds", "gauge",
+                       "Longest run of a phase of evaluation.");
+    for (const PhaseMetricsSnapshot &phase : phases) {
+      stream << "gtx_phase_max_seconds{phase=\""
+             << EvaluationPhaseName(phase.phase) << "\"} "
+             << Seconds(phase.max_nanoseconds) << "\n";
+    }
+    if (AllocationTrackingEnabled()) {
+      AppendMetricHeader(stream, "gtx_phase_allocations_total", "counter",
+                         "Number of heap allocations made by a phase.");
+      for (const PhaseMetricsSnapshot &phase : phases) {
+        stream << "gtx_phase_allocations_total{phase=\""
+               << EvaluationPhaseName(phase.phase) << "\"} "
+               << phase.allocations << "\n";
+      }
+      AppendMetricHeader(stream, "gtx_phase_allocated_bytes_total", "counter",
+                         "Bytes of heap allocations made by a phase.");
+      for (const PhaseMetricsSnapshot &phase : phases) {
+        stream << "gtx_phase_allocated_bytes_total{phase=\""
+               << EvaluationPhaseName(phase.phase) << "\"} "
+               << phase.allocated_bytes << "\n";
+      }
+      AppendMetricHeader(stream, "gtx_phase_max_peak_bytes", "gauge",
+                         "Most heap memory a run of a phase held at once.");
+      for (const PhaseMetricsSnapshot &phase : phases) {
+        stream << "gtx_phase_max_peak_bytes{phase=\""
+               << EvaluationPhaseName(phase.phase) << "\"} "
+               << phase.max_peak_bytes << "\n";
+      }
+    }
+  }
+  return stream.str();
+}
+
+}  // namespace gtx
@@ -0,0 +1,248 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_EVALUATION_METRICS_H_
+#define GTXILIB_OOPCLASSES_EVALUATION_METRICS_H_
+
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "typedefs.h"
+#include "allocation_tracker.h"
+
+namespace gtx {
+
+// The phases of evaluating a hierarchy that EvaluationMetrics can time.
+enum class EvaluationPhase {
+  // Deserializing hierarchies or evaluations.
+  kParse,
+  // Selecting the elements checks are run on, for example by visibility.
+  kClassify,
+  // Running checks on elements.
+  kCheck,
+  // Rendering check results for output, such as their messages or their
+  // serialized form.
+  kRender,
+};
+
+// The number of values of EvaluationPhase.
+constexpr int kEvaluationPhaseCount = 4;
+
+// Returns the name of @c phase, for example "parse".
+const char *EvaluationPhaseName(EvaluationPhase phase);
+
+// The number of buckets of the latency histograms of checks.
+constexpr int kLatencyBucketCount = 11;
+
+// The upper bounds of all but the last latency bucket, in nanoseconds. Bounds
+// grow by a factor of 4 from 1 microsecond to about a quarter of a second.
+extern const std::array<uint64_t, kLatencyBucketCount - 1>
+    kLatencyBucketBoundsNanoseconds;
+
+// Counters and timing of a single check.
+struct CheckMetricsSnapshot {
+  std::string check_name;
+  // The number of elements the check was run on.
+  uint64_t invocations = 0;
+  // The number of elements the check was not run on because the toolkit
+  // skipped them, for not being accessibility elements or not being visible.
+  uint64_t skips = 0;
+  // The number of invocations that produced a check result.
+  uint64_t failures = 0;
+  uint64_t total_nanoseconds = 0;
+  uint64_t max_nanoseconds = 0;
+  // The number of invocations in each bucket, see
+  // kLatencyBucketBoundsNanoseconds.
+  std::array<uint64_t, kLatencyBucketCount> latency_histogram = {};
+  // The heap allocations of the check, if AllocationTrackingEnabled. The
+  // peak is the largest of any single invocation, or batch of invocations.
+  uint64_t allocations = 0;
+  uint64_t allocated_bytes = 0;
+  uint64_t max_peak_bytes = 0;
+};
+
+// Counters and timing of a phase of evaluation.
+struct PhaseMetricsSnapshot {
+  EvaluationPhase phase;
+  // The number of times the phase ran.
+  uint64_t count = 0;
+  uint64_t total_nanoseconds = 0;
+  uint64_t max_nanoseconds = 0;
+  // The heap allocations of the phase, if AllocationTrackingEnabled. The peak
+  // is the largest of any single run.
+  uint64_t allocations = 0;
+  uint64_t allocated_bytes = 0;
+  uint64_t max_peak_bytes = 0;
+};
+
+// A copy of the metrics recorded by an EvaluationMetrics object.
+struct EvaluationMetricsSnapshot {
+  // The metrics of each check, in the order the checks were first recorded.
+  std::vector<CheckMetricsSnapshot> checks;
+
+  // The metrics of each phase, in the order of EvaluationPhase. Empty if
+  // phases are not timed.
+  std::vector<PhaseMetricsSnapshot> phases;
+
+  // Returns this snapshot as a proto.
+  EvaluationMetricsProto ToProto() const;
+
+  // Returns this snapshot in the Prometheus text exposition format. Check
+  // latencies are exported as the histogram gtx_check_latency_seconds with a
+  // "check" label.
+  std::string ToPrometheusText() const;
+};
+
+// The counters of a single check. Recording is thread safe and lock free.
+class CheckCounters {
+ public:
+  explicit CheckCounters(const std::string &check_name)
+      : check_name_(check_name) {}
+
+  // Records that the check was run on an element, taking @c nanoseconds, and
+  // whether it produced a check result.
+  void RecordInvocation(uint64_t nanoseconds, bool failed);
+
+  // Records that the check was run on @c count elements at once, taking
+  // @c nanoseconds in total, and produced @c failures check results. The
+  // latency of each element is recorded as the average latency.
+  void RecordBatch(uint64_t count, uint64_t nanoseconds, uint64_t failures);
+
+  // Records the heap allocations of one invocation or batch of invocations.
+  void RecordAllocations(const AllocationCounts &counts);
+
+  // Records that @c count elements were not checked.
+  void RecordSkips(uint64_t count) {
+    skips_.fetch_add(count, std::memory_order_relaxed);
+  }
+
+  CheckMetricsSnapshot Snapshot() const;
+
+ private:
+  const std::string check_name_;
+  std::atomic<uint64_t> invocations_{0};
+  std::atomic<uint64_t> skips_{0};
+  std::atomic<uint64_t> failures_{0};
+  std::atomic<uint64_t> total_nanoseconds_{0};
+  std::atomic<uint64_t> max_nanoseconds_{0};
+  std::array<std::atomic<uint64_t>, kLatencyBucketCount> latency_histogram_{};
+  std::atomic<uint64_t> allocations_{0};
+  std::atomic<uint64_t> allocated_bytes_{0};
+  std::atomic<uint64_t> max_peak_bytes_{0};
+};
+
+// Records per check and per phase counters and timing of evaluations. One
+// object can be shared by toolkits on several threads. Toolkits record into
+// it when set with Toolkit::set_metrics, and record nothing, at the cost of a
+// single branch per check, otherwise.
+class EvaluationMetrics {
+ public:
+  // If @c times_phases is false, phases are not timed and ScopedPhaseTimer
+  // does nothing.
+  explicit EvaluationMetrics(bool times_phases = true)
+      : times_phases_(times_phases) {}
+
+  bool times_phases() const { return times_phases_; }
+
+  // Returns the counters of the check named @c check_name, creating them if
+  // needed. The returned counters live as long as this object. Takes a lock,
+  // so callers look counters up once and keep them.
+  CheckCounters *CountersForCheck(const std::string &check_name);
+
+  // Records that @c phase ran for @c nanoseconds.
+  void RecordPhase(EvaluationPhase phase, uint64_t nanoseconds);
+
+  // Records the heap allocations of a run of @c phase.
+  void RecordPhaseAllocations(EvaluationPhase phase,
+                              const AllocationCounts &counts);
+
+  // Returns a copy of the metrics recorded so far. Counters recorded
+  // concurrently with the snapshot may or may not be included.
+  EvaluationMetricsSnapshot Snapshot() const;
+
+ private:
+  struct PhaseCounters {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_nanoseconds{0};
+    std::atomic<uint64_t> max_nanoseconds{0};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> allocated_bytes{0};
+    std::atomic<uint64_t> max_peak_bytes{0};
+  };
+
+  const bool times_phases_;
+  std::array<PhaseCounters, kEvaluationPhaseCount> phases_;
+
+  // Guards check_counters_ and counters_by_name_.
+  mutable std::mutex mutex_;
+  // Counters of each check in the order they were created. A deque keeps
+  // their addresses stable.
+  std::deque<CheckCounters> check_counters_;
+  std::map<std::string, CheckCounters *> counters_by_name_;
+};
+
+// Returns the current time of the clock used by EvaluationMetrics in
+// nanoseconds.
+inline uint64_t MetricsClockNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Records the time from its construction to its destruction as a run of a
+// phase, and its heap allocations if AllocationTrackingEnabled. Does nothing
+// if @c metrics is nullptr or does not time phases.
+class ScopedPhaseTimer {
+ public:
+  ScopedPhaseTimer(EvaluationMetrics *metrics, EvaluationPhase phase)
+      : metrics_(metrics != nullptr && metrics->times_phases() ? metrics
+                                                                : nullptr),
+        phase_(phase),
+        allocations_(metrics_ != nullptr && AllocationTrackingEnabled()),
+        start_nanoseconds_(metrics_ != nullptr ? MetricsClockNanoseconds()
+                                               : 0) {}
+
+  ~ScopedPhaseTimer() {
+    if (metrics_ != nullptr) {
+      metrics_->RecordPhase(phase_,
+                            MetricsClockNanoseconds() - start_nanoseconds_);
+      if (allocations_.active()) {
+        metrics_->RecordPhaseAllocations(phase_, allocations_.Counts());
+      }
+    }
+  }
+
+  ScopedPhaseTimer(const ScopedPhaseTimer &) = delete;
+  ScopedPhaseTimer &operator=(const ScopedPhaseTimer &) = delete;
+
+ private:
+  EvaluationMetrics *const metrics_;
+  const EvaluationPhase phase_;
+  const ScopedAllocationCounter allocations_;
+  const uint64_t start_nanoseconds_;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_EVALUATION_METRICS_H_
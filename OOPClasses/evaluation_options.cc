@@ -0,0 +1,98 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "evaluation_options.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace gtx {
+
+EvaluationOptions EvaluationOptions::WithTimeout(Clock::duration timeout) {
+  EvaluationOptions options;
+  options.deadline = Clock::now() + timeout;
+  return options;
+}
+
+const char *EvaluationStatusName(EvaluationStatus status) {
+  switch (status) {
+    case EvaluationStatus::kComplete:
+      return "complete";
+    case EvaluationStatus::kDeadlineExceeded:
+      return "deadline_exceeded";
+    case EvaluationStatus::kCancelled:
+      return "cancelled";
+  }
+  return "unknown";
+}
+
+void CheckResultCounts::Record(int check_index, int result_id) {
+  if (check_index < 0 || result_id < 0) {
+    invalid_count_++;
+    return;
+  }
+  Reserve(check_index + 1);
+  std::vector<int64_t> &check_counts = counts_[check_index];
+  if (result_id >= static_cast<int>(check_counts.size())) {
+    check_counts.resize(result_id + 1);
+  }
+  check_counts[result_id]++;
+  total_++;
+}
+
+void CheckResultCounts::Add(const CheckResultCounts &other) {
+  Reserve(other.check_count());
+  for (size_t i = 0; i < other.counts_.size(); i++) {
+    const std::vector<int64_t> &other_counts = other.counts_[i];
+    std::vector<int64_t> &check_counts = counts_[i];
+    if (other_counts.size() > check_counts.size()) {
+      check_counts.resize(other_counts.size());
+    }
+    for (size_t j = 0; j < other_counts.size(); j++) {
+      check_counts[j] += other_counts[j];
+    }
+  }
+  total_ += other.total_;
+  invalid_count_ += other.invalid_count_;
+}
+
+int64_t CheckResultCounts::Count(int check_index) const {
+  if (check_index < 0 || check_index >= check_count()) {
+    return 0;
+  }
+  int64_t count = 0;
+  for (int64_t result_count : counts_[check_index]) {
+    count += result_count;
+  }
+  return count;
+}
+
+int64_t CheckResultCounts::Count(int check_index, int result_id) const {
+  if (check_index < 0 || check_index >= check_count() || result_id < 0 ||
+      result_id >= static_cast<int>(counts_[check_index].size())) {
+    return 0;
+  }
+  return counts_[check_index][result_id];
+}
+
+void CheckResultCounts::Reserve(int check_count) {
+  if (check_count > this->check_count()) {
+    counts_.resize(check_count);
+  }
+}
+
+}  // namespace gtx
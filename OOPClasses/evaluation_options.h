@@ -0,0 +1,183 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_EVALUATION_OPTIONS_H_
+#define GTXILIB_OOPCLASSES_EVALUATION_OPTIONS_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "typedefs.h"
+
+namespace gtx {
+
+// A flag that one thread sets to ask evaluations on other threads to stop.
+// Copies share the same flag, so a caller keeps a copy to cancel evaluations
+// it passed the token to.
+class CancellationToken {
+ public:
+  CancellationToken() : cancelled_(std::make_shared<std::atomic<bool>>()) {}
+
+  // Asks the evaluations using this token to stop. Thread safe.
+  void Cancel() { cancelled_->store(true, std::memory_order_relaxed); }
+
+  // Returns true if Cancel has been called on this token or a copy of it.
+  bool IsCancelled() const {
+    return cancelled_->load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+// Bounds the time Toolkit::CheckElements spends on a hierarchy. Evaluation
+// stops cooperatively: the deadline and the cancellation token are checked
+// between elements, so a check invocation that has started always finishes.
+struct EvaluationOptions {
+  using Clock = std::chrono::steady_clock;
+
+  // Returns options whose deadline is @c timeout from now.
+  static EvaluationOptions WithTimeout(Clock::duration timeout);
+
+  // Evaluation stops at the first element boundary after this time. Defaults
+  // to no deadline.
+  Clock::time_point deadline = Clock::time_point::max();
+
+  // If not nullptr, evaluation stops at the first element boundary after the
+  // token is cancelled. The token must outlive the evaluation.
+  const CancellationToken *cancellation_token = nullptr;
+
+  // Returns true if these options can stop an evaluation early.
+  bool IsBounded() const {
+    return deadline != Clock::time_point::max() ||
+           cancellation_token != nullptr;
+  }
+};
+
+// Why an evaluation returned.
+enum class EvaluationStatus {
+  // All elements were evaluated.
+  kComplete,
+  // The deadline of the evaluation passed.
+  kDeadlineExceeded,
+  // The cancellation token of the evaluation was cancelled.
+  kCancelled,
+};
+
+// Returns a name for @c status, such as "deadline_exceeded".
+const char *EvaluationStatusName(EvaluationStatus status);
+
+// The results of an evaluation that may have stopped early.
+struct EvaluationResult {
+  // The results found, in the same order as a complete evaluation would
+  // return them. If the evaluation stopped early, these are all the results
+  // of the first @c elements_evaluated elements and no others.
+  std::vector<CheckResultProto> results;
+
+  EvaluationStatus status = EvaluationStatus::kComplete;
+
+  // The number of elements, in hierarchy order, that were evaluated or
+  // skipped, and the number of elements in the hierarchy.
+  int elements_evaluated = 0;
+  int element_count = 0;
+
+  // Returns true if all elements were evaluated.
+  bool complete() const { return status == EvaluationStatus::kComplete; }
+};
+
+// The number of results of an evaluation by check and by result id, for
+// callers that only need tallies. Checks are identified by their index among
+// the checks of the toolkit, and result ids are the small non-negative ids
+// checks define. Counting needs no memory beyond a slot per result id seen.
+class CheckResultCounts {
+ public:
+  // Counts a result with @c result_id of the check at @c check_index. A
+  // result whose check index or result id is negative has no slot, and is
+  // counted only by invalid_count.
+  void Record(int check_index, int result_id);
+
+  // Adds the counts of @c other to these, to aggregate the counts of several
+  // evaluations.
+  void Add(const CheckResultCounts &other);
+
+  // The number of results of the check at @c check_index.
+  int64_t Count(int check_index) const;
+
+  // The number of results with @c result_id of the check at @c check_index.
+  int64_t Count(int check_index, int result_id) const;
+
+  // The number of results of all checks, excluding invalid_count.
+  int64_t total() const { return total_; }
+
+  // The number of results recorded with a negative check index or result id.
+  int64_t invalid_count() const { return invalid_count_; }
+
+  // The number of checks with a slot, one more than the highest check index
+  // counted so far or reserved.
+  int check_count() const { return static_cast<int>(counts_.size()); }
+
+  // Makes room for the counts of @c check_count checks.
+  void Reserve(int check_count);
+
+ private:
+  // The counts indexed by check index, then result id.
+  std::vector<std::vector<int64_t>> counts_;
+  int64_t total_ = 0;
+  int64_t invalid_count_ = 0;
+};
+
+// Checks the deadline and the cancellation token of EvaluationOptions. Reading
+// the clock costs about as much as checking a small element, so evaluations
+// call IsExhausted every few elements rather than before each one.
+class EvaluationBudget {
+ public:
+  explicit EvaluationBudget(const EvaluationOptions &options)
+      : options_(options), bounded_(options.IsBounded()) {}
+
+  // Returns true if evaluation must stop, and sets status() to the reason.
+  // Once it returns true, it always does.
+  bool IsExhausted() {
+    if (!bounded_) {
+      return false;
+    }
+    if (status_ != EvaluationStatus::kComplete) {
+      return true;
+    }
+    if (options_.cancellation_token != nullptr &&
+        options_.cancellation_token->IsCancelled()) {
+      status_ = EvaluationStatus::kCancelled;
+    } else if (EvaluationOptions::Clock::now() >= options_.deadline) {
+      status_ = EvaluationStatus::kDeadlineExceeded;
+    }
+    return status_ != EvaluationStatus::kComplete;
+  }
+
+  // Why IsExhausted last returned true, or kComplete if it has not.
+  EvaluationStatus status() const { return status_; }
+
+ private:
+  const EvaluationOptions &options_;
+  const bool bounded_;
+  EvaluationStatus status_ = EvaluationStatus::kComplete;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_EVALUATION_OPTIONS_H_
@@ -0,0 +1,78 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "executor.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace gtx {
+
+ThreadPoolExecutor::ThreadPoolExecutor(int thread_count) {
+  if (thread_count <= 0) {
+    thread_count =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  for (int i = 0; i < thread_count; i++) {
+    threads_.emplace_back([this] { RunTasks(); });
+  }
+}
+
+ThreadPoolExecutor::~ThreadPoolExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  tasks_changed_.notify_all();
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPoolExecutor::Execute(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  tasks_changed_.notify_one();
+}
+
+ThreadPoolExecutor *ThreadPoolExecutor::Default() {
+  static ThreadPoolExecutor *executor = new ThreadPoolExecutor();
+  return executor;
+}
+
+void ThreadPoolExecutor::RunTasks() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      tasks_changed_.wait(lock,
+                          [this] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace gtx
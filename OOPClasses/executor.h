@@ -0,0 +1,74 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_EXECUTOR_H_
+#define GTXILIB_OOPCLASSES_EXECUTOR_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gtx {
+
+// Runs tasks, such as asynchronous evaluations, on threads it manages. Hosts
+// that already have a thread pool or an event loop implement this interface
+// to run evaluations on it instead of on threads created by GTXiLib.
+class Executor {
+ public:
+  virtual ~Executor() {}
+
+  // Schedules @c task to run once, on any thread. Must be thread safe.
+  virtual void Execute(std::function<void()> task) = 0;
+};
+
+// An Executor that runs tasks in first in, first out order on a fixed number
+// of threads.
+class ThreadPoolExecutor : public Executor {
+ public:
+  // Starts @c thread_count threads. 0 starts one per core.
+  explicit ThreadPoolExecutor(int thread_count = 0);
+
+  // Runs the tasks scheduled so far, then stops the threads.
+  ~ThreadPoolExecutor() override;
+
+  ThreadPoolExecutor(const ThreadPoolExecutor &) = delete;
+  ThreadPoolExecutor &operator=(const ThreadPoolExecutor &) = delete;
+
+  void Execute(std::function<void()> task) override;
+
+  int thread_count() const { return static_cast<int>(threads_.size()); }
+
+  // Returns an executor with one thread per core, created on first use and
+  // never destroyed. Used by asynchronous evaluations given no executor.
+  static ThreadPoolExecutor *Default();
+
+ private:
+  // Runs tasks until the executor stops and no tasks are left.
+  void RunTasks();
+
+  std::mutex mutex_;
+  std::condition_variable tasks_changed_;
+  std::deque<std::function<void()>> tasks_;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_EXECUTOR_H_
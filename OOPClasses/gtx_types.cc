@@ -18,6 +18,8 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+
 #include "gtx.pb.h"
 #include "image_color_utils.h"
 
@@ -62,5 +64,16 @@ gtx::Rect gtx::Rect::ScaledRect(float x_scale, float y_scale) const {
               this->size.width * x_scale, this->size.height * y_scale);
 }
 
+gtx::Rect gtx::Rect::Intersection(const gtx::Rect &other) const {
+  float min_x = std::max(origin.x, other.origin.x);
+  float min_y = std::max(origin.y, other.origin.y);
+  float max_x = std::min(GetMaxX(), other.GetMaxX());
+  float max_y = std::min(GetMaxY(), other.GetMaxY());
+  if (max_x <= min_x || max_y <= min_y) {
+    return Rect();
+  }
+  return Rect(min_x, min_y, max_x - min_x, max_y - min_y);
+}
+
 gtx::Image::Image(gtx::Pixel *pixels, int width, int height)
     : width(width), height(height), pixels(pixels) {}
@@ -79,6 +79,13 @@ struct Rect {
   float GetMaxX() const { return origin.x + fabs(size.width); }
   float GetMaxY() const { return origin.y + fabs(size.height); }
   Rect ScaledRect(float x_scale, float y_scale) const;
+
+  // Returns true if this rect has no area.
+  bool IsEmpty() const { return size.width == 0 || size.height == 0; }
+
+  // Returns the intersection of this rect and @c other, modelled after
+  // CGRectIntersection. Returns an empty rect if the rects do not intersect.
+  Rect Intersection(const Rect &other) const;
 };
 
 // Image is defined as a 2D block of pixels/color values.
@@ -88,8 +95,8 @@ struct Image {
   int width, height;
   Pixel *pixels;
 
-  // Constructs a new empty image.
-  Image() {}
+  // Constructs a new empty image, without pixels.
+  Image() : width(0), height(0), pixels(nullptr) {}
 
   // Constructs a new image with the given pixels and dimensions, note that
   // pixel memory is not owned by this instance.
@@ -0,0 +1,186 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "hierarchy_table.h"
+
+#include <stdint.h>
+
+#include <abseil/absl/strings/string_view.h>
+#include <abseil/absl/types/span.h>
+#include "enums.pb.h"
+#include "hierarchy_snapshot.h"
+#include "typedefs.h"
+#include "element_trait.h"
+
+using gtxilib::oopclasses::protos::
+    ElementType_ElementTypeEnum_BUTTON;
+using gtxilib::oopclasses::protos::
+    ElementType_ElementTypeEnum_STATIC_TEXT;
+using gtxilib::oopclasses::protos::
+    ElementType_ElementTypeEnum_TEXT_FIELD;
+using gtxilib::oopclasses::protos::
+    ElementType_ElementTypeEnum_TEXT_VIEW;
+
+namespace gtx {
+
+HierarchyTable HierarchyTable::FromProto(
+    const AccessibilityHierarchyProto &hierarchy) {
+  HierarchyTable table;
+  table.hierarchy_ = &hierarchy;
+  const int element_count = hierarchy.elements_size();
+  table.ids_.reserve(element_count);
+  table.parent_ids_.reserve(element_count);
+  table.ax_traits_.reserve(element_count);
+  table.element_types_.reserve(element_count);
+  table.ax_frames_.reserve(element_count);
+  table.alphas_.reserve(element_count);
+  table.flags_.reserve(element_count);
+  table.label_offsets_.reserve(element_count + 1);
+  table.child_offsets_.reserve(element_count + 1);
+  table.label_offsets_.push_back(0);
+  table.child_offsets_.push_back(0);
+
+  for (const UIElementProto &element : hierarchy.elements()) {
+    uint16_t flags = 0;
+    flags |= element.has_id() ? kHasId : 0;
+    flags |= element.has_parent_id() ? kHasParentId : 0;
+    flags |= element.is_ax_element() ? kIsAXElement : 0;
+    flags |= element.has_ax_traits() ? kHasAXTraits : 0;
+    flags |= element.has_element_type() ? kHasElementType : 0;
+    flags |= element.has_ax_frame() ? kHasAXFrame : 0;
+    flags |= element.has_alpha() ? kHasAlpha : 0;
+    flags |= element.hidden() ? kHidden : 0;
+    flags |= element.clips_to_bounds() ? kClipsToBounds : 0;
+    table.flags_.push_back(flags);
+
+    table.ids_.push_back(element.id());
+    table.parent_ids_.push_back(element.parent_id());
+    table.ax_traits_.push_back(element.ax_traits());
+    table.element_types_.push_back(element.element_type());
+    const RectProto &frame = element.ax_frame();
+    table.ax_frames_.push_back({frame.origin().x(), frame.origin().y(),
+                                frame.size().width(), frame.size().height()});
+    table.alphas_.push_back(element.alpha());
+
+    table.label_arena_.append(element.ax_label());
+    table.label_offsets_.push_back(
+        static_cast<uint32_t>(table.label_arena_.size()));
+    const std::vector<int32_t> &child_ids = element.child_ids();
+    table.child_ids_.insert(table.child_ids_.end(), child_ids.begin(),
+                            child_ids.end());
+    table.child_offsets_.push_back(
+        static_cast<uint32_t>(table.child_ids_.size()));
+  }
+  return table;
+}
+
+HierarchyTable HierarchyTable::FromSnapshot(
+    const HierarchySnapshot &snapshot) {
+  HierarchyTable table;
+  table.snapshot_ = &snapshot;
+  const absl::Span<const SnapshotElement> elements = snapshot.elements();
+  const int element_count = static_cast<int>(elements.size());
+  table.ids_.reserve(element_count);
+  table.parent_ids_.reserve(element_count);
+  table.ax_traits_.reserve(element_count);
+  table.element_types_.reserve(element_count);
+  table.ax_frames_.reserve(element_count);
+  table.alphas_.reserve(element_count);
+  table.flags_.reserve(element_count);
+  table.label_offsets_.reserve(element_count + 1);
+  table.child_offsets_.reserve(element_count + 1);
+  table.label_offsets_.push_back(0);
+  table.child_offsets_.push_back(0);
+
+  for (const SnapshotElement &element : elements) {
+    auto flag_if = [&element](SnapshotElement::Field field, Flag flag) {
+      return element.has(field) ? flag : 0;
+    };
+    auto flag_if_true = [&element](SnapshotElement::Field field, Flag flag) {
+      return element.bool_value(field) ? flag : 0;
+    };
+    uint16_t flags = 0;
+    flags |= flag_if(SnapshotElement::kId, kHasId);
+    flags |= flag_if(SnapshotElement::kParentId, kHasParentId);
+    flags |= flag_if_true(SnapshotElement::kIsAXElement, kIsAXElement);
+    flags |= flag_if(SnapshotElement::kAXTraits, kHasAXTraits);
+    flags |= flag_if(SnapshotElement::kElementType, kHasElementType);
+    flags |= flag_if(SnapshotElement::kAXFrame, kHasAXFrame);
+    flags |= flag_if(SnapshotElement::kAlpha, kHasAlpha);
+    flags |= flag_if_true(SnapshotElement::kHidden, kHidden);
+    flags |= flag_if_true(SnapshotElement::kClipsToBounds, kClipsToBounds);
+    table.flags_.push_back(flags);
+
+    table.ids_.push_back(element.id);
+    table.parent_ids_.push_back(element.parent_id);
+    table.ax_traits_.push_back(element.ax_traits);
+    table.element_types_.push_back(element.element_type);
+    table.ax_frames_.push_back({element.ax_frame.x, element.ax_frame.y,
+                                element.ax_frame.width,
+                                element.ax_frame.height});
+    table.alphas_.push_back(element.alpha);
+
+    absl::string_view label = snapshot.String(element.ax_label);
+    table.label_arena_.append(label.data(), label.size());
+    table.label_offsets_.push_back(
+        static_cast<uint32_t>(table.label_arena_.size()));
+    absl::Span<const int32_t> child_ids = snapshot.Int32s(element.child_ids);
+    table.child_ids_.insert(table.child_ids_.end(), child_ids.begin(),
+                            child_ids.end());
+    table.child_offsets_.push_back(
+        static_cast<uint32_t>(table.child_ids_.size()));
+  }
+  return table;
+}
+
+UIElementProto HierarchyTable::ElementProto(int index) const {
+  if (hierarchy_ != nullptr) {
+    return hierarchy_->elements(index);
+  }
+  return snapshot_->ElementProto(index);
+}
+
+bool HierarchyTable::HasAnyTrait(int index, ElementTrait traits) const {
+  return HasFlag(index, kHasAXTraits) &&
+         (ax_traits_[index] & static_cast<uint64_t>(traits)) != 0;
+}
+
+bool HierarchyTable::HasElementType(int index,
+                                    ElementTypeProto element_type) const {
+  return HasFlag(index, kHasElementType) &&
+         element_types_[index] == element_type;
+}
+
+bool HierarchyTable::IsStaticTextElement(int index) const {
+  return HasAnyTrait(index, ElementTrait::kStaticText) ||
+         HasElementType(index, ElementType_ElementTypeEnum_STATIC_TEXT);
+}
+
+bool HierarchyTable::IsButtonElement(int index) const {
+  return HasAnyTrait(index, ElementTrait::kButton) ||
+         HasElementType(index, ElementType_ElementTypeEnum_BUTTON);
+}
+
+bool HierarchyTable::IsTextDisplayingElement(int index) const {
+  return HasAnyTrait(index, ElementTrait::kStaticText | ElementTrait::kLink |
+                                ElementTrait::kSearchField |
+                                ElementTrait::kKeyboardKey) ||
+         HasElementType(index, ElementType_ElementTypeEnum_STATIC_TEXT) ||
+         HasElementType(index, ElementType_ElementTypeEnum_TEXT_FIELD) ||
+         HasElementType(index, ElementType_ElementTypeEnum_TEXT_VIEW);
+}
+
+}  // namespace gtx
@@ -0,0 +1,155 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_HIERARCHY_TABLE_H_
+#define GTXILIB_OOPCLASSES_HIERARCHY_TABLE_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <abseil/absl/strings/string_view.h>
+#include <abseil/absl/types/span.h>
+#include "hierarchy_snapshot.h"
+#include "typedefs.h"
+#include "element_trait.h"
+#include "gtx_types.h"
+
+namespace gtx {
+
+// A rectangle stored as four contiguous floats, so columns of frames can be
+// processed with vector instructions.
+struct alignas(16) Float4 {
+  float x, y, width, height;
+};
+
+// A columnar (struct-of-arrays) representation of an accessibility hierarchy.
+// Each property of the hierarchy's elements is stored in its own contiguous
+// array, indexed by the position of the element in the hierarchy, so checks
+// can process a property of all elements at once instead of going through the
+// accessors of each UIElementProto.
+class HierarchyTable {
+ public:
+  // Boolean properties of elements, stored as bits in flags().
+  enum Flag : uint16_t {
+    kHasId = 1 << 0,
+    kHasParentId = 1 << 1,
+    kIsAXElement = 1 << 2,
+    kHasAXTraits = 1 << 3,
+    kHasElementType = 1 << 4,
+    kHasAXFrame = 1 << 5,
+    kHasAlpha = 1 << 6,
+    kHidden = 1 << 7,
+    kClipsToBounds = 1 << 8,
+  };
+
+  // Constructs a table with the elements of @c hierarchy. The table keeps a
+  // reference to @c hierarchy, which must outlive it.
+  static HierarchyTable FromProto(const AccessibilityHierarchyProto &hierarchy);
+
+  // Constructs a table with the elements of @c snapshot without converting
+  // them to protos. The table keeps a reference to @c snapshot, which must
+  // outlive it.
+  static HierarchyTable FromSnapshot(const HierarchySnapshot &snapshot);
+
+  HierarchyTable(HierarchyTable &&) = default;
+  HierarchyTable &operator=(HierarchyTable &&) = default;
+
+  // The number of elements in this table.
+  int size() const { return static_cast<int>(ids_.size()); }
+
+  // The hierarchy this table was constructed from, or nullptr if it was
+  // constructed from a snapshot.
+  const AccessibilityHierarchyProto *hierarchy() const { return hierarchy_; }
+
+  // The snapshot this table was constructed from, or nullptr if it was
+  // constructed from a hierarchy.
+  const HierarchySnapshot *snapshot() const { return snapshot_; }
+
+  // Returns the element at @c index as a proto, copying it out of the snapshot
+  // if the table was constructed from one.
+  UIElementProto ElementProto(int index) const;
+
+  // Columns of element properties. Values of properties an element does not
+  // have are zero.
+  const std::vector<int32_t> &ids() const { return ids_; }
+  const std::vector<int32_t> &parent_ids() const { return parent_ids_; }
+  const std::vector<uint64_t> &ax_traits() const { return ax_traits_; }
+  const std::vector<int32_t> &element_types() const { return element_types_; }
+  const std::vector<Float4> &ax_frames() const { return ax_frames_; }
+  const std::vector<float> &alphas() const { return alphas_; }
+  const std::vector<uint16_t> &flags() const { return flags_; }
+
+  // Returns true if the element at @c index has the given flag set.
+  bool HasFlag(int index, Flag flag) const {
+    return (flags_[index] & flag) != 0;
+  }
+
+  // Returns the accessibility label of the element at @c index. The returned
+  // view is valid as long as this table is.
+  absl::string_view ax_label(int index) const {
+    return absl::string_view(label_arena_)
+        .substr(label_offsets_[index],
+                label_offsets_[index + 1] - label_offsets_[index]);
+  }
+
+  // Returns the ids of the children of the element at @c index.
+  absl::Span<const int32_t> child_ids(int index) const {
+    return absl::MakeConstSpan(child_ids_)
+        .subspan(child_offsets_[index],
+                 child_offsets_[index + 1] - child_offsets_[index]);
+  }
+
+  // Returns true if the element at @c index has the given trait or element
+  // type, the columnar equivalents of the functions in proto_utils.h.
+  bool IsStaticTextElement(int index) const;
+  bool IsButtonElement(int index) const;
+  bool IsTextDisplayingElement(int index) const;
+
+ private:
+  HierarchyTable() {}
+
+  // Returns true if the element at @c index has any of @c traits.
+  bool HasAnyTrait(int index, ElementTrait traits) const;
+
+  // Returns true if the element at @c index has @c element_type.
+  bool HasElementType(int index, ElementTypeProto element_type) const;
+
+  const AccessibilityHierarchyProto *hierarchy_ = nullptr;
+  const HierarchySnapshot *snapshot_ = nullptr;
+  std::vector<int32_t> ids_;
+  std::vector<int32_t> parent_ids_;
+  std::vector<uint64_t> ax_traits_;
+  std::vector<int32_t> element_types_;
+  std::vector<Float4> ax_frames_;
+  std::vector<float> alphas_;
+  std::vector<uint16_t> flags_;
+
+  // The labels of all elements, concatenated. The label of element i starts at
+  // label_offsets_[i] and ends at label_offsets_[i + 1].
+  std::string label_arena_;
+  std::vector<uint32_t> label_offsets_;
+
+  // The child ids of all elements, concatenated. The child ids of element i
+  // start at child_offsets_[i] and end at child_offsets_[i + 1].
+  std::vector<int32_t> child_ids_;
+  std::vector<uint32_t> child_offsets_;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_HIERARCHY_TABLE_H_
@@ -0,0 +1,210 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "hierarchy_visibility.h"
+
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+#include <abseil/absl/container/flat_hash_map.h>
+#include <abseil/absl/types/span.h>
+#include "typedefs.h"
+#include "gtx_types.h"
+#include "hierarchy_table.h"
+
+namespace gtx {
+
+namespace {
+
+// The state an element passes down to its children.
+struct InheritedState {
+  // True if clip is the area descendants are clipped to, false if they are not
+  // clipped at all.
+  bool has_clip;
+  Rect clip;
+  float alpha;
+  bool hidden;
+};
+
+// Provides access to the elements of an AccessibilityHierarchyProto for
+// ComputeVisibility.
+class ProtoElements {
+ public:
+  explicit ProtoElements(const AccessibilityHierarchyProto &hierarchy)
+      : hierarchy_(hierarchy) {}
+
+  int size() const { return hierarchy_.elements_size(); }
+  bool HasId(int i) const { return hierarchy_.elements(i).has_id(); }
+  int Id(int i) const { return hierarchy_.elements(i).id(); }
+  bool HasParentId(int i) const {
+    return hierarchy_.elements(i).has_parent_id();
+  }
+  int ParentId(int i) const { return hierarchy_.elements(i).parent_id(); }
+  float Alpha(int i) const {
+    const UIElementProto &element = hierarchy_.elements(i);
+    return element.has_alpha() ? element.alpha() : 1.0f;
+  }
+  bool Hidden(int i) const { return hierarchy_.elements(i).hidden(); }
+  bool HasFrame(int i) const { return hierarchy_.elements(i).has_ax_frame(); }
+  Rect Frame(int i) const { return Rect(hierarchy_.elements(i).ax_frame()); }
+  bool ClipsToBounds(int i) const {
+    return hierarchy_.elements(i).clips_to_bounds();
+  }
+  const std::vector<int32_t> &ChildIds(int i) const {
+    return hierarchy_.elements(i).child_ids();
+  }
+
+ private:
+  const AccessibilityHierarchyProto &hierarchy_;
+};
+
+// Provides access to the elements of a HierarchyTable for ComputeVisibility.
+class TableElements {
+ public:
+  explicit TableElements(const HierarchyTable &table) : table_(table) {}
+
+  int size() const { return table_.size(); }
+  bool HasId(int i) const { return table_.HasFlag(i, HierarchyTable::kHasId); }
+  int Id(int i) const { return table_.ids()[i]; }
+  bool HasParentId(int i) const {
+    return table_.HasFlag(i, HierarchyTable::kHasParentId);
+  }
+  int ParentId(int i) const { return table_.parent_ids()[i]; }
+  float Alpha(int i) const {
+    return table_.HasFlag(i, HierarchyTable::kHasAlpha) ? table_.alphas()[i]
+                                                         : 1.0f;
+  }
+  bool Hidden(int i) const {
+    return table_.HasFlag(i, HierarchyTable::kHidden);
+  }
+  bool HasFrame(int i) const {
+    return table_.HasFlag(i, HierarchyTable::kHasAXFrame);
+  }
+  Rect Frame(int i) const {
+    const Float4 &frame = table_.ax_frames()[i];
+    return Rect(frame.x, frame.y, frame.width, frame.height);
+  }
+  bool ClipsToBounds(int i) const {
+    return table_.HasFlag(i, HierarchyTable::kClipsToBounds);
+  }
+  absl::Span<const int32_t> ChildIds(int i) const {
+    return table_.child_ids(i);
+  }
+
+ private:
+  const HierarchyTable &table_;
+};
+
+// Computes the visibility of all elements in a single top-down pass. Elements
+// must be one of the accessor classes above.
+template <typename Elements>
+std::vector<ElementVisibility> ComputeVisibility(const Elements &elements,
+                                                 const Rect &screen_bounds) {
+  const int element_count = elements.size();
+  std::vector<ElementVisibility> visibilities(element_count);
+
+  absl::flat_hash_map<int, int> index_of_id;
+  index_of_id.reserve(element_count);
+  for (int i = 0; i < element_count; i++) {
+    if (elements.HasId(i)) {
+      index_of_id.emplace(elements.Id(i), i);
+    }
+  }
+
+  const InheritedState root_state = {!screen_bounds.IsEmpty(), screen_bounds,
+                                     1.0f, false};
+  std::vector<InheritedState> inherited_states(element_count);
+  std::vector<bool> visited(element_count, false);
+  // Pairs of element indices and the indices of their parents, or -1 for
+  // elements that are treated as roots.
+  std::vector<std::pair<int, int>> stack;
+
+  auto visit_tree = [&](int root_index) {
+    visited[root_index] = true;
+    stack.emplace_back(root_index, -1);
+    while (!stack.empty()) {
+      const int index = stack.back().first;
+      const int parent_index = stack.back().second;
+      stack.pop_back();
+      const InheritedState &parent_state =
+          parent_index < 0 ? root_state : inherited_states[parent_index];
+
+      float alpha = parent_state.alpha * elements.Alpha(index);
+      bool hidden = parent_state.hidden || elements.Hidden(index);
+      bool has_bounds = parent_state.has_clip;
+      Rect visible_rect = parent_state.has_clip ? parent_state.clip : Rect();
+      if (elements.HasFrame(index)) {
+        Rect frame = elements.Frame(index);
+        visible_rect = parent_state.has_clip
+                           ? parent_state.clip.Intersection(frame)
+                           : frame;
+        has_bounds = true;
+      }
+      bool is_visible =
+          !hidden && alpha > 0 && !(has_bounds && visible_rect.IsEmpty());
+      visibilities[index] = {visible_rect, alpha, is_visible};
+
+      InheritedState &state = inherited_states[index];
+      state = {parent_state.has_clip, parent_state.clip, alpha, hidden};
+      if (elements.ClipsToBounds(index) && elements.HasFrame(index)) {
+        state.has_clip = true;
+        state.clip = visible_rect;
+      }
+
+      for (int child_id : elements.ChildIds(index)) {
+        auto child = index_of_id.find(child_id);
+        if (child == index_of_id.end() || visited[child->second]) {
+          continue;
+        }
+        visited[child->second] = true;
+        stack.emplace_back(child->second, index);
+      }
+    }
+  };
+
+  for (int i = 0; i < element_count; i++) {
+    bool has_parent_in_hierarchy =
+        elements.HasParentId(i) && elements.ParentId(i) != elements.Id(i) &&
+        index_of_id.contains(elements.ParentId(i));
+    if (!has_parent_in_hierarchy && !visited[i]) {
+      visit_tree(i);
+    }
+  }
+  // Elements that are not reachable from a root, for example because their
+  // parents do not list them as children or because of cycles, are evaluated as
+  // if they were roots themselves.
+  for (int i = 0; i < element_count; i++) {
+    if (!visited[i]) {
+      visit_tree(i);
+    }
+  }
+  return visibilities;
+}
+
+}  // namespace
+
+HierarchyVisibility::HierarchyVisibility(
+    const AccessibilityHierarchyProto &hierarchy, const Rect &screen_bounds)
+    : visibilities_(
+          ComputeVisibility(ProtoElements(hierarchy), screen_bounds)) {}
+
+HierarchyVisibility::HierarchyVisibility(const HierarchyTable &table,
+                                         const Rect &screen_bounds)
+    : visibilities_(ComputeVisibility(TableElements(table), screen_bounds)) {}
+
+}  // namespace gtx
@@ -0,0 +1,80 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_HIERARCHY_VISIBILITY_H_
+#define GTXILIB_OOPCLASSES_HIERARCHY_VISIBILITY_H_
+
+#include <vector>
+
+#include "typedefs.h"
+#include "gtx_types.h"
+#include "hierarchy_table.h"
+
+namespace gtx {
+
+// The effective visibility of an element, taking the state of its ancestors
+// into account.
+struct ElementVisibility {
+  // The part of the element's accessibility frame that is not clipped by the
+  // screen or by an ancestor that clips to its bounds. Elements without an
+  // accessibility frame are assumed to cover the whole area they are clipped
+  // to, which is empty if they are not clipped at all.
+  Rect visible_rect;
+
+  // The element's alpha multiplied by the alpha of all its ancestors. Elements
+  // without an alpha are treated as fully opaque.
+  float effective_alpha;
+
+  // True if neither the element nor any of its ancestors is hidden or fully
+  // transparent, and visible_rect is not empty.
+  bool is_visible;
+};
+
+// Computes the visibility of every element in an accessibility hierarchy in a
+// single top-down pass over the parent/child ids of its elements.
+class HierarchyVisibility {
+ public:
+  // Computes the visibility of all elements in @c hierarchy. Elements are
+  // clipped to @c screen_bounds, unless it is empty in which case elements are
+  // never considered off-screen. Both @c screen_bounds and the accessibility
+  // frames of elements are expected to be in screen coordinates.
+  HierarchyVisibility(const AccessibilityHierarchyProto &hierarchy,
+                      const Rect &screen_bounds);
+
+  // Computes the visibility of all elements in @c table, in the same way as
+  // the constructor taking an AccessibilityHierarchyProto.
+  HierarchyVisibility(const HierarchyTable &table, const Rect &screen_bounds);
+
+  // Returns the visibility of the element at @c index in the hierarchy's
+  // elements or table. Behavior is undefined if @c index is out of bounds.
+  const ElementVisibility &VisibilityOfElementAtIndex(int index) const {
+    return visibilities_[index];
+  }
+
+  // Returns true if the element at @c index in the hierarchy's elements is
+  // visible. Behavior is undefined if @c index is out of bounds.
+  bool IsElementAtIndexVisible(int index) const {
+    return visibilities_[index].is_visible;
+  }
+
+ private:
+  // Visibility of each element, in the same order as the hierarchy's elements.
+  std::vector<ElementVisibility> visibilities_;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_HIERARCHY_VISIBILITY_H_
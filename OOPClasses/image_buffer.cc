@@ -0,0 +1,236 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "image_buffer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "gtx_types.h"
+#include "luminance_plane.h"
+
+namespace gtx {
+
+namespace {
+
+// The capacity, in pixels, of the smallest size class.
+constexpr size_t kMinClassPixelCount = 1024;
+
+// Returns the capacity of the smallest size class that holds @c pixel_count
+// pixels, and its index in @c size_class.
+size_t SizeClassCapacity(size_t pixel_count, int *size_class) {
+  int index = 0;
+  for (size_t base = kMinClassPixelCount;; base *= 2) {
+    for (size_t quarters = 4; quarters < 8; quarters++) {
+      const size_t capacity = base / 4 * quarters;
+      if (capacity >= pixel_count) {
+        *size_class = index;
+        return capacity;
+      }
+      index++;
+    }
+  }
+}
+
+}  // namespace
+
+struct ImageBuffer::Block {
+  Block(std::shared_ptr<ImageBufferPool::State> pool, int size_class,
+        size_t capacity)
+      : pool(std::move(pool)),
+        size_class(size_class),
+        capacity(capacity),
+        pixels(new Pixel[capacity]) {}
+
+  std::atomic<int> use_count{1};
+  // The pool the block returns to when released, nullptr for heap blocks.
+  const std::shared_ptr<ImageBufferPool::State> pool;
+  const int size_class;
+  const size_t capacity;
+  const std::unique_ptr<Pixel[]> pixels;
+  LazyLuminancePlane luminance_plane{Image(), nullptr, nullptr};
+  // The next released block of the same size class.
+  Block *next_free = nullptr;
+};
+
+struct ImageBufferPool::State {
+  explicit State(size_t max_retained_bytes)
+      : max_retained_bytes(max_retained_bytes) {}
+
+  // Keeps @c block for reuse. Returns false, and the caller frees the block,
+  // if the pool is destroyed or would retain too many bytes.
+  bool Keep(ImageBuffer::Block *block) {
+    const size_t bytes = block->capacity * sizeof(Pixel);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (destroyed || retained_bytes + bytes > max_retained_bytes) {
+      return false;
+    }
+    if (free_blocks.size() <= static_cast<size_t>(block->size_class)) {
+      free_blocks.resize(block->size_class + 1, nullptr);
+    }
+    block->next_free = free_blocks[block->size_class];
+    free_blocks[block->size_class] = block;
+    retained_bytes += bytes;
+    return true;
+  }
+
+  const size_t max_retained_bytes;
+  mutable std::mutex mutex;
+  // The first released block of each size class.
+  std::vector<ImageBuffer::Block *> free_blocks;
+  size_t retained_bytes = 0;
+  int64_t allocation_count = 0;
+  int64_t reuse_count = 0;
+  bool destroyed = false;
+};
+
+void ImageBuffer::Unref(Block *block) {
+  if (block == nullptr ||
+      block->use_count.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  // A retained block does not hold on to the plane of its last screenshot.
+  block->luminance_plane.Reset(Image(), nullptr, nullptr);
+  if (block->pool != nullptr && block->pool->Keep(block)) {
+    return;
+  }
+  delete block;
+}
+
+ImageBuffer ImageBuffer::Allocate(int width, int height) {
+  if (width <= 0 || height <= 0) {
+    return ImageBuffer();
+  }
+  const size_t pixel_count = static_cast<size_t>(width) * height;
+  return ImageBuffer(new Block(nullptr, 0, pixel_count), width, height);
+}
+
+ImageBuffer::ImageBuffer(Block *block, int width, int height)
+    : block_(block), width_(width), height_(height) {
+  block_->luminance_plane.Reset(image(), nullptr, nullptr);
+}
+
+ImageBuffer::ImageBuffer(const ImageBuffer &other)
+    : block_(other.block_), width_(other.width_), height_(other.height_) {
+  if (block_ != nullptr) {
+    block_->use_count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+ImageBuffer::ImageBuffer(ImageBuffer &&other)
+    : block_(other.block_), width_(other.width_), height_(other.height_) {
+  other.block_ = nullptr;
+  other.width_ = 0;
+  other.height_ = 0;
+}
+
+ImageBuffer &ImageBuffer::operator=(ImageBuffer other) {
+  std::swap(block_, other.block_);
+  std::swap(width_, other.width_);
+  std::swap(height_, other.height_);
+  return *this;
+}
+
+ImageBuffer::~ImageBuffer() { Unref(block_); }
+
+Pixel *ImageBuffer::pixels() const {
+  return block_ != nullptr ? block_->pixels.get() : nullptr;
+}
+
+LazyLuminancePlane *ImageBuffer::luminance_plane() const {
+  return block_ != nullptr ? &block_->luminance_plane : nullptr;
+}
+
+int ImageBuffer::use_count() const {
+  return block_ != nullptr
+             ? block_->use_count.load(std::memory_order_relaxed)
+             : 0;
+}
+
+constexpr size_t ImageBufferPool::kDefaultMaxRetainedBytes;
+
+ImageBufferPool::ImageBufferPool(size_t max_retained_bytes)
+    : state_(std::make_shared<State>(max_retained_bytes)) {}
+
+ImageBufferPool::~ImageBufferPool() {
+  std::vector<ImageBuffer::Block *> free_blocks;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->destroyed = true;
+    free_blocks.swap(state_->free_blocks);
+    state_->retained_bytes = 0;
+  }
+  for (ImageBuffer::Block *block : free_blocks) {
+    while (block != nullptr) {
+      ImageBuffer::Block *next = block->next_free;
+      delete block;
+      block = next;
+    }
+  }
+}
+
+ImageBuffer ImageBufferPool::Acquire(int width, int height) {
+  if (width <= 0 || height <= 0) {
+    return ImageBuffer();
+  }
+  int size_class = 0;
+  const size_t capacity =
+      SizeClassCapacity(static_cast<size_t>(width) * height, &size_class);
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (static_cast<size_t>(size_class) < state_->free_blocks.size() &&
+        state_->free_blocks[size_class] != nullptr) {
+      ImageBuffer::Block *block = state_->free_blocks[size_class];
+      state_->free_blocks[size_class] = block->next_free;
+      state_->retained_bytes -= capacity * sizeof(Pixel);
+      state_->reuse_count++;
+      block->next_free = nullptr;
+      block->use_count.store(1, std::memory_order_relaxed);
+      return ImageBuffer(block, width, height);
+    }
+    state_->allocation_count++;
+  }
+  return ImageBuffer(new ImageBuffer::Block(state_, size_class, capacity),
+                     width, height);
+}
+
+size_t ImageBufferPool::retained_bytes() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->retained_bytes;
+}
+
+int64_t ImageBufferPool::allocation_count() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->allocation_count;
+}
+
+int64_t ImageBufferPool::reuse_count() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->reuse_count;
+}
+
+ImageBufferPool *ImageBufferPool::Default() {
+  static ImageBufferPool *pool = new ImageBufferPool();
+  return pool;
+}
+
+}  // namespace gtx
@@ -0,0 +1,135 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_IMAGE_BUFFER_H_
+#define GTXILIB_OOPCLASSES_IMAGE_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include "gtx_types.h"
+
+namespace gtx {
+
+class ImageBufferPool;
+class LazyLuminancePlane;
+
+// An owning, reference counted buffer of screenshot pixels. Copies share the
+// pixels, and the buffer is released when the last copy is destroyed: back
+// to its ImageBufferPool if it came from one, otherwise to the heap. Copying
+// and destroying copies does not allocate and is thread safe, so one
+// screenshot can be shared by concurrent evaluations; writing the pixels
+// while they are shared is not.
+class ImageBuffer {
+ public:
+  // Creates an empty buffer, with no pixels.
+  ImageBuffer() {}
+
+  // Allocates a buffer of @c width x @c height uninitialized pixels from the
+  // heap, not from a pool. Returns an empty buffer if either dimension is not
+  // positive.
+  static ImageBuffer Allocate(int width, int height);
+
+  ImageBuffer(const ImageBuffer &other);
+  ImageBuffer(ImageBuffer &&other);
+  ImageBuffer &operator=(ImageBuffer other);
+  ~ImageBuffer();
+
+  bool empty() const { return block_ == nullptr; }
+  int width() const { return width_; }
+  int height() const { return height_; }
+  Pixel *pixels() const;
+
+  // An Image of these pixels, valid while any copy of this buffer is alive.
+  Image image() const { return Image(pixels(), width_, height_); }
+
+  // The number of copies of this buffer, 0 if it is empty.
+  int use_count() const;
+
+  // The luminance plane of the pixels, computed on first use and shared by
+  // all copies of this buffer, or nullptr if it is empty. It is discarded
+  // when the buffer is released, and a pooled buffer reuses it for its next
+  // screenshot, so that setting a screenshot does not allocate.
+  LazyLuminancePlane *luminance_plane() const;
+
+ private:
+  friend class ImageBufferPool;
+  struct Block;
+
+  // Takes the reference of @c block, whose use count is 1, and prepares its
+  // luminance plane for the pixels.
+  ImageBuffer(Block *block, int width, int height);
+
+  // Drops a reference to @c block, and releases it if that was the last.
+  static void Unref(Block *block);
+
+  Block *block_ = nullptr;
+  int width_ = 0;
+  int height_ = 0;
+};
+
+// A pool of ImageBuffer pixel storage in size classes, so that a long-lived
+// evaluator that receives screenshots of a few sizes reuses the same
+// allocations instead of allocating and freeing each screenshot. Size
+// classes are a quarter of a power of two apart, so a buffer wastes at most
+// a fifth of its storage. Thread safe.
+class ImageBufferPool {
+ public:
+  // The default limit on the bytes of released buffers kept for reuse.
+  static constexpr size_t kDefaultMaxRetainedBytes = 256 << 20;
+
+  // Creates a pool that keeps at most @c max_retained_bytes of released
+  // buffers, and frees buffers released beyond that.
+  explicit ImageBufferPool(
+      size_t max_retained_bytes = kDefaultMaxRetainedBytes);
+
+  // Frees the released buffers. Buffers still in use stay valid and are
+  // freed when they are released.
+  ~ImageBufferPool();
+
+  ImageBufferPool(const ImageBufferPool &) = delete;
+  ImageBufferPool &operator=(const ImageBufferPool &) = delete;
+
+  // Returns a buffer of @c width x @c height uninitialized pixels, reusing a
+  // released buffer of the same size class if there is one. Returns an empty
+  // buffer if either dimension is not positive.
+  ImageBuffer Acquire(int width, int height);
+
+  // The bytes of released buffers kept for reuse.
+  size_t retained_bytes() const;
+
+  // The number of buffers Acquire allocated, and the number it reused.
+  int64_t allocation_count() const;
+  int64_t reuse_count() const;
+
+  // Returns a pool with the default limit, created on first use and never
+  // destroyed.
+  static ImageBufferPool *Default();
+
+ private:
+  friend class ImageBuffer;
+  struct State;
+
+  // State is shared with the buffers in use, so that they can be released
+  // after the pool is destroyed.
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_IMAGE_BUFFER_H_
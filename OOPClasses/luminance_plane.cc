@@ -0,0 +1,365 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "luminance_plane.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "banded_screenshot.h"
+#include "executor.h"
+#include "gtx_types.h"
+#include "image_color_utils.h"
+#include "palette_image.h"
+#include "rle_image.h"
+
+namespace gtx {
+
+namespace {
+
+// The fewest rows each thread computes, so that small images are not split
+// over threads that cost more to start than the rows take.
+constexpr int kMinRowsPerThread = 64;
+
+// The number of fractional bits of the per channel luminance tables, which
+// keep the rounding error of their sum below one fixed point unit.
+constexpr int kTableFractionBits = 8;
+
+// The contribution of each value of each channel to the fixed point
+// luminance of a color, scaled by 2^kTableFractionBits. Luminance is a
+// weighted sum of the linearized channels, so it is the sum of three table
+// lookups, and the gamma curve is evaluated 768 times instead of 3 times per
+// pixel.
+struct ChannelTables {
+  ChannelTables() {
+    const double scale = LuminancePlane::kMaxValue * (1 << kTableFractionBits);
+    for (int value = 0; value < 256; value++) {
+      float component = value / 255.0f;
+      // image_color_utils::Luminance takes red, blue and green, in that order.
+      red[value] = static_cast<uint32_t>(
+          lround(image_color_utils::Luminance(component, 0, 0) * scale));
+      blue[value] = static_cast<uint32_t>(
+          lround(image_color_utils::Luminance(0, component, 0) * scale));
+      green[value] = static_cast<uint32_t>(
+          lround(image_color_utils::Luminance(0, 0, component) * scale));
+    }
+  }
+
+  // Returns the fixed point luminance of @c color.
+  uint16_t Luminance(const Color &color) const {
+    uint32_t sum = red[color.red] + green[color.green] + blue[color.blue];
+    sum = (sum + (1 << (kTableFractionBits - 1))) >> kTableFractionBits;
+    return static_cast<uint16_t>(
+        std::min<uint32_t>(sum, LuminancePlane::kMaxValue));
+  }
+
+  uint32_t red[256];
+  uint32_t green[256];
+  uint32_t blue[256];
+};
+
+const ChannelTables &Tables() {
+  static const ChannelTables *tables = new ChannelTables();
+  return *tables;
+}
+
+// The ranges of a ParallelFor on an executor, which its tasks and the
+// calling thread claim in turn. Tasks own it jointly with the calling thread,
+// since an executor may start them after the loop has ended.
+struct ParallelForState {
+  std::atomic<int> next_range{0};
+  int range_count = 0;
+  int count = 0;
+  int per_range = 0;
+  // Only called on claimed ranges, while the calling thread still waits.
+  std::function<void(int, int)> work;
+  std::mutex mutex;
+  std::condition_variable ranges_done_changed;
+  int ranges_done = 0;
+};
+
+// Claims and runs ranges of @c state until none are left.
+void RunParallelForRanges(ParallelForState *state) {
+  int range;
+  while ((range = state->next_range.fetch_add(1)) < state->range_count) {
+    const int begin = range * state->per_range;
+    state->work(begin, std::min(state->count, begin + state->per_range));
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->ranges_done++;
+    }
+    state->ranges_done_changed.notify_all();
+  }
+}
+
+// Calls @c work with consecutive ranges of [0, @c count) on up to
+// @c thread_count threads, the calling thread included, each range holding
+// at least @c min_count items. 0 threads uses one per core. The other
+// threads are tasks of @c executor if it is not nullptr.
+template <typename RangeWork>
+void ParallelFor(int count, int thread_count, int min_count,
+                 Executor *executor, RangeWork work) {
+  if (thread_count <= 0) {
+    thread_count =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  thread_count =
+      std::max(1, std::min(thread_count, count / std::max(1, min_count)));
+  const int per_thread = (count + thread_count - 1) / thread_count;
+  if (thread_count == 1) {
+    work(0, count);
+    return;
+  }
+  if (executor != nullptr) {
+    auto state = std::make_shared<ParallelForState>();
+    state->range_count = (count + per_thread - 1) / per_thread;
+    state->count = count;
+    state->per_range = per_thread;
+    state->work = [&work](int begin, int end) { work(begin, end); };
+    for (int i = 1; i < state->range_count; i++) {
+      executor->Execute([state] { RunParallelForRanges(state.get()); });
+    }
+    RunParallelForRanges(state.get());
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->ranges_done_changed.wait(lock, [&state] {
+      return state->ranges_done == state->range_count;
+    });
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (int begin = per_thread; begin < count; begin += per_thread) {
+    threads.emplace_back(work, begin, std::min(count, begin + per_thread));
+  }
+  work(0, std::min(count, per_thread));
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace
+
+constexpr int LuminancePlane::kMaxValue;
+
+template <typename RowFiller>
+LuminancePlane LuminancePlane::Compute(int width, int height,
+                                       int thread_count, Executor *executor,
+                                       RowFiller fill_rows) {
+  LuminancePlane plane;
+  if (width <= 0 || height <= 0) {
+    return plane;
+  }
+  plane.width_ = width;
+  plane.height_ = height;
+  plane.values_.resize(static_cast<size_t>(width) * height);
+  const size_t stride = static_cast<size_t>(width) + 1;
+  plane.sums_.resize(stride * (height + 1));
+  uint16_t *values = plane.values_.data();
+  uint64_t *sums = plane.sums_.data();
+  // Each thread fills its rows and their prefix sums, then the prefix sums
+  // of the rows are summed down each column, in ranges of columns.
+  ParallelFor(height, thread_count, kMinRowsPerThread, executor,
+              [&fill_rows, values, sums, width, stride](int begin, int end) {
+                fill_rows(begin, end, values);
+                for (int y = begin; y < end; y++) {
+                  const uint16_t *row = values + static_cast<size_t>(y) * width;
+                  uint64_t *row_sums = sums + (y + 1) * stride;
+                  uint64_t sum = 0;
+                  for (int x = 0; x < width; x++) {
+                    sum += row[x];
+                    row_sums[x + 1] = sum;
+                  }
+                }
+              });
+  ParallelFor(width, thread_count, kMinRowsPerThread, executor,
+              [sums, height, stride](int begin, int end) {
+                for (int y = 2; y <= height; y++) {
+                  uint64_t *row_sums = sums + y * stride;
+                  const uint64_t *above = row_sums - stride;
+                  for (int x = begin + 1; x <= end; x++) {
+                    row_sums[x] += above[x];
+                  }
+                }
+              });
+  return plane;
+}
+
+LuminancePlane LuminancePlane::FromImage(const Image &image,
+                                         int thread_count,
+                                         Executor *executor) {
+  if (image.pixels == nullptr) {
+    return LuminancePlane();
+  }
+  const ChannelTables &tables = Tables();
+  const int width = image.width;
+  return Compute(
+      width, image.height, thread_count, executor,
+      [&image, &tables, width](int begin, int end, uint16_t *values) {
+        const size_t first = static_cast<size_t>(begin) * width;
+        const size_t last = static_cast<size_t>(end) * width;
+        for (size_t i = first; i < last; i++) {
+          values[i] = tables.Luminance(image.pixels[i]);
+        }
+      });
+}
+
+LuminancePlane LuminancePlane::FromPaletteImage(const PaletteImage &image,
+                                                int thread_count,
+                                                Executor *executor) {
+  if (image.encoding() == PaletteImage::Encoding::kRgba) {
+    return FromImage(image.RgbaImage(), thread_count, executor);
+  }
+  const ChannelTables &tables = Tables();
+  std::vector<uint16_t> palette_luminances;
+  palette_luminances.reserve(image.palette().size());
+  for (int32_t packed_color : image.palette()) {
+    palette_luminances.push_back(
+        tables.Luminance(Color::UnpackedColor(packed_color)));
+  }
+  const int width = image.width();
+  return Compute(
+      width, image.height(), thread_count, executor,
+      [&image, &palette_luminances, width](int begin, int end,
+                                           uint16_t *values) {
+        const size_t first = static_cast<size_t>(begin) * width;
+        const size_t last = static_cast<size_t>(end) * width;
+        if (image.encoding() == PaletteImage::Encoding::kIndexed8) {
+          const uint8_t *indices = image.indices8().data();
+          for (size_t i = first; i < last; i++) {
+            values[i] = palette_luminances[indices[i]];
+          }
+        } else {
+          const uint16_t *indices = image.indices16().data();
+          for (size_t i = first; i < last; i++) {
+            values[i] = palette_luminances[indices[i]];
+          }
+        }
+      });
+}
+
+LuminancePlane LuminancePlane::FromRleImage(const RleImage &image,
+                                            int thread_count,
+                                            Executor *executor) {
+  const ChannelTables &tables = Tables();
+  const int width = image.width();
+  return Compute(
+      width, image.height(), thread_count, executor,
+      [&image, &tables, width](int begin, int end, uint16_t *values) {
+        for (int y = begin; y < end; y++) {
+          uint16_t *row = values + static_cast<size_t>(y) * width;
+          for (const RleImage::Run *run = image.RowBegin(y);
+               run != image.RowEnd(y); run++) {
+            const int run_end =
+                run + 1 == image.RowEnd(y) ? width : run[1].start;
+            const uint16_t luminance =
+                tables.Luminance(Color::UnpackedColor(run->packed_color));
+            std::fill(row + run->start, row + run_end, luminance);
+          }
+        }
+      });
+}
+
+LuminancePlane LuminancePlane::FromBandedScreenshot(
+    const BandedScreenshot &image, int thread_count, Executor *executor) {
+  const ChannelTables &tables = Tables();
+  const int width = image.width();
+  const int band_height = image.band_height();
+  return Compute(
+      width, image.height(), thread_count, executor,
+      [&image, &tables, width, band_height](int begin, int end,
+                                            uint16_t *values) {
+        int y = begin;
+        while (y < end) {
+          const int band_end =
+              std::min(end, (y / band_height + 1) * band_height);
+          ScreenshotRows rows = image.Rows(y, band_end);
+          const Pixel *pixels = rows.image().pixels;
+          const size_t count = static_cast<size_t>(band_end - y) * width;
+          uint16_t *row_values = values + static_cast<size_t>(y) * width;
+          for (size_t i = 0; i < count; i++) {
+            row_values[i] = tables.Luminance(pixels[i]);
+          }
+          y = band_end;
+        }
+      });
+}
+
+uint16_t LuminancePlane::PixelLuminance(const Color &color) {
+  return Tables().Luminance(color);
+}
+
+float LuminancePlane::MeanLuminance(const Rect &rect) const {
+  const int x_begin = std::max(0, static_cast<int>(floorf(rect.origin.x)));
+  const int y_begin = std::max(0, static_cast<int>(floorf(rect.origin.y)));
+  const int x_end = std::min(width_, static_cast<int>(ceilf(rect.GetMaxX())));
+  const int y_end = std::min(height_, static_cast<int>(ceilf(rect.GetMaxY())));
+  if (x_begin >= x_end || y_begin >= y_end) {
+    return 0;
+  }
+  const size_t stride = static_cast<size_t>(width_) + 1;
+  const uint64_t sum = sums_[y_end * stride + x_end] -
+                       sums_[y_begin * stride + x_end] -
+                       sums_[y_end * stride + x_begin] +
+                       sums_[y_begin * stride + x_begin];
+  const double count =
+      static_cast<double>(x_end - x_begin) * (y_end - y_begin);
+  return static_cast<float>(sum / count / kMaxValue);
+}
+
+size_t LuminancePlane::ByteSize() const {
+  return values_.size() * sizeof(uint16_t) + sums_.size() * sizeof(uint64_t);
+}
+
+const LuminancePlane &LazyLuminancePlane::Get() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!computed_) {
+    if (rle_image_ != nullptr) {
+      plane_ = LuminancePlane::FromRleImage(*rle_image_);
+    } else if (palette_image_ != nullptr) {
+      plane_ = LuminancePlane::FromPaletteImage(*palette_image_);
+    } else if (banded_image_ != nullptr) {
+      plane_ = LuminancePlane::FromBandedScreenshot(*banded_image_);
+    } else {
+      plane_ = LuminancePlane::FromImage(image_);
+    }
+    computed_ = true;
+  }
+  return plane_;
+}
+
+void LazyLuminancePlane::Reset(const Image &image,
+                               const PaletteImage *palette_image,
+                               const RleImage *rle_image,
+                               const BandedScreenshot *banded_image) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  image_ = image;
+  palette_image_ = palette_image;
+  rle_image_ = rle_image;
+  banded_image_ = banded_image;
+  computed_ = false;
+  plane_ = LuminancePlane();
+}
+
+}  // namespace gtx
@@ -0,0 +1,157 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_LUMINANCE_PLANE_H_
+#define GTXILIB_OOPCLASSES_LUMINANCE_PLANE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <vector>
+
+#include "banded_screenshot.h"
+#include "executor.h"
+#include "gtx_types.h"
+#include "palette_image.h"
+#include "rle_image.h"
+
+namespace gtx {
+
+// The relative luminance of each pixel of an image, as Color::Luminance
+// computes it, with a summed-area table so that the mean luminance of any
+// rect takes constant time. Luminances are 16 bit fixed point: 0 is black and
+// kMaxValue is white. The luminances take 2 bytes per pixel and the
+// summed-area table 8 more, so a plane takes 10 bytes per pixel, about 30MB
+// for a 1170 by 2532 screenshot.
+//
+// Planes are computed on the calling thread by default. Callers that can
+// spare threads pass a @c thread_count above 1 and an Executor, whose tasks
+// compute part of the rows while the calling thread computes the rest.
+class LuminancePlane {
+ public:
+  // The value of a luminance of 1.
+  static constexpr int kMaxValue = 65535;
+
+  // Constructs an empty plane.
+  LuminancePlane() {}
+
+  // Computes the luminance of @c image on up to @c thread_count threads, the
+  // calling thread included. 0 uses one per core. The other threads are
+  // tasks of @c executor or, if it is nullptr, threads started for the
+  // computation. The calling thread computes the rows that tasks have not
+  // started, so the computation never waits for a busy executor.
+  static LuminancePlane FromImage(const Image &image, int thread_count = 1,
+                                  Executor *executor = nullptr);
+
+  // Computes the luminance of @c image, looking up the luminance of each
+  // palette color once.
+  static LuminancePlane FromPaletteImage(const PaletteImage &image,
+                                         int thread_count = 1,
+                                         Executor *executor = nullptr);
+
+  // Computes the luminance of @c image, once per run.
+  static LuminancePlane FromRleImage(const RleImage &image,
+                                     int thread_count = 1,
+                                     Executor *executor = nullptr);
+
+  // Computes the luminance of @c image band by band, so that it is decoded
+  // once if its cache holds at least one band per thread.
+  static LuminancePlane FromBandedScreenshot(const BandedScreenshot &image,
+                                             int thread_count = 1,
+                                             Executor *executor = nullptr);
+
+  // Returns the fixed point luminance of @c color, as planes hold it.
+  static uint16_t PixelLuminance(const Color &color);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  // The fixed point luminance of each pixel, row by row.
+  const std::vector<uint16_t> &values() const { return values_; }
+
+  // Returns the luminance of the pixel at @c x, @c y, between 0 and 1.
+  float LuminanceAt(int x, int y) const {
+    return values_[x + y * width_] / static_cast<float>(kMaxValue);
+  }
+
+  // Returns the mean luminance, between 0 and 1, of the pixels that
+  // @c rect covers at least partly, or 0 if it covers none. @c rect is in
+  // pixels and clipped to the image.
+  float MeanLuminance(const Rect &rect) const;
+
+  // The number of bytes the luminances and the summed-area table take.
+  size_t ByteSize() const;
+
+ private:
+  // Allocates a plane of @c width by @c height pixels, fills it by calling
+  // @c fill_rows with ranges of rows on @c thread_count threads, and builds
+  // its summed-area table.
+  template <typename RowFiller>
+  static LuminancePlane Compute(int width, int height, int thread_count,
+                                Executor *executor, RowFiller fill_rows);
+
+  int width_ = 0;
+  int height_ = 0;
+  std::vector<uint16_t> values_;
+  // The sum of the values above and to the left of each pixel, with an extra
+  // row and column of zeros, in (width_ + 1) * (height_ + 1) entries.
+  std::vector<uint64_t> sums_;
+};
+
+// Computes the luminance plane of a screenshot on first use, so that the
+// checks of an evaluation that need it share it and evaluations that do not
+// need it do not pay for it. The plane is computed on the thread that first
+// needs it, which is running an evaluation, possibly on the threads of an
+// executor already, so it does not start threads of its own. Thread safe.
+class LazyLuminancePlane {
+ public:
+  // The plane is computed from the first of @c rle_image, @c palette_image
+  // and @c banded_image that is not nullptr, otherwise from @c image. They
+  // must outlive this object.
+  LazyLuminancePlane(const Image &image, const PaletteImage *palette_image,
+                     const RleImage *rle_image,
+                     const BandedScreenshot *banded_image = nullptr)
+      : image_(image),
+        palette_image_(palette_image),
+        rle_image_(rle_image),
+        banded_image_(banded_image) {}
+
+  // Returns the plane, computing it if this is the first call since
+  // construction or the last Reset.
+  const LuminancePlane &Get();
+
+  // Discards the plane, and computes the next from the given images, like
+  // the constructor, so that an object can be reused for many screenshots.
+  // Must not be called while another thread calls Get, or while a plane Get
+  // returned is in use. Does not allocate.
+  void Reset(const Image &image, const PaletteImage *palette_image,
+             const RleImage *rle_image,
+             const BandedScreenshot *banded_image = nullptr);
+
+ private:
+  Image image_;
+  const PaletteImage *palette_image_;
+  const RleImage *rle_image_;
+  const BandedScreenshot *banded_image_;
+  std::mutex mutex_;
+  bool computed_ = false;
+  LuminancePlane plane_;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_LUMINANCE_PLANE_H_
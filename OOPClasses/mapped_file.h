@@ -0,0 +1,55 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_MAPPED_FILE_H_
+#define GTXILIB_OOPCLASSES_MAPPED_FILE_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+
+namespace gtx {
+
+// A read-only memory mapping of a file, for example to read a
+// HierarchySnapshot in place. The mapping is removed when this object is
+// destroyed.
+class MappedFile {
+ public:
+  // Maps the file at @c path into memory. Returns nullptr if the file cannot
+  // be opened or mapped.
+  static std::unique_ptr<MappedFile> Open(const std::string &path);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // The contents of the file, aligned to the page size. data() is nullptr if
+  // the file is empty.
+  const void *data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  MappedFile(void *data, size_t size) : data_(data), size_(size) {}
+
+  void *data_;
+  size_t size_;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_MAPPED_FILE_H_
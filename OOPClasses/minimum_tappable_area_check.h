@@ -18,11 +18,14 @@
 #define GTXILIB_OOPCLASSES_MINIMUM_TAPPABLE_AREA_CHECK_H_
 
 #include <string>
+#include <vector>
 
 #include <abseil/absl/types/optional.h>
+#include <abseil/absl/types/span.h>
 #include "metadata_map.h"
 #include "typedefs.h"
 #include "check.h"
+#include "hierarchy_table.h"
 #include "localized_strings_manager.h"
 #include "parameters.h"
 
@@ -44,6 +47,21 @@ class MinimumTappableAreaCheck : public Check {
   absl::optional<CheckResultProto> CheckElement(
       const UIElementProto &element, const Parameters &params) const override;
 
+  void CheckElementsInTable(
+      const HierarchyTable &table, absl::Span<const int> element_indices,
+      const Parameters &params,
+      std::vector<IndexedCheckResult> &results) const override;
+
+  // Describes the size of the element in the values of @c result, width
+  // first.
+  bool CheckElementCompact(const UIElementProto &element,
+                           const Parameters &params,
+                           CompactCheckResult *result) const override;
+
+  CheckResultProto ExpandCompactResult(
+      const CompactCheckResult &result, const UIElementProto &element,
+      const Parameters &params) const override;
+
   std::string GetRichShortMessage(
       Locale locale, int result_id, const MetadataMap &metadata,
       const LocalizedStringsManager &string_manager) const override;
@@ -56,6 +74,17 @@ class MinimumTappableAreaCheck : public Check {
   std::string GetDefaultMessage(
       Locale locale, int result_id, const MetadataMap &metadata,
       const LocalizedStringsManager &string_manager) const override;
+
+ private:
+  // Returns a result for the element with the given id if a touch target of the
+  // given size is too small, absl::nullopt otherwise.
+  absl::optional<CheckResultProto> CheckSize(int32_t element_id, float width,
+                                             float height) const;
+
+  // Returns the result for the element with the given id, whose touch target
+  // of the given size is too small.
+  CheckResultProto SizeResult(int32_t element_id, float width,
+                              float height) const;
 };
 
 }  // namespace gtx
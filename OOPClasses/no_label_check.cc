@@ -17,11 +17,14 @@
 #include "no_label_check.h"
 
 #include <string>
+#include <vector>
 
 #include <abseil/absl/types/optional.h>
+#include <abseil/absl/types/span.h>
 #include "metadata_map.h"
 #include "typedefs.h"
 #include "check.h"
+#include "hierarchy_table.h"
 #include "localized_string_ids.h"
 #include "localized_strings_manager.h"
 #include "parameters.h"
@@ -45,6 +48,35 @@ absl::optional<CheckResultProto> NoLabelCheck::CheckElement(
   return absl::nullopt;
 }
 
+void NoLabelCheck::CheckElementsInTable(
+    const HierarchyTable &table, absl::Span<const int> element_indices,
+    const Parameters &params, std::vector<IndexedCheckResult> &results) const {
+  for (int index : element_indices) {
+    if (table.ax_label(index).empty()) {
+      results.push_back(
+          {index, CheckResult(RESULT_ID_MISSING_ACCESSIBILITY_LABEL,
+                              table.ids()[index], MetadataMap())});
+    }
+  }
+}
+
+bool NoLabelCheck::CheckElementCompact(const UIElementProto &element,
+                                       const Parameters &params,
+                                       CompactCheckResult *result) const {
+  if (!element.ax_label().empty()) {
+    return false;
+  }
+  result->result_id = RESULT_ID_MISSING_ACCESSIBILITY_LABEL;
+  return true;
+}
+
+CheckResultProto NoLabelCheck::ExpandCompactResult(
+    const CompactCheckResult &result, const UIElementProto &element,
+    const Parameters &params) const {
+  return CheckResult(RESULT_ID_MISSING_ACCESSIBILITY_LABEL, element,
+                     MetadataMap());
+}
+
 std::string NoLabelCheck::GetRichShortMessage(
     Locale locale, int result_id, const MetadataMap &metadata,
     const LocalizedStringsManager &string_manager) const {
@@ -18,11 +18,14 @@
 #define GTXILIB_OOPCLASSES_NO_LABEL_CHECK_H_
 
 #include <string>
+#include <vector>
 
 #include <abseil/absl/types/optional.h>
+#include <abseil/absl/types/span.h>
 #include "metadata_map.h"
 #include "typedefs.h"
 #include "check.h"
+#include "hierarchy_table.h"
 #include "localized_strings_manager.h"
 #include "parameters.h"
 
@@ -40,6 +43,19 @@ class NoLabelCheck : public Check {
   absl::optional<CheckResultProto> CheckElement(
       const UIElementProto &element, const Parameters &params) const override;
 
+  void CheckElementsInTable(
+      const HierarchyTable &table, absl::Span<const int> element_indices,
+      const Parameters &params,
+      std::vector<IndexedCheckResult> &results) const override;
+
+  bool CheckElementCompact(const UIElementProto &element,
+                           const Parameters &params,
+                           CompactCheckResult *result) const override;
+
+  CheckResultProto ExpandCompactResult(
+      const CompactCheckResult &result, const UIElementProto &element,
+      const Parameters &params) const override;
+
   std::string GetRichShortMessage(
       Locale locale, int result_id, const MetadataMap &metadata,
       const LocalizedStringsManager &string_manager) const override;
@@ -0,0 +1,103 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "palette_image.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+#include <abseil/absl/container/flat_hash_map.h>
+#include "gtx_types.h"
+
+namespace gtx {
+
+constexpr size_t PaletteImage::kMaxPaletteSize;
+
+PaletteImage PaletteImage::Encode(const Image &image) {
+  PaletteImage encoded;
+  if (image.pixels == nullptr || image.width <= 0 || image.height <= 0) {
+    return encoded;
+  }
+  encoded.width_ = image.width;
+  encoded.height_ = image.height;
+  const size_t pixel_count = static_cast<size_t>(image.width) * image.height;
+  // Indices are collected as 16 bit and narrowed at the end if the palette
+  // turns out to be small.
+  std::vector<uint16_t> indices(pixel_count);
+  absl::flat_hash_map<int32_t, uint16_t> color_indices;
+  // Flat UI has long runs of a single color, which skip the lookup.
+  int32_t previous_color = 0;
+  uint16_t previous_index = 0;
+  bool has_previous = false;
+  for (size_t i = 0; i < pixel_count; i++) {
+    int32_t color = image.pixels[i].PackedColor();
+    if (!has_previous || color != previous_color) {
+      auto inserted = color_indices.emplace(
+          color, static_cast<uint16_t>(encoded.palette_.size()));
+      if (inserted.second) {
+        if (encoded.palette_.size() == kMaxPaletteSize) {
+          encoded.palette_.clear();
+          encoded.encoding_ = Encoding::kRgba;
+          encoded.pixels_.assign(image.pixels, image.pixels + pixel_count);
+          return encoded;
+        }
+        encoded.palette_.push_back(color);
+      }
+      previous_color = color;
+      previous_index = inserted.first->second;
+      has_previous = true;
+    }
+    indices[i] = previous_index;
+  }
+  if (encoded.palette_.size() <= 256) {
+    encoded.encoding_ = Encoding::kIndexed8;
+    encoded.indices8_.assign(indices.begin(), indices.end());
+  } else {
+    encoded.encoding_ = Encoding::kIndexed16;
+    encoded.indices16_ = std::move(indices);
+  }
+  return encoded;
+}
+
+Image PaletteImage::RgbaImage() const {
+  if (encoding_ != Encoding::kRgba) {
+    return Image(nullptr, width_, height_);
+  }
+  return Image(const_cast<Pixel *>(pixels_.data()), width_, height_);
+}
+
+int32_t PaletteImage::PackedColorAt(int index) const {
+  switch (encoding_) {
+    case Encoding::kIndexed8:
+      return palette_[indices8_[index]];
+    case Encoding::kIndexed16:
+      return palette_[indices16_[index]];
+    case Encoding::kRgba:
+      return pixels_[index].PackedColor();
+  }
+  return 0;
+}
+
+size_t PaletteImage::ByteSize() const {
+  return palette_.size() * sizeof(int32_t) +
+         indices8_.size() * sizeof(uint8_t) +
+         indices16_.size() * sizeof(uint16_t) + pixels_.size() * sizeof(Pixel);
+}
+
+}  // namespace gtx
@@ -0,0 +1,94 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_PALETTE_IMAGE_H_
+#define GTXILIB_OOPCLASSES_PALETTE_IMAGE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "gtx_types.h"
+
+namespace gtx {
+
+// An image stored as a table of its distinct colors and, for each pixel, the
+// index of its color in the table. Screenshots of apps rarely have more than
+// a few hundred distinct colors, so indices take 1 or 2 bytes per pixel
+// instead of the 4 of an Image. Images with more colors than 16 bit indices
+// can address are stored as RGBA pixels instead.
+//
+// Colors are packed as by Color::PackedColor, so alpha is dropped: colors of
+// screenshots have alpha pre-multiplied.
+class PaletteImage {
+ public:
+  // How the pixels are stored.
+  enum class Encoding {
+    // 8 bit indices into a palette of at most 256 colors.
+    kIndexed8,
+    // 16 bit indices into a palette of at most 65536 colors.
+    kIndexed16,
+    // RGBA pixels, without a palette.
+    kRgba,
+  };
+
+  // The most colors a palette holds.
+  static constexpr size_t kMaxPaletteSize = 65536;
+
+  // Constructs an empty image.
+  PaletteImage() {}
+
+  // Encodes the pixels of @c image, with the narrowest encoding that holds
+  // its colors.
+  static PaletteImage Encode(const Image &image);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  Encoding encoding() const { return encoding_; }
+
+  // The packed colors of the palette, in order of their first pixel. Empty if
+  // the encoding is kRgba.
+  const std::vector<int32_t> &palette() const { return palette_; }
+
+  // The palette index of each pixel, row by row, if the encoding is kIndexed8
+  // or kIndexed16 respectively, otherwise empty.
+  const std::vector<uint8_t> &indices8() const { return indices8_; }
+  const std::vector<uint16_t> &indices16() const { return indices16_; }
+
+  // Returns an Image of the pixels if the encoding is kRgba, otherwise an
+  // image without pixels. Valid as long as this image is.
+  Image RgbaImage() const;
+
+  // Returns the packed color of the pixel at @c index, counted row by row.
+  int32_t PackedColorAt(int index) const;
+
+  // The number of bytes the pixels and the palette take.
+  size_t ByteSize() const;
+
+ private:
+  int width_ = 0;
+  int height_ = 0;
+  Encoding encoding_ = Encoding::kIndexed8;
+  std::vector<int32_t> palette_;
+  std::vector<uint8_t> indices8_;
+  std::vector<uint16_t> indices16_;
+  std::vector<Pixel> pixels_;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_PALETTE_IMAGE_H_
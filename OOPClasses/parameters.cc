@@ -16,7 +16,10 @@
 
 #include "parameters.h"
 
+#include <memory>
+
 #include "gtx_types.h"
+#include "luminance_plane.h"
 
 namespace gtx {
 
@@ -30,4 +33,26 @@ Rect Parameters::ConvertRectToScreenshotSpace(
   return converted_rect;
 }
 
+const LuminancePlane *Parameters::luminance_plane() const {
+  if (!HasScreenshotPixels()) {
+    return nullptr;
+  }
+  if (!screenshot_buffer_.empty() && palette_screenshot_ == nullptr &&
+      rle_screenshot_ == nullptr && banded_screenshot_ == nullptr) {
+    return &screenshot_buffer_.luminance_plane()->Get();
+  }
+  std::shared_ptr<LazyLuminancePlane> plane =
+      std::atomic_load(&luminance_plane_);
+  if (plane == nullptr) {
+    auto created = std::make_shared<LazyLuminancePlane>(
+        screenshot_, palette_screenshot_, rle_screenshot_, banded_screenshot_);
+    // If another thread created a plane first, plane is set to it.
+    if (std::atomic_compare_exchange_strong(&luminance_plane_, &plane,
+                                            created)) {
+      plane = std::move(created);
+    }
+  }
+  return &plane->Get();
+}
+
 }  // namespace gtx
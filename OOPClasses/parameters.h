@@ -1,7 +1,14 @@
 #ifndef GTXILIB_OOPCLASSES_PARAMETERS_H_
 #define GTXILIB_OOPCLASSES_PARAMETERS_H_
 
+#include <memory>
+
+#include "banded_screenshot.h"
 #include "gtx_types.h"
+#include "image_buffer.h"
+#include "luminance_plane.h"
+#include "palette_image.h"
+#include "rle_image.h"
 
 namespace gtx {
 
@@ -11,9 +18,73 @@ class Parameters {
   // Creates a new Parameter object.
   Parameters() {}
 
-  // Screenshot of the entire screen.
+  // Screenshot of the entire screen. Setting it releases the buffer of a
+  // previous screenshot set from an ImageBuffer.
   const Image& screenshot() const { return screenshot_; }
-  void set_screenshot(const Image& screenshot) { screenshot_ = screenshot; }
+  void set_screenshot(const Image& screenshot) {
+    screenshot_ = screenshot;
+    screenshot_buffer_ = ImageBuffer();
+    ResetLuminancePlane();
+  }
+
+  // Sets the screenshot to the pixels of @c buffer, which these parameters and
+  // all their copies share, so that concurrent evaluations of one screenshot
+  // need not manage its lifetime, and a pooled buffer returns to its pool
+  // when the last of them is destroyed.
+  void set_screenshot(const ImageBuffer& buffer) {
+    screenshot_ = buffer.image();
+    screenshot_buffer_ = buffer;
+    ResetLuminancePlane();
+  }
+
+  // The buffer the screenshot was set from, or an empty buffer if it was set
+  // from an Image.
+  const ImageBuffer& screenshot_buffer() const { return screenshot_buffer_; }
+
+  // The screenshot encoded as a PaletteImage, or nullptr, the default. If set,
+  // checks read pixels from it instead of screenshot(), whose pixels may then
+  // be nullptr, but whose dimensions must still be set. Not owned.
+  const PaletteImage* palette_screenshot() const {
+    return palette_screenshot_;
+  }
+  void set_palette_screenshot(const PaletteImage* palette_screenshot) {
+    palette_screenshot_ = palette_screenshot;
+    ResetLuminancePlane();
+  }
+
+  // The screenshot encoded as an RleImage, or nullptr, the default. Like
+  // palette_screenshot, and read in preference to it if both are set.
+  const RleImage* rle_screenshot() const { return rle_screenshot_; }
+  void set_rle_screenshot(const RleImage* rle_screenshot) {
+    rle_screenshot_ = rle_screenshot;
+    ResetLuminancePlane();
+  }
+
+  // The screenshot as a BandedScreenshot, decoded in bands as checks read
+  // it, or nullptr, the default. Like palette_screenshot, but read only if
+  // neither rle_screenshot nor palette_screenshot is set.
+  const BandedScreenshot* banded_screenshot() const {
+    return banded_screenshot_;
+  }
+  void set_banded_screenshot(const BandedScreenshot* banded_screenshot) {
+    banded_screenshot_ = banded_screenshot;
+    ResetLuminancePlane();
+  }
+
+  // Returns true if any representation of the screenshot has pixels.
+  bool HasScreenshotPixels() const {
+    return screenshot_.pixels != nullptr || palette_screenshot_ != nullptr ||
+           rle_screenshot_ != nullptr || banded_screenshot_ != nullptr;
+  }
+
+  // The luminance of the screenshot, computed on first use and shared by all
+  // checks, or nullptr if the screenshot has no pixels. The plane of a
+  // screenshot set from an ImageBuffer alone is held by the buffer, and
+  // shared by all copies of these parameters; others are shared by the
+  // copies made after first use. Thread safe. Image checks that read
+  // luminance, rather than a few colors, read it from here instead of calling
+  // Color::Luminance per pixel.
+  const LuminancePlane* luminance_plane() const;
 
   // Bounds of the device in points.
   const Rect& device_bounds() const { return device_bounds_; }
@@ -24,7 +95,18 @@ class Parameters {
   Rect ConvertRectToScreenshotSpace(const Rect& device_space_rect) const;
 
  private:
+  // Discards the luminance plane of the previous screenshot. Does not
+  // allocate: the next plane is created on first use.
+  void ResetLuminancePlane() { luminance_plane_.reset(); }
+
   Image screenshot_;
+  ImageBuffer screenshot_buffer_;
+  const PaletteImage* palette_screenshot_ = nullptr;
+  const RleImage* rle_screenshot_ = nullptr;
+  const BandedScreenshot* banded_screenshot_ = nullptr;
+  // Created by the first call to luminance_plane, unless the plane is held
+  // by screenshot_buffer_. Accessed atomically, since that call is const.
+  mutable std::shared_ptr<LazyLuminancePlane> luminance_plane_;
   Rect device_bounds_;
 };
 
@@ -0,0 +1,625 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "record_stream.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <abseil/absl/strings/string_view.h>
+#include <abseil/absl/types/optional.h>
+#include "proto_serialization.h"
+#include "typedefs.h"
+
+namespace gtx {
+
+namespace {
+
+constexpr char kFileMagic[4] = {'G', 'T', 'X', 'R'};
+constexpr char kBlockMagic[4] = {'G', 'T', 'X', 'B'};
+constexpr char kIndexMagic[4] = {'G', 'T', 'X', 'I'};
+constexpr char kTrailerMagic[4] = {'G', 'T', 'X', 'E'};
+
+constexpr uint32_t kVersion = 1;
+
+// Magic, version, record type and reserved flags.
+constexpr size_t kFileHeaderSize = 16;
+
+// Magic, compression, record count, raw size, stored size and the CRC-32 of
+// the stored bytes.
+constexpr size_t kBlockHeaderSize = 24;
+
+// Magic and block count, followed by the entries.
+constexpr size_t kIndexHeaderSize = 8;
+
+// Block offset, first record, record count and reserved.
+constexpr size_t kIndexEntrySize = 24;
+
+// Index offset, record count, block count and magic.
+constexpr size_t kTrailerSize = 24;
+
+// Blocks larger than this are considered corrupt, so that a corrupt size does
+// not cause a large allocation.
+constexpr uint32_t kMaxBlockSize = 1u << 30;
+
+enum Compression : uint32_t {
+  kCompressionNone = 0,
+  kCompressionZlib = 1,
+};
+
+void PutUint32(uint32_t value, std::string *output) {
+  for (int i = 0; i < 4; i++) {
+    output->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+void PutUint64(uint64_t value, std::string *output) {
+  for (int i = 0; i < 8; i++) {
+    output->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+uint32_t GetUint32(const char *data) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) {
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+  }
+  return value;
+}
+
+uint64_t GetUint64(const char *data) {
+  return GetUint32(data) | (static_cast<uint64_t>(GetUint32(data + 4)) << 32);
+}
+
+uint32_t Crc32(absl::string_view data) {
+  uLong crc = crc32(0L, Z_NULL, 0);
+  // crc32 takes the size as a uInt, so large inputs are processed in chunks.
+  while (!data.empty()) {
+    uInt size = static_cast<uInt>(std::min<size_t>(data.size(), 1u << 30));
+    crc = crc32(crc, reinterpret_cast<const Bytef *>(data.data()), size);
+    data.remove_prefix(size);
+  }
+  return static_cast<uint32_t>(crc);
+}
+
+// Reads @c size bytes at @c offset of @c file into @c output. Returns false if
+// the file is shorter.
+bool ReadAt(FILE *file, uint64_t offset, size_t size, std::string *output) {
+  output->resize(size);
+  if (fseeko(file, static_cast<off_t>(offset), SEEK_SET) != 0) {
+    return false;
+  }
+  return size == 0 || fread(&(*output)[0], 1, size, file) == size;
+}
+
+struct BlockHeader {
+  uint32_t compression;
+  uint32_t record_count;
+  uint32_t raw_size;
+  uint32_t stored_size;
+  uint32_t crc;
+};
+
+enum class BlockHeaderStatus {
+  kOk,
+  kEnd,
+  kCorrupt,
+};
+
+// Reads the header of the block at @c offset, where @c data_end is the end of
+// the blocks of the stream. If @c indexed is false, an incomplete block at the
+// end of the stream is treated as the end, since it is left behind by a writer
+// that was interrupted.
+BlockHeaderStatus ReadBlockHeader(FILE *file, uint64_t offset,
+                                  uint64_t data_end, bool indexed,
+                                  BlockHeader *header) {
+  if (offset >= data_end) {
+    return BlockHeaderStatus::kEnd;
+  }
+  BlockHeaderStatus incomplete =
+      indexed ? BlockHeaderStatus::kCorrupt : BlockHeaderStatus::kEnd;
+  std::string bytes;
+  if (data_end - offset < kBlockHeaderSize ||
+      !ReadAt(file, offset, kBlockHeaderSize, &bytes)) {
+    return incomplete;
+  }
+  if (memcmp(bytes.data(), kBlockMagic, 4) != 0) {
+    // Without a valid trailer, the index of a stream is not recognized and
+    // marks the end of its blocks.
+    bool is_index = memcmp(bytes.data(), kIndexMagic, 4) == 0;
+    return is_index && !indexed ? BlockHeaderStatus::kEnd
+                                : BlockHeaderStatus::kCorrupt;
+  }
+  header->compression = GetUint32(bytes.data() + 4);
+  header->record_count = GetUint32(bytes.data() + 8);
+  header->raw_size = GetUint32(bytes.data() + 12);
+  header->stored_size = GetUint32(bytes.data() + 16);
+  header->crc = GetUint32(bytes.data() + 20);
+  if (header->compression > kCompressionZlib ||
+      header->raw_size > kMaxBlockSize ||
+      header->stored_size > kMaxBlockSize ||
+      (header->compression == kCompressionNone &&
+       header->stored_size != header->raw_size)) {
+    return BlockHeaderStatus::kCorrupt;
+  }
+  if (data_end - offset - kBlockHeaderSize < header->stored_size) {
+    return incomplete;
+  }
+  return BlockHeaderStatus::kOk;
+}
+
+// Returns true if @c records consists of exactly @c record_count records, each
+// prefixed with its size.
+bool ValidateRecords(absl::string_view records, uint32_t record_count) {
+  for (uint32_t i = 0; i < record_count; i++) {
+    uint64_t size;
+    if (!ConsumeVarint(&records, &size) || size > records.size()) {
+      return false;
+    }
+    records.remove_prefix(size);
+  }
+  return records.empty();
+}
+
+}  // namespace
+
+#pragma mark - RecordWriter
+
+std::unique_ptr<RecordWriter> RecordWriter::Create(
+    const std::string &path, RecordType record_type,
+    const RecordWriterOptions &options) {
+  FILE *file = fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return nullptr;
+  }
+  std::unique_ptr<RecordWriter> writer(new RecordWriter(file, options));
+  std::string header(kFileMagic, 4);
+  PutUint32(kVersion, &header);
+  PutUint32(static_cast<uint32_t>(record_type), &header);
+  PutUint32(0, &header);
+  if (!writer->Write(header.data(), header.size())) {
+    return nullptr;
+  }
+  return writer;
+}
+
+RecordWriter::RecordWriter(FILE *file, const RecordWriterOptions &options)
+    : file_(file), options_(options) {}
+
+RecordWriter::~RecordWriter() { Close(); }
+
+bool RecordWriter::WriteRecord(absl::string_view record) {
+  if (file_ == nullptr || record.size() > kMaxBlockSize / 2) {
+    return false;
+  }
+  AppendVarint(record.size(), &block_);
+  block_.append(record.data(), record.size());
+  block_record_count_++;
+  record_count_++;
+  if (block_.size() >= options_.block_size) {
+    return FlushBlock();
+  }
+  return ok_;
+}
+
+bool RecordWriter::WriteEvaluation(
+    const AccessibilityEvaluationProto &evaluation) {
+  return WriteRecord(SerializeProto(evaluation));
+}
+
+bool RecordWriter::WriteCheckResult(const CheckResultProto &result) {
+  return WriteRecord(SerializeProto(result));
+}
+
+bool RecordWriter::Close() {
+  if (file_ == nullptr) {
+    return ok_;
+  }
+  FlushBlock();
+  uint64_t index_offset = offset_;
+  std::string index(kIndexMagic, 4);
+  PutUint32(static_cast<uint32_t>(index_.size()), &index);
+  for (const IndexEntry &entry : index_) {
+    PutUint64(entry.offset, &index);
+    PutUint64(entry.first_record, &index);
+    PutUint32(entry.record_count, &index);
+    PutUint32(0, &index);
+  }
+  PutUint64(index_offset, &index);
+  PutUint64(static_cast<uint64_t>(record_count_), &index);
+  PutUint32(static_cast<uint32_t>(index_.size()), &index);
+  index.append(kTrailerMagic, 4);
+  Write(index.data(), index.size());
+  if (fclose(file_) != 0) {
+    ok_ = false;
+  }
+  file_ = nullptr;
+  return ok_;
+}
+
+bool RecordWriter::FlushBlock() {
+  if (block_record_count_ == 0) {
+    return ok_;
+  }
+  uint32_t compression = kCompressionNone;
+  std::string compressed;
+  absl::string_view stored = block_;
+  if (options_.compress) {
+    uLongf compressed_size = compressBound(static_cast<uLong>(block_.size()));
+    compressed.resize(compressed_size);
+    if (compress2(reinterpret_cast<Bytef *>(&compressed[0]), &compressed_size,
+                  reinterpret_cast<const Bytef *>(block_.data()),
+                  static_cast<uLong>(block_.size()),
+                  Z_DEFAULT_COMPRESSION) == Z_OK &&
+        compressed_size < block_.size()) {
+      compression = kCompressionZlib;
+      stored = absl::string_view(compressed.data(), compressed_size);
+    }
+  }
+  std::string header(kBlockMagic, 4);
+  PutUint32(compression, &header);
+  PutUint32(block_record_count_, &header);
+  PutUint32(static_cast<uint32_t>(block_.size()), &header);
+  PutUint32(static_cast<uint32_t>(stored.size()), &header);
+  PutUint32(Crc32(stored), &header);
+  index_.push_back({offset_,
+                    static_cast<uint64_t>(record_count_ - block_record_count_),
+                    block_record_count_});
+  Write(header.data(), header.size());
+  Write(stored.data(), stored.size());
+  block_.clear();
+  block_record_count_ = 0;
+  return ok_;
+}
+
+bool RecordWriter::Write(const void *data, size_t size) {
+  if (fwrite(data, 1, size, file_) != size) {
+    ok_ = false;
+  }
+  offset_ += size;
+  return ok_;
+}
+
+#pragma mark - RecordReader
+
+std::unique_ptr<RecordReader> RecordReader::Open(
+    const std::string &path, const RecordReaderOptions &options) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return nullptr;
+  }
+  std::string header;
+  if (!ReadAt(file, 0, kFileHeaderSize, &header) ||
+      memcmp(header.data(), kFileMagic, 4) != 0 ||
+      GetUint32(header.data() + 4) != kVersion) {
+    fclose(file);
+    return nullptr;
+  }
+  RecordType record_type = static_cast<RecordType>(GetUint32(&header[8]));
+  std::unique_ptr<RecordReader> reader(
+      new RecordReader(file, record_type, options));
+  if (fseeko(file, 0, SEEK_END) != 0) {
+    return nullptr;
+  }
+  reader->file_size_ = static_cast<uint64_t>(ftello(file));
+  reader->ReadIndex();
+  reader->StartAt(kFileHeaderSize, 0);
+  return reader;
+}
+
+RecordReader::RecordReader(FILE *file, RecordType record_type,
+                           const RecordReaderOptions &options)
+    : file_(file), record_type_(record_type), options_(options) {}
+
+RecordReader::~RecordReader() {
+  StopReadAhead();
+  fclose(file_);
+}
+
+absl::optional<int64_t> RecordReader::record_count() const {
+  return record_count_;
+}
+
+void RecordReader::ReadIndex() {
+  data_end_ = file_size_;
+  std::string trailer;
+  if (file_size_ < kFileHeaderSize + kIndexHeaderSize + kTrailerSize ||
+      !ReadAt(file_, file_size_ - kTrailerSize, kTrailerSize, &trailer) ||
+      memcmp(trailer.data() + 20, kTrailerMagic, 4) != 0) {
+    return;
+  }
+  uint64_t index_offset = GetUint64(trailer.data());
+  uint64_t record_count = GetUint64(trailer.data() + 8);
+  uint64_t block_count = GetUint32(trailer.data() + 16);
+  uint64_t index_end = file_size_ - kTrailerSize;
+  if (index_offset < kFileHeaderSize || index_offset > index_end ||
+      index_end - index_offset !=
+          kIndexHeaderSize + block_count * kIndexEntrySize) {
+    return;
+  }
+  std::string index;
+  if (!ReadAt(file_, index_offset, index_end - index_offset, &index) ||
+      memcmp(index.data(), kIndexMagic, 4) != 0 ||
+      GetUint32(index.data() + 4) != block_count) {
+    return;
+  }
+  std::vector<IndexEntry> entries;
+  entries.reserve(block_count);
+  uint64_t next_offset = kFileHeaderSize;
+  uint64_t next_record = 0;
+  for (uint64_t i = 0; i < block_count; i++) {
+    const char *entry = index.data() + kIndexHeaderSize + i * kIndexEntrySize;
+    IndexEntry parsed = {GetUint64(entry), GetUint64(entry + 8),
+                         GetUint32(entry + 16)};
+    // Blocks are contiguous in the file, so each entry only needs to be in
+    // order and in bounds. The blocks themselves are validated when read.
+    if (parsed.offset < next_offset || parsed.offset >= index_offset ||
+        parsed.first_record != next_record) {
+      return;
+    }
+    next_offset = parsed.offset + kBlockHeaderSize;
+    next_record += parsed.record_count;
+    entries.push_back(parsed);
+  }
+  if (next_record != record_count || record_count > INT64_MAX) {
+    return;
+  }
+  index_ = std::move(entries);
+  record_count_ = static_cast<int64_t>(record_count);
+  data_end_ = index_offset;
+}
+
+RecordReader::Block RecordReader::ReadNextBlock() {
+  Block block;
+  block.first_record = next_block_first_record_;
+  BlockHeader header;
+  switch (ReadBlockHeader(file_, next_block_offset_, data_end_,
+                          record_count_.has_value(), &header)) {
+    case BlockHeaderStatus::kOk:
+      break;
+    case BlockHeaderStatus::kEnd:
+      block.end = true;
+      return block;
+    case BlockHeaderStatus::kCorrupt:
+      block.ok = false;
+      return block;
+  }
+  std::string stored;
+  if (!ReadAt(file_, next_block_offset_ + kBlockHeaderSize,
+              header.stored_size, &stored) ||
+      Crc32(stored) != header.crc) {
+    block.ok = false;
+    return block;
+  }
+  if (header.compression == kCompressionZlib) {
+    block.records.resize(header.raw_size);
+    uLongf raw_size = header.raw_size;
+    if (uncompress(reinterpret_cast<Bytef *>(&block.records[0]), &raw_size,
+                   reinterpret_cast<const Bytef *>(stored.data()),
+                   static_cast<uLong>(stored.size())) != Z_OK ||
+        raw_size != header.raw_size) {
+      block.ok = false;
+      return block;
+    }
+  } else {
+    block.records = std::move(stored);
+  }
+  if (!ValidateRecords(block.records, header.record_count)) {
+    block.ok = false;
+    return block;
+  }
+  next_block_offset_ += kBlockHeaderSize + header.stored_size;
+  next_block_first_record_ += header.record_count;
+  return block;
+}
+
+RecordReader::Block RecordReader::NextBlock() {
+  if (!read_ahead_thread_.joinable()) {
+    return ReadNextBlock();
+  }
+  Block block;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    queue_changed_.wait(lock, [this] { return !queue_.empty(); });
+    block = std::move(queue_.front());
+    queue_.pop_front();
+  }
+  queue_changed_.notify_all();
+  return block;
+}
+
+void RecordReader::ReadAhead() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queue_changed_.wait(lock, [this] {
+        return stop_ ||
+               queue_.size() < static_cast<size_t>(options_.read_ahead_blocks);
+      });
+      if (stop_) {
+        return;
+      }
+    }
+    // Blocks are read and decoded without holding the lock, so the consumer
+    // can process queued blocks in the meantime.
+    Block block = ReadNextBlock();
+    bool last = block.end || !block.ok;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(std::move(block));
+    }
+    queue_changed_.notify_all();
+    if (last) {
+      return;
+    }
+  }
+}
+
+void RecordReader::StartAt(uint64_t offset, int64_t first_record) {
+  StopReadAhead();
+  queue_.clear();
+  stop_ = false;
+  next_block_offset_ = offset;
+  next_block_first_record_ = first_record;
+  current_ = Block();
+  position_ = 0;
+  next_record_ = first_record;
+  if (options_.read_ahead_blocks > 0) {
+    read_ahead_thread_ = std::thread(&RecordReader::ReadAhead, this);
+  }
+}
+
+void RecordReader::StopReadAhead() {
+  if (!read_ahead_thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  queue_changed_.notify_all();
+  read_ahead_thread_.join();
+}
+
+bool RecordReader::NextRecord(absl::string_view *record) {
+  while (position_ >= current_.records.size()) {
+    if (current_.end || !current_.ok) {
+      return false;
+    }
+    current_ = NextBlock();
+    position_ = 0;
+    if (!current_.ok) {
+      ok_ = false;
+      return false;
+    }
+  }
+  // The records of a block are validated when it is decoded.
+  absl::string_view records(current_.records);
+  records.remove_prefix(position_);
+  uint64_t size;
+  size_t prefix_size = records.size();
+  ConsumeVarint(&records, &size);
+  prefix_size -= records.size();
+  *record = records.substr(0, size);
+  position_ += prefix_size + size;
+  next_record_++;
+  return true;
+}
+
+bool RecordReader::ReadRecord(std::string *record) {
+  absl::string_view view;
+  if (!NextRecord(&view)) {
+    return false;
+  }
+  record->assign(view.data(), view.size());
+  return true;
+}
+
+bool RecordReader::ReadEvaluation(AccessibilityEvaluationProto *evaluation) {
+  *evaluation = AccessibilityEvaluationProto();
+  absl::string_view record;
+  if (!NextRecord(&record)) {
+    return false;
+  }
+  if (!ParseProto(record, evaluation)) {
+    ok_ = false;
+    return false;
+  }
+  return true;
+}
+
+bool RecordReader::ReadCheckResult(CheckResultProto *result) {
+  *result = CheckResultProto();
+  absl::string_view record;
+  if (!NextRecord(&record)) {
+    return false;
+  }
+  if (!ParseProto(record, result)) {
+    ok_ = false;
+    return false;
+  }
+  return true;
+}
+
+bool RecordReader::SeekToRecord(int64_t index) {
+  if (index < 0 || !ok_) {
+    return false;
+  }
+  uint64_t block_offset = kFileHeaderSize;
+  int64_t first_record = 0;
+  if (record_count_.has_value()) {
+    if (index > *record_count_) {
+      return false;
+    }
+    // Finds the last block starting at or before index. Blocks are never
+    // empty, so it contains index unless index is the end of the stream.
+    auto it = std::upper_bound(
+        index_.begin(), index_.end(), static_cast<uint64_t>(index),
+        [](uint64_t record, const IndexEntry &entry) {
+          return record < entry.first_record;
+        });
+    if (it == index_.begin()) {
+      block_offset = data_end_;
+      first_record = *record_count_;
+    } else {
+      --it;
+      block_offset = it->offset;
+      first_record = static_cast<int64_t>(it->first_record);
+    }
+  } else {
+    StopReadAhead();
+    while (true) {
+      BlockHeader header;
+      BlockHeaderStatus status = ReadBlockHeader(
+          file_, block_offset, data_end_, /*indexed=*/false, &header);
+      if (status == BlockHeaderStatus::kCorrupt) {
+        ok_ = false;
+        return false;
+      }
+      if (status == BlockHeaderStatus::kEnd) {
+        if (index > first_record) {
+          return false;
+        }
+        break;
+      }
+      if (index < first_record + header.record_count) {
+        break;
+      }
+      block_offset += kBlockHeaderSize + header.stored_size;
+      first_record += header.record_count;
+    }
+  }
+  StartAt(block_offset, first_record);
+  absl::string_view record;
+  while (next_record_ < index) {
+    if (!NextRecord(&record)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace gtx
@@ -0,0 +1,244 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_RECORD_STREAM_H_
+#define GTXILIB_OOPCLASSES_RECORD_STREAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <abseil/absl/strings/string_view.h>
+#include <abseil/absl/types/optional.h>
+#include "typedefs.h"
+
+namespace gtx {
+
+// A record stream is a file of serialized protos, for example a corpus of
+// AccessibilityEvaluationProtos, that can be written and read with bounded
+// memory regardless of its size. The file consists of
+//
+//   a file header       ("GTXR", version, record type)
+//   blocks              (block header, then the records of the block, each
+//                        prefixed with its size as a varint, optionally
+//                        compressed with zlib)
+//   an index            ("GTXI", then the offset, first record and record
+//                        count of each block)
+//   a trailer           (index offset, record and block counts, "GTXE")
+//
+// All integers are little-endian. The index and trailer are written when the
+// stream is closed. Streams without them, for example because the writer was
+// interrupted, can still be read sequentially up to the last complete block.
+
+// The type of the records in a record stream.
+enum class RecordType : uint32_t {
+  kUnknown = 0,
+  kEvaluation = 1,
+  kCheckResult = 2,
+};
+
+struct RecordWriterOptions {
+  // The uncompressed size at which the buffered records are written as a
+  // block. Records larger than this are written in a block of their own.
+  size_t block_size = 1 << 20;
+
+  // If true, blocks are compressed with zlib. Blocks that do not get smaller
+  // are stored uncompressed.
+  bool compress = false;
+};
+
+// Writes records to a record stream, buffering at most one block in memory.
+class RecordWriter {
+ public:
+  // Creates the file at @c path, replacing any existing file, and writes the
+  // file header. Returns nullptr if the file cannot be created.
+  static std::unique_ptr<RecordWriter> Create(
+      const std::string &path, RecordType record_type,
+      const RecordWriterOptions &options = RecordWriterOptions());
+
+  // Closes the stream if Close has not been called.
+  ~RecordWriter();
+
+  RecordWriter(const RecordWriter &) = delete;
+  RecordWriter &operator=(const RecordWriter &) = delete;
+
+  // Appends @c record to the stream. Returns false if writing fails or the
+  // stream is closed.
+  bool WriteRecord(absl::string_view record);
+
+  // Serializes and appends the given message.
+  bool WriteEvaluation(const AccessibilityEvaluationProto &evaluation);
+  bool WriteCheckResult(const CheckResultProto &result);
+
+  // Writes the buffered records, the index and the trailer and closes the
+  // file. Returns false if any write since the stream was created failed.
+  bool Close();
+
+  // The number of records written so far.
+  int64_t record_count() const { return record_count_; }
+
+ private:
+  struct IndexEntry {
+    uint64_t offset;
+    uint64_t first_record;
+    uint32_t record_count;
+  };
+
+  RecordWriter(FILE *file, const RecordWriterOptions &options);
+
+  // Writes the buffered records as a block.
+  bool FlushBlock();
+
+  // Writes @c size bytes at @c data to the file.
+  bool Write(const void *data, size_t size);
+
+  FILE *file_;
+  RecordWriterOptions options_;
+  // The records of the block being built, each prefixed with its size.
+  std::string block_;
+  uint32_t block_record_count_ = 0;
+  std::vector<IndexEntry> index_;
+  uint64_t offset_ = 0;
+  int64_t record_count_ = 0;
+  bool ok_ = true;
+};
+
+struct RecordReaderOptions {
+  // The number of blocks read and decoded ahead of the block being consumed,
+  // on a background thread. If 0, blocks are read on the calling thread.
+  int read_ahead_blocks = 2;
+};
+
+// Reads records from a record stream. RecordReader holds at most
+// read_ahead_blocks + 1 decoded blocks in memory. It is not thread safe.
+class RecordReader {
+ public:
+  // Opens the record stream at @c path. Returns nullptr if the file cannot be
+  // opened or does not start with a valid file header.
+  static std::unique_ptr<RecordReader> Open(
+      const std::string &path,
+      const RecordReaderOptions &options = RecordReaderOptions());
+
+  ~RecordReader();
+
+  RecordReader(const RecordReader &) = delete;
+  RecordReader &operator=(const RecordReader &) = delete;
+
+  RecordType record_type() const { return record_type_; }
+
+  // The number of records in the stream, or absl::nullopt if the stream has
+  // no valid index.
+  absl::optional<int64_t> record_count() const;
+
+  // Reads the next record into @c record. Returns false at the end of the
+  // stream or if the stream is corrupt, which can be distinguished with ok().
+  bool ReadRecord(std::string *record);
+
+  // Reads and parses the next record into the given message, which is
+  // cleared first. Returns false like ReadRecord, or if the record cannot be
+  // parsed, in which case ok() returns false.
+  bool ReadEvaluation(AccessibilityEvaluationProto *evaluation);
+  bool ReadCheckResult(CheckResultProto *result);
+
+  // Positions the reader so that the next record read is the record at
+  // @c index. Uses the index if there is one and otherwise skips blocks from
+  // the start of the stream without decoding them. Returns false if @c index
+  // is out of bounds or the stream is corrupt.
+  bool SeekToRecord(int64_t index);
+
+  // Returns false if corrupt data was encountered.
+  bool ok() const { return ok_; }
+
+ private:
+  struct IndexEntry {
+    uint64_t offset;
+    uint64_t first_record;
+    uint32_t record_count;
+  };
+
+  // A decoded block. A block with ok false marks corrupt data, and a block
+  // with end true marks the end of the stream.
+  struct Block {
+    std::string records;
+    int64_t first_record = 0;
+    bool ok = true;
+    bool end = false;
+  };
+
+  RecordReader(FILE *file, RecordType record_type,
+               const RecordReaderOptions &options);
+
+  // Reads the index and trailer at the end of the file, if they are valid.
+  void ReadIndex();
+
+  // Reads and decodes the block at next_block_offset_ and advances to the
+  // block after it.
+  Block ReadNextBlock();
+
+  // Returns the next decoded block, from the read-ahead queue if the
+  // background thread is running.
+  Block NextBlock();
+
+  // Starts reading at the block at @c offset whose first record is
+  // @c first_record, discarding any blocks read ahead.
+  void StartAt(uint64_t offset, int64_t first_record);
+  void StopReadAhead();
+
+  // The body of the read-ahead thread.
+  void ReadAhead();
+
+  // Sets @c record to the next record, which points into current_. Returns
+  // false like ReadRecord.
+  bool NextRecord(absl::string_view *record);
+
+  FILE *file_;
+  RecordType record_type_;
+  RecordReaderOptions options_;
+  uint64_t file_size_ = 0;
+  // The offset of the index, or of the end of the file if there is no index.
+  uint64_t data_end_ = 0;
+  std::vector<IndexEntry> index_;
+  absl::optional<int64_t> record_count_;
+
+  // The block being consumed and the position of the next record in it.
+  Block current_;
+  size_t position_ = 0;
+  int64_t next_record_ = 0;
+  bool ok_ = true;
+
+  // State of the sequential read of blocks, owned by the read-ahead thread
+  // while it runs.
+  uint64_t next_block_offset_ = 0;
+  int64_t next_block_first_record_ = 0;
+
+  std::thread read_ahead_thread_;
+  std::mutex mutex_;
+  std::condition_variable queue_changed_;
+  std::deque<Block> queue_;
+  bool stop_ = false;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_RECORD_STREAM_H_
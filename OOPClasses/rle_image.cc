@@ -0,0 +1,67 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "rle_image.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "gtx_types.h"
+
+namespace gtx {
+
+RleImage RleImage::Encode(const Image &image) {
+  RleImage encoded;
+  if (image.pixels == nullptr || image.width <= 0 || image.height <= 0) {
+    return encoded;
+  }
+  encoded.width_ = image.width;
+  encoded.height_ = image.height;
+  encoded.row_starts_.reserve(image.height + 1);
+  const Pixel *pixel = image.pixels;
+  for (int y = 0; y < image.height; y++) {
+    int32_t run_color = 0;
+    for (int x = 0; x < image.width; x++, pixel++) {
+      int32_t color = pixel->PackedColor();
+      if (x == 0 || color != run_color) {
+        encoded.runs_.push_back({x, color});
+        run_color = color;
+      }
+    }
+    encoded.row_starts_.push_back(static_cast<uint32_t>(encoded.runs_.size()));
+  }
+  encoded.runs_.shrink_to_fit();
+  return encoded;
+}
+
+int32_t RleImage::PackedColorAt(int x, int y) const {
+  int32_t color = 0;
+  int index = x + y * width_;
+  // The range of a single pixel is at most one run of length 1.
+  ForEachRunInRange(index, index + 1, [&color](int32_t packed_color, int) {
+    color = packed_color;
+  });
+  return color;
+}
+
+size_t RleImage::ByteSize() const {
+  return runs_.size() * sizeof(Run) + row_starts_.size() * sizeof(uint32_t);
+}
+
+}  // namespace gtx
@@ -0,0 +1,107 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_RLE_IMAGE_H_
+#define GTXILIB_OOPCLASSES_RLE_IMAGE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "gtx_types.h"
+
+namespace gtx {
+
+// An image stored row by row as runs of pixels of the same color. Screenshots
+// of apps are mostly flat backgrounds, so most rows are a few long runs, and
+// histograms of a region can be accumulated per run instead of per pixel.
+//
+// Colors are packed as by Color::PackedColor, so alpha is dropped: colors of
+// screenshots have alpha pre-multiplied.
+class RleImage {
+ public:
+  // A run of pixels of the same color, from column @c start to the start of
+  // the next run of its row, or to the end of the row.
+  struct Run {
+    int32_t start;
+    int32_t packed_color;
+  };
+
+  // Constructs an empty image.
+  RleImage() {}
+
+  // Encodes the pixels of @c image in one pass.
+  static RleImage Encode(const Image &image);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  // The runs of row @c y, in order of column.
+  const Run *RowBegin(int y) const { return runs_.data() + row_starts_[y]; }
+  const Run *RowEnd(int y) const { return runs_.data() + row_starts_[y + 1]; }
+
+  // The number of runs in the image.
+  size_t run_count() const { return runs_.size(); }
+
+  // Calls @c visit with the packed color and the length of each run, or part
+  // of a run, between pixels @c begin and @c end, counted row by row. The
+  // range may span several rows.
+  template <typename RunVisitor>
+  void ForEachRunInRange(int begin, int end, RunVisitor visit) const;
+
+  // Returns the packed color of the pixel at @c x, @c y.
+  int32_t PackedColorAt(int x, int y) const;
+
+  // The number of bytes the runs take.
+  size_t ByteSize() const;
+
+ private:
+  int width_ = 0;
+  int height_ = 0;
+  std::vector<Run> runs_;
+  // The index in runs_ of the first run of each row, and the number of runs.
+  std::vector<uint32_t> row_starts_ = {0};
+};
+
+template <typename RunVisitor>
+void RleImage::ForEachRunInRange(int begin, int end,
+                                 RunVisitor visit) const {
+  while (begin < end) {
+    const int y = begin / width_;
+    const int row_end = std::min(end, (y + 1) * width_);
+    const int x_begin = begin - y * width_;
+    const int x_end = row_end - y * width_;
+    const Run *row_end_run = RowEnd(y);
+    // The last run that starts at or before x_begin.
+    const Run *run =
+        std::upper_bound(RowBegin(y), row_end_run, x_begin,
+                         [](int x, const Run &run) { return x < run.start; }) -
+        1;
+    for (int x = x_begin; x < x_end; run++) {
+      const int run_end = run + 1 == row_end_run ? width_ : run[1].start;
+      const int next_x = std::min(run_end, x_end);
+      visit(run->packed_color, next_x - x);
+      x = next_x;
+    }
+    begin = row_end;
+  }
+}
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_RLE_IMAGE_H_
@@ -0,0 +1,321 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "sampling.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "typedefs.h"
+#include "element_trait.h"
+#include "evaluation_options.h"
+#include "gtx_types.h"
+#include "parameters.h"
+
+namespace gtx {
+
+namespace {
+
+// The parameters of the 64 bit FNV-1a hash.
+constexpr uint64_t kFingerprintOffsetBasis = 14695981039346656037ULL;
+constexpr uint64_t kFingerprintPrime = 1099511628211ULL;
+
+// Hashes the @c size bytes at @c bytes into the FNV-1a hash @c hash, preceded
+// by their count so that consecutive strings cannot run into each other.
+void FingerprintBytes(const void *bytes, size_t size, uint64_t *hash) {
+  uint64_t length = size;
+  for (int i = 0; i < 8; i++) {
+    *hash = (*hash ^ ((length >> (8 * i)) & 0xff)) * kFingerprintPrime;
+  }
+  const unsigned char *data = static_cast<const unsigned char *>(bytes);
+  for (size_t i = 0; i < size; i++) {
+    *hash = (*hash ^ data[i]) * kFingerprintPrime;
+  }
+}
+
+void FingerprintString(const std::string &value, uint64_t *hash) {
+  FingerprintBytes(value.data(), value.size(), hash);
+}
+
+// Hashes @c value in little endian order, whatever the platform's.
+void FingerprintInteger(uint64_t value, uint64_t *hash) {
+  unsigned char bytes[8];
+  for (int i = 0; i < 8; i++) {
+    bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+  }
+  FingerprintBytes(bytes, sizeof(bytes), hash);
+}
+
+// Returns true if @c element has any of @c traits.
+bool HasTrait(const UIElementProto &element, ElementTrait traits) {
+  return (element.ax_traits() & static_cast<uint64_t>(traits)) != 0;
+}
+
+// The traits that make an element interactive.
+constexpr ElementTrait kInteractiveTraits =
+    ElementTrait::kButton | ElementTrait::kLink | ElementTrait::kSearchField |
+    ElementTrait::kKeyboardKey | ElementTrait::kAdjustable |
+    ElementTrait::kAllowsDirectInteraction;
+
+// The strata of TraitStratifier, from the most to the least specific.
+const std::pair<ElementTrait, const char *> kTraitStrata[] = {
+    {ElementTrait::kSearchField, "search_field"},
+    {ElementTrait::kAdjustable, "adjustable"},
+    {ElementTrait::kKeyboardKey, "keyboard_key"},
+    {ElementTrait::kLink, "link"},
+    {ElementTrait::kButton, "button"},
+    {ElementTrait::kImage, "image"},
+    {ElementTrait::kHeader, "header"},
+    {ElementTrait::kStaticText, "static_text"},
+};
+
+// The state of a stratum while SamplingPlan::Create orders its candidates.
+struct StratumQueue {
+  int stratum;
+  // The candidates of the stratum, as positions in the candidate list, from
+  // the highest to the lowest score.
+  std::vector<int> candidates;
+  // The number of candidates taken so far.
+  size_t taken = 0;
+};
+
+}  // namespace
+
+ElementScorer VisibleAreaScorer() {
+  return [](const UIElementProto &element, const Parameters &params) {
+    Rect frame(element.ax_frame());
+    const Rect &device_bounds = params.device_bounds();
+    if (device_bounds.IsEmpty()) {
+      return frame.IsEmpty() ? 0.0 : 1.0;
+    }
+    Rect visible = frame.Intersection(device_bounds);
+    double visible_area = fabs(visible.size.width * visible.size.height);
+    double device_area =
+        fabs(device_bounds.size.width * device_bounds.size.height);
+    return std::min(1.0, visible_area / device_area);
+  };
+}
+
+ElementScorer InteractivityScorer() {
+  return [](const UIElementProto &element, const Parameters &params) {
+    return HasTrait(element, kInteractiveTraits) ? 1.0 : 0.0;
+  };
+}
+
+ElementScorer NoveltyScorer(
+    std::unordered_set<uint64_t> previous_fingerprints) {
+  return [previous_fingerprints = std::move(previous_fingerprints)](
+             const UIElementProto &element, const Parameters &params) {
+    return previous_fingerprints.count(ElementFingerprint(element)) == 0
+               ? 1.0
+               : 0.0;
+  };
+}
+
+ElementScorer WeightedScorer(
+    std::vector<std::pair<double, ElementScorer>> scorers) {
+  return [scorers = std::move(scorers)](const UIElementProto &element,
+                                        const Parameters &params) {
+    double score = 0;
+    for (const auto &scorer : scorers) {
+      score += scorer.first * scorer.second(element, params);
+    }
+    return score;
+  };
+}
+
+ElementScorer DefaultElementScorer() {
+  return WeightedScorer({{1.0, VisibleAreaScorer()},
+                         {1.0, InteractivityScorer()}});
+}
+
+ElementStratifier TraitStratifier() {
+  return [](const UIElementProto &element) {
+    for (const auto &stratum : kTraitStrata) {
+      if (HasTrait(element, stratum.first)) {
+        return std::string(stratum.second);
+      }
+    }
+    return std::string("other");
+  };
+}
+
+ElementStratifier ClassNameStratifier() {
+  return [](const UIElementProto &element) {
+    const std::vector<std::string> &class_names =
+        element.class_names_hierarchy();
+    return class_names.empty() ? std::string() : class_names.back();
+  };
+}
+
+uint64_t ElementFingerprint(const UIElementProto &element) {
+  uint64_t hash = kFingerprintOffsetBasis;
+  FingerprintString(element.ax_label(), &hash);
+  FingerprintString(element.ax_identifier(), &hash);
+  FingerprintInteger(element.ax_traits(), &hash);
+  const std::vector<std::string> &class_names =
+      element.class_names_hierarchy();
+  FingerprintString(class_names.empty() ? std::string() : class_names.back(),
+                    &hash);
+  // Frames are rounded to whole points, so that layout noise does not make
+  // elements look new.
+  Rect frame(element.ax_frame());
+  const float coordinates[] = {frame.origin.x, frame.origin.y,
+                               frame.size.width, frame.size.height};
+  for (float coordinate : coordinates) {
+    FingerprintInteger(static_cast<uint64_t>(llroundf(coordinate)), &hash);
+  }
+  return hash;
+}
+
+std::unordered_set<uint64_t> ElementFingerprints(
+    const AccessibilityHierarchyProto &hierarchy) {
+  std::unordered_set<uint64_t> fingerprints;
+  for (const UIElementProto &element : hierarchy.elements()) {
+    if (element.is_ax_element()) {
+      fingerprints.insert(ElementFingerprint(element));
+    }
+  }
+  return fingerprints;
+}
+
+SamplingOptions SamplingOptions::WithTimeout(
+    EvaluationOptions::Clock::duration timeout) {
+  SamplingOptions options;
+  options.evaluation_options = EvaluationOptions::WithTimeout(timeout);
+  return options;
+}
+
+SamplingPlan SamplingPlan::Create(const AccessibilityHierarchyProto &hierarchy,
+                                  const std::vector<int> &candidate_indices,
+                                  const Parameters &params,
+                                  const SamplingOptions &options) {
+  ElementScorer scorer =
+      options.scorer ? options.scorer : DefaultElementScorer();
+  ElementStratifier stratifier =
+      options.stratifier ? options.stratifier : TraitStratifier();
+
+  // Score and stratify the candidates. Strata are numbered in order of name.
+  std::vector<double> scores;
+  std::vector<std::string> names;
+  scores.reserve(candidate_indices.size());
+  names.reserve(candidate_indices.size());
+  std::map<std::string, int> stratum_numbers;
+  for (int index : candidate_indices) {
+    const UIElementProto &element = hierarchy.elements(index);
+    scores.push_back(std::max(0.0, scorer(element, params)));
+    names.push_back(stratifier(element));
+    stratum_numbers.emplace(names.back(), 0);
+  }
+  SamplingPlan plan;
+  for (auto &stratum : stratum_numbers) {
+    stratum.second = static_cast<int>(plan.stratum_names.size());
+    plan.stratum_names.push_back(stratum.first);
+  }
+  std::vector<StratumQueue> queues(plan.stratum_names.size());
+  for (size_t i = 0; i < queues.size(); i++) {
+    queues[i].stratum = static_cast<int>(i);
+  }
+  for (size_t i = 0; i < candidate_indices.size(); i++) {
+    queues[stratum_numbers[names[i]]].candidates.push_back(
+        static_cast<int>(i));
+  }
+  for (StratumQueue &queue : queues) {
+    // Stable, so that candidates of equal score keep hierarchy order.
+    std::stable_sort(queue.candidates.begin(), queue.candidates.end(),
+                     [&scores](int lhs, int rhs) {
+                       return scores[lhs] > scores[rhs];
+                     });
+    plan.stratum_sizes.push_back(static_cast<int>(queue.candidates.size()));
+  }
+
+  // The stratum to take from next is the one with the smallest fraction
+  // taken, then the one with the highest scoring remaining candidate, then
+  // the first.
+  auto comes_after = [&scores](const StratumQueue *lhs,
+                               const StratumQueue *rhs) {
+    uint64_t lhs_taken = lhs->taken * rhs->candidates.size();
+    uint64_t rhs_taken = rhs->taken * lhs->candidates.size();
+    if (lhs_taken != rhs_taken) {
+      return lhs_taken > rhs_taken;
+    }
+    double lhs_score = scores[lhs->candidates[lhs->taken]];
+    double rhs_score = scores[rhs->candidates[rhs->taken]];
+    if (lhs_score != rhs_score) {
+      return lhs_score < rhs_score;
+    }
+    return lhs->stratum > rhs->stratum;
+  };
+  std::priority_queue<StratumQueue *, std::vector<StratumQueue *>,
+                      decltype(comes_after)>
+      next_stratum(comes_after);
+  for (StratumQueue &queue : queues) {
+    next_stratum.push(&queue);
+  }
+  plan.element_indices.reserve(candidate_indices.size());
+  plan.scores.reserve(candidate_indices.size());
+  plan.strata.reserve(candidate_indices.size());
+  while (!next_stratum.empty()) {
+    StratumQueue *queue = next_stratum.top();
+    next_stratum.pop();
+    int candidate = queue->candidates[queue->taken++];
+    plan.element_indices.push_back(candidate_indices[candidate]);
+    plan.scores.push_back(scores[candidate]);
+    plan.strata.push_back(queue->stratum);
+    if (queue->taken < queue->candidates.size()) {
+      next_stratum.push(queue);
+    }
+  }
+  return plan;
+}
+
+double SamplingCoverage::CandidateFraction() const {
+  return candidate_count == 0
+             ? 1.0
+             : static_cast<double>(evaluated_count) / candidate_count;
+}
+
+double SamplingCoverage::ScoreFraction() const {
+  return total_score <= 0 ? 1.0 : evaluated_score / total_score;
+}
+
+std::string SamplingCoverage::ToString() const {
+  char summary[256];
+  snprintf(summary, sizeof(summary),
+           "%d of %d candidates evaluated (%.1f%%), %.1f%% of the score, "
+           "%d elements\n",
+           evaluated_count, candidate_count, 100 * CandidateFraction(),
+           100 * ScoreFraction(), element_count);
+  std::string text = summary;
+  for (const StratumCoverage &stratum : strata) {
+    snprintf(summary, sizeof(summary), "  %s: %d of %d\n",
+             stratum.stratum.empty() ? "(none)" : stratum.stratum.c_str(),
+             stratum.evaluated_count, stratum.element_count);
+    text += summary;
+  }
+  return text;
+}
+
+}  // namespace gtx
@@ -0,0 +1,187 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_SAMPLING_H_
+#define GTXILIB_OOPCLASSES_SAMPLING_H_
+
+#include <stdint.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "typedefs.h"
+#include "evaluation_options.h"
+#include "parameters.h"
+
+namespace gtx {
+
+// Scores an element for a sampled evaluation. Elements with higher scores
+// are evaluated first. Scores are non-negative, and the built-in scorers
+// return scores between 0 and 1, so that they can be combined with weights.
+using ElementScorer =
+    std::function<double(const UIElementProto &element,
+                         const Parameters &params)>;
+
+// Returns the stratum of an element, the class of elements it is sampled
+// with.
+using ElementStratifier =
+    std::function<std::string(const UIElementProto &element)>;
+
+// Scores elements by the fraction of Parameters::device_bounds their frame
+// covers. If the device bounds are empty, elements with a non-empty frame
+// score 1.
+ElementScorer VisibleAreaScorer();
+
+// Scores elements 1 if their traits make them interactive, such as buttons,
+// links and adjustable elements, and 0 otherwise.
+ElementScorer InteractivityScorer();
+
+// Scores elements 1 if their fingerprint is not in @c previous_fingerprints,
+// and 0 otherwise, so that elements that are new since a previous run are
+// evaluated first. See ElementFingerprints.
+ElementScorer NoveltyScorer(std::unordered_set<uint64_t> previous_fingerprints);
+
+// Scores elements by the sum of the scores of @c scorers, each multiplied by
+// its weight.
+ElementScorer WeightedScorer(
+    std::vector<std::pair<double, ElementScorer>> scorers);
+
+// Visible area and interactivity, weighted equally. The scorer used if
+// SamplingOptions::scorer is empty.
+ElementScorer DefaultElementScorer();
+
+// Stratifies elements by their most specific trait: "button", "link",
+// "search_field", "adjustable", "keyboard_key", "image", "header",
+// "static_text" or "other". The stratifier used if
+// SamplingOptions::stratifier is empty.
+ElementStratifier TraitStratifier();
+
+// Stratifies elements by their most specific class name, or "" if they have
+// none.
+ElementStratifier ClassNameStratifier();
+
+// Returns a hash of the properties that identify @c element across runs: its
+// label, identifier, traits, most specific class name and frame. Stable
+// across processes and platforms, so it can be stored between runs.
+uint64_t ElementFingerprint(const UIElementProto &element);
+
+// Returns the fingerprints of the accessibility elements of @c hierarchy.
+std::unordered_set<uint64_t> ElementFingerprints(
+    const AccessibilityHierarchyProto &hierarchy);
+
+// Configures Toolkit::CheckElementsSampled. The budget is a number of
+// elements, a deadline, or both.
+struct SamplingOptions {
+  // Returns options whose deadline is @c timeout from now.
+  static SamplingOptions WithTimeout(
+      EvaluationOptions::Clock::duration timeout);
+
+  // The most elements to evaluate, or 0 for no limit.
+  int max_elements = 0;
+
+  // The deadline and cancellation token of the evaluation.
+  EvaluationOptions evaluation_options;
+
+  // Orders the elements within each stratum. DefaultElementScorer if empty.
+  ElementScorer scorer;
+
+  // Groups elements into strata. TraitStratifier if empty.
+  ElementStratifier stratifier;
+};
+
+// The order in which a sampled evaluation checks the candidate elements of a
+// hierarchy. Every stratum contributes its highest scoring element first, in
+// order of those scores. After that, each next element is the highest
+// scoring remaining element of the stratum with the smallest fraction of its
+// elements sampled so far, so that any prefix of the order samples the
+// strata in proportion to their size.
+struct SamplingPlan {
+  // Plans the evaluation of the elements of @c hierarchy at
+  // @c candidate_indices.
+  static SamplingPlan Create(const AccessibilityHierarchyProto &hierarchy,
+                             const std::vector<int> &candidate_indices,
+                             const Parameters &params,
+                             const SamplingOptions &options);
+
+  // The indices of the candidates in the order to evaluate them, and their
+  // scores and strata.
+  std::vector<int> element_indices;
+  std::vector<double> scores;
+  std::vector<int> strata;
+
+  // The name and the number of candidates of each stratum, in order of name.
+  std::vector<std::string> stratum_names;
+  std::vector<int> stratum_sizes;
+};
+
+// The number of elements of a stratum that were candidates and evaluated.
+struct StratumCoverage {
+  std::string stratum;
+  int element_count = 0;
+  int evaluated_count = 0;
+};
+
+// How much of a hierarchy a sampled evaluation covered.
+struct SamplingCoverage {
+  // The number of elements in the hierarchy.
+  int element_count = 0;
+
+  // The number of accessibility elements, which are the candidates for
+  // sampling. Invisible elements are not candidates if the toolkit skips
+  // them.
+  int candidate_count = 0;
+
+  // The number of candidates evaluated.
+  int evaluated_count = 0;
+
+  // The sum of the scores of the evaluated candidates, and of all
+  // candidates.
+  double evaluated_score = 0;
+  double total_score = 0;
+
+  // The coverage of each stratum, in order of name.
+  std::vector<StratumCoverage> strata;
+
+  // The fraction of candidates evaluated, 1 if there were none.
+  double CandidateFraction() const;
+
+  // The fraction of the total score evaluated, 1 if it is 0.
+  double ScoreFraction() const;
+
+  // Returns a human readable summary of the coverage.
+  std::string ToString() const;
+};
+
+// The results of a sampled evaluation.
+struct SampledEvaluationResult {
+  // The results found, ordered by the position of their element in the
+  // hierarchy and then by check, as CheckElements orders them.
+  std::vector<CheckResultProto> results;
+
+  // kComplete if all elements within SamplingOptions::max_elements were
+  // evaluated, otherwise why the evaluation stopped.
+  EvaluationStatus status = EvaluationStatus::kComplete;
+
+  SamplingCoverage coverage;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_SAMPLING_H_
@@ -0,0 +1,122 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "scratch_arena.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace gtx {
+
+namespace {
+
+// The arena set by ScopedScratchArena on the calling thread.
+thread_local ScratchArena *current_scratch_arena = nullptr;
+
+}  // namespace
+
+constexpr size_t ScratchArena::kDefaultChunkSize;
+
+ScratchArena::ScratchArena(size_t chunk_size)
+    : chunk_size_(std::max<size_t>(chunk_size, 1)) {}
+
+void *ScratchArena::Allocate(size_t bytes, size_t alignment) {
+  uintptr_t next = reinterpret_cast<uintptr_t>(next_);
+  uintptr_t aligned = (next + alignment - 1) & ~(alignment - 1);
+  if (next_ == nullptr ||
+      aligned + bytes > reinterpret_cast<uintptr_t>(end_)) {
+    AddChunk(bytes + alignment);
+    next = reinterpret_cast<uintptr_t>(next_);
+    aligned = (next + alignment - 1) & ~(alignment - 1);
+  }
+  bytes_allocated_ += aligned - next + bytes;
+  next_ = reinterpret_cast<char *>(aligned + bytes);
+  return reinterpret_cast<void *>(aligned);
+}
+
+void ScratchArena::Reset() {
+  if (chunks_.size() > 1) {
+    const size_t capacity = capacity_;
+    chunks_.clear();
+    capacity_ = 0;
+    AddChunk(capacity);
+  }
+  if (!chunks_.empty()) {
+    next_ = chunks_.back().data.get();
+    end_ = next_ + chunks_.back().size;
+  }
+  bytes_allocated_ = 0;
+}
+
+void ScratchArena::AddChunk(size_t min_size) {
+  // Doubling the capacity keeps the number of chunks logarithmic in the
+  // bytes allocated.
+  const size_t size = std::max(min_size, std::max(chunk_size_, capacity_));
+  chunks_.push_back(Chunk{std::unique_ptr<char[]>(new char[size]), size});
+  next_ = chunks_.back().data.get();
+  end_ = next_ + size;
+  capacity_ += size;
+  chunk_allocation_count_++;
+}
+
+ScratchArena *ScratchArena::Current() { return current_scratch_arena; }
+
+std::unique_ptr<ScratchArena> ScratchArenaPool::Acquire() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!arenas_.empty()) {
+      std::unique_ptr<ScratchArena> arena = std::move(arenas_.back());
+      arenas_.pop_back();
+      return arena;
+    }
+  }
+  return std::make_unique<ScratchArena>();
+}
+
+void ScratchArenaPool::Release(std::unique_ptr<ScratchArena> arena) {
+  arena->Reset();
+  std::lock_guard<std::mutex> lock(mutex_);
+  arenas_.push_back(std::move(arena));
+}
+
+ScopedScratchArena::ScopedScratchArena(ScratchArena *arena)
+    : previous_arena_(current_scratch_arena) {
+  current_scratch_arena = arena;
+}
+
+ScopedScratchArena::ScopedScratchArena(ScratchArenaPool *pool)
+    : previous_arena_(current_scratch_arena) {
+  if (current_scratch_arena == nullptr) {
+    pool_ = pool;
+    pooled_arena_ = pool->Acquire();
+    current_scratch_arena = pooled_arena_.get();
+  }
+}
+
+ScopedScratchArena::~ScopedScratchArena() {
+  current_scratch_arena = previous_arena_;
+  if (pooled_arena_ != nullptr) {
+    pool_->Release(std::move(pooled_arena_));
+  }
+}
+
+}  // namespace gtx
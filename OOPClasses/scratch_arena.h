@@ -0,0 +1,183 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_SCRATCH_ARENA_H_
+#define GTXILIB_OOPCLASSES_SCRATCH_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace gtx {
+
+// A monotonic arena for the temporaries of an evaluation, such as swatch
+// histograms. Allocation bumps a pointer in a chunk, freeing does nothing,
+// and Reset frees everything at once but keeps the memory, so an evaluator
+// that resets its arena between hierarchies stops allocating from the heap
+// once the arena has grown to what a hierarchy needs. Not thread safe: each
+// thread evaluating checks uses its own arena.
+class ScratchArena {
+ public:
+  // The size of the first chunk. Later chunks grow geometrically.
+  static constexpr size_t kDefaultChunkSize = 64 << 10;
+
+  explicit ScratchArena(size_t chunk_size = kDefaultChunkSize);
+
+  ScratchArena(const ScratchArena &) = delete;
+  ScratchArena &operator=(const ScratchArena &) = delete;
+
+  // Returns @c bytes of uninitialized memory aligned to @c alignment, a
+  // power of two, valid until the next Reset.
+  void *Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+  // Frees everything allocated since the last Reset. If the allocations
+  // spanned several chunks, they are replaced by a single chunk of their
+  // total size, so that the next evaluation of the same size fits in it.
+  void Reset();
+
+  // The bytes allocated since the last Reset, including alignment padding.
+  size_t bytes_allocated() const { return bytes_allocated_; }
+
+  // The bytes of all chunks.
+  size_t capacity() const { return capacity_; }
+
+  // The number of chunks allocated from the heap since construction.
+  int64_t chunk_allocation_count() const { return chunk_allocation_count_; }
+
+  // The arena of the calling thread, set by ScopedScratchArena, or nullptr.
+  // Checks and the code they call allocate their temporaries from it, for
+  // example with ArenaAllocator, without it being passed through Check.
+  static ScratchArena *Current();
+
+ private:
+  friend class ScopedScratchArena;
+
+  struct Chunk {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  // Allocates a chunk of at least @c min_size bytes and makes it current.
+  void AddChunk(size_t min_size);
+
+  const size_t chunk_size_;
+  std::vector<Chunk> chunks_;
+  char *next_ = nullptr;
+  char *end_ = nullptr;
+  size_t bytes_allocated_ = 0;
+  size_t capacity_ = 0;
+  int64_t chunk_allocation_count_ = 0;
+};
+
+// Arenas for the threads of evaluations, reused from one evaluation to the
+// next. Thread safe.
+class ScratchArenaPool {
+ public:
+  ScratchArenaPool() {}
+
+  ScratchArenaPool(const ScratchArenaPool &) = delete;
+  ScratchArenaPool &operator=(const ScratchArenaPool &) = delete;
+
+  // Returns an arena released earlier, or a new one.
+  std::unique_ptr<ScratchArena> Acquire();
+
+  // Resets @c arena and keeps it for a later Acquire.
+  void Release(std::unique_ptr<ScratchArena> arena);
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<ScratchArena>> arenas_;
+};
+
+// Sets the scratch arena of the calling thread from its construction to its
+// destruction.
+class ScopedScratchArena {
+ public:
+  // Makes @c arena, which may be nullptr, the arena of the calling thread.
+  // The caller resets it.
+  explicit ScopedScratchArena(ScratchArena *arena);
+
+  // Makes an arena from @c pool the arena of the calling thread, unless the
+  // thread already has one, as it does in an evaluation nested in another.
+  // The arena is reset and returned to @c pool on destruction, so that the
+  // temporaries of one evaluation do not accumulate into the next.
+  explicit ScopedScratchArena(ScratchArenaPool *pool);
+
+  ~ScopedScratchArena();
+
+  ScopedScratchArena(const ScopedScratchArena &) = delete;
+  ScopedScratchArena &operator=(const ScopedScratchArena &) = delete;
+
+ private:
+  ScratchArena *previous_arena_;
+  ScratchArenaPool *pool_ = nullptr;
+  std::unique_ptr<ScratchArena> pooled_arena_;
+};
+
+// A standard library allocator that allocates from a ScratchArena, by
+// default the arena of the calling thread when the allocator is created, and
+// from the heap if there is none. Containers using it must not outlive the
+// evaluation that created them.
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  ArenaAllocator() : arena_(ScratchArena::Current()) {}
+  explicit ArenaAllocator(ScratchArena *arena) : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : arena_(other.arena()) {}
+
+  T *allocate(size_t count) {
+    if (arena_ == nullptr) {
+      return static_cast<T *>(::operator new(count * sizeof(T)));
+    }
+    return static_cast<T *>(arena_->Allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *pointer, size_t) {
+    if (arena_ == nullptr) {
+      ::operator delete(pointer);
+    }
+  }
+
+  ScratchArena *arena() const { return arena_; }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U> &other) const {
+    return arena_ == other.arena();
+  }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U> &other) const {
+    return arena_ != other.arena();
+  }
+
+ private:
+  ScratchArena *arena_;
+};
+
+// A vector of evaluation temporaries.
+template <typename T>
+using ScratchVector = std::vector<T, ArenaAllocator<T>>;
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_SCRATCH_ARENA_H_
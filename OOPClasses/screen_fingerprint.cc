@@ -0,0 +1,324 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "screen_fingerprint.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "typedefs.h"
+#include "banded_screenshot.h"
+#include "evaluation_options.h"
+#include "gtx_types.h"
+#include "luminance_plane.h"
+#include "palette_image.h"
+#include "parameters.h"
+#include "rle_image.h"
+
+namespace gtx {
+
+namespace {
+
+// The size of the grid of mean luminances the image hash compares.
+constexpr int kImageHashColumns = 9;
+constexpr int kImageHashRows = 8;
+
+// The number of pixels sampled along each side of a cell of the grid. The
+// hash needs only a rough mean of each cell, and reading every pixel of a
+// screenshot costs as much as the evaluation a fingerprint may save.
+constexpr int kSamplesPerCellSide = 16;
+
+// Scrambles @c value so that nearby inputs have unrelated bits, as SimHash
+// needs of its feature hashes (the finalizer of SplitMix64).
+uint64_t Mix(uint64_t value) {
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  return value ^ (value >> 31);
+}
+
+uint64_t Combine(uint64_t hash, uint64_t value) {
+  return Mix(hash ^ (value + 0x9E3779B97F4A7C15ULL + (hash << 6)));
+}
+
+uint64_t HashString(const std::string &value) {
+  // FNV-1a.
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : value) {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+int64_t Quantize(float coordinate) {
+  return static_cast<int64_t>(
+      floorf(coordinate / ScreenFingerprint::kFrameQuantum));
+}
+
+// Adds a feature with hash @c feature to the SimHash counters @c counters.
+void AddFeature(uint64_t feature, std::array<int, 64> *counters) {
+  for (int bit = 0; bit < 64; bit++) {
+    (*counters)[bit] += (feature >> bit) & 1 ? 1 : -1;
+  }
+}
+
+uint64_t StructureHash(const AccessibilityHierarchyProto &hierarchy) {
+  std::array<int, 64> counters = {};
+  for (const UIElementProto &element : hierarchy.elements()) {
+    // Where the element is, and what and where it is, are separate features,
+    // so that an element whose class or traits change still shares a feature
+    // with its earlier self. What it is alone is not a feature: screens share
+    // a few kinds of elements, which would outweigh their differences.
+    const std::vector<std::string> &class_names =
+        element.class_names_hierarchy();
+    uint64_t kind = Combine(
+        HashString(class_names.empty() ? std::string() : class_names.back()),
+        element.ax_traits());
+    kind = Combine(kind, element.is_ax_element() ? 1 : 0);
+    Rect frame(element.ax_frame());
+    uint64_t place = Combine(Mix(Quantize(frame.origin.x)),
+                             Quantize(frame.origin.y));
+    place = Combine(place, Quantize(frame.size.width));
+    place = Combine(place, Quantize(frame.size.height));
+    AddFeature(place, &counters);
+    AddFeature(Combine(place, kind), &counters);
+  }
+  uint64_t hash = 0;
+  for (int bit = 0; bit < 64; bit++) {
+    if (counters[bit] > 0) {
+      hash |= uint64_t{1} << bit;
+    }
+  }
+  return hash;
+}
+
+// Returns the sampled coordinates along a side of @c length pixels split into
+// @c cell_count cells: the centers of kSamplesPerCellSide equal parts of each
+// cell, in increasing order.
+std::vector<int> SampleCoordinates(int length, int cell_count) {
+  const int64_t sample_count = cell_count * kSamplesPerCellSide;
+  std::vector<int> coordinates(sample_count);
+  for (int64_t i = 0; i < sample_count; i++) {
+    coordinates[i] =
+        static_cast<int>((2 * i + 1) * length / (2 * sample_count));
+  }
+  return coordinates;
+}
+
+// Returns the difference hash of a @c width by @c height screenshot, calling
+// @c sample_row(y, xs, luminances) to write the fixed point luminances of the
+// pixels at the columns @c xs of row @c y to @c luminances.
+template <typename RowSampler>
+uint64_t ImageHash(int width, int height, RowSampler sample_row) {
+  const std::vector<int> xs = SampleCoordinates(width, kImageHashColumns);
+  const std::vector<int> ys = SampleCoordinates(height, kImageHashRows);
+  // Every cell has as many samples, so their sums compare as their means do.
+  std::array<uint64_t, kImageHashColumns * kImageHashRows> sums = {};
+  std::vector<uint16_t> luminances(xs.size());
+  for (size_t i = 0; i < ys.size(); i++) {
+    sample_row(ys[i], xs, luminances.data());
+    uint64_t *row_sums =
+        sums.data() + i / kSamplesPerCellSide * kImageHashColumns;
+    for (size_t j = 0; j < xs.size(); j++) {
+      row_sums[j / kSamplesPerCellSide] += luminances[j];
+    }
+  }
+  uint64_t hash = 0;
+  int bit = 0;
+  for (int row = 0; row < kImageHashRows; row++) {
+    const uint64_t *row_sums = sums.data() + row * kImageHashColumns;
+    for (int column = 1; column < kImageHashColumns; column++) {
+      if (row_sums[column - 1] < row_sums[column]) {
+        hash |= uint64_t{1} << bit;
+      }
+      bit++;
+    }
+  }
+  return hash;
+}
+
+// Sets @c hash to the difference hash of the screenshot of @c params, read
+// from the representation that checks read, and returns true, or returns
+// false if the screenshot has no pixels.
+bool ScreenshotHash(const Parameters &params, uint64_t *hash) {
+  if (params.rle_screenshot() != nullptr) {
+    const RleImage &image = *params.rle_screenshot();
+    if (image.width() <= 0 || image.height() <= 0) {
+      return false;
+    }
+    *hash = ImageHash(
+        image.width(), image.height(),
+        [&image](int y, const std::vector<int> &xs, uint16_t *luminances) {
+          // The columns are in increasing order, so the runs holding them
+          // are found in one pass over the row.
+          const RleImage::Run *run = image.RowBegin(y);
+          const RleImage::Run *row_end = image.RowEnd(y);
+          for (size_t i = 0; i < xs.size(); i++) {
+            while (run + 1 != row_end && run[1].start <= xs[i]) {
+              run++;
+            }
+            luminances[i] = LuminancePlane::PixelLuminance(
+                Color::UnpackedColor(run->packed_color));
+          }
+        });
+  } else if (params.palette_screenshot() != nullptr) {
+    const PaletteImage &image = *params.palette_screenshot();
+    if (image.width() <= 0 || image.height() <= 0) {
+      return false;
+    }
+    *hash = ImageHash(
+        image.width(), image.height(),
+        [&image](int y, const std::vector<int> &xs, uint16_t *luminances) {
+          const int row = y * image.width();
+          for (size_t i = 0; i < xs.size(); i++) {
+            luminances[i] = LuminancePlane::PixelLuminance(
+                Color::UnpackedColor(image.PackedColorAt(row + xs[i])));
+          }
+        });
+  } else if (params.banded_screenshot() != nullptr) {
+    const BandedScreenshot &image = *params.banded_screenshot();
+    if (image.width() <= 0 || image.height() <= 0) {
+      return false;
+    }
+    *hash = ImageHash(
+        image.width(), image.height(),
+        [&image](int y, const std::vector<int> &xs, uint16_t *luminances) {
+          ScreenshotRows rows = image.Rows(y, y + 1);
+          const Pixel *pixels = rows.image().pixels;
+          for (size_t i = 0; i < xs.size(); i++) {
+            luminances[i] = LuminancePlane::PixelLuminance(pixels[xs[i]]);
+          }
+        });
+  } else {
+    const Image &image = params.screenshot();
+    if (image.pixels == nullptr || image.width <= 0 || image.height <= 0) {
+      return false;
+    }
+    *hash = ImageHash(
+        image.width, image.height,
+        [&image](int y, const std::vector<int> &xs, uint16_t *luminances) {
+          const Pixel *row =
+              image.pixels + static_cast<size_t>(y) * image.width;
+          for (size_t i = 0; i < xs.size(); i++) {
+            luminances[i] = LuminancePlane::PixelLuminance(row[xs[i]]);
+          }
+        });
+  }
+  return true;
+}
+
+}  // namespace
+
+constexpr float ScreenFingerprint::kFrameQuantum;
+constexpr size_t RecentScreenIndex::kDefaultCapacity;
+
+ScreenFingerprint ScreenFingerprint::Compute(
+    const AccessibilityHierarchyProto &hierarchy, const Parameters &params) {
+  ScreenFingerprint fingerprint;
+  fingerprint.structure_hash = StructureHash(hierarchy);
+  fingerprint.has_image = ScreenshotHash(params, &fingerprint.image_hash);
+  return fingerprint;
+}
+
+int HammingDistance(uint64_t lhs, uint64_t rhs) {
+  return __builtin_popcountll(lhs ^ rhs);
+}
+
+bool ScreenFingerprintTolerance::Matches(const ScreenFingerprint &lhs,
+                                         const ScreenFingerprint &rhs) const {
+  if (lhs.has_image != rhs.has_image) {
+    return false;
+  }
+  return HammingDistance(lhs.structure_hash, rhs.structure_hash) <=
+             max_structure_distance &&
+         HammingDistance(lhs.image_hash, rhs.image_hash) <=
+             max_image_distance;
+}
+
+RecentScreenIndex::RecentScreenIndex(size_t capacity,
+                                     ScreenFingerprintTolerance tolerance)
+    : capacity_(capacity), tolerance_(tolerance) {}
+
+bool RecentScreenIndex::Find(const ScreenFingerprint &fingerprint,
+                             EvaluationResult *result) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto closest = entries_.end();
+  int closest_distance = std::numeric_limits<int>::max();
+  for (auto entry = entries_.begin(); entry != entries_.end(); ++entry) {
+    if (!tolerance_.Matches(entry->fingerprint, fingerprint)) {
+      continue;
+    }
+    const int distance =
+        HammingDistance(entry->fingerprint.structure_hash,
+                        fingerprint.structure_hash) +
+        HammingDistance(entry->fingerprint.image_hash, fingerprint.image_hash);
+    // Strictly closer, so that the most recent screen wins ties.
+    if (distance < closest_distance) {
+      closest = entry;
+      closest_distance = distance;
+    }
+  }
+  if (closest == entries_.end()) {
+    miss_count_++;
+    return false;
+  }
+  hit_count_++;
+  entries_.splice(entries_.begin(), entries_, closest);
+  *result = entries_.front().result;
+  return true;
+}
+
+void RecentScreenIndex::Insert(const ScreenFingerprint &fingerprint,
+                               EvaluationResult result) {
+  if (capacity_ == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.push_front(Entry{fingerprint, std::move(result)});
+  while (entries_.size() > capacity_) {
+    entries_.pop_back();
+  }
+}
+
+void RecentScreenIndex::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+}
+
+size_t RecentScreenIndex::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+uint64_t RecentScreenIndex::hit_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hit_count_;
+}
+
+uint64_t RecentScreenIndex::miss_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return miss_count_;
+}
+
+}  // namespace gtx
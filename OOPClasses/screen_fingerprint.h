@@ -0,0 +1,129 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_SCREEN_FINGERPRINT_H_
+#define GTXILIB_OOPCLASSES_SCREEN_FINGERPRINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <mutex>
+
+#include "typedefs.h"
+#include "evaluation_options.h"
+#include "parameters.h"
+
+namespace gtx {
+
+// A fingerprint of a screen, from its hierarchy and its screenshot, for
+// recognizing screens that were already evaluated. Similar screens have
+// fingerprints within a small Hamming distance of each other.
+struct ScreenFingerprint {
+  // The size of the grid that frames are quantized to, in points, so that
+  // small layout changes move few bits of the structure hash.
+  static constexpr float kFrameQuantum = 8;
+
+  // A SimHash of the class name, traits and quantized frame of each element.
+  uint64_t structure_hash = 0;
+
+  // A difference hash of the screenshot: each bit says whether a cell of a 9
+  // by 8 grid of mean luminances is darker than the cell to its right.
+  uint64_t image_hash = 0;
+
+  // False if the screenshot had no pixels, in which case image_hash is 0.
+  bool has_image = false;
+
+  // Fingerprints @c hierarchy and the screenshot of @c params. The cell
+  // means of the image hash are estimated from a grid of samples of the
+  // screenshot, without computing its Parameters::luminance_plane.
+  static ScreenFingerprint Compute(const AccessibilityHierarchyProto &hierarchy,
+                                   const Parameters &params);
+};
+
+// The number of bits that differ between @c lhs and @c rhs.
+int HammingDistance(uint64_t lhs, uint64_t rhs);
+
+// How far apart two fingerprints may be for their screens to be considered
+// the same. The defaults match screens where an element moved or a small
+// region of pixels changed, and tell apart screens with different layouts,
+// whose structure hashes differ in about half of their bits.
+struct ScreenFingerprintTolerance {
+  int max_structure_distance = 8;
+  int max_image_distance = 6;
+
+  // Returns true if @c lhs and @c rhs are within this tolerance. Screens are
+  // different if only one of them has a screenshot.
+  bool Matches(const ScreenFingerprint &lhs,
+               const ScreenFingerprint &rhs) const;
+};
+
+// The results of the most recently evaluated screens, keyed by fingerprint,
+// so that an evaluation of a screen seen moments ago can return the earlier
+// results instead. Holds at most @c capacity screens and discards the least
+// recently used. Results are those of the earlier screen: element ids and
+// frames are the ones it had. Use one index per toolkit configuration, since
+// results depend on the registered checks. Thread safe.
+class RecentScreenIndex {
+ public:
+  static constexpr size_t kDefaultCapacity = 64;
+
+  explicit RecentScreenIndex(
+      size_t capacity = kDefaultCapacity,
+      ScreenFingerprintTolerance tolerance = ScreenFingerprintTolerance());
+
+  RecentScreenIndex(const RecentScreenIndex &) = delete;
+  RecentScreenIndex &operator=(const RecentScreenIndex &) = delete;
+
+  size_t capacity() const { return capacity_; }
+  const ScreenFingerprintTolerance &tolerance() const { return tolerance_; }
+
+  // Copies into @c result the results of the screen closest to
+  // @c fingerprint within the tolerance, preferring the most recent on ties,
+  // and marks that screen as used. Returns false if no screen matches.
+  bool Find(const ScreenFingerprint &fingerprint, EvaluationResult *result);
+
+  // Adds the results of a screen, discarding the least recently used screen
+  // if the index is full.
+  void Insert(const ScreenFingerprint &fingerprint, EvaluationResult result);
+
+  // Discards all screens, such as after the app's state was reset.
+  void Clear();
+
+  size_t size() const;
+
+  // The number of calls to Find that returned true, and that returned false.
+  uint64_t hit_count() const;
+  uint64_t miss_count() const;
+
+ private:
+  struct Entry {
+    ScreenFingerprint fingerprint;
+    EvaluationResult result;
+  };
+
+  const size_t capacity_;
+  const ScreenFingerprintTolerance tolerance_;
+  mutable std::mutex mutex_;
+  // Most recently used first.
+  std::list<Entry> entries_;
+  uint64_t hit_count_ = 0;
+  uint64_t miss_count_ = 0;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_SCREEN_FINGERPRINT_H_
@@ -21,17 +21,25 @@
 #include <iterator>
 #include <string>
 
+#include <abseil/absl/strings/string_view.h>
+
 namespace gtx {
 
 std::string TrimWhitespace(std::string str) {
+  return std::string(TrimWhitespaceView(str));
+}
+
+absl::string_view TrimWhitespaceView(absl::string_view str) {
+  auto is_space = [](char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+  };
   auto first_nonwhitespace_iter =
-      std::find_if_not(str.begin(), str.end(), std::isspace);
-  auto trimmed_leading = str.substr(first_nonwhitespace_iter - str.begin(),
-                                    str.end() - first_nonwhitespace_iter);
-  auto last_nonwhitespace_iter = std::find_if_not(
-      trimmed_leading.rbegin(), trimmed_leading.rend(), std::isspace);
-  return trimmed_leading.substr(
-      0, trimmed_leading.rend() - last_nonwhitespace_iter);
+      std::find_if_not(str.begin(), str.end(), is_space);
+  str.remove_prefix(first_nonwhitespace_iter - str.begin());
+  auto last_nonwhitespace_iter =
+      std::find_if_not(str.rbegin(), str.rend(), is_space);
+  str.remove_suffix(last_nonwhitespace_iter - str.rbegin());
+  return str;
 }
 
 }  // namespace gtx
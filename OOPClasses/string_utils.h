@@ -16,9 +16,15 @@
 
 #import <string>
 
+#include <abseil/absl/strings/string_view.h>
+
 namespace gtx {
 
 // Returns the given string with all leading and trailing whitespace removed.
 std::string TrimWhitespace(std::string str);
 
+// Like TrimWhitespace, but returns a view of @c str instead of a copy, for
+// checks that only inspect the trimmed string.
+absl::string_view TrimWhitespaceView(absl::string_view str);
+
 }  // namespace gtx
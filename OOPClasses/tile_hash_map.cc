@@ -0,0 +1,191 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "tile_hash_map.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "gtx_types.h"
+
+namespace gtx {
+
+namespace {
+
+// The primes and rounds of xxHash64, whose four independent lanes keep the
+// multipliers of a superscalar or vectorizing CPU busy.
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t RotateLeft(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t Round(uint64_t lane, uint64_t word) {
+  return RotateLeft(lane + word * kPrime2, 31) * kPrime1;
+}
+
+inline uint64_t ReadWord(const unsigned char *bytes) {
+  uint64_t word;
+  memcpy(&word, bytes, sizeof(word));
+  return word;
+}
+
+// The hash state of one tile, fed one row of its pixels at a time.
+struct TileHasher {
+  uint64_t lanes[4] = {kPrime1 + kPrime2, kPrime2, 0, 0 - kPrime1};
+
+  void Update(const unsigned char *bytes, size_t size) {
+    const unsigned char *end = bytes + size;
+    for (; end - bytes >= 32; bytes += 32) {
+      lanes[0] = Round(lanes[0], ReadWord(bytes));
+      lanes[1] = Round(lanes[1], ReadWord(bytes + 8));
+      lanes[2] = Round(lanes[2], ReadWord(bytes + 16));
+      lanes[3] = Round(lanes[3], ReadWord(bytes + 24));
+    }
+    for (int lane = 0; end - bytes >= 8; bytes += 8, lane++) {
+      lanes[lane] = Round(lanes[lane], ReadWord(bytes));
+    }
+    if (bytes < end) {
+      // Pixels are 4 bytes, so at most one is left.
+      uint32_t word;
+      memcpy(&word, bytes, sizeof(word));
+      lanes[3] = Round(lanes[3], word ^ kPrime3);
+    }
+  }
+
+  uint64_t Finish() const {
+    uint64_t hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) +
+                    RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+    for (uint64_t lane : lanes) {
+      hash = (hash ^ Round(0, lane)) * kPrime1 + kPrime4;
+    }
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash ^ kPrime5;
+  }
+};
+
+}  // namespace
+
+TileHashMap TileHashMap::FromImage(const Image &image, int tile_size) {
+  TileHashMap map;
+  if (image.pixels == nullptr) {
+    return map;
+  }
+  map.width_ = std::max(0, image.width);
+  map.height_ = std::max(0, image.height);
+  map.tile_size_ = std::max(1, tile_size);
+  map.columns_ = (map.width_ + map.tile_size_ - 1) / map.tile_size_;
+  map.rows_ = (map.height_ + map.tile_size_ - 1) / map.tile_size_;
+  map.hashes_.reserve(static_cast<size_t>(map.columns_) * map.rows_);
+  // Rows of pixels are hashed in memory order, into the hashers of the tiles
+  // in the current row of tiles.
+  std::vector<TileHasher> hashers;
+  for (int tile_row = 0; tile_row < map.rows_; tile_row++) {
+    hashers.assign(map.columns_, TileHasher());
+    const int y_end = std::min(map.height_, (tile_row + 1) * map.tile_size_);
+    for (int y = tile_row * map.tile_size_; y < y_end; y++) {
+      const unsigned char *row = reinterpret_cast<const unsigned char *>(
+          image.pixels + static_cast<size_t>(y) * map.width_);
+      for (int column = 0; column < map.columns_; column++) {
+        const int x = column * map.tile_size_;
+        const int tile_width = std::min(map.tile_size_, map.width_ - x);
+        hashers[column].Update(row + static_cast<size_t>(x) * sizeof(Pixel),
+                               static_cast<size_t>(tile_width) * sizeof(Pixel));
+      }
+    }
+    for (const TileHasher &hasher : hashers) {
+      map.hashes_.push_back(hasher.Finish());
+    }
+  }
+  return map;
+}
+
+bool TileHashMap::IsIdentical(const TileHashMap &other) const {
+  return HasSameTiles(other) && hashes_ == other.hashes_;
+}
+
+std::vector<Rect> TileHashMap::ChangedRects(
+    const TileHashMap &previous) const {
+  if (!HasSameTiles(previous)) {
+    if (width_ == 0 || height_ == 0) {
+      return {};
+    }
+    return {Rect(0, 0, width_, height_)};
+  }
+  std::vector<Rect> changed_rects;
+  for (int row = 0; row < rows_; row++) {
+    const int y = row * tile_size_;
+    const int tile_height = std::min(tile_size_, height_ - y);
+    int column = 0;
+    while (column < columns_) {
+      const size_t index = static_cast<size_t>(row) * columns_ + column;
+      if (hashes_[index] == previous.hashes_[index]) {
+        column++;
+        continue;
+      }
+      int end = column + 1;
+      while (end < columns_ && hashes_[index + end - column] !=
+                                   previous.hashes_[index + end - column]) {
+        end++;
+      }
+      const int x = column * tile_size_;
+      const int x_end = std::min(width_, end * tile_size_);
+      changed_rects.emplace_back(x, y, x_end - x, tile_height);
+      column = end;
+    }
+  }
+  return changed_rects;
+}
+
+bool TileHashMap::IsRectUnchanged(const TileHashMap &previous,
+                                  const Rect &rect) const {
+  if (!HasSameTiles(previous)) {
+    return false;
+  }
+  const int x_begin = std::max(0, static_cast<int>(floorf(rect.origin.x)));
+  const int y_begin = std::max(0, static_cast<int>(floorf(rect.origin.y)));
+  const int x_end = std::min(width_, static_cast<int>(ceilf(rect.GetMaxX())));
+  const int y_end = std::min(height_, static_cast<int>(ceilf(rect.GetMaxY())));
+  if (x_begin >= x_end || y_begin >= y_end) {
+    return true;
+  }
+  const int column_end = (x_end + tile_size_ - 1) / tile_size_;
+  const int row_end = (y_end + tile_size_ - 1) / tile_size_;
+  for (int row = y_begin / tile_size_; row < row_end; row++) {
+    for (int column = x_begin / tile_size_; column < column_end; column++) {
+      const size_t index = static_cast<size_t>(row) * columns_ + column;
+      if (hashes_[index] != previous.hashes_[index]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace gtx
@@ -0,0 +1,97 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_TILE_HASH_MAP_H_
+#define GTXILIB_OOPCLASSES_TILE_HASH_MAP_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "gtx_types.h"
+
+namespace gtx {
+
+// A hash of each square tile of an image, to find the regions that changed
+// between two screenshots without comparing their pixels. Consecutive
+// screenshots of a UI test usually differ in a small region, so image checks
+// can reuse their previous results for elements whose frames touch only
+// unchanged tiles, and a crawler can skip screens that did not change.
+//
+// Hashes are 64 bit and not cryptographic: a changed tile has a 2^-64 chance
+// of hashing as unchanged.
+class TileHashMap {
+ public:
+  // The width and height of tiles in pixels, unless given otherwise.
+  static constexpr int kDefaultTileSize = 32;
+
+  // Constructs an empty map.
+  TileHashMap() {}
+
+  // Hashes the tiles of @c image, which are @c tile_size pixels square,
+  // except at its right and bottom edges. Returns an empty map if @c image
+  // has no pixels.
+  static TileHashMap FromImage(const Image &image,
+                               int tile_size = kDefaultTileSize);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  int tile_size() const { return tile_size_; }
+
+  // The number of tiles across and down the image.
+  int columns() const { return columns_; }
+  int rows() const { return rows_; }
+
+  // Returns the hash of the tile at @c column, @c row.
+  uint64_t TileHash(int column, int row) const {
+    return hashes_[column + row * columns_];
+  }
+
+  // Returns true if @c other hashes an image of the same size with the same
+  // tiles, and all its tiles are the same.
+  bool IsIdentical(const TileHashMap &other) const;
+
+  // Returns the rects, in pixels, of the tiles of this image that differ from
+  // those of @c previous. Changed tiles that are adjacent in a row of tiles
+  // are merged into one rect. If @c previous hashes an image of another size
+  // or with other tiles, returns the bounds of the whole image.
+  std::vector<Rect> ChangedRects(const TileHashMap &previous) const;
+
+  // Returns true if every tile that @c rect, in pixels, overlaps is the same
+  // in @c previous. Parts of @c rect outside the image are ignored. Callers
+  // with a frame in points convert it with
+  // Parameters::ConvertRectToScreenshotSpace.
+  bool IsRectUnchanged(const TileHashMap &previous, const Rect &rect) const;
+
+ private:
+  // Returns true if @c other has the same dimensions and tiles.
+  bool HasSameTiles(const TileHashMap &other) const {
+    return width_ == other.width_ && height_ == other.height_ &&
+           tile_size_ == other.tile_size_;
+  }
+
+  int width_ = 0;
+  int height_ = 0;
+  int tile_size_ = kDefaultTileSize;
+  int columns_ = 0;
+  int rows_ = 0;
+  // The hash of each tile, row by row.
+  std::vector<uint64_t> hashes_;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_TILE_HASH_MAP_H_
@@ -17,24 +17,122 @@
 #include "toolkit.h"
 
 #include <assert.h>
+#include <math.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include <abseil/absl/types/optional.h>
+#include "hierarchy_snapshot.h"
 #include "typedefs.h"
 #include "accessibility_label_not_punctuated_check.h"
+#include "allocation_tracker.h"
 #include "check.h"
 #include "contrast_check.h"
+#include "evaluation_metrics.h"
+#include "evaluation_options.h"
+#include "executor.h"
+#include "hierarchy_table.h"
+#include "hierarchy_visibility.h"
 #include "minimum_tappable_area_check.h"
 #include "no_label_check.h"
 #include "parameters.h"
+#include "record_stream.h"
+#include "sampling.h"
+#include "scratch_arena.h"
+#include "screen_fingerprint.h"
+#include "tracer.h"
+#include "work_stealing_queues.h"
 
 namespace gtx {
 
+namespace {
+
+// The number of elements in each chunk CheckElements traces as a span.
+constexpr int kElementsPerTraceChunk = 256;
+
+// The number of elements CheckElements checks between reads of the
+// EvaluationBudget. A power of two that divides kElementsPerTraceChunk.
+constexpr int kElementsPerBudgetCheck = 8;
+
+// The number of elements in each batch checked on a HierarchyTable when the
+// evaluation can stop early.
+constexpr int kElementsPerBoundedTableBatch = 64;
+
+// A result of Toolkit::CheckElementsInStages, with the element and the check
+// it was found by, to merge the results of both stages in the order of
+// CheckElements.
+struct StagedCheckResult {
+  int element_index;
+  size_t check_index;
+  CheckResultProto check_result;
+};
+
+// Returns the number of screenshot pixels under @c element, which estimates
+// the cost of image checks on it. At least 1, so that elements without a
+// screenshot are still distributed evenly.
+uint64_t EstimatedPixelArea(const UIElementProto &element,
+                            const Parameters &params) {
+  const Image &screenshot = params.screenshot();
+  if (!params.HasScreenshotPixels() || params.device_bounds().IsEmpty()) {
+    return 1;
+  }
+  Rect frame = params.ConvertRectToScreenshotSpace(Rect(element.ax_frame()))
+                   .Intersection(Rect(0, 0, screenshot.width,
+                                      screenshot.height));
+  double area = fabs(frame.size.width * frame.size.height);
+  return area >= 1 ? static_cast<uint64_t>(area) : 1;
+}
+
+// The state of the image stage of Toolkit::CheckElementsInStages that its
+// threads share. Helper tasks own it jointly with the calling thread, since
+// an executor may start them after the stage has ended.
+struct ImageStage {
+  ImageStage(int queue_count, const std::vector<int> &items,
+             const std::vector<uint64_t> &costs)
+      : queues(queue_count, items, costs) {}
+
+  WorkStealingQueues queues;
+  std::mutex mutex;
+  std::condition_variable workers_changed;
+  // The number of helpers running work.
+  int active_workers = 0;
+  // Set once the calling thread has run out of work. Helpers that start
+  // afterwards return without calling work, which may no longer be valid.
+  bool closed = false;
+  // Checks the elements of the queue it is given, and steals from the others.
+  std::function<void(int)> work;
+};
+
+// Runs the work of @c stage for @c queue on a thread of the executor.
+void RunImageStageHelper(const std::shared_ptr<ImageStage> &stage, int queue) {
+  {
+    std::lock_guard<std::mutex> lock(stage->mutex);
+    if (stage->closed) {
+      return;
+    }
+    stage->active_workers++;
+  }
+  stage->work(queue);
+  {
+    std::lock_guard<std::mutex> lock(stage->mutex);
+    stage->active_workers--;
+  }
+  stage->workers_changed.notify_all();
+}
+
+}  // namespace
+
 std::unique_ptr<Toolkit> Toolkit::ToolkitWithAllDefaultChecks() {
   auto toolkit = std::make_unique<Toolkit>();
   std::unique_ptr<gtx::Check> no_label_check = std::make_unique<NoLabelCheck>();
@@ -64,10 +162,54 @@ bool Toolkit::RegisterCheck(std::unique_ptr<Check> &check) {
     }
   }
 
+  if (metrics_ != nullptr) {
+    check_counters_.push_back(metrics_->CountersForCheck(check_name));
+  }
+  if (tracer_ != nullptr) {
+    check_span_names_.push_back(tracer_->InternName(check_name));
+  }
   registered_checks_.push_back(std::move(check));
   return true;
 }
 
+void Toolkit::set_metrics(EvaluationMetrics *metrics) {
+  metrics_ = metrics;
+  check_counters_.clear();
+  if (metrics_ != nullptr) {
+    for (const auto &check : registered_checks_) {
+      check_counters_.push_back(metrics_->CountersForCheck(check->name()));
+    }
+  }
+}
+
+void Toolkit::set_image_check_executor(Executor *executor, int parallelism) {
+  image_check_executor_ = executor;
+  if (parallelism <= 0) {
+    parallelism =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  image_check_parallelism_ = parallelism;
+}
+
+void Toolkit::set_tracer(Tracer *tracer) {
+  tracer_ = tracer;
+  check_span_names_.clear();
+  if (tracer_ != nullptr) {
+    for (const auto &check : registered_checks_) {
+      check_span_names_.push_back(tracer_->InternName(check->name()));
+    }
+  }
+}
+
+void Toolkit::RecordSkips(uint64_t count) {
+  if (metrics_ == nullptr || count == 0) {
+    return;
+  }
+  for (CheckCounters *counters : check_counters_) {
+    counters->RecordSkips(count);
+  }
+}
+
 const gtx::Check &Toolkit::GetRegisteredCheckNamed(
     const std::string &check_name) const {
   for (auto &check : registered_checks_) {
@@ -83,31 +225,643 @@ const gtx::Check &Toolkit::GetRegisteredCheckNamed(
 std::vector<CheckResultProto> Toolkit::CheckElement(
     const UIElementProto &element, const Parameters &params) {
   std::vector<CheckResultProto> result;
+  AppendElementResults(element, params, &result);
+  return result;
+}
+
+bool Toolkit::CanRunCheck(size_t check_index,
+                          const Parameters &params) const {
+  return params.HasScreenshotPixels() ||
+         registered_checks_[check_index]->CostClass() != CheckCostClass::kImage;
+}
+
+void Toolkit::AppendElementResults(const UIElementProto &element,
+                                   const Parameters &params,
+                                   std::vector<CheckResultProto> *results) {
   if (!element.is_ax_element()) {
     // Currently all checks are only applicable to accessibility elements.
-    return result;
+    RecordSkips(1);
+    return;
   }
 
-  for (const auto &check : registered_checks_) {
+  absl::optional<ScopedCurrentTracer> current_tracer;
+  if (tracer_ != nullptr) {
+    current_tracer.emplace(tracer_);
+  }
+  ScopedScratchArena scratch_arena(&scratch_arenas_);
+  for (size_t i = 0; i < registered_checks_.size(); i++) {
+    if (!CanRunCheck(i, params)) {
+      continue;
+    }
     absl::optional<CheckResultProto> check_result =
-        check->CheckElement(element, params);
+        RunCheck(i, element, params);
     if (check_result.has_value()) {
-      result.push_back(*check_result);
+      results->push_back(*std::move(check_result));
     }
   }
-  return result;
+}
+
+template <typename Invoke>
+bool Toolkit::RunInstrumented(size_t check_index, int32_t element_id,
+                              const Invoke &invoke) {
+  if (metrics_ == nullptr && tracer_ == nullptr) {
+    return invoke();
+  }
+  ScopedAllocationCounter allocations(metrics_ != nullptr &&
+                                      AllocationTrackingEnabled());
+  // Metrics and traces share the steady clock.
+  uint64_t start_nanoseconds = TraceClockNanoseconds();
+  const bool failed = invoke();
+  uint64_t nanoseconds = TraceClockNanoseconds() - start_nanoseconds;
+  if (metrics_ != nullptr) {
+    check_counters_[check_index]->RecordInvocation(nanoseconds, failed);
+    if (allocations.active()) {
+      check_counters_[check_index]->RecordAllocations(allocations.Counts());
+    }
+  }
+  if (tracer_ != nullptr &&
+      nanoseconds >= tracer_->options().min_check_span_nanoseconds) {
+    tracer_->AddSpan(check_span_names_[check_index], "check",
+                     start_nanoseconds, nanoseconds, "element_id", element_id);
+  }
+  return failed;
+}
+
+absl::optional<CheckResultProto> Toolkit::RunCheck(
+    size_t check_index, const UIElementProto &element,
+    const Parameters &params) {
+  const Check &check = *registered_checks_[check_index];
+  if (metrics_ == nullptr && tracer_ == nullptr) {
+    return check.CheckElement(element, params);
+  }
+  absl::optional<CheckResultProto> check_result;
+  RunInstrumented(check_index, element.id(), [&]() {
+    check_result = check.CheckElement(element, params);
+    return check_result.has_value();
+  });
+  return check_result;
+}
+
+bool Toolkit::RunCheckCompact(size_t check_index,
+                              const UIElementProto &element,
+                              const Parameters &params,
+                              CompactCheckResult *result) {
+  const Check &check = *registered_checks_[check_index];
+  return RunInstrumented(check_index, element.id(), [&]() {
+    return check.CheckElementCompact(element, params, result);
+  });
 }
 
 std::vector<CheckResultProto> Toolkit::CheckElements(
     const AccessibilityHierarchyProto &root_element, const Parameters &params) {
-  std::vector<CheckResultProto> result;
-  for (const auto &element : root_element.elements()) {
-    auto errors = CheckElement(element, params);
-    if (!errors.empty()) {
-      result.insert(result.end(), errors.begin(), errors.end());
+  return CheckElements(root_element, params, EvaluationOptions()).results;
+}
+
+EvaluationResult Toolkit::CheckElements(
+    const AccessibilityHierarchyProto &root_element, const Parameters &params,
+    const EvaluationOptions &options) {
+  const int element_count = root_element.elements_size();
+  ScopedTraceSpan span(tracer_, "CheckElements", "evaluation", "elements",
+                       element_count);
+  ScopedScratchArena scratch_arena(&scratch_arenas_);
+  EvaluationResult result;
+  result.element_count = element_count;
+  EvaluationBudget budget(options);
+  absl::optional<HierarchyVisibility> visibility;
+  if (skips_invisible_elements_) {
+    ScopedPhaseTimer timer(metrics_, EvaluationPhase::kClassify);
+    ScopedTraceSpan classify_span(tracer_, "Classify", "evaluation");
+    visibility.emplace(root_element, params.device_bounds());
+  }
+  if (image_check_executor_ != nullptr) {
+    return CheckElementsInStages(
+        root_element, params, options,
+        visibility.has_value() ? &*visibility : nullptr);
+  }
+  ScopedPhaseTimer timer(metrics_, EvaluationPhase::kCheck);
+  for (int chunk_start = 0; chunk_start < element_count;
+       chunk_start += kElementsPerTraceChunk) {
+    ScopedTraceSpan chunk_span(tracer_, "CheckChunk", "evaluation",
+                               "first_element", chunk_start);
+    const int chunk_end =
+        std::min(element_count, chunk_start + kElementsPerTraceChunk);
+    for (int i = chunk_start; i < chunk_end; i++) {
+      if (i % kElementsPerBudgetCheck == 0 && budget.IsExhausted()) {
+        result.status = budget.status();
+        result.elements_evaluated = i;
+        return result;
+      }
+      if (visibility.has_value() && !visibility->IsElementAtIndexVisible(i)) {
+        RecordSkips(1);
+        continue;
+      }
+      AppendElementResults(root_element.elements(i), params, &result.results);
     }
   }
+  result.elements_evaluated = element_count;
   return result;
 }
 
+EvaluationResult Toolkit::CheckElements(
+    const AccessibilityHierarchyProto &root_element, const Parameters &params,
+    const EvaluationOptions &options, RecentScreenIndex *index,
+    bool *reused) {
+  ScreenFingerprint fingerprint;
+  {
+    ScopedTraceSpan span(tracer_, "FingerprintScreen", "evaluation");
+    fingerprint = ScreenFingerprint::Compute(root_element, params);
+  }
+  EvaluationResult result;
+  const bool found = index->Find(fingerprint, &result);
+  if (reused != nullptr) {
+    *reused = found;
+  }
+  if (found) {
+    return result;
+  }
+  result = CheckElements(root_element, params, options);
+  if (result.complete()) {
+    index->Insert(fingerprint, result);
+  }
+  return result;
+}
+
+template <typename Emit>
+void Toolkit::EmitCompactResults(
+    const AccessibilityHierarchyProto &root_element, const Parameters &params,
+    const Emit &emit) {
+  const int element_count = root_element.elements_size();
+  ScopedTraceSpan span(tracer_, "CheckElementsCompact", "evaluation",
+                       "elements", element_count);
+  ScopedScratchArena scratch_arena(&scratch_arenas_);
+  absl::optional<HierarchyVisibility> visibility;
+  if (skips_invisible_elements_) {
+    ScopedPhaseTimer timer(metrics_, EvaluationPhase::kClassify);
+    ScopedTraceSpan classify_span(tracer_, "Classify", "evaluation");
+    visibility.emplace(root_element, params.device_bounds());
+  }
+  ScopedPhaseTimer timer(metrics_, EvaluationPhase::kCheck);
+  absl::optional<ScopedCurrentTracer> current_tracer;
+  if (tracer_ != nullptr) {
+    current_tracer.emplace(tracer_);
+  }
+  for (int i = 0; i < element_count; i++) {
+    const UIElementProto &element = root_element.elements(i);
+    if ((visibility.has_value() && !visibility->IsElementAtIndexVisible(i)) ||
+        !element.is_ax_element()) {
+      RecordSkips(1);
+      continue;
+    }
+    for (size_t j = 0; j < registered_checks_.size(); j++) {
+      if (!CanRunCheck(j, params)) {
+        continue;
+      }
+      CompactCheckResult result;
+      if (RunCheckCompact(j, element, params, &result)) {
+        result.check_index = static_cast<int32_t>(j);
+        result.element_id = element.id();
+        result.element_index = i;
+        emit(result);
+      }
+    }
+  }
+}
+
+std::vector<CompactCheckResult> Toolkit::CheckElementsCompact(
+    const AccessibilityHierarchyProto &root_element, const Parameters &params) {
+  std::vector<CompactCheckResult> results;
+  EmitCompactResults(root_element, params,
+                     [&results](const CompactCheckResult &result) {
+                       results.push_back(result);
+                     });
+  return results;
+}
+
+CheckResultProto Toolkit::ToCheckResultProto(
+    const CompactCheckResult &result,
+    const AccessibilityHierarchyProto &root_element,
+    const Parameters &params) const {
+  return registered_checks_[result.check_index]->ExpandCompactResult(
+      result, root_element.elements(result.element_index), params);
+}
+
+CheckResultCounts Toolkit::CountCheckResults(
+    const AccessibilityHierarchyProto &root_element, const Parameters &params) {
+  CheckResultCounts counts;
+  counts.Reserve(static_cast<int>(registered_checks_.size()));
+  EmitCompactResults(root_element, params,
+                     [&counts](const CompactCheckResult &result) {
+                       counts.Record(result.check_index, result.result_id);
+                     });
+  return counts;
+}
+
+SampledEvaluationResult Toolkit::CheckElementsSampled(
+    const AccessibilityHierarchyProto &root_element, const Parameters &params,
+    const SamplingOptions &options) {
+  const int element_count = root_element.elements_size();
+  ScopedTraceSpan span(tracer_, "CheckElementsSampled", "evaluation",
+                       "elements", element_count);
+  ScopedScratchArena scratch_arena(&scratch_arenas_);
+  SampledEvaluationResult result;
+  SamplingCoverage &coverage = result.coverage;
+  coverage.element_count = element_count;
+  EvaluationBudget budget(options.evaluation_options);
+  SamplingPlan plan;
+  {
+    ScopedPhaseTimer timer(metrics_, EvaluationPhase::kClassify);
+    ScopedTraceSpan classify_span(tracer_, "Classify", "evaluation");
+    absl::optional<HierarchyVisibility> visibility;
+    if (skips_invisible_elements_) {
+      visibility.emplace(root_element, params.device_bounds());
+    }
+    std::vector<int> candidate_indices;
+    for (int i = 0; i < element_count; i++) {
+      if (root_element.elements(i).is_ax_element() &&
+          (!visibility.has_value() || visibility->IsElementAtIndexVisible(i))) {
+        candidate_indices.push_back(i);
+      }
+    }
+    plan = SamplingPlan::Create(root_element, candidate_indices, params,
+                                options);
+  }
+  coverage.candidate_count = static_cast<int>(plan.element_indices.size());
+  for (size_t i = 0; i < plan.stratum_names.size(); i++) {
+    StratumCoverage stratum;
+    stratum.stratum = plan.stratum_names[i];
+    stratum.element_count = plan.stratum_sizes[i];
+    coverage.strata.push_back(stratum);
+  }
+  int sample_size = coverage.candidate_count;
+  if (options.max_elements > 0) {
+    sample_size = std::min(sample_size, options.max_elements);
+  }
+
+  ScopedPhaseTimer timer(metrics_, EvaluationPhase::kCheck);
+  // The results of the evaluated elements, to put them in hierarchy order.
+  std::vector<IndexedCheckResult> indexed_results;
+  std::vector<CheckResultProto> element_results;
+  for (int i = 0; i < sample_size; i++) {
+    if (i % kElementsPerBudgetCheck == 0 && budget.IsExhausted()) {
+      result.status = budget.status();
+      break;
+    }
+    int element_index = plan.element_indices[i];
+    element_results.clear();
+    AppendElementResults(root_element.elements(element_index), params,
+                         &element_results);
+    for (CheckResultProto &element_result : element_results) {
+      indexed_results.push_back({element_index, std::move(element_result)});
+    }
+    coverage.evaluated_count++;
+    coverage.evaluated_score += plan.scores[i];
+    coverage.strata[plan.strata[i]].evaluated_count++;
+  }
+  RecordSkips(element_count - coverage.evaluated_count);
+  for (double score : plan.scores) {
+    coverage.total_score += score;
+  }
+  // Stable sorting keeps the checks of each element in registration order.
+  std::stable_sort(indexed_results.begin(), indexed_results.end(),
+                   [](const IndexedCheckResult &lhs,
+                      const IndexedCheckResult &rhs) {
+                     return lhs.element_index < rhs.element_index;
+                   });
+  result.results.reserve(indexed_results.size());
+  for (IndexedCheckResult &indexed_result : indexed_results) {
+    result.results.push_back(std::move(indexed_result.check_result));
+  }
+  return result;
+}
+
+std::future<EvaluationResult> Toolkit::CheckElementsAsync(
+    AccessibilityHierarchyProto hierarchy, const Parameters &params,
+    const EvaluationOptions &options, Executor *executor) {
+  // std::function must be copyable, so the promise is shared.
+  auto promise = std::make_shared<std::promise<EvaluationResult>>();
+  std::future<EvaluationResult> future = promise->get_future();
+  CheckElementsAsync(std::move(hierarchy), params, options, executor,
+                     [promise](EvaluationResult result) {
+                       promise->set_value(std::move(result));
+                     });
+  return future;
+}
+
+void Toolkit::CheckElementsAsync(AccessibilityHierarchyProto hierarchy,
+                                 const Parameters &params,
+                                 const EvaluationOptions &options,
+                                 Executor *executor,
+                                 std::function<void(EvaluationResult)> done) {
+  if (executor == nullptr) {
+    executor = ThreadPoolExecutor::Default();
+  }
+  executor->Execute([this, hierarchy = std::move(hierarchy), params, options,
+                     done = std::move(done)] {
+    done(CheckElements(hierarchy, params, options));
+  });
+}
+
+EvaluationResult Toolkit::CheckElementsInStages(
+    const AccessibilityHierarchyProto &root_element, const Parameters &params,
+    const EvaluationOptions &options, const HierarchyVisibility *visibility) {
+  const int element_count = root_element.elements_size();
+  EvaluationResult result;
+  result.element_count = element_count;
+  result.elements_evaluated = element_count;
+  ScopedPhaseTimer timer(metrics_, EvaluationPhase::kCheck);
+  std::vector<size_t> metadata_checks;
+  std::vector<size_t> image_checks;
+  for (size_t i = 0; i < registered_checks_.size(); i++) {
+    if (registered_checks_[i]->CostClass() == CheckCostClass::kImage) {
+      if (CanRunCheck(i, params)) {
+        image_checks.push_back(i);
+      }
+    } else {
+      metadata_checks.push_back(i);
+    }
+  }
+
+  // The first stage runs the metadata checks and collects the elements the
+  // image checks apply to, with their estimated cost.
+  std::vector<StagedCheckResult> staged_results;
+  std::vector<int> image_elements;
+  std::vector<uint64_t> image_costs;
+  {
+    ScopedTraceSpan span(tracer_, "MetadataChecks", "evaluation", "elements",
+                         element_count);
+    absl::optional<ScopedCurrentTracer> current_tracer;
+    if (tracer_ != nullptr) {
+      current_tracer.emplace(tracer_);
+    }
+    EvaluationBudget budget(options);
+    for (int i = 0; i < element_count; i++) {
+      if (i % kElementsPerBudgetCheck == 0 && budget.IsExhausted()) {
+        result.status = budget.status();
+        result.elements_evaluated = i;
+        break;
+      }
+      const UIElementProto &element = root_element.elements(i);
+      // Currently all checks are only applicable to accessibility elements.
+      if (!element.is_ax_element() ||
+          (visibility != nullptr && !visibility->IsElementAtIndexVisible(i))) {
+        RecordSkips(1);
+        continue;
+      }
+      for (size_t check_index : metadata_checks) {
+        absl::optional<CheckResultProto> check_result =
+            RunCheck(check_index, element, params);
+        if (check_result.has_value()) {
+          staged_results.push_back({i, check_index, std::move(*check_result)});
+        }
+      }
+      if (!image_checks.empty()) {
+        image_elements.push_back(i);
+        image_costs.push_back(EstimatedPixelArea(element, params));
+      }
+    }
+  }
+
+  // The second stage runs the image checks, on the calling thread and on
+  // helpers of the executor, each with a queue of about the same total cost.
+  const int item_count = static_cast<int>(image_elements.size());
+  std::vector<std::vector<StagedCheckResult>> item_results(item_count);
+  std::vector<char> item_done(item_count, 0);
+  if (item_count > 0 && result.complete()) {
+    std::vector<int> items(item_count);
+    for (int i = 0; i < item_count; i++) {
+      items[i] = i;
+    }
+    const int queue_count = std::min(image_check_parallelism_, item_count);
+    auto stage = std::make_shared<ImageStage>(queue_count, items, image_costs);
+    std::atomic<bool> stopped{false};
+    std::atomic<EvaluationStatus> stop_status{EvaluationStatus::kComplete};
+    stage->work = [this, &root_element, &params, &options, &image_checks,
+                   &image_elements, &item_results, &item_done, &stopped,
+                   &stop_status, &stage](int queue) {
+      ScopedTraceSpan span(tracer_, "ImageChecks", "evaluation", "queue",
+                           queue);
+      ScopedScratchArena scratch_arena(&scratch_arenas_);
+      absl::optional<ScopedCurrentTracer> current_tracer;
+      if (tracer_ != nullptr) {
+        current_tracer.emplace(tracer_);
+      }
+      EvaluationBudget budget(options);
+      int item;
+      while (!stopped.load(std::memory_order_relaxed) &&
+             stage->queues.Pop(queue, &item)) {
+        if (budget.IsExhausted()) {
+          stop_status.store(budget.status(), std::memory_order_relaxed);
+          stopped.store(true, std::memory_order_relaxed);
+          break;
+        }
+        const int element_index = image_elements[item];
+        const UIElementProto &element = root_element.elements(element_index);
+        for (size_t check_index : image_checks) {
+          absl::optional<CheckResultProto> check_result =
+              RunCheck(check_index, element, params);
+          if (check_result.has_value()) {
+            item_results[item].push_back(
+                {element_index, check_index, std::move(*check_result)});
+          }
+        }
+        item_done[item] = 1;
+      }
+    };
+    for (int queue = 1; queue < queue_count; queue++) {
+      image_check_executor_->Execute(
+          [stage, queue] { RunImageStageHelper(stage, queue); });
+    }
+    stage->work(0);
+    {
+      std::unique_lock<std::mutex> lock(stage->mutex);
+      stage->closed = true;
+      stage->workers_changed.wait(
+          lock, [&stage] { return stage->active_workers == 0; });
+    }
+    stage->work = nullptr;
+    if (stopped.load()) {
+      result.status = stop_status.load();
+    }
+  }
+
+  // Results cover the elements before the first one whose image checks did
+  // not run.
+  for (int i = 0; i < item_count; i++) {
+    if (!item_done[i]) {
+      result.elements_evaluated =
+          std::min(result.elements_evaluated, image_elements[i]);
+      break;
+    }
+  }
+  for (std::vector<StagedCheckResult> &results : item_results) {
+    for (StagedCheckResult &staged_result : results) {
+      staged_results.push_back(std::move(staged_result));
+    }
+  }
+  std::stable_sort(staged_results.begin(), staged_results.end(),
+                   [](const StagedCheckResult &lhs,
+                      const StagedCheckResult &rhs) {
+                     return lhs.element_index != rhs.element_index
+                                ? lhs.element_index < rhs.element_index
+                                : lhs.check_index < rhs.check_index;
+                   });
+  for (StagedCheckResult &staged_result : staged_results) {
+    if (staged_result.element_index >= result.elements_evaluated) {
+      break;
+    }
+    result.results.push_back(std::move(staged_result.check_result));
+  }
+  return result;
+}
+
+std::vector<CheckResultProto> Toolkit::CheckElements(
+    const HierarchyTable &table, const Parameters &params) {
+  return CheckElements(table, params, EvaluationOptions()).results;
+}
+
+EvaluationResult Toolkit::CheckElements(const HierarchyTable &table,
+                                        const Parameters &params,
+                                        const EvaluationOptions &options) {
+  ScopedTraceSpan span(tracer_, "CheckElementsInTable", "evaluation",
+                       "elements", table.size());
+  ScopedScratchArena scratch_arena(&scratch_arenas_);
+  absl::optional<ScopedCurrentTracer> current_tracer;
+  if (tracer_ != nullptr) {
+    current_tracer.emplace(tracer_);
+  }
+  EvaluationResult result;
+  result.element_count = table.size();
+  EvaluationBudget budget(options);
+  std::vector<int> element_indices;
+  {
+    ScopedPhaseTimer timer(metrics_, EvaluationPhase::kClassify);
+    ScopedTraceSpan classify_span(tracer_, "Classify", "evaluation");
+    absl::optional<HierarchyVisibility> visibility;
+    if (skips_invisible_elements_) {
+      visibility.emplace(table, params.device_bounds());
+    }
+    // Currently all checks are only applicable to accessibility elements.
+    for (int i = 0; i < table.size(); i++) {
+      if (!table.HasFlag(i, HierarchyTable::kIsAXElement)) {
+        continue;
+      }
+      if (visibility.has_value() && !visibility->IsElementAtIndexVisible(i)) {
+        continue;
+      }
+      element_indices.push_back(i);
+    }
+  }
+  RecordSkips(table.size() - element_indices.size());
+
+  ScopedPhaseTimer timer(metrics_, EvaluationPhase::kCheck);
+  std::vector<IndexedCheckResult> indexed_results;
+  result.elements_evaluated = table.size();
+  if (!options.IsBounded()) {
+    CheckBatchInTable(table, element_indices, params, &indexed_results);
+  } else {
+    std::vector<int> batch_indices;
+    for (size_t batch_start = 0; batch_start < element_indices.size();
+         batch_start += kElementsPerBoundedTableBatch) {
+      if (budget.IsExhausted()) {
+        result.status = budget.status();
+        result.elements_evaluated = element_indices[batch_start];
+        break;
+      }
+      const size_t batch_end = std::min(
+          element_indices.size(), batch_start + kElementsPerBoundedTableBatch);
+      batch_indices.assign(element_indices.begin() + batch_start,
+                           element_indices.begin() + batch_end);
+      CheckBatchInTable(table, batch_indices, params, &indexed_results);
+    }
+  }
+  // Results are grouped by check, regroup them by element to match the order
+  // of CheckElements. Stable sorting keeps the checks in registration order.
+  std::stable_sort(indexed_results.begin(), indexed_results.end(),
+                   [](const IndexedCheckResult &lhs,
+                      const IndexedCheckResult &rhs) {
+                     return lhs.element_index < rhs.element_index;
+                   });
+  result.results.reserve(indexed_results.size());
+  for (IndexedCheckResult &indexed_result : indexed_results) {
+    result.results.push_back(std::move(indexed_result.check_result));
+  }
+  return result;
+}
+
+void Toolkit::CheckBatchInTable(const HierarchyTable &table,
+                                const std::vector<int> &element_indices,
+                                const Parameters &params,
+                                std::vector<IndexedCheckResult> *results) {
+  for (size_t i = 0; i < registered_checks_.size(); i++) {
+    if (!CanRunCheck(i, params)) {
+      continue;
+    }
+    if (metrics_ == nullptr && tracer_ == nullptr) {
+      registered_checks_[i]->CheckElementsInTable(table, element_indices,
+                                                  params, *results);
+      continue;
+    }
+    // Checks process the table in bulk, so only the time of the whole batch
+    // is known. Batches are always traced, as there are few per check.
+    size_t result_count = results->size();
+    ScopedAllocationCounter allocations(metrics_ != nullptr &&
+                                        AllocationTrackingEnabled());
+    uint64_t start_nanoseconds = TraceClockNanoseconds();
+    registered_checks_[i]->CheckElementsInTable(table, element_indices, params,
+                                                *results);
+    uint64_t nanoseconds = TraceClockNanoseconds() - start_nanoseconds;
+    if (metrics_ != nullptr) {
+      check_counters_[i]->RecordBatch(element_indices.size(), nanoseconds,
+                                      results->size() - result_count);
+      if (allocations.active()) {
+        check_counters_[i]->RecordAllocations(allocations.Counts());
+      }
+    }
+    if (tracer_ != nullptr) {
+      tracer_->AddSpan(check_span_names_[i], "check", start_nanoseconds,
+                       nanoseconds, "elements", element_indices.size());
+    }
+  }
+}
+
+std::vector<CheckResultProto> Toolkit::CheckElements(
+    const HierarchySnapshot &snapshot, const Parameters &params) {
+  return CheckElements(HierarchyTable::FromSnapshot(snapshot), params);
+}
+
+bool Toolkit::CheckEvaluations(RecordReader &reader, const Parameters &params,
+                               RecordWriter &writer) {
+  return CheckEvaluations(
+      reader,
+      [&params](int evaluation_index,
+                const AccessibilityEvaluationProto &evaluation) {
+        return params;
+      },
+      writer);
+}
+
+bool Toolkit::CheckEvaluations(RecordReader &reader,
+                               const ParametersProvider &params_provider,
+                               RecordWriter &writer) {
+  AccessibilityEvaluationProto evaluation;
+  auto read_evaluation = [this, &reader, &evaluation] {
+    ScopedPhaseTimer timer(metrics_, EvaluationPhase::kParse);
+    ScopedTraceSpan span(tracer_, "ReadEvaluation", "parse");
+    return reader.ReadEvaluation(&evaluation);
+  };
+  for (int evaluation_index = 0; read_evaluation(); evaluation_index++) {
+    const Parameters params = params_provider(evaluation_index, evaluation);
+    std::vector<CheckResultProto> results =
+        CheckElements(evaluation.hierarchy(), params);
+    evaluation.clear_results();
+    for (CheckResultProto &result : results) {
+      *evaluation.add_results() = std::move(result);
+    }
+    if (!writer.WriteEvaluation(evaluation)) {
+      return false;
+    }
+  }
+  return reader.ok();
+}
+
 }  // namespace gtx
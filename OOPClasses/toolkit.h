@@ -17,16 +17,31 @@
 #ifndef GTXILIB_OOPCLASSES_TOOLKIT_H_
 #define GTXILIB_OOPCLASSES_TOOLKIT_H_
 
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include <abseil/absl/types/optional.h>
+#include "hierarchy_snapshot.h"
 #include "typedefs.h"
 #include "check.h"
+#include "evaluation_metrics.h"
+#include "evaluation_options.h"
+#include "executor.h"
+#include "hierarchy_table.h"
 #include "parameters.h"
+#include "record_stream.h"
+#include "sampling.h"
+#include "scratch_arena.h"
+#include "screen_fingerprint.h"
+#include "tracer.h"
 
 namespace gtx {
 
+class HierarchyVisibility;
+
 // Toolkit can be used for custom implementation of a checking mechanism, @class
 // GTXiLib uses Toolkit for performing the checks on provided elements.
 class Toolkit {
@@ -41,11 +56,61 @@ class Toolkit {
   // true if the check is registered successfully, false otherwise.
   bool RegisterCheck(std::unique_ptr<Check> &check);
 
+  // If true, CheckElements skips elements that are hidden, fully transparent,
+  // clipped by an ancestor or off-screen, as determined by
+  // HierarchyVisibility. Parameters::device_bounds are used as the bounds of
+  // the screen. Defaults to false.
+  bool skips_invisible_elements() const { return skips_invisible_elements_; }
+  void set_skips_invisible_elements(bool skips_invisible_elements) {
+    skips_invisible_elements_ = skips_invisible_elements;
+  }
+
+  // The metrics this toolkit records the counters and timing of its checks
+  // into, or nullptr, the default, to record nothing. Metrics must outlive
+  // this toolkit or be reset to nullptr. Toolkits on several threads can
+  // share the same metrics. The classify and check phases are timed by
+  // CheckElements, and the parse phase by CheckEvaluations. If an allocation
+  // tracking shim is linked in, the heap allocations of checks and phases are
+  // recorded too, see allocation_tracker.h.
+  EvaluationMetrics *metrics() const { return metrics_; }
+  void set_metrics(EvaluationMetrics *metrics);
+
+  // The tracer this toolkit records spans of its evaluations into, or
+  // nullptr, the default, to record nothing. CheckElements records a span for
+  // each hierarchy and each chunk of elements, and check invocations that
+  // take at least TracerOptions::min_check_span_nanoseconds. The tracer is
+  // Tracer::Current while checks run, so that swatch extraction and message
+  // rendering are traced too. The tracer must outlive this toolkit or be
+  // reset to nullptr. Toolkits on several threads can share the same tracer.
+  Tracer *tracer() const { return tracer_; }
+  void set_tracer(Tracer *tracer);
+
+  // The executor CheckElements runs checks of cost class kImage on, or
+  // nullptr, the default, to run all checks on the calling thread element by
+  // element. If set, CheckElements on a hierarchy runs in two stages: it first
+  // runs the kMetadata checks on all elements on the calling thread, then
+  // runs the kImage checks on up to @c parallelism threads, the calling thread
+  // included. The elements of the second stage are distributed over the
+  // threads by the pixel area of their frames in the screenshot, and threads
+  // that run out of elements steal them from the others. Results are in the
+  // same order either way. @c parallelism 0 uses one thread per core. The
+  // executor must outlive this toolkit or be reset to nullptr.
+  Executor *image_check_executor() const { return image_check_executor_; }
+  void set_image_check_executor(Executor *executor, int parallelism = 0);
+
   // Returns a const reference to check that has been registered under the given
   // @c name, behavior is undefined if no such check exists.
   const gtx::Check &GetRegisteredCheckNamed(
       const std::string &check_name) const;
 
+  // The number of registered checks, and the check at @c index, in order of
+  // registration. CompactCheckResult and CheckResultCounts identify checks
+  // by this index.
+  size_t registered_check_count() const { return registered_checks_.size(); }
+  const Check &GetRegisteredCheckAt(size_t index) const {
+    return *registered_checks_[index];
+  }
+
   // Applies all the registered checks on the given element and returns a vector
   // of CheckResultProtos for each accessibility issue found. If none were
   // found, returns an empty vector.
@@ -62,9 +127,213 @@ class Toolkit {
       const AccessibilityHierarchyProto &root_element,
       const Parameters &params);
 
+  // Like CheckElements, but stops early if the deadline of @c options passes
+  // or its cancellation token is cancelled. The deadline and the token are
+  // checked every few elements. The returned EvaluationResult holds the
+  // results of the elements evaluated before stopping and says why and how
+  // far the evaluation got, so that callers with a fixed time budget can use
+  // partial results instead of timing out.
+  EvaluationResult CheckElements(
+      const AccessibilityHierarchyProto &root_element,
+      const Parameters &params, const EvaluationOptions &options);
+
+  // Like CheckElements, but if @c index holds the results of a screen whose
+  // fingerprint matches that of @c root_element and @c params, returns those
+  // results without evaluating, and sets @c reused to true if it is not
+  // nullptr. Otherwise evaluates and, if the evaluation completes, adds its
+  // results to @c index. For crawlers that revisit the same screens.
+  EvaluationResult CheckElements(
+      const AccessibilityHierarchyProto &root_element,
+      const Parameters &params, const EvaluationOptions &options,
+      RecentScreenIndex *index, bool *reused = nullptr);
+
+  // Evaluates a sample of the accessibility elements of @c root_element
+  // within the budget of @c options, for monitoring hierarchies too large to
+  // evaluate exhaustively. Elements are evaluated in the order of
+  // SamplingPlan, which covers every stratum early and prefers high scoring
+  // elements, until SamplingOptions::max_elements have been evaluated, the
+  // deadline passes or the token is cancelled. All checks run on the calling
+  // thread, even if an image check executor is set. The returned coverage
+  // says how much of the hierarchy, and of each stratum, was evaluated.
+  SampledEvaluationResult CheckElementsSampled(
+      const AccessibilityHierarchyProto &root_element,
+      const Parameters &params, const SamplingOptions &options);
+
+  // Evaluates @c hierarchy as CheckElements does, on @c executor or, if it is
+  // nullptr, on ThreadPoolExecutor::Default, and returns a future of the
+  // result. The deadline of @c options includes the time the evaluation waits
+  // for a thread. Evaluations on the same toolkit can run concurrently, but
+  // checks must not be registered and the metrics and tracer must not be
+  // changed until they complete. This toolkit, the screenshot of @c params
+  // and the cancellation token of @c options must outlive the evaluation.
+  std::future<EvaluationResult> CheckElementsAsync(
+      AccessibilityHierarchyProto hierarchy, const Parameters &params,
+      const EvaluationOptions &options = EvaluationOptions(),
+      Executor *executor = nullptr);
+
+  // Like CheckElementsAsync, but calls @c done with the result on the thread
+  // that evaluated it instead of returning a future.
+  void CheckElementsAsync(AccessibilityHierarchyProto hierarchy,
+                          const Parameters &params,
+                          const EvaluationOptions &options,
+                          Executor *executor,
+                          std::function<void(EvaluationResult)> done);
+
+  // Applies all the registered checks on the elements of @c table, using each
+  // check's batch entry point Check::CheckElementsInTable. Returns the same
+  // CheckResultProtos in the same order as CheckElements would for the
+  // hierarchy @c table was constructed from.
+  std::vector<CheckResultProto> CheckElements(const HierarchyTable &table,
+                                              const Parameters &params);
+
+  // Like CheckElements on @c table, but stops early as the overload for
+  // hierarchies with EvaluationOptions does. If @c options are bounded,
+  // checks run on batches of a few dozen elements at a time, between which
+  // the deadline and the token are checked.
+  EvaluationResult CheckElements(const HierarchyTable &table,
+                                 const Parameters &params,
+                                 const EvaluationOptions &options);
+
+  // Applies all the registered checks on the elements of @c snapshot.
+  // Equivalent to calling CheckElements on the hierarchy the snapshot was
+  // created from. The elements are not converted to protos, but their fields,
+  // labels and child ids are copied into a HierarchyTable first, which costs
+  // one pass over the snapshot and about as much memory as the snapshot.
+  std::vector<CheckResultProto> CheckElements(
+      const HierarchySnapshot &snapshot, const Parameters &params);
+
+  // Applies all the registered checks on the accessibility hierarchy with root
+  // @c root_element as CheckElements does, but returns the results as
+  // CompactCheckResults, in the same order, without building protos. Use
+  // ToCheckResultProto to convert the results that are needed as protos. All
+  // checks run on the calling thread, even if an image check executor is set.
+  std::vector<CompactCheckResult> CheckElementsCompact(
+      const AccessibilityHierarchyProto &root_element,
+      const Parameters &params);
+
+  // Returns the CheckResultProto CheckElements would have returned for
+  // @c result, which CheckElementsCompact returned for @c root_element and
+  // @c params.
+  CheckResultProto ToCheckResultProto(
+      const CompactCheckResult &result,
+      const AccessibilityHierarchyProto &root_element,
+      const Parameters &params) const;
+
+  // Applies all the registered checks on the accessibility hierarchy with root
+  // @c root_element as CheckElementsCompact does, and returns only the number
+  // of results of each check and result id, without storing the results.
+  CheckResultCounts CountCheckResults(
+      const AccessibilityHierarchyProto &root_element,
+      const Parameters &params);
+
+  // Applies all the registered checks on the hierarchy of each
+  // AccessibilityEvaluationProto read from @c reader and writes it to
+  // @c writer with its results replaced by the results found. Evaluations are
+  // processed one at a time, so memory use does not depend on the size of the
+  // stream. Returns false if reading or writing fails. All evaluations share
+  // @c params, so this suits streams of one screen only, or streams without
+  // screenshots, on which image checks do not run.
+  bool CheckEvaluations(RecordReader &reader, const Parameters &params,
+                        RecordWriter &writer);
+
+  // Returns the parameters, such as the screenshot and device bounds, of the
+  // evaluation at @c evaluation_index in a stream, counting from 0.
+  using ParametersProvider = std::function<Parameters(
+      int evaluation_index, const AccessibilityEvaluationProto &evaluation)>;
+
+  // Like CheckEvaluations with shared parameters, but checks each evaluation
+  // with the parameters @c params_provider returns for it, which must stay
+  // valid until the evaluation has been written.
+  bool CheckEvaluations(RecordReader &reader,
+                        const ParametersProvider &params_provider,
+                        RecordWriter &writer);
+
  private:
   // Collection of all the registered checks.
   std::vector<std::unique_ptr<Check>> registered_checks_;
+
+  // Returns false if the registered check at @c check_index cannot run with
+  // @c params, which is the case for checks of cost class kImage if the
+  // screenshot has no pixels. Such checks would report every element they
+  // apply to as failing.
+  bool CanRunCheck(size_t check_index, const Parameters &params) const;
+
+  // Records that @c count elements were not checked by any check.
+  void RecordSkips(uint64_t count);
+
+  // Runs the registered check at @c check_index on @c element, recording its
+  // metrics and span if enabled.
+  absl::optional<CheckResultProto> RunCheck(size_t check_index,
+                                            const UIElementProto &element,
+                                            const Parameters &params);
+
+  // Runs the registered check at @c check_index on @c element like RunCheck,
+  // describing its result, if any, in @c result. Returns true if the element
+  // fails the check.
+  bool RunCheckCompact(size_t check_index, const UIElementProto &element,
+                       const Parameters &params, CompactCheckResult *result);
+
+  // Calls @c invoke, which runs the registered check at @c check_index on the
+  // element with id @c element_id and returns true if it fails, recording
+  // its metrics and span if enabled. Returns the result of @c invoke.
+  template <typename Invoke>
+  bool RunInstrumented(size_t check_index, int32_t element_id,
+                       const Invoke &invoke);
+
+  // Implements CheckElementsCompact and CountCheckResults, calling @c emit
+  // with each result in the order of CheckElements.
+  template <typename Emit>
+  void EmitCompactResults(const AccessibilityHierarchyProto &root_element,
+                          const Parameters &params, const Emit &emit);
+
+  // Applies all the registered checks on @c element and appends their
+  // results to @c results, so that evaluations of hierarchies need no vector
+  // per element.
+  void AppendElementResults(const UIElementProto &element,
+                            const Parameters &params,
+                            std::vector<CheckResultProto> *results);
+
+  // Implements CheckElements on a hierarchy with an image check executor.
+  // @c visibility is nullptr if invisible elements are not skipped.
+  EvaluationResult CheckElementsInStages(
+      const AccessibilityHierarchyProto &root_element,
+      const Parameters &params, const EvaluationOptions &options,
+      const HierarchyVisibility *visibility);
+
+  // Applies all the registered checks on the elements of @c table at
+  // @c element_indices and appends their results to @c results, grouped by
+  // check.
+  void CheckBatchInTable(const HierarchyTable &table,
+                         const std::vector<int> &element_indices,
+                         const Parameters &params,
+                         std::vector<IndexedCheckResult> *results);
+
+  // Whether CheckElements skips elements that are not visible.
+  bool skips_invisible_elements_ = false;
+
+  // Where the metrics of checks are recorded, if not nullptr.
+  EvaluationMetrics *metrics_ = nullptr;
+
+  // The counters of each check in registered_checks_, if metrics_ is not
+  // nullptr.
+  std::vector<CheckCounters *> check_counters_;
+
+  // Where checks of cost class kImage run, if not nullptr, and on how many
+  // threads.
+  Executor *image_check_executor_ = nullptr;
+  int image_check_parallelism_ = 1;
+
+  // Where spans of evaluations are recorded, if not nullptr.
+  Tracer *tracer_ = nullptr;
+
+  // The names of the spans of each check in registered_checks_, interned in
+  // tracer_, if tracer_ is not nullptr.
+  std::vector<const char *> check_span_names_;
+
+  // The scratch arenas of the threads running checks. Each evaluation of a
+  // hierarchy, and each image check worker, takes an arena from here for the
+  // temporaries of the checks, and resets and returns it when it is done.
+  ScratchArenaPool scratch_arenas_;
 };
 
 }  // namespace gtx
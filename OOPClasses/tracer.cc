@@ -0,0 +1,226 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "tracer.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace gtx {
+
+namespace {
+
+// Source of Tracer ids. Ids start at 1 so that 0 means no tracer.
+std::atomic<uint64_t> next_tracer_id{1};
+
+// The buffer the calling thread last recorded spans into, and the id of its
+// tracer.
+struct CachedBuffer {
+  uint64_t tracer_id = 0;
+  void *buffer = nullptr;
+};
+thread_local CachedBuffer cached_buffer;
+
+// The tracer set by ScopedCurrentTracer on the calling thread.
+thread_local Tracer *current_tracer = nullptr;
+
+// Appends @c value as a JSON string to @c output.
+void AppendJSONString(const char *value, std::string *output) {
+  output->push_back('"');
+  for (const char *c = value; *c != '\0'; c++) {
+    switch (*c) {
+      case '"':
+        output->append("\\\"");
+        break;
+      case '\\':
+        output->append("\\\\");
+        break;
+      default:
+        if (static_cast<unsigned char>(*c) < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+          output->append(escaped);
+        } else {
+          output->push_back(*c);
+        }
+    }
+  }
+  output->push_back('"');
+}
+
+// Appends @c nanoseconds in microseconds, the unit of trace event
+// timestamps, to @c output.
+void AppendMicroseconds(uint64_t nanoseconds, std::string *output) {
+  char microseconds[32];
+  snprintf(microseconds, sizeof(microseconds), "%llu.%03u",
+           static_cast<unsigned long long>(nanoseconds / 1000),
+           static_cast<unsigned>(nanoseconds % 1000));
+  output->append(microseconds);
+}
+
+}  // namespace
+
+Tracer::Tracer(const TracerOptions &options)
+    : options_(options),
+      id_(next_tracer_id.fetch_add(1)),
+      origin_nanoseconds_(TraceClockNanoseconds()) {}
+
+Tracer::~Tracer() {
+  for (ThreadBuffer &buffer : buffers_) {
+    // The first chunk is owned by the buffer, the others by their
+    // predecessor.
+    Chunk *chunk = buffer.first->next.load(std::memory_order_relaxed);
+    while (chunk != nullptr) {
+      Chunk *next = chunk->next.load(std::memory_order_relaxed);
+      delete chunk;
+      chunk = next;
+    }
+  }
+}
+
+const char *Tracer::InternName(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return interned_names_.insert(name).first->c_str();
+}
+
+Tracer::ThreadBuffer *Tracer::BufferForCurrentThread() {
+  if (cached_buffer.tracer_id == id_) {
+    return static_cast<ThreadBuffer *>(cached_buffer.buffer);
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The thread may have recorded into this tracer before switching to
+  // another one.
+  std::thread::id thread_id = std::this_thread::get_id();
+  ThreadBuffer *buffer = nullptr;
+  for (ThreadBuffer &existing_buffer : buffers_) {
+    if (existing_buffer.thread_id == thread_id) {
+      buffer = &existing_buffer;
+      break;
+    }
+  }
+  if (buffer == nullptr) {
+    buffers_.emplace_back();
+    buffer = &buffers_.back();
+    buffer->thread_id = thread_id;
+    buffer->thread_index = static_cast<int>(buffers_.size()) - 1;
+    buffer->first.reset(new Chunk);
+    buffer->last = buffer->first.get();
+  }
+  cached_buffer.tracer_id = id_;
+  cached_buffer.buffer = buffer;
+  return buffer;
+}
+
+void Tracer::AddSpan(const char *name, const char *category,
+                     uint64_t start_nanoseconds, uint64_t duration_nanoseconds,
+                     const char *arg_name, int64_t arg_value) {
+  ThreadBuffer *buffer = BufferForCurrentThread();
+  if (buffer->span_count >= options_.max_spans_per_thread) {
+    buffer->dropped_span_count.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  Chunk *chunk = buffer->last;
+  size_t size = chunk->size.load(std::memory_order_relaxed);
+  if (size == Chunk::kCapacity) {
+    Chunk *next = new Chunk;
+    chunk->next.store(next, std::memory_order_release);
+    buffer->last = next;
+    chunk = next;
+    size = 0;
+  }
+  Span &span = chunk->spans[size];
+  span.name = name;
+  span.category = category;
+  span.arg_name = arg_name;
+  span.start_nanoseconds = start_nanoseconds;
+  span.duration_nanoseconds = duration_nanoseconds;
+  span.arg_value = arg_value;
+  chunk->size.store(size + 1, std::memory_order_release);
+  buffer->span_count++;
+}
+
+std::string Tracer::ToTraceEventJSON() const {
+  std::string json = "{\"traceEvents\":[";
+  uint64_t dropped_span_count = 0;
+  bool first_event = true;
+  auto start_event = [&json, &first_event] {
+    json.append(first_event ? "\n" : ",\n");
+    first_event = false;
+  };
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const ThreadBuffer &buffer : buffers_) {
+    std::string tid = std::to_string(buffer.thread_index);
+    start_event();
+    json.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" +
+                tid + ",\"args\":{\"name\":\"gtx thread " + tid + "\"}}");
+    for (const Chunk *chunk = buffer.first.get(); chunk != nullptr;
+         chunk = chunk->next.load(std::memory_order_acquire)) {
+      size_t size = chunk->size.load(std::memory_order_acquire);
+      for (size_t i = 0; i < size; i++) {
+        const Span &span = chunk->spans[i];
+        start_event();
+        json.append("{\"name\":");
+        AppendJSONString(span.name, &json);
+        json.append(",\"cat\":");
+        AppendJSONString(span.category, &json);
+        json.append(",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid + ",\"ts\":");
+        AppendMicroseconds(span.start_nanoseconds > origin_nanoseconds_
+                               ? span.start_nanoseconds - origin_nanoseconds_
+                               : 0,
+                           &json);
+        json.append(",\"dur\":");
+        AppendMicroseconds(span.duration_nanoseconds, &json);
+        if (span.arg_name != nullptr) {
+          json.append(",\"args\":{");
+          AppendJSONString(span.arg_name, &json);
+          json.append(":" + std::to_string(span.arg_value) + "}");
+        }
+        json.append("}");
+      }
+    }
+    dropped_span_count +=
+        buffer.dropped_span_count.load(std::memory_order_relaxed);
+  }
+  json.append("\n],\"displayTimeUnit\":\"ns\",\"otherData\":{");
+  json.append("\"dropped_spans\":\"" + std::to_string(dropped_span_count) +
+              "\"}}\n");
+  return json;
+}
+
+bool Tracer::WriteTraceEventJSON(const std::string &path) const {
+  std::ofstream file(path, std::ios::binary);
+  file << ToTraceEventJSON();
+  return static_cast<bool>(file.flush());
+}
+
+Tracer *Tracer::Current() { return current_tracer; }
+
+ScopedCurrentTracer::ScopedCurrentTracer(Tracer *tracer)
+    : previous_tracer_(current_tracer) {
+  current_tracer = tracer;
+}
+
+ScopedCurrentTracer::~ScopedCurrentTracer() {
+  current_tracer = previous_tracer_;
+}
+
+}  // namespace gtx
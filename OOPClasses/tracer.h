@@ -0,0 +1,190 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_TRACER_H_
+#define GTXILIB_OOPCLASSES_TRACER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+namespace gtx {
+
+// Returns the current time of the clock used by Tracer in nanoseconds.
+inline uint64_t TraceClockNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Options of Tracer.
+struct TracerOptions {
+  // Check invocations shorter than this are not traced, so that traces of
+  // large hierarchies stay small. 0 traces every invocation.
+  uint64_t min_check_span_nanoseconds = 50000;
+
+  // The maximum number of spans recorded per thread. Later spans are dropped
+  // and counted in the trace's metadata.
+  size_t max_spans_per_thread = 1 << 20;
+};
+
+// Records spans of evaluations, such as the evaluation of a hierarchy or a
+// slow check invocation, and writes them in the Chrome trace event format,
+// which Perfetto and chrome://tracing can open. One tracer can be shared by
+// toolkits on several threads. Each thread appends to its own buffer without
+// locks; a lock is only taken the first time a thread records a span.
+class Tracer {
+ public:
+  explicit Tracer(const TracerOptions &options = TracerOptions());
+  ~Tracer();
+
+  Tracer(const Tracer &) = delete;
+  Tracer &operator=(const Tracer &) = delete;
+
+  const TracerOptions &options() const { return options_; }
+
+  // Returns a copy of @c name that lives as long as this tracer, for names of
+  // spans that are not string literals. Takes a lock, so callers intern names
+  // once and keep them.
+  const char *InternName(const std::string &name);
+
+  // Records a span of the calling thread that started at @c start_nanoseconds
+  // of TraceClockNanoseconds and lasted @c duration_nanoseconds. @c name and
+  // @c category must outlive this tracer, as string literals or interned
+  // names do. If @c arg_name is not nullptr, the span has the argument
+  // @c arg_name with value @c arg_value.
+  void AddSpan(const char *name, const char *category,
+               uint64_t start_nanoseconds, uint64_t duration_nanoseconds,
+               const char *arg_name = nullptr, int64_t arg_value = 0);
+
+  // Returns the spans recorded so far as a JSON object in the Chrome trace
+  // event format. Spans recorded concurrently may or may not be included.
+  std::string ToTraceEventJSON() const;
+
+  // Writes ToTraceEventJSON to the file at @c path. Returns false if it
+  // cannot be written.
+  bool WriteTraceEventJSON(const std::string &path) const;
+
+  // The tracer of the calling thread, set by ScopedCurrentTracer, or nullptr.
+  // Code without access to the toolkit, such as ContrastSwatch::Extract,
+  // records its spans into it.
+  static Tracer *Current();
+
+ private:
+  friend class ScopedCurrentTracer;
+
+  struct Span {
+    const char *name;
+    const char *category;
+    const char *arg_name;
+    uint64_t start_nanoseconds;
+    uint64_t duration_nanoseconds;
+    int64_t arg_value;
+  };
+
+  // A fixed size block of spans. Only the owning thread appends to it, and
+  // publishes each span by incrementing size with release semantics.
+  struct Chunk {
+    static constexpr size_t kCapacity = 1024;
+    Span spans[kCapacity];
+    std::atomic<size_t> size{0};
+    std::atomic<Chunk *> next{nullptr};
+  };
+
+  // The spans of a single thread.
+  struct ThreadBuffer {
+    std::thread::id thread_id;
+    int thread_index = 0;
+    std::unique_ptr<Chunk> first;
+    // Only accessed by the owning thread.
+    Chunk *last = nullptr;
+    size_t span_count = 0;
+    std::atomic<uint64_t> dropped_span_count{0};
+  };
+
+  // Returns the buffer of the calling thread, creating it if needed.
+  ThreadBuffer *BufferForCurrentThread();
+
+  const TracerOptions options_;
+  // Distinguishes this tracer from tracers that were destroyed earlier and
+  // may have had the same address, in the thread local cache of buffers.
+  const uint64_t id_;
+  const uint64_t origin_nanoseconds_;
+
+  // Guards buffers_ and interned_names_.
+  mutable std::mutex mutex_;
+  std::deque<ThreadBuffer> buffers_;
+  std::set<std::string> interned_names_;
+};
+
+// Records the time from its construction to its destruction as a span. Does
+// nothing if the tracer is nullptr.
+class ScopedTraceSpan {
+ public:
+  ScopedTraceSpan(Tracer *tracer, const char *name, const char *category,
+                  const char *arg_name = nullptr, int64_t arg_value = 0)
+      : tracer_(tracer),
+        name_(name),
+        category_(category),
+        arg_name_(arg_name),
+        arg_value_(arg_value),
+        start_nanoseconds_(tracer != nullptr ? TraceClockNanoseconds() : 0) {}
+
+  ~ScopedTraceSpan() {
+    if (tracer_ != nullptr) {
+      tracer_->AddSpan(name_, category_, start_nanoseconds_,
+                       TraceClockNanoseconds() - start_nanoseconds_, arg_name_,
+                       arg_value_);
+    }
+  }
+
+  ScopedTraceSpan(const ScopedTraceSpan &) = delete;
+  ScopedTraceSpan &operator=(const ScopedTraceSpan &) = delete;
+
+ private:
+  Tracer *const tracer_;
+  const char *const name_;
+  const char *const category_;
+  const char *const arg_name_;
+  const int64_t arg_value_;
+  const uint64_t start_nanoseconds_;
+};
+
+// Sets Tracer::Current of the calling thread from its construction to its
+// destruction, restoring the previous tracer afterwards.
+class ScopedCurrentTracer {
+ public:
+  explicit ScopedCurrentTracer(Tracer *tracer);
+  ~ScopedCurrentTracer();
+
+  ScopedCurrentTracer(const ScopedCurrentTracer &) = delete;
+  ScopedCurrentTracer &operator=(const ScopedCurrentTracer &) = delete;
+
+ private:
+  Tracer *const previous_tracer_;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_TRACER_H_
@@ -0,0 +1,89 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "work_stealing_queues.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+namespace gtx {
+
+WorkStealingQueues::WorkStealingQueues(int queue_count,
+                                       const std::vector<int> &items,
+                                       const std::vector<uint64_t> &costs) {
+  queue_count = std::max(1, queue_count);
+  for (int i = 0; i < queue_count; i++) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  std::vector<size_t> order(items.size());
+  std::iota(order.begin(), order.end(), 0);
+  // Stable, so that items of equal cost keep their order.
+  std::stable_sort(order.begin(), order.end(),
+                   [&costs](size_t lhs, size_t rhs) {
+                     return costs[lhs] > costs[rhs];
+                   });
+  for (size_t i : order) {
+    auto cheapest =
+        std::min_element(queues_.begin(), queues_.end(),
+                         [](const std::unique_ptr<Queue> &lhs,
+                            const std::unique_ptr<Queue> &rhs) {
+                           return lhs->cost < rhs->cost;
+                         });
+    (*cheapest)->items.push_back(items[i]);
+    (*cheapest)->cost += costs[i];
+  }
+}
+
+bool WorkStealingQueues::Pop(int queue, int *item) {
+  {
+    Queue &own = *queues_[queue];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.items.empty()) {
+      *item = own.items.front();
+      own.items.pop_front();
+      return true;
+    }
+  }
+  // Steal from the other queues, starting with the next one so that thieves
+  // spread over their victims.
+  for (size_t i = 1; i < queues_.size(); i++) {
+    Queue &victim = *queues_[(queue + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.items.empty()) {
+      *item = victim.items.back();
+      victim.items.pop_back();
+      victim.stolen_count++;
+      return true;
+    }
+  }
+  return false;
+}
+
+int64_t WorkStealingQueues::stolen_count() const {
+  int64_t stolen_count = 0;
+  for (const auto &queue : queues_) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    stolen_count += queue->stolen_count;
+  }
+  return stolen_count;
+}
+
+}  // namespace gtx
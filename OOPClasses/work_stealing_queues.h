@@ -0,0 +1,69 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef GTXILIB_OOPCLASSES_WORK_STEALING_QUEUES_H_
+#define GTXILIB_OOPCLASSES_WORK_STEALING_QUEUES_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace gtx {
+
+// A queue of work items per worker. Items are distributed up front by their
+// estimated cost, so that each queue holds about the same total cost, and
+// workers that run out of items steal from the other queues. Items are ints,
+// typically indices into the caller's array of work.
+class WorkStealingQueues {
+ public:
+  // Distributes @c items, whose estimated costs are @c costs, over
+  // @c queue_count queues. Items are assigned in order of decreasing cost to
+  // the queue with the least total cost so far, and each queue holds its
+  // items in that order.
+  WorkStealingQueues(int queue_count, const std::vector<int> &items,
+                     const std::vector<uint64_t> &costs);
+
+  int queue_count() const { return static_cast<int>(queues_.size()); }
+
+  // The total estimated cost of the items initially in queue @c queue.
+  uint64_t InitialCost(int queue) const { return queues_[queue]->cost; }
+
+  // Removes an item into @c item, from the front of queue @c queue if it is
+  // not empty, otherwise from the back of another queue. Returns false if all
+  // queues are empty. Thread safe.
+  bool Pop(int queue, int *item);
+
+  // The number of items Pop removed from queues other than the one asked
+  // for.
+  int64_t stolen_count() const;
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<int> items;
+    uint64_t cost = 0;
+    int64_t stolen_count = 0;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+};
+
+}  // namespace gtx
+
+#endif  // GTXILIB_OOPCLASSES_WORK_STEALING_QUEUES_H_
@@ -0,0 +1,183 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Replaces the global operator new and operator delete with versions that
+// count allocations with gtx::RecordAllocation and gtx::RecordDeallocation.
+// Link this file into an executable, such as gtx_evaluate or the benchmarks,
+// to record the allocations of checks and phases in EvaluationMetrics. It is
+// not part of the library, since a library must not replace the allocator of
+// the apps it is linked into. When built as C++17 or later it also replaces
+// the std::align_val_t forms, so that over-aligned allocations are counted.
+
+#include <stdlib.h>
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+#include <algorithm>
+#include <new>
+
+#include "allocation_tracker.h"
+
+namespace {
+
+// Returns the size of the block at @c pointer, which may be larger than the
+// size requested. Blocks are counted by their size so that deallocations,
+// which do not know the requested size, subtract what was added.
+size_t BlockSize(void *pointer) {
+#if defined(__APPLE__)
+  return malloc_size(pointer);
+#else
+  return malloc_usable_size(pointer);
+#endif
+}
+
+void *Allocate(size_t size) {
+  void *pointer = malloc(size == 0 ? 1 : size);
+  if (pointer != nullptr) {
+    gtx::RecordAllocation(BlockSize(pointer));
+  }
+  return pointer;
+}
+
+#if defined(__cpp_aligned_new)
+void *AllocateAligned(size_t size, std::align_val_t alignment) {
+  void *pointer = nullptr;
+  // posix_memalign needs a power of two multiple of sizeof(void *), and its
+  // blocks are freed with free, like those of malloc.
+  const size_t block_alignment =
+      std::max(static_cast<size_t>(alignment), sizeof(void *));
+  if (posix_memalign(&pointer, block_alignment, size == 0 ? 1 : size) != 0) {
+    return nullptr;
+  }
+  gtx::RecordAllocation(BlockSize(pointer));
+  return pointer;
+}
+#endif
+
+void Deallocate(void *pointer) {
+  if (pointer != nullptr) {
+    gtx::RecordDeallocation(BlockSize(pointer));
+    free(pointer);
+  }
+}
+
+// Enables counting by toolkits when the executable starts.
+struct EnableAllocationTrackingAtStartup {
+  EnableAllocationTrackingAtStartup() { gtx::EnableAllocationTracking(); }
+} enable_allocation_tracking_at_startup;
+
+}  // namespace
+
+void *operator new(size_t size) {
+  void *pointer = Allocate(size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void *operator new[](size_t size) {
+  void *pointer = Allocate(size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return Allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return Allocate(size);
+}
+
+void operator delete(void *pointer) noexcept { Deallocate(pointer); }
+
+void operator delete[](void *pointer) noexcept { Deallocate(pointer); }
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept { Deallocate(pointer); }
+
+void operator delete[](void *pointer, size_t) noexcept {
+  Deallocate(pointer);
+}
+
+#if defined(__cpp_aligned_new)
+
+void *operator new(size_t size, std::align_val_t alignment) {
+  void *pointer = AllocateAligned(size, alignment);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+  void *pointer = AllocateAligned(size, alignment);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void *operator new(size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  return AllocateAligned(size, alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  return AllocateAligned(size, alignment);
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept {
+  Deallocate(pointer);
+}
+
+void operator delete[](void *pointer, size_t, std::align_val_t) noexcept {
+  Deallocate(pointer);
+}
+
+#endif  // defined(__cpp_aligned_new)
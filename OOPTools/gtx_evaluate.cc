@@ -0,0 +1,852 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// gtx_evaluate runs the default GTXiLib checks on accessibility hierarchies
+// captured on a device, without iOS. See README.md for usage.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <abseil/absl/strings/string_view.h>
+#include "proto_serialization.h"
+#include "typedefs.h"
+#include "banded_screenshot.h"
+#include "check_lookup.h"
+#include "corpus_replay.h"
+#include "evaluation_metrics.h"
+#include "gtx_types.h"
+#include "image_buffer.h"
+#include "parameters.h"
+#include "record_stream.h"
+#include "toolkit.h"
+#include "tracer.h"
+
+namespace {
+
+constexpr char kUsage[] =
+    "Usage: gtx_evaluate [flags] [input ...]\n"
+    "\n"
+    "Runs the default GTXiLib checks on each hierarchy read from the inputs\n"
+    "and writes the hierarchies with their check results. An input is a\n"
+    "record stream, a file of varint-length-delimited\n"
+    "AccessibilityEvaluation protos, or '-' for such protos on stdin, which\n"
+    "is the default if there are no inputs.\n"
+    "\n"
+    "Flags:\n"
+    "  --manifest=PATH       Also reads inputs listed in PATH, one per line,\n"
+    "                        as 'HIERARCHY [SCREENSHOT [WIDTH HEIGHT]]'.\n"
+    "                        HIERARCHY is a serialized AccessibilityHierarchy\n"
+    "                        and SCREENSHOT a file of WIDTH x HEIGHT raw RGBA\n"
+    "                        pixels or, without WIDTH and HEIGHT, a PNG or\n"
+    "                        binary PPM file, decoded in bands as checks\n"
+    "                        read it. ContrastCheck only runs on hierarchies\n"
+    "                        with a screenshot.\n"
+    "  --output=PATH         Where results are written. Defaults to stdout.\n"
+    "  --output_format=FMT   'delimited' (default) for varint-length-\n"
+    "                        delimited AccessibilityEvaluation protos,\n"
+    "                        'jsonl' for one JSON object per hierarchy or\n"
+    "                        'records' for a record stream.\n"
+    "  --threads=N           Number of evaluation threads. Defaults to the\n"
+    "                        number of cores.\n"
+    "  --quiet               Does not print statistics on exit.\n"
+    "  --metrics=PATH        Writes per-check and per-phase counters and\n"
+    "                        timing to PATH in the Prometheus text format.\n"
+    "  --trace=PATH          Writes a timeline of the evaluation to PATH in\n"
+    "                        the Chrome trace event format, for Perfetto or\n"
+    "                        chrome://tracing.\n";
+
+enum class OutputFormat {
+  kDelimited,
+  kJSONLines,
+  kRecords,
+};
+
+struct Flags {
+  std::vector<std::string> inputs;
+  std::string manifest;
+  std::string output;
+  OutputFormat output_format = OutputFormat::kDelimited;
+  int threads = 0;
+  bool quiet = false;
+  std::string metrics;
+  std::string trace;
+};
+
+// Parses the command line into @c flags. Returns false and prints an error if
+// it is malformed.
+bool ParseFlags(int argc, char **argv, Flags *flags) {
+  for (int i = 1; i < argc; i++) {
+    absl::string_view arg = argv[i];
+    if (arg.substr(0, 2) != "--") {
+      flags->inputs.emplace_back(arg);
+      continue;
+    }
+    size_t equals = arg.find('=');
+    absl::string_view name = arg.substr(2, equals - 2);
+    std::string value;
+    if (equals != absl::string_view::npos) {
+      value = std::string(arg.substr(equals + 1));
+    }
+    if (name == "manifest") {
+      flags->manifest = value;
+    } else if (name == "output") {
+      flags->output = value;
+    } else if (name == "output_format") {
+      if (value == "delimited") {
+        flags->output_format = OutputFormat::kDelimited;
+      } else if (value == "jsonl") {
+        flags->output_format = OutputFormat::kJSONLines;
+      } else if (value == "records") {
+        flags->output_format = OutputFormat::kRecords;
+      } else {
+        std::cerr << "unknown output format '" << value << "'" << std::endl;
+        return false;
+      }
+    } else if (name == "threads") {
+      flags->threads = atoi(value.c_str());
+      if (flags->threads <= 0) {
+        std::cerr << "--threads must be positive" << std::endl;
+        return false;
+      }
+    } else if (name == "quiet") {
+      flags->quiet = true;
+    } else if (name == "metrics") {
+      flags->metrics = value;
+    } else if (name == "trace") {
+      flags->trace = value;
+    } else if (name == "help") {
+      std::cout << kUsage;
+      exit(0);
+    } else {
+      std::cerr << "unknown flag '" << arg << "'\n\n" << kUsage;
+      return false;
+    }
+  }
+  if (flags->output_format == OutputFormat::kRecords && flags->output.empty()) {
+    std::cerr << "--output_format=records requires --output" << std::endl;
+    return false;
+  }
+  if (flags->threads == 0) {
+    flags->threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (flags->inputs.empty() && flags->manifest.empty()) {
+    flags->inputs.push_back("-");
+  }
+  return true;
+}
+
+#pragma mark - Pipeline
+
+// A queue between two stages of the pipeline. Push blocks while the queue is
+// full, so that a fast stage cannot get arbitrarily far ahead of a slow one.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+  void Push(T value) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return values_.size() < capacity_; });
+    values_.push_back(std::move(value));
+    changed_.notify_all();
+  }
+
+  // Removes the value at the front of the queue into @c value. Returns false
+  // if the queue is closed and empty.
+  bool Pop(T *value) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return closed_ || !values_.empty(); });
+    if (values_.empty()) {
+      return false;
+    }
+    *value = std::move(values_.front());
+    values_.pop_front();
+    changed_.notify_all();
+    return true;
+  }
+
+  // Indicates that no more values will be pushed.
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    changed_.notify_all();
+  }
+
+ private:
+  const size_t capacity_;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<T> values_;
+  bool closed_ = false;
+};
+
+// Outputs of evaluations, which may complete out of order, are handed to the
+// writer in input order. Put blocks while the output is too far ahead of the
+// next output to be written, which bounds the number of buffered outputs.
+class OrderedOutputs {
+ public:
+  explicit OrderedOutputs(int64_t window) : window_(window) {}
+
+  void Put(int64_t index, std::string output) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this, index] { return index < next_ + window_; });
+    outputs_.emplace(index, std::move(output));
+    changed_.notify_all();
+  }
+
+  // Removes the next output in order into @c output. Returns false once all
+  // outputs have been taken and Finish has been called.
+  bool Take(std::string *output) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] {
+      return (!outputs_.empty() && outputs_.begin()->first == next_) ||
+             (finished_ && outputs_.empty());
+    });
+    if (outputs_.empty()) {
+      return false;
+    }
+    *output = std::move(outputs_.begin()->second);
+    outputs_.erase(outputs_.begin());
+    next_++;
+    changed_.notify_all();
+    return true;
+  }
+
+  // Indicates that all outputs have been put.
+  void Finish() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+    changed_.notify_all();
+  }
+
+ private:
+  const int64_t window_;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::map<int64_t, std::string> outputs_;
+  int64_t next_ = 0;
+  bool finished_ = false;
+};
+
+// A screenshot read from a file of raw RGBA pixels into a pooled buffer, or
+// opened from a PNG or PPM file to be decoded in bands.
+struct Screenshot {
+  gtx::ImageBuffer pixels;
+  std::unique_ptr<gtx::BandedScreenshot> banded;
+  int width = 0;
+  int height = 0;
+};
+
+// A hierarchy to evaluate.
+struct WorkItem {
+  int64_t index = 0;
+  // The input the hierarchy was read from, for error messages and JSON
+  // output.
+  std::string source;
+  AccessibilityEvaluationProto evaluation;
+  std::shared_ptr<const Screenshot> screenshot;
+};
+
+struct Statistics {
+  std::atomic<int64_t> hierarchies{0};
+  std::atomic<int64_t> elements{0};
+  std::atomic<int64_t> results{0};
+  std::atomic<int64_t> bytes_read{0};
+  std::atomic<int64_t> bytes_written{0};
+  std::atomic<int64_t> errors{0};
+  // Time spent in each stage, summed over the threads of the stage.
+  std::atomic<int64_t> read_nanos{0};
+  std::atomic<int64_t> evaluate_nanos{0};
+  std::atomic<int64_t> write_nanos{0};
+  // Where the toolkits and the phases of the pipeline record their metrics,
+  // or nullptr if --metrics is not set.
+  gtx::EvaluationMetrics *metrics = nullptr;
+  // Where the toolkits and the stages of the pipeline record spans, or
+  // nullptr if --trace is not set.
+  gtx::Tracer *tracer = nullptr;
+};
+
+using Clock = std::chrono::steady_clock;
+
+int64_t NanosSince(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                              start)
+      .count();
+}
+
+#pragma mark - Input
+
+// Reads a file into @c contents. Returns false if it cannot be read.
+bool ReadFile(const std::string &path, std::string *contents) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  *contents = buffer.str();
+  return !file.bad();
+}
+
+// Reads a varint-length-delimited record from @c file into @c record. Returns
+// false at the end of the file, setting @c error if the record is truncated.
+bool ReadDelimitedRecord(FILE *file, std::string *record, bool *error) {
+  uint64_t size = 0;
+  for (int shift = 0;; shift += 7) {
+    int byte = fgetc(file);
+    if (byte == EOF) {
+      *error = shift != 0;
+      return false;
+    }
+    if (shift >= 64) {
+      *error = true;
+      return false;
+    }
+    size |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      break;
+    }
+  }
+  record->resize(size);
+  if (size > 0 && fread(&(*record)[0], 1, size, file) != size) {
+    *error = true;
+    return false;
+  }
+  return true;
+}
+
+// Reads all inputs in order and pushes a WorkItem for each hierarchy.
+class InputReader {
+ public:
+  InputReader(const Flags &flags, BoundedQueue<WorkItem> *queue,
+              Statistics *statistics)
+      : flags_(flags), queue_(queue), statistics_(statistics) {}
+
+  void ReadAll() {
+    for (const std::string &input : flags_.inputs) {
+      if (input == "-") {
+        ReadDelimited(stdin, "stdin");
+      } else {
+        ReadInput(input);
+      }
+    }
+    if (!flags_.manifest.empty()) {
+      ReadManifest(flags_.manifest);
+    }
+    queue_->Close();
+  }
+
+ private:
+  void Error(const std::string &message) {
+    std::cerr << "gtx_evaluate: " << message << std::endl;
+    statistics_->errors++;
+  }
+
+  void Push(std::string source, AccessibilityEvaluationProto evaluation,
+            std::shared_ptr<const Screenshot> screenshot) {
+    WorkItem item;
+    item.index = next_index_++;
+    item.source = std::move(source);
+    item.evaluation = std::move(evaluation);
+    item.screenshot = std::move(screenshot);
+    // Time blocked on a full queue is not reading time.
+    statistics_->read_nanos += NanosSince(start_);
+    queue_->Push(std::move(item));
+    start_ = Clock::now();
+  }
+
+  void ReadInput(const std::string &path) {
+    std::unique_ptr<gtx::RecordReader> reader = gtx::RecordReader::Open(path);
+    if (reader == nullptr) {
+      FILE *file = fopen(path.c_str(), "rb");
+      if (file == nullptr) {
+        Error("cannot open " + path);
+        return;
+      }
+      ReadDelimited(file, path);
+      fclose(file);
+      return;
+    }
+    if (reader->record_type() != gtx::RecordType::kEvaluation) {
+      Error(path + " is not a record stream of evaluations");
+      return;
+    }
+    std::string record;
+    for (int64_t i = 0; reader->ReadRecord(&record); i++) {
+      statistics_->bytes_read += record.size();
+      AccessibilityEvaluationProto evaluation;
+      if (!Parse(record, &evaluation)) {
+        Error(path + "#" + std::to_string(i) + " is not an evaluation");
+        continue;
+      }
+      Push(path + "#" + std::to_string(i), std::move(evaluation), nullptr);
+    }
+    if (!reader->ok()) {
+      Error(path + " is corrupt");
+    }
+  }
+
+  void ReadDelimited(FILE *file, const std::string &name) {
+    std::string record;
+    bool error = false;
+    for (int64_t i = 0; ReadDelimitedRecord(file, &record, &error); i++) {
+      statistics_->bytes_read += record.size();
+      AccessibilityEvaluationProto evaluation;
+      if (!Parse(record, &evaluation)) {
+        Error(name + "#" + std::to_string(i) + " is not an evaluation");
+        continue;
+      }
+      Push(name + "#" + std::to_string(i), std::move(evaluation), nullptr);
+    }
+    if (error) {
+      Error(name + " ends with a truncated record");
+    }
+  }
+
+  void ReadManifest(const std::string &path) {
+    std::ifstream manifest(path);
+    if (!manifest) {
+      Error("cannot open manifest " + path);
+      return;
+    }
+    std::string line;
+    while (std::getline(manifest, line)) {
+      std::istringstream fields(line);
+      std::string hierarchy_path;
+      if (!(fields >> hierarchy_path) || hierarchy_path[0] == '#') {
+        continue;
+      }
+      std::shared_ptr<Screenshot> screenshot;
+      std::string screenshot_path;
+      std::string width;
+      if (fields >> screenshot_path && !(fields >> width)) {
+        screenshot = std::make_shared<Screenshot>();
+        screenshot->banded = gtx::BandedScreenshot::Open(screenshot_path);
+        if (screenshot->banded == nullptr) {
+          Error(screenshot_path + " is not a supported PNG or PPM image");
+          continue;
+        }
+        screenshot->width = screenshot->banded->width();
+        screenshot->height = screenshot->banded->height();
+      } else if (!screenshot_path.empty()) {
+        screenshot = std::make_shared<Screenshot>();
+        std::istringstream width_field(width);
+        if (!(width_field >> screenshot->width) ||
+            !(fields >> screenshot->height) ||
+            screenshot->width <= 0 || screenshot->height <= 0) {
+          Error("malformed manifest line '" + line + "'");
+          continue;
+        }
+        std::string pixels;
+        size_t size = static_cast<size_t>(screenshot->width) *
+                      screenshot->height * sizeof(gtx::Pixel);
+        if (!ReadFile(screenshot_path, &pixels) || pixels.size() != size) {
+          Error(screenshot_path + " is not a " +
+                std::to_string(screenshot->width) + "x" +
+                std::to_string(screenshot->height) + " RGBA image");
+          continue;
+        }
+        statistics_->bytes_read += pixels.size();
+        screenshot->pixels = gtx::ImageBufferPool::Default()->Acquire(
+            screenshot->width, screenshot->height);
+        memcpy(screenshot->pixels.pixels(), pixels.data(), pixels.size());
+      }
+      std::string bytes;
+      AccessibilityEvaluationProto evaluation;
+      if (!ReadFile(hierarchy_path, &bytes) ||
+          !Parse(bytes, evaluation.mutable_hierarchy())) {
+        Error(hierarchy_path + " is not a hierarchy");
+        continue;
+      }
+      statistics_->bytes_read += bytes.size();
+      Push(hierarchy_path, std::move(evaluation), std::move(screenshot));
+    }
+  }
+
+  // Parses @c bytes into @c message, timing it as the parse phase.
+  template <typename Message>
+  bool Parse(absl::string_view bytes, Message *message) {
+    gtx::ScopedPhaseTimer timer(statistics_->metrics,
+                                gtx::EvaluationPhase::kParse);
+    gtx::ScopedTraceSpan span(statistics_->tracer, "Parse", "parse", "bytes",
+                              bytes.size());
+    return gtx::ParseProto(bytes, message);
+  }
+
+  const Flags &flags_;
+  BoundedQueue<WorkItem> *queue_;
+  Statistics *statistics_;
+  int64_t next_index_ = 0;
+  Clock::time_point start_ = Clock::now();
+};
+
+#pragma mark - Output
+
+void AppendJSONString(absl::string_view value, std::string *output) {
+  output->push_back('"');
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        output->append("\\\"");
+        break;
+      case '\\':
+        output->append("\\\\");
+        break;
+      case '\n':
+        output->append("\\n");
+        break;
+      case '\r':
+        output->append("\\r");
+        break;
+      case '\t':
+        output->append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          output->append(escaped);
+        } else {
+          output->push_back(c);
+        }
+    }
+  }
+  output->push_back('"');
+}
+
+void AppendJSONNumber(double value, std::string *output) {
+  char number[32];
+  snprintf(number, sizeof(number), "%.9g", value);
+  output->append(number);
+}
+
+void AppendJSONValue(const TypedValueProto &value, std::string *output) {
+  if (value.has_boolean_value()) {
+    output->append(value.boolean_value() ? "true" : "false");
+  } else if (value.has_int_value()) {
+    output->append(std::to_string(value.int_value()));
+  } else if (value.has_long_value()) {
+    output->append(std::to_string(value.long_value()));
+  } else if (value.has_float_value()) {
+    AppendJSONNumber(value.float_value(), output);
+  } else if (value.has_double_value()) {
+    AppendJSONNumber(value.double_value(), output);
+  } else if (value.has_string_value()) {
+    AppendJSONString(value.string_value(), output);
+  } else if (value.has_byte_value()) {
+    AppendJSONString(value.byte_value(), output);
+  } else if (value.has_short_value()) {
+    AppendJSONString(value.short_value(), output);
+  } else if (value.has_char_value()) {
+    AppendJSONString(value.char_value(), output);
+  } else if (value.has_string_list_value()) {
+    output->push_back('[');
+    const auto &values = value.string_list_value().values();
+    for (size_t i = 0; i < values.size(); i++) {
+      if (i > 0) output->push_back(',');
+      AppendJSONString(values[i], output);
+    }
+    output->push_back(']');
+  } else if (value.has_int_list_value()) {
+    output->push_back('[');
+    const auto &values = value.int_list_value().values();
+    for (size_t i = 0; i < values.size(); i++) {
+      if (i > 0) output->push_back(',');
+      output->append(std::to_string(values[i]));
+    }
+    output->push_back(']');
+  } else {
+    output->append("null");
+  }
+}
+
+// Returns @c item with its results as a single line of JSON.
+std::string JSONLine(const WorkItem &item) {
+  std::string line = "{\"source\":";
+  AppendJSONString(item.source, &line);
+  line.append(",\"elements\":");
+  line.append(std::to_string(item.evaluation.hierarchy().elements_size()));
+  line.append(",\"results\":[");
+  bool first = true;
+  for (const CheckResultProto &result : item.evaluation.results()) {
+    line.append(first ? "{" : ",{");
+    first = false;
+    line.append("\"check\":");
+    AppendJSONString(result.source_check_class(), &line);
+    line.append(",\"result_id\":" + std::to_string(result.result_id()));
+    line.append(",\"element_id\":" +
+                std::to_string(result.hierarchy_source_id()));
+    line.append(",\"result_type\":" +
+                std::to_string(static_cast<int>(result.result_type())));
+    line.append(",\"metadata\":{");
+    bool first_entry = true;
+    for (const auto &entry : result.metadata().metadata_map()) {
+      if (!first_entry) line.push_back(',');
+      first_entry = false;
+      AppendJSONString(entry.first, &line);
+      line.push_back(':');
+      AppendJSONValue(entry.second, &line);
+    }
+    line.append("}}");
+  }
+  line.append("]}\n");
+  return line;
+}
+
+#pragma mark - Evaluation
+
+// Returns a toolkit with the default checks that do not need a screenshot.
+std::unique_ptr<gtx::Toolkit> ToolkitWithoutScreenshotChecks() {
+  auto toolkit = std::make_unique<gtx::Toolkit>();
+  for (const char *name : {"NoLabelCheck", "MinimumTappableAreaCheck",
+                           "AccessibilityLabelNotPunctuatedCheck"}) {
+    std::unique_ptr<gtx::Check> check = gtx::CheckForName(name);
+    if (check != nullptr) {
+      toolkit->RegisterCheck(check);
+    }
+  }
+  return toolkit;
+}
+
+// Returns @c item with its results in the output format of @c flags.
+std::string FormatOutput(const Flags &flags, const WorkItem &item) {
+  std::string output;
+  switch (flags.output_format) {
+    case OutputFormat::kDelimited:
+    {
+      std::string bytes = gtx::SerializeProto(item.evaluation);
+      gtx::AppendVarint(bytes.size(), &output);
+      output.append(bytes);
+      break;
+    }
+    case OutputFormat::kJSONLines:
+      output = JSONLine(item);
+      break;
+    case OutputFormat::kRecords:
+      output = gtx::SerializeProto(item.evaluation);
+      break;
+  }
+  return output;
+}
+
+void Evaluate(const Flags &flags, BoundedQueue<WorkItem> *queue,
+              OrderedOutputs *outputs, Statistics *statistics) {
+  std::unique_ptr<gtx::Toolkit> toolkit =
+      gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  std::unique_ptr<gtx::Toolkit> toolkit_without_screenshot =
+      ToolkitWithoutScreenshotChecks();
+  toolkit->set_metrics(statistics->metrics);
+  toolkit_without_screenshot->set_metrics(statistics->metrics);
+  toolkit->set_tracer(statistics->tracer);
+  toolkit_without_screenshot->set_tracer(statistics->tracer);
+  gtx::ScopedCurrentTracer current_tracer(statistics->tracer);
+  WorkItem item;
+  while (queue->Pop(&item)) {
+    Clock::time_point start = Clock::now();
+    const AccessibilityHierarchyProto &hierarchy = item.evaluation.hierarchy();
+    gtx::Parameters params;
+    const Screenshot *screenshot = item.screenshot.get();
+    params.set_device_bounds(gtx::DeviceBoundsOfHierarchy(
+        hierarchy, screenshot != nullptr ? screenshot->width : 0,
+        screenshot != nullptr ? screenshot->height : 0));
+    gtx::Toolkit *item_toolkit = toolkit_without_screenshot.get();
+    if (item.screenshot != nullptr && item.screenshot->banded != nullptr) {
+      params.set_screenshot(gtx::Image(nullptr, item.screenshot->width,
+                                       item.screenshot->height));
+      params.set_banded_screenshot(item.screenshot->banded.get());
+      item_toolkit = toolkit.get();
+    } else if (item.screenshot != nullptr) {
+      params.set_screenshot(item.screenshot->pixels);
+      item_toolkit = toolkit.get();
+    } else {
+      params.set_screenshot(gtx::Image(nullptr, 0, 0));
+    }
+    std::vector<CheckResultProto> results =
+        item_toolkit->CheckElements(hierarchy, params);
+    statistics->hierarchies++;
+    statistics->elements += hierarchy.elements_size();
+    statistics->results += results.size();
+    item.evaluation.clear_results();
+    for (CheckResultProto &result : results) {
+      *item.evaluation.add_results() = std::move(result);
+    }
+    std::string output;
+    {
+      gtx::ScopedPhaseTimer timer(statistics->metrics,
+                                  gtx::EvaluationPhase::kRender);
+      gtx::ScopedTraceSpan span(statistics->tracer, "FormatOutput", "render");
+      output = FormatOutput(flags, item);
+    }
+    statistics->evaluate_nanos += NanosSince(start);
+    outputs->Put(item.index, std::move(output));
+  }
+}
+
+// Writes outputs in order. Returns false if writing fails.
+bool WriteAll(const Flags &flags, OrderedOutputs *outputs,
+              Statistics *statistics) {
+  std::unique_ptr<gtx::RecordWriter> record_writer;
+  FILE *file = stdout;
+  if (flags.output_format == OutputFormat::kRecords) {
+    record_writer = gtx::RecordWriter::Create(flags.output,
+                                              gtx::RecordType::kEvaluation);
+    if (record_writer == nullptr) {
+      std::cerr << "gtx_evaluate: cannot create " << flags.output << std::endl;
+    }
+  } else if (!flags.output.empty()) {
+    file = fopen(flags.output.c_str(), "wb");
+    if (file == nullptr) {
+      std::cerr << "gtx_evaluate: cannot create " << flags.output << std::endl;
+    }
+  }
+  bool ok = record_writer != nullptr || file != nullptr;
+  std::string output;
+  while (outputs->Take(&output)) {
+    // Outputs are still taken after an error so that evaluation finishes.
+    if (!ok) {
+      continue;
+    }
+    Clock::time_point start = Clock::now();
+    gtx::ScopedTraceSpan span(statistics->tracer, "Write", "write", "bytes",
+                              output.size());
+    if (record_writer != nullptr) {
+      ok = record_writer->WriteRecord(output);
+    } else {
+      ok = fwrite(output.data(), 1, output.size(), file) == output.size();
+    }
+    statistics->bytes_written += output.size();
+    statistics->write_nanos += NanosSince(start);
+  }
+  if (record_writer != nullptr) {
+    ok = record_writer->Close() && ok;
+  } else if (file != nullptr) {
+    ok = fflush(file) == 0 && ok;
+    if (file != stdout) {
+      ok = fclose(file) == 0 && ok;
+    }
+  }
+  if (!ok) {
+    std::cerr << "gtx_evaluate: writing results failed" << std::endl;
+  }
+  return ok;
+}
+
+void PrintStatistics(const Statistics &statistics, int threads,
+                     double seconds) {
+  double hierarchies = statistics.hierarchies;
+  fprintf(stderr,
+          "gtx_evaluate: %lld hierarchies, %lld elements, %lld results in "
+          "%.3f s\n",
+          static_cast<long long>(statistics.hierarchies),
+          static_cast<long long>(statistics.elements),
+          static_cast<long long>(statistics.results), seconds);
+  if (seconds > 0) {
+    fprintf(stderr,
+            "  %.1f hierarchies/s, %.1f elements/s, %.2f MB/s read, "
+            "%.2f MB/s written\n",
+            hierarchies / seconds, statistics.elements / seconds,
+            statistics.bytes_read / seconds / 1e6,
+            statistics.bytes_written / seconds / 1e6);
+  }
+  fprintf(stderr,
+          "  busy time: read %.3f s, evaluate %.3f s (%d threads), write "
+          "%.3f s\n",
+          statistics.read_nanos / 1e9, statistics.evaluate_nanos / 1e9,
+          threads, statistics.write_nanos / 1e9);
+  if (statistics.errors > 0) {
+    fprintf(stderr, "  %lld inputs could not be read\n",
+            static_cast<long long>(statistics.errors));
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Flags flags;
+  if (!ParseFlags(argc, argv, &flags)) {
+    return 2;
+  }
+  Clock::time_point start = Clock::now();
+  Statistics statistics;
+  std::unique_ptr<gtx::EvaluationMetrics> metrics;
+  if (!flags.metrics.empty()) {
+    metrics = std::make_unique<gtx::EvaluationMetrics>();
+    statistics.metrics = metrics.get();
+  }
+  std::unique_ptr<gtx::Tracer> tracer;
+  if (!flags.trace.empty()) {
+    tracer = std::make_unique<gtx::Tracer>();
+    statistics.tracer = tracer.get();
+  }
+  // Reading, evaluation and writing run concurrently. The queue and the
+  // reordering window bound the number of hierarchies in memory.
+  BoundedQueue<WorkItem> queue(2 * flags.threads);
+  OrderedOutputs outputs(4 * flags.threads);
+
+  std::thread reader_thread([&flags, &queue, &statistics] {
+    InputReader(flags, &queue, &statistics).ReadAll();
+  });
+  std::vector<std::thread> evaluation_threads;
+  for (int i = 0; i < flags.threads; i++) {
+    evaluation_threads.emplace_back([&flags, &queue, &outputs, &statistics] {
+      Evaluate(flags, &queue, &outputs, &statistics);
+    });
+  }
+  std::thread finish_thread([&reader_thread, &evaluation_threads, &outputs] {
+    reader_thread.join();
+    for (std::thread &thread : evaluation_threads) {
+      thread.join();
+    }
+    outputs.Finish();
+  });
+  bool written = WriteAll(flags, &outputs, &statistics);
+  finish_thread.join();
+
+  if (!flags.quiet) {
+    PrintStatistics(statistics, flags.threads, NanosSince(start) / 1e9);
+  }
+  if (metrics != nullptr) {
+    std::ofstream metrics_file(flags.metrics);
+    metrics_file << metrics->Snapshot().ToPrometheusText();
+    if (!metrics_file.flush()) {
+      std::cerr << "gtx_evaluate: cannot write " << flags.metrics << std::endl;
+      written = false;
+    }
+  }
+  if (tracer != nullptr && !tracer->WriteTraceEventJSON(flags.trace)) {
+    std::cerr << "gtx_evaluate: cannot write " << flags.trace << std::endl;
+    written = false;
+  }
+  return written && statistics.errors == 0 ? 0 : 1;
+}
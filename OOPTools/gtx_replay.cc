@@ -0,0 +1,193 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// gtx_replay replays a corpus of recorded hierarchies through the toolkit and
+// reports throughput, latency and memory use. See README.md for usage.
+
+#include <stdlib.h>
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <abseil/absl/strings/str_split.h>
+#include <abseil/absl/strings/string_view.h>
+#include "check_lookup.h"
+#include "corpus_replay.h"
+#include "evaluation_metrics.h"
+#include "tracer.h"
+
+namespace {
+
+constexpr char kUsage[] =
+    "Usage: gtx_replay [flags] corpus ...\n"
+    "\n"
+    "Evaluates every hierarchy of the corpora and prints the throughput,\n"
+    "the per-hierarchy latency and the peak memory use. A corpus is a record\n"
+    "stream of AccessibilityEvaluation protos, a file holding one serialized\n"
+    "AccessibilityEvaluation or a directory of such files. See\n"
+    "OOPClasses/corpus_replay.h for where screenshots are read from.\n"
+    "\n"
+    "Flags:\n"
+    "  --threads=N           Number of evaluation threads. Defaults to the\n"
+    "                        number of cores.\n"
+    "  --checks=A,B,...      The checks to run. Defaults to the default\n"
+    "                        checks of the toolkit.\n"
+    "  --skip_invisible      Skips elements hidden from accessibility.\n"
+    "  --evaluation_path=P   'proto' (default) checks hierarchy protos,\n"
+    "                        'table' builds a HierarchyTable per hierarchy\n"
+    "                        and checks it.\n"
+    "  --preload             Reads the corpora into memory before timing,\n"
+    "                        so that only evaluation is measured.\n"
+    "  --repeat=N            Evaluates the corpora N times.\n"
+    "  --screenshot_encoding=E\n"
+    "                        How screenshots are kept in memory: 'rgba'\n"
+    "                        (default), 'palette' or 'rle'.\n"
+    "  --metrics=PATH        Writes per-check and per-phase counters and\n"
+    "                        timing to PATH in the Prometheus text format.\n"
+    "  --trace=PATH          Writes a timeline of the replay to PATH in the\n"
+    "                        Chrome trace event format.\n";
+
+struct Flags {
+  std::vector<std::string> corpora;
+  gtx::ReplayOptions options;
+  std::string metrics;
+  std::string trace;
+};
+
+// Parses the command line into @c flags. Returns false and prints an error if
+// it is invalid.
+bool ParseFlags(int argc, char **argv, Flags *flags) {
+  for (int i = 1; i < argc; i++) {
+    absl::string_view arg = argv[i];
+    if (arg.substr(0, 2) != "--") {
+      flags->corpora.emplace_back(arg);
+      continue;
+    }
+    size_t equals = arg.find('=');
+    absl::string_view name = arg.substr(2, equals - 2);
+    std::string value;
+    if (equals != absl::string_view::npos) {
+      value = std::string(arg.substr(equals + 1));
+    }
+    if (name == "threads") {
+      flags->options.threads = atoi(value.c_str());
+      if (flags->options.threads <= 0) {
+        std::cerr << "--threads must be positive" << std::endl;
+        return false;
+      }
+    } else if (name == "checks") {
+      for (absl::string_view check_name :
+           absl::StrSplit(value, ',', absl::SkipEmpty())) {
+        if (gtx::CheckForName(check_name) == nullptr) {
+          std::cerr << "unknown check '" << check_name << "'" << std::endl;
+          return false;
+        }
+        flags->options.check_names.emplace_back(check_name);
+      }
+    } else if (name == "skip_invisible") {
+      flags->options.skips_invisible_elements = true;
+    } else if (name == "evaluation_path") {
+      if (value == "proto") {
+        flags->options.evaluation_path = gtx::ReplayEvaluationPath::kProto;
+      } else if (value == "table") {
+        flags->options.evaluation_path =
+            gtx::ReplayEvaluationPath::kHierarchyTable;
+      } else {
+        std::cerr << "unknown evaluation path '" << value << "'" << std::endl;
+        return false;
+      }
+    } else if (name == "preload") {
+      flags->options.preloads_corpus = true;
+    } else if (name == "screenshot_encoding") {
+      if (value == "rgba") {
+        flags->options.screenshot_encoding =
+            gtx::ReplayScreenshotEncoding::kRgba;
+      } else if (value == "palette") {
+        flags->options.screenshot_encoding =
+            gtx::ReplayScreenshotEncoding::kPalette;
+      } else if (value == "rle") {
+        flags->options.screenshot_encoding =
+            gtx::ReplayScreenshotEncoding::kRunLength;
+      } else {
+        std::cerr << "unknown screenshot encoding '" << value << "'"
+                  << std::endl;
+        return false;
+      }
+    } else if (name == "repeat") {
+      flags->options.repeat_count = atoi(value.c_str());
+      if (flags->options.repeat_count <= 0) {
+        std::cerr << "--repeat must be positive" << std::endl;
+        return false;
+      }
+    } else if (name == "metrics") {
+      flags->metrics = value;
+    } else if (name == "trace") {
+      flags->trace = value;
+    } else if (name == "help") {
+      std::cout << kUsage;
+      exit(0);
+    } else {
+      std::cerr << "unknown flag '" << arg << "'\n\n" << kUsage;
+      return false;
+    }
+  }
+  if (flags->corpora.empty()) {
+    std::cerr << "no corpus\n\n" << kUsage;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Flags flags;
+  if (!ParseFlags(argc, argv, &flags)) {
+    return 2;
+  }
+  std::unique_ptr<gtx::EvaluationMetrics> metrics;
+  if (!flags.metrics.empty()) {
+    metrics = std::make_unique<gtx::EvaluationMetrics>();
+    flags.options.metrics = metrics.get();
+  }
+  std::unique_ptr<gtx::Tracer> tracer;
+  if (!flags.trace.empty()) {
+    tracer = std::make_unique<gtx::Tracer>();
+    flags.options.tracer = tracer.get();
+  }
+  std::unique_ptr<gtx::CorpusReplay> replay =
+      gtx::CorpusReplay::Create(flags.options);
+  gtx::ReplayReport report = replay->Replay(flags.corpora);
+  std::cout << report.ToString();
+
+  bool written = true;
+  if (metrics != nullptr) {
+    std::ofstream metrics_file(flags.metrics);
+    metrics_file << metrics->Snapshot().ToPrometheusText();
+    if (!metrics_file.flush()) {
+      std::cerr << "gtx_replay: cannot write " << flags.metrics << std::endl;
+      written = false;
+    }
+  }
+  if (tracer != nullptr && !tracer->WriteTraceEventJSON(flags.trace)) {
+    std::cerr << "gtx_replay: cannot write " << flags.trace << std::endl;
+    written = false;
+  }
+  return written && report.errors.empty() ? 0 : 1;
+}
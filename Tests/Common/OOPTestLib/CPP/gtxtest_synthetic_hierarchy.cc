@@ -0,0 +1,381 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "gtxtest_synthetic_hierarchy.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "typedefs.h"
+#include "element_trait.h"
+#include "gtx_types.h"
+#include "image_color_utils.h"
+#include "parameters.h"
+
+namespace gtxtest {
+
+namespace {
+
+// Words labels are made of.
+constexpr const char *kWords[] = {
+    "account", "add",     "back",    "cancel",  "cart",    "close",
+    "compose", "continue", "delete", "done",    "download", "edit",
+    "email",   "favorite", "filter", "help",    "home",    "inbox",
+    "join",    "like",    "list",    "login",   "map",     "menu",
+    "message", "more",    "music",   "new",     "next",    "notes",
+    "open",    "order",   "password", "pay",    "photo",   "play",
+    "previous", "profile", "refresh", "remove", "reply",   "save",
+    "search",  "send",    "settings", "share",  "shop",    "sign",
+    "skip",    "sort",    "start",   "stop",    "submit",  "support",
+    "tag",     "today",   "trash",   "update",  "upload",  "video",
+    "view",    "volume",  "weather", "welcome",
+};
+constexpr int kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+// The minimum size of buttons that are too small, in points.
+constexpr float kMinSmallButtonSize = 12;
+
+enum class ElementKind {
+  kContainer,
+  kButton,
+  kText,
+  kImage,
+};
+
+struct Frame {
+  float x, y, width, height;
+};
+
+// Returns a gray pixel with the given value.
+gtx::Pixel Gray(int value) {
+  unsigned char channel = static_cast<unsigned char>(value);
+  return {channel, channel, channel, 255};
+}
+
+// Returns the gray value whose contrast ratio with the gray value
+// @c background is closest to @c contrast_ratio.
+int GrayWithContrastRatio(int background, float contrast_ratio) {
+  static const std::vector<float> *luminances = [] {
+    auto *luminances = new std::vector<float>(256);
+    for (int value = 0; value < 256; value++) {
+      (*luminances)[value] = Gray(value).Luminance();
+    }
+    return luminances;
+  }();
+  int best_value = 0;
+  float best_difference = INFINITY;
+  for (int value = 0; value < 256; value++) {
+    float difference =
+        fabsf(gtx::image_color_utils::ContrastRatio(
+                  (*luminances)[value], (*luminances)[background]) -
+              contrast_ratio);
+    if (difference < best_difference) {
+      best_difference = difference;
+      best_value = value;
+    }
+  }
+  return best_value;
+}
+
+// Draws into the pixels of a screenshot in points.
+class Canvas {
+ public:
+  Canvas(std::vector<gtx::Pixel> *pixels, int width, int height, float scale)
+      : pixels_(*pixels), width_(width), height_(height), scale_(scale) {}
+
+  // Fills @c frame with @c color.
+  void Fill(const Frame &frame, gtx::Pixel color) {
+    int x0, y0, x1, y1;
+    ToPixels(frame, &x0, &y0, &x1, &y1);
+    for (int y = y0; y < y1; y++) {
+      std::fill(pixels_.begin() + y * width_ + x0,
+                pixels_.begin() + y * width_ + x1, color);
+    }
+  }
+
+  // Fills @c frame with @c background and draws lines of glyphs in
+  // @c foreground on it. Glyph widths and gaps are taken from @c random.
+  template <typename RandomFunction>
+  void DrawText(const Frame &frame, gtx::Pixel background,
+                gtx::Pixel foreground, RandomFunction random) {
+    Fill(frame, background);
+    int x0, y0, x1, y1;
+    ToPixels(frame, &x0, &y0, &x1, &y1);
+    int line_height = std::max(4, static_cast<int>(12 * scale_));
+    int glyph_height = line_height * 2 / 3;
+    for (int line_top = y0 + line_height / 6; line_top + glyph_height <= y1;
+         line_top += line_height) {
+      int x = x0 + 1;
+      while (x < x1) {
+        int glyph_width = 1 + static_cast<int>(random() % 4);
+        int gap = 1 + static_cast<int>(random() % 2);
+        int glyph_end = std::min(x + glyph_width, x1);
+        for (int y = line_top; y < line_top + glyph_height; y++) {
+          std::fill(pixels_.begin() + y * width_ + x,
+                    pixels_.begin() + y * width_ + glyph_end, foreground);
+        }
+        x = glyph_end + gap;
+      }
+    }
+  }
+
+ private:
+  void ToPixels(const Frame &frame, int *x0, int *y0, int *x1, int *y1) const {
+    *x0 = std::max(0, static_cast<int>(frame.x * scale_));
+    *y0 = std::max(0, static_cast<int>(frame.y * scale_));
+    *x1 = std::min(width_, static_cast<int>((frame.x + frame.width) * scale_));
+    *y1 =
+        std::min(height_, static_cast<int>((frame.y + frame.height) * scale_));
+    *x1 = std::max(*x0, *x1);
+    *y1 = std::max(*y0, *y1);
+  }
+
+  std::vector<gtx::Pixel> &pixels_;
+  int width_;
+  int height_;
+  float scale_;
+};
+
+}  // namespace
+
+gtx::Image GTXTestSyntheticScreen::screenshot() {
+  return gtx::Image(pixels_.empty() ? nullptr : pixels_.data(),
+                    screenshot_width_, screenshot_height_);
+}
+
+gtx::Parameters GTXTestSyntheticScreen::parameters() {
+  const DisplayMetricsProto &metrics =
+      hierarchy_.device_state().display_metrics();
+  gtx::Parameters params;
+  params.set_screenshot(screenshot());
+  params.set_device_bounds(
+      gtx::Rect(0, 0, metrics.screen_width(), metrics.screen_height()));
+  return params;
+}
+
+GTXTestSyntheticHierarchyGenerator::GTXTestSyntheticHierarchyGenerator(
+    const GTXTestSyntheticHierarchyOptions &options)
+    : options_(options), random_state_(options.seed) {}
+
+AccessibilityHierarchyProto
+GTXTestSyntheticHierarchyGenerator::GenerateHierarchy() {
+  GTXTestSyntheticScreen screen;
+  Generate(/*render=*/false, &screen);
+  return std::move(screen.hierarchy_);
+}
+
+GTXTestSyntheticScreen GTXTestSyntheticHierarchyGenerator::GenerateScreen() {
+  GTXTestSyntheticScreen screen;
+  Generate(/*render=*/true, &screen);
+  return screen;
+}
+
+uint64_t GTXTestSyntheticHierarchyGenerator::NextRandom() {
+  // SplitMix64, which is fast and has no bad seeds.
+  uint64_t z = (random_state_ += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+float GTXTestSyntheticHierarchyGenerator::Uniform() {
+  return (NextRandom() >> 40) * (1.0f / (1 << 24));
+}
+
+int GTXTestSyntheticHierarchyGenerator::UniformInt(int min, int max) {
+  if (max <= min) {
+    return min;
+  }
+  return min + static_cast<int>(NextRandom() %
+                                static_cast<uint64_t>(max - min + 1));
+}
+
+void GTXTestSyntheticHierarchyGenerator::Generate(
+    bool render, GTXTestSyntheticScreen *screen) {
+  const GTXTestSyntheticHierarchyOptions &options = options_;
+  AccessibilityHierarchyProto &hierarchy = screen->hierarchy_;
+  DisplayMetricsProto *metrics =
+      hierarchy.mutable_device_state()->mutable_display_metrics();
+  metrics->set_screen_width(options.screen_width);
+  metrics->set_screen_height(options.screen_height);
+  metrics->set_screen_scale(options.screen_scale);
+  if (render) {
+    screen->screenshot_width_ =
+        static_cast<int>(options.screen_width * options.screen_scale);
+    screen->screenshot_height_ =
+        static_cast<int>(options.screen_height * options.screen_scale);
+    screen->pixels_.assign(static_cast<size_t>(screen->screenshot_width_) *
+                               screen->screenshot_height_,
+                           Gray(255));
+  }
+  Canvas canvas(&screen->pixels_, screen->screenshot_width_,
+                screen->screenshot_height_, options.screen_scale);
+  auto random = [this] { return NextRandom(); };
+
+  float total_weight = options.container_weight + options.button_weight +
+                       options.text_weight + options.image_weight;
+  auto random_kind = [&] {
+    float value = Uniform() * total_weight;
+    if ((value -= options.container_weight) < 0) return ElementKind::kContainer;
+    if ((value -= options.button_weight) < 0) return ElementKind::kButton;
+    if ((value -= options.text_weight) < 0) return ElementKind::kText;
+    return ElementKind::kImage;
+  };
+  auto random_label = [&] {
+    std::string label;
+    int word_count =
+        UniformInt(options.min_label_words, options.max_label_words);
+    for (int i = 0; i < word_count; i++) {
+      if (i > 0) label.push_back(' ');
+      label.append(kWords[NextRandom() % kWordCount]);
+    }
+    if (!label.empty()) {
+      label[0] = static_cast<char>(label[0] - 'a' + 'A');
+      if (Uniform() < options.punctuated_label_rate) label.push_back('.');
+    }
+    return label;
+  };
+
+  // The frames and depths of the elements, by id.
+  std::vector<Frame> frames;
+  std::vector<int> depths;
+  // Ids of the containers whose children have not been generated, in
+  // breadth-first order.
+  std::vector<int> containers;
+  int element_count = std::max(1, options.element_count);
+  frames.reserve(element_count);
+  depths.reserve(element_count);
+
+  UIElementProto *root = hierarchy.add_elements();
+  root->set_id(0);
+  root->add_class_names_hierarchy("UIWindow");
+  Frame screen_frame = {0, 0, static_cast<float>(options.screen_width),
+                        static_cast<float>(options.screen_height)};
+  RectProto *root_frame = root->mutable_ax_frame();
+  root_frame->mutable_size()->set_width(screen_frame.width);
+  root_frame->mutable_size()->set_height(screen_frame.height);
+  frames.push_back(screen_frame);
+  depths.push_back(0);
+  containers.push_back(0);
+
+  int next_id = 1;
+  for (size_t next_container = 0;
+       next_container < containers.size() && next_id < element_count;
+       next_container++) {
+    int parent_id = containers[next_container];
+    int depth = depths[parent_id] + 1;
+    if (depth > options.max_depth) {
+      continue;
+    }
+    Frame parent_frame = frames[parent_id];
+    int child_count =
+        std::min(UniformInt(std::max(1, options.min_fan_out),
+                            std::max(1, options.max_fan_out)),
+                 element_count - next_id);
+    // Children are laid out in a grid of equally sized cells.
+    int columns = static_cast<int>(ceilf(sqrtf(child_count)));
+    int rows = (child_count + columns - 1) / columns;
+    float cell_width = parent_frame.width / columns;
+    float cell_height = parent_frame.height / rows;
+    for (int i = 0; i < child_count; i++) {
+      int id = next_id++;
+      // The last child of each container is a container, so that the
+      // hierarchy keeps growing until it has element_count elements.
+      ElementKind kind = i == child_count - 1 && depth < options.max_depth
+                             ? ElementKind::kContainer
+                             : random_kind();
+      Frame frame = {parent_frame.x + (i % columns) * cell_width,
+                     parent_frame.y + (i / columns) * cell_height, cell_width,
+                     cell_height};
+      // Children are inset from their cell, up to a point on each side.
+      float inset = std::min(1.0f, std::min(frame.width, frame.height) / 4);
+      frame = {frame.x + inset, frame.y + inset, frame.width - 2 * inset,
+               frame.height - 2 * inset};
+      if (kind == ElementKind::kButton &&
+          Uniform() < options.small_button_rate) {
+        frame.width = std::min(
+            frame.width, kMinSmallButtonSize + Uniform() * kMinSmallButtonSize);
+        frame.height = std::min(
+            frame.height,
+            kMinSmallButtonSize + Uniform() * kMinSmallButtonSize);
+      }
+      frames.push_back(frame);
+      depths.push_back(depth);
+      hierarchy.mutable_elements(parent_id)->add_child_ids(id);
+
+      UIElementProto *element = hierarchy.add_elements();
+      element->set_id(id);
+      element->set_parent_id(parent_id);
+      RectProto *ax_frame = element->mutable_ax_frame();
+      ax_frame->mutable_origin()->set_x(frame.x);
+      ax_frame->mutable_origin()->set_y(frame.y);
+      ax_frame->mutable_size()->set_width(frame.width);
+      ax_frame->mutable_size()->set_height(frame.height);
+      element->add_class_names_hierarchy("UIView");
+      if (kind != ElementKind::kContainer) {
+        element->set_is_ax_element(true);
+        if (Uniform() >= options.missing_label_rate) {
+          element->set_ax_label(random_label());
+        }
+      }
+      // Backgrounds are light or dark, so that any contrast ratio up to about
+      // 12 can be reached with a gray foreground.
+      int background = NextRandom() % 2 == 0 ? UniformInt(200, 255)
+                                             : UniformInt(0, 40);
+      switch (kind) {
+        case ElementKind::kContainer:
+          containers.push_back(id);
+          if (render) canvas.Fill(frame, Gray(background));
+          break;
+        case ElementKind::kButton:
+          element->set_ax_traits(
+              static_cast<uint64_t>(gtx::ElementTrait::kButton));
+          element->add_class_names_hierarchy("UIControl");
+          element->add_class_names_hierarchy("UIButton");
+          if (render) canvas.Fill(frame, Gray(background));
+          break;
+        case ElementKind::kText: {
+          element->set_ax_traits(
+              static_cast<uint64_t>(gtx::ElementTrait::kStaticText));
+          element->add_class_names_hierarchy("UILabel");
+          float contrast_ratio =
+              options.min_text_contrast_ratio +
+              Uniform() * (options.max_text_contrast_ratio -
+                           options.min_text_contrast_ratio);
+          if (render) {
+            canvas.DrawText(
+                frame, Gray(background),
+                Gray(GrayWithContrastRatio(background, contrast_ratio)),
+                random);
+          }
+          break;
+        }
+        case ElementKind::kImage:
+          element->set_ax_traits(
+              static_cast<uint64_t>(gtx::ElementTrait::kImage));
+          element->add_class_names_hierarchy("UIImageView");
+          if (render) canvas.Fill(frame, Gray(background));
+          break;
+      }
+    }
+  }
+}
+
+}  // namespace gtxtest
@@ -0,0 +1,148 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef THIRD_PARTY_OBJECTIVE_C_GTXILIB_TESTS_COMMON_OOPTESTLIB_CPP_GTXTEST_SYNTHETIC_HIERARCHY_H_
+#define THIRD_PARTY_OBJECTIVE_C_GTXILIB_TESTS_COMMON_OOPTESTLIB_CPP_GTXTEST_SYNTHETIC_HIERARCHY_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "typedefs.h"
+#include "gtx_types.h"
+#include "parameters.h"
+
+namespace gtxtest {
+
+// Options of GTXTestSyntheticHierarchyGenerator.
+struct GTXTestSyntheticHierarchyOptions {
+  // The seed of the generator. Generators with the same seed and options
+  // generate the same hierarchies and screenshots.
+  uint64_t seed = 1;
+
+  // The number of elements of each hierarchy. Fewer elements are generated
+  // only if max_depth and max_fan_out cannot accommodate element_count.
+  int element_count = 1000;
+
+  // The maximum depth of an element. The root element has depth 0.
+  int max_depth = 16;
+
+  // The number of children of each container element is drawn uniformly from
+  // [min_fan_out, max_fan_out].
+  int min_fan_out = 2;
+  int max_fan_out = 8;
+
+  // Relative weights of the kinds of elements that are generated as children.
+  // Containers are plain UIViews that contain other elements, the other kinds
+  // are accessibility elements without children.
+  float container_weight = 3;
+  float button_weight = 2;
+  float text_weight = 3;
+  float image_weight = 1;
+
+  // The fraction of buttons, text and images without an accessibility label.
+  float missing_label_rate = 0.1f;
+
+  // The fraction of labels that end with a period.
+  float punctuated_label_rate = 0.1f;
+
+  // The number of words in each label is drawn uniformly from
+  // [min_label_words, max_label_words].
+  int min_label_words = 1;
+  int max_label_words = 4;
+
+  // The fraction of buttons that are smaller than the minimum tappable area.
+  float small_button_rate = 0.2f;
+
+  // The contrast ratio between the glyphs of text elements and their
+  // background in the screenshot is drawn uniformly from
+  // [min_text_contrast_ratio, max_text_contrast_ratio].
+  float min_text_contrast_ratio = 1.5f;
+  float max_text_contrast_ratio = 12.0f;
+
+  // The display metrics of the device. Screenshots have
+  // screen_scale * screen_width x screen_scale * screen_height pixels.
+  int screen_width = 390;
+  int screen_height = 844;
+  float screen_scale = 2;
+};
+
+// A generated hierarchy and the screenshot rendered for it.
+class GTXTestSyntheticScreen {
+ public:
+  GTXTestSyntheticScreen() {}
+
+  GTXTestSyntheticScreen(GTXTestSyntheticScreen &&) = default;
+  GTXTestSyntheticScreen &operator=(GTXTestSyntheticScreen &&) = default;
+
+  const AccessibilityHierarchyProto &hierarchy() const { return hierarchy_; }
+
+  // The screenshot, which points into this object and must not outlive it.
+  // Has no pixels if the screenshot was not rendered.
+  gtx::Image screenshot();
+
+  // Parameters with the screenshot and device bounds of this screen, which
+  // must not outlive this object.
+  gtx::Parameters parameters();
+
+ private:
+  friend class GTXTestSyntheticHierarchyGenerator;
+
+  AccessibilityHierarchyProto hierarchy_;
+  std::vector<gtx::Pixel> pixels_;
+  int screenshot_width_ = 0;
+  int screenshot_height_ = 0;
+};
+
+// Generates pseudo-random accessibility hierarchies for load tests and
+// benchmarks. Elements are laid out by subdividing the frame of their parent,
+// so they are nested and on screen, and element ids are their indices in the
+// hierarchy. Successive calls generate different hierarchies from a single
+// stream of random numbers.
+class GTXTestSyntheticHierarchyGenerator {
+ public:
+  explicit GTXTestSyntheticHierarchyGenerator(
+      const GTXTestSyntheticHierarchyOptions &options);
+
+  // Generates a hierarchy without a screenshot.
+  AccessibilityHierarchyProto GenerateHierarchy();
+
+  // Generates a hierarchy and renders a screenshot of it. Containers and
+  // buttons are filled with solid colors, and text elements with rows of
+  // text-like glyphs at their generated contrast ratio.
+  GTXTestSyntheticScreen GenerateScreen();
+
+ private:
+  // Generates a hierarchy into @c screen, rendering the screenshot if
+  // @c render is true.
+  void Generate(bool render, GTXTestSyntheticScreen *screen);
+
+  // Returns the next pseudo-random number.
+  uint64_t NextRandom();
+
+  // Returns a pseudo-random number uniformly distributed in [0, 1).
+  float Uniform();
+
+  // Returns a pseudo-random number uniformly distributed in [min, max].
+  int UniformInt(int min, int max);
+
+  GTXTestSyntheticHierarchyOptions options_;
+  uint64_t random_state_;
+};
+
+}  // namespace gtxtest
+
+#endif  // THIRD_PARTY_OBJECTIVE_C_GTXILIB_TESTS_COMMON_OOPTESTLIB_CPP_GTXTEST_SYNTHETIC_HIERARCHY_H_
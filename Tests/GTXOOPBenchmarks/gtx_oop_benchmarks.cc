@@ -0,0 +1,351 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks of the hot paths of OOPClasses. See README.md for how to build
+// and run them.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <abseil/absl/container/flat_hash_map.h>
+#include "check_result_clustering.h"
+#include "metadata_map.h"
+#include "typedefs.h"
+#include "allocation_tracker.h"
+#include "check_result_in_hierarchy.h"
+#include "check_result_resource_similarity.h"
+#include "contrast_check.h"
+#include "contrast_swatch.h"
+#include "evaluation_metrics.h"
+#include "gtx_types.h"
+#include "gtxtest_synthetic_hierarchy.h"
+#include "hierarchy_table.h"
+#include "image_buffer.h"
+#include "localized_strings_manager.h"
+#include "nearest_ancestor_relation_resource_id_generator.h"
+#include "parameters.h"
+#include "toolkit.h"
+
+namespace {
+
+// Whether a benchmark exceeded its allocation budget.
+bool allocation_budget_exceeded = false;
+
+// Reports the heap allocations counted by @c allocations over all iterations
+// of @c state, per item with @c items_per_iteration items per iteration, and
+// fails the benchmark and the run if there are more than
+// @c allocations_per_item_budget per item. Allocations are only counted if
+// gtx_allocation_shim.cc is linked in, see README.md.
+void ReportAllocations(benchmark::State &state,
+                       const gtx::ScopedAllocationCounter &allocations,
+                       double items_per_iteration,
+                       double allocations_per_item_budget) {
+  if (!allocations.active() || state.iterations() == 0) {
+    return;
+  }
+  gtx::AllocationCounts counts = allocations.Counts();
+  double items = state.iterations() * items_per_iteration;
+  double allocations_per_item = counts.allocations / items;
+  state.counters["allocs_per_item"] = allocations_per_item;
+  state.counters["bytes_per_item"] = counts.bytes / items;
+  state.counters["peak_bytes"] = counts.peak_bytes;
+  if (allocations_per_item > allocations_per_item_budget) {
+    allocation_budget_exceeded = true;
+    state.SkipWithError(
+        ("allocation budget exceeded: " + std::to_string(allocations_per_item) +
+         " allocations per item, budget " +
+         std::to_string(allocations_per_item_budget))
+            .c_str());
+  }
+}
+
+// Returns a hierarchy of @c element_count elements, with a screenshot, that
+// is the same in every run.
+gtxtest::GTXTestSyntheticScreen SyntheticScreen(int element_count) {
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.element_count = element_count;
+  return gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateScreen();
+}
+
+void BM_ToolkitCheckElements(benchmark::State &state) {
+  gtxtest::GTXTestSyntheticScreen screen =
+      SyntheticScreen(static_cast<int>(state.range(0)));
+  const AccessibilityHierarchyProto &hierarchy = screen.hierarchy();
+  gtx::Parameters params = screen.parameters();
+  std::unique_ptr<gtx::Toolkit> toolkit =
+      gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  gtx::ScopedAllocationCounter allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(toolkit->CheckElements(hierarchy, params));
+  }
+  ReportAllocations(state, allocations, state.range(0),
+                    /*allocations_per_item_budget=*/25);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ToolkitCheckElements)
+    ->RangeMultiplier(10)
+    ->Range(100, 100000)
+    ->Unit(benchmark::kMicrosecond);
+
+// Same as BM_ToolkitCheckElements with metrics recorded, to measure their
+// overhead.
+void BM_ToolkitCheckElementsWithMetrics(benchmark::State &state) {
+  gtxtest::GTXTestSyntheticScreen screen =
+      SyntheticScreen(static_cast<int>(state.range(0)));
+  const AccessibilityHierarchyProto &hierarchy = screen.hierarchy();
+  gtx::Parameters params = screen.parameters();
+  std::unique_ptr<gtx::Toolkit> toolkit =
+      gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  gtx::EvaluationMetrics metrics;
+  toolkit->set_metrics(&metrics);
+  gtx::ScopedAllocationCounter allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(toolkit->CheckElements(hierarchy, params));
+  }
+  ReportAllocations(state, allocations, state.range(0),
+                    /*allocations_per_item_budget=*/25);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ToolkitCheckElementsWithMetrics)
+    ->RangeMultiplier(10)
+    ->Range(100, 100000)
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_ToolkitCheckElementsInTable(benchmark::State &state) {
+  gtxtest::GTXTestSyntheticScreen screen =
+      SyntheticScreen(static_cast<int>(state.range(0)));
+  const AccessibilityHierarchyProto &hierarchy = screen.hierarchy();
+  gtx::Parameters params = screen.parameters();
+  std::unique_ptr<gtx::Toolkit> toolkit =
+      gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  gtx::ScopedAllocationCounter allocations;
+  for (auto _ : state) {
+    gtx::HierarchyTable table = gtx::HierarchyTable::FromProto(hierarchy);
+    benchmark::DoNotOptimize(toolkit->CheckElements(table, params));
+  }
+  ReportAllocations(state, allocations, state.range(0),
+                    /*allocations_per_item_budget=*/15);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ToolkitCheckElementsInTable)
+    ->RangeMultiplier(10)
+    ->Range(100, 100000)
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_ContrastSwatchExtract(benchmark::State &state) {
+  gtxtest::GTXTestSyntheticScreen screen = SyntheticScreen(1000);
+  gtx::Image image = screen.screenshot();
+  float size = state.range(0);
+  gtx::Rect bounds(100, 100, size, size);
+  gtx::ScopedAllocationCounter allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(gtx::ContrastSwatch::Extract(image, bounds));
+  }
+  ReportAllocations(state, allocations, state.range(0) * state.range(0),
+                    /*allocations_per_item_budget=*/0.06);
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(0));
+}
+BENCHMARK(BM_ContrastSwatchExtract)->RangeMultiplier(4)->Range(8, 512);
+
+// Acquires a pooled screenshot buffer, sets it as the screenshot of the
+// parameters of an evaluation, and releases it, as a long-lived evaluator does
+// for each screenshot. Once the pool holds a buffer, none of it allocates.
+void BM_PooledScreenshotCycle(benchmark::State &state) {
+  const int width = 1170;
+  const int height = 2532;
+  gtx::ImageBufferPool pool;
+  gtx::Parameters params;
+  // Fills the pool, and the storage of its size class.
+  pool.Acquire(width, height);
+  gtx::ScopedAllocationCounter allocations;
+  for (auto _ : state) {
+    gtx::ImageBuffer buffer = pool.Acquire(width, height);
+    params.set_screenshot(buffer);
+    benchmark::DoNotOptimize(params.screenshot().pixels);
+    params.set_screenshot(gtx::Image());
+  }
+  ReportAllocations(state, allocations, 1, /*allocations_per_item_budget=*/0);
+}
+BENCHMARK(BM_PooledScreenshotCycle);
+
+void BM_ClusterBySimilarity(benchmark::State &state) {
+  gtxtest::GTXTestSyntheticScreen screen =
+      SyntheticScreen(static_cast<int>(state.range(0)));
+  const AccessibilityHierarchyProto &hierarchy = screen.hierarchy();
+  gtx::Parameters params = screen.parameters();
+  std::vector<CheckResultProto> results =
+      gtx::Toolkit::ToolkitWithAllDefaultChecks()->CheckElements(hierarchy,
+                                                                 params);
+  std::vector<gtx::CheckResultInHierarchy> results_in_hierarchy;
+  for (const CheckResultProto &result : results) {
+    results_in_hierarchy.push_back({result, hierarchy});
+  }
+  gtx::CheckResultResourceSimilarity similarity(
+      gtx::NearestAncestorRelationResourceIDGenerator(
+          gtx::NearestAncestorRelationResourceIDGenerator::IndexType::
+              kExclude));
+  gtx::ScopedAllocationCounter allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        gtx::ClusterBySimilarity(results_in_hierarchy, similarity));
+  }
+  ReportAllocations(state, allocations, results.size(),
+                    /*allocations_per_item_budget=*/270);
+  state.SetItemsProcessed(state.iterations() * results.size());
+}
+BENCHMARK(BM_ClusterBySimilarity)
+    ->RangeMultiplier(4)
+    ->Range(16, 1024)
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_NearestAncestorRelationResourceIDGenerator(benchmark::State &state) {
+  // IDs are generated for the deepest elements of the hierarchy, whose
+  // ancestors are searched for in the whole hierarchy.
+  constexpr int kElementCount = 64;
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.element_count = static_cast<int>(state.range(0));
+  AccessibilityHierarchyProto hierarchy =
+      gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateHierarchy();
+  gtx::NearestAncestorRelationResourceIDGenerator generator(
+      gtx::NearestAncestorRelationResourceIDGenerator::IndexType::kInclude);
+  gtx::ScopedAllocationCounter allocations;
+  for (auto _ : state) {
+    for (int i = 0; i < kElementCount; i++) {
+      benchmark::DoNotOptimize(generator(
+          hierarchy.elements(hierarchy.elements_size() - 1 - i), hierarchy));
+    }
+  }
+  ReportAllocations(state, allocations, kElementCount,
+                    /*allocations_per_item_budget=*/36);
+  state.SetItemsProcessed(state.iterations() * kElementCount);
+}
+BENCHMARK(BM_NearestAncestorRelationResourceIDGenerator)
+    ->RangeMultiplier(10)
+    ->Range(100, 10000)
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_MetadataMapRoundTrip(benchmark::State &state) {
+  gtx::MetadataMap metadata;
+  metadata.SetFloat("KEY_EXPECTED_CONTRAST_RATIO", 4.5);
+  metadata.SetFloat("KEY_ACTUAL_CONTRAST_RATIO", 1.5);
+  metadata.SetString("KEY_FOREGROUND_COLOR", "(40, 40, 40, 255)");
+  metadata.SetString("KEY_BACKGROUND_COLOR", "(220, 220, 220, 255)");
+  metadata.SetInt("KEY_ELEMENT_COUNT", 12);
+  metadata.SetIntList("KEY_ELEMENT_IDS", {1, 2, 3, 5, 8, 13});
+  metadata.SetStringList("KEY_CLASS_NAMES", {"UIView", "UIButton"});
+  gtx::ScopedAllocationCounter allocations;
+  for (auto _ : state) {
+    MetadataProto proto = metadata.ToProto();
+    benchmark::DoNotOptimize(gtx::MetadataMap::FromProto(proto));
+  }
+  ReportAllocations(state, allocations, 1, /*allocations_per_item_budget=*/40);
+}
+BENCHMARK(BM_MetadataMapRoundTrip);
+
+// Returns a strings manager with the English strings of ContrastCheck. The
+// strings are not loaded from ios_translations.bundle so that only rendering
+// is measured.
+gtx::LocalizedStringsManager ContrastCheckStringsManager() {
+  gtx::LocalizedStringMap strings;
+  strings[gtx::kLocalizedStringIDResultMessageInsufficientTextContrast] =
+      "The element's text contrast ratio is $0. This ratio is based on a text "
+      "color of <tt>$1</tt> and background color of <tt>$2</tt>. Consider "
+      "increasing this element's text contrast ratio to $3 or greater.";
+  strings[gtx::kLocalizedStringIDResultBriefMessageInsufficientContrast] =
+      "Consider increasing this element's text foreground to background "
+      "contrast ratio.";
+  strings[gtx::kLocalizedStringIDCheckTitleInsufficientTextContrast] =
+      "Text contrast";
+  absl::flat_hash_map<gtx::Locale, gtx::LocalizedStringMap> strings_by_locale;
+  strings_by_locale[gtx::kLocaleEnglish] = std::move(strings);
+  return gtx::LocalizedStringsManager(std::move(strings_by_locale));
+}
+
+gtx::MetadataMap ContrastCheckMetadata() {
+  gtx::MetadataMap metadata;
+  metadata.SetFloat(gtx::ContrastCheck::KEY_EXPECTED_CONTRAST_RATIO, 4.5);
+  metadata.SetFloat(gtx::ContrastCheck::KEY_ACTUAL_CONTRAST_RATIO, 1.5);
+  metadata.SetString(gtx::ContrastCheck::KEY_FOREGROUND_COLOR,
+                     "(40, 40, 40, 255)");
+  metadata.SetString(gtx::ContrastCheck::KEY_BACKGROUND_COLOR,
+                     "(220, 220, 220, 255)");
+  return metadata;
+}
+
+void BM_LocalizedRichMessage(benchmark::State &state) {
+  gtx::LocalizedStringsManager strings_manager = ContrastCheckStringsManager();
+  gtx::MetadataMap metadata = ContrastCheckMetadata();
+  gtx::ContrastCheck check;
+  gtx::ScopedAllocationCounter allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(check.GetRichMessage(
+        gtx::kLocaleEnglish,
+        gtx::ContrastCheck::RESULT_ID_INSUFFICIENT_CONTRAST_RATIO, metadata,
+        strings_manager));
+  }
+  ReportAllocations(state, allocations, 1, /*allocations_per_item_budget=*/20);
+}
+BENCHMARK(BM_LocalizedRichMessage);
+
+void BM_LocalizedPlainMessage(benchmark::State &state) {
+  gtx::LocalizedStringsManager strings_manager = ContrastCheckStringsManager();
+  gtx::MetadataMap metadata = ContrastCheckMetadata();
+  gtx::ContrastCheck check;
+  gtx::ScopedAllocationCounter allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(check.GetPlainMessage(
+        gtx::kLocaleEnglish,
+        gtx::ContrastCheck::RESULT_ID_INSUFFICIENT_CONTRAST_RATIO, metadata,
+        strings_manager));
+  }
+  ReportAllocations(state, allocations, 1, /*allocations_per_item_budget=*/22);
+}
+BENCHMARK(BM_LocalizedPlainMessage);
+
+}  // namespace
+
+// Reports results as JSON unless another format is requested, so that results
+// can be compared across runs.
+int main(int argc, char **argv) {
+  std::vector<char *> args(argv, argv + argc);
+  char json_format[] = "--benchmark_format=json";
+  bool has_format = false;
+  for (int i = 1; i < argc; i++) {
+    has_format |= strncmp(argv[i], "--benchmark_format", 18) == 0;
+  }
+  if (!has_format) {
+    args.insert(args.begin() + 1, json_format);
+  }
+  int args_count = static_cast<int>(args.size());
+  benchmark::Initialize(&args_count, args.data());
+  if (benchmark::ReportUnrecognizedArguments(args_count, args.data())) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  if (allocation_budget_exceeded) {
+    fprintf(stderr, "gtx_oop_benchmarks: allocation budgets exceeded\n");
+    return 1;
+  }
+  return 0;
+}
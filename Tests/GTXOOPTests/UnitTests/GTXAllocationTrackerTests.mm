@@ -0,0 +1,101 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "allocation_tracker.h"
+
+#import <XCTest/XCTest.h>
+
+#include "proto_serialization.h"
+#include "typedefs.h"
+#include "evaluation_metrics.h"
+
+// The test bundle does not link an allocation shim, so allocations are
+// recorded by calling the shim's hooks directly.
+@interface GTXAllocationTrackerTests : XCTestCase
+@end
+
+@implementation GTXAllocationTrackerTests
+
+- (void)testCounterCountsAllocationsAndPeak {
+  gtx::ScopedAllocationCounter counter(/*active=*/true);
+  gtx::RecordAllocation(100);
+  gtx::RecordAllocation(50);
+  gtx::RecordDeallocation(100);
+  gtx::RecordAllocation(20);
+  gtx::AllocationCounts counts = counter.Counts();
+  XCTAssertEqual(counts.allocations, 3);
+  XCTAssertEqual(counts.bytes, 170);
+  XCTAssertEqual(counts.peak_bytes, 150);
+  gtx::RecordDeallocation(70);
+}
+
+- (void)testNestedCountersHaveTheirOwnPeaks {
+  gtx::ScopedAllocationCounter outer(/*active=*/true);
+  gtx::RecordAllocation(100);
+  {
+    gtx::ScopedAllocationCounter inner(/*active=*/true);
+    gtx::RecordAllocation(10);
+    gtx::RecordDeallocation(10);
+    gtx::AllocationCounts inner_counts = inner.Counts();
+    XCTAssertEqual(inner_counts.allocations, 1);
+    XCTAssertEqual(inner_counts.peak_bytes, 10);
+  }
+  gtx::RecordDeallocation(100);
+  gtx::AllocationCounts outer_counts = outer.Counts();
+  XCTAssertEqual(outer_counts.allocations, 2);
+  XCTAssertEqual(outer_counts.bytes, 110);
+  XCTAssertEqual(outer_counts.peak_bytes, 110);
+}
+
+- (void)testInactiveCounterCountsNothing {
+  gtx::ScopedAllocationCounter counter(/*active=*/false);
+  gtx::RecordAllocation(100);
+  gtx::RecordDeallocation(100);
+  XCTAssertFalse(counter.active());
+  XCTAssertEqual(counter.Counts().allocations, 0);
+}
+
+- (void)testMetricsRecordAllocationsOfChecksAndPhases {
+  gtx::EvaluationMetrics metrics;
+  gtx::AllocationCounts counts;
+  counts.allocations = 2;
+  counts.bytes = 64;
+  counts.peak_bytes = 48;
+  gtx::CheckCounters *counters = metrics.CountersForCheck("check");
+  counters->RecordAllocations(counts);
+  counts.peak_bytes = 16;
+  counters->RecordAllocations(counts);
+  metrics.RecordPhaseAllocations(gtx::EvaluationPhase::kRender, counts);
+
+  gtx::EvaluationMetricsSnapshot snapshot = metrics.Snapshot();
+  XCTAssertEqual(snapshot.checks[0].allocations, 4);
+  XCTAssertEqual(snapshot.checks[0].allocated_bytes, 128);
+  XCTAssertEqual(snapshot.checks[0].max_peak_bytes, 48);
+  const gtx::PhaseMetricsSnapshot &render =
+      snapshot.phases[static_cast<int>(gtx::EvaluationPhase::kRender)];
+  XCTAssertEqual(render.allocations, 2);
+  XCTAssertEqual(render.max_peak_bytes, 16);
+
+  EvaluationMetricsProto parsed;
+  XCTAssertTrue(
+      gtx::ParseProto(gtx::SerializeProto(snapshot.ToProto()), &parsed));
+  XCTAssertEqual(parsed.checks(0).allocations(), 4);
+  XCTAssertEqual(parsed.checks(0).allocated_bytes(), 128);
+  XCTAssertEqual(parsed.checks(0).max_peak_bytes(), 48);
+  XCTAssertEqual(parsed.phases(3).allocations(), 2);
+}
+
+@end
@@ -0,0 +1,256 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "banded_screenshot.h"
+
+#import <XCTest/XCTest.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <abseil/absl/types/optional.h>
+#include "typedefs.h"
+#include "contrast_check.h"
+#include "contrast_swatch.h"
+#include "element_trait.h"
+#include "gtx_types.h"
+#include "luminance_plane.h"
+#include "parameters.h"
+
+static const int kGTXTestImageWidth = 50;
+static const int kGTXTestImageHeight = 100;
+static const int kGTXTestBandHeight = 8;
+
+@interface GTXBandedScreenshotTests : XCTestCase
+@end
+
+@implementation GTXBandedScreenshotTests {
+  std::vector<gtx::Pixel> _pixels;
+}
+
+- (void)setUp {
+  [super setUp];
+  // Text-like blocks on a gradient, so that rows differ and filters matter.
+  _pixels.resize(kGTXTestImageWidth * kGTXTestImageHeight);
+  for (int y = 0; y < kGTXTestImageHeight; y++) {
+    for (int x = 0; x < kGTXTestImageWidth; x++) {
+      gtx::Pixel &pixel = _pixels[x + y * kGTXTestImageWidth];
+      bool text = (x / 5) % 2 == 0 && (y / 10) % 3 == 1;
+      pixel.red = static_cast<unsigned char>(text ? 20 : 200 + y / 2);
+      pixel.green = static_cast<unsigned char>(text ? 20 : 230);
+      pixel.blue = static_cast<unsigned char>(text ? 40 : x * 5);
+      pixel.alpha = static_cast<unsigned char>(255 - (x + y) % 3);
+    }
+  }
+}
+
+- (void)testPngRowsMatchPixels {
+  std::string png = [self pngData];
+  std::unique_ptr<gtx::BandedScreenshot> screenshot =
+      gtx::BandedScreenshot::FromData(png, kGTXTestBandHeight, 2);
+  XCTAssertTrue(screenshot != nullptr);
+  XCTAssertEqual(screenshot->width(), kGTXTestImageWidth);
+  XCTAssertEqual(screenshot->height(), kGTXTestImageHeight);
+  // Bands out of order, discarded and decoded again from checkpoints.
+  const int firstRows[] = {90, 3, 40, 0, 64, 17, 99, 30};
+  for (int firstRow : firstRows) {
+    [self assertRows:screenshot->Rows(firstRow, firstRow + 12) equalPixelsFromRow:firstRow];
+  }
+  XCTAssertTrue(screenshot->ok());
+  XCTAssertLessThanOrEqual(screenshot->peak_cached_bytes(),
+                           2 * kGTXTestBandHeight * kGTXTestImageWidth * sizeof(gtx::Pixel));
+}
+
+- (void)testPpmRowsMatchPixels {
+  std::string ppm = "P6\n# A comment\n" + std::to_string(kGTXTestImageWidth) + " " +
+                    std::to_string(kGTXTestImageHeight) + "\n255\n";
+  for (gtx::Pixel &pixel : _pixels) {
+    pixel.alpha = 255;
+    ppm.push_back(static_cast<char>(pixel.red));
+    ppm.push_back(static_cast<char>(pixel.green));
+    ppm.push_back(static_cast<char>(pixel.blue));
+  }
+  std::unique_ptr<gtx::BandedScreenshot> screenshot =
+      gtx::BandedScreenshot::FromData(ppm, kGTXTestBandHeight, 2);
+  XCTAssertTrue(screenshot != nullptr);
+  [self assertRows:screenshot->Rows(0, kGTXTestImageHeight) equalPixelsFromRow:0];
+  [self assertRows:screenshot->Rows(33, 35) equalPixelsFromRow:33];
+}
+
+- (void)testRowsAreClippedAndOutliveTheirBands {
+  std::string png = [self pngData];
+  std::unique_ptr<gtx::BandedScreenshot> screenshot =
+      gtx::BandedScreenshot::FromData(png, kGTXTestBandHeight, 1);
+  gtx::ScreenshotRows rows = screenshot->Rows(-5, 4);
+  XCTAssertEqual(rows.first_row(), 0);
+  XCTAssertEqual(rows.image().height, 4);
+  // Reading another band discards the first from the cache, not from rows.
+  screenshot->Rows(50, 51);
+  [self assertRows:rows equalPixelsFromRow:0];
+  XCTAssertTrue(screenshot->Rows(kGTXTestImageHeight, kGTXTestImageHeight + 5).image().pixels ==
+                nullptr);
+  XCTAssertEqual(screenshot->decoded_band_count(), 2);
+}
+
+- (void)testUnsupportedOrCorruptDataIsRejected {
+  XCTAssertTrue(gtx::BandedScreenshot::FromData("not an image") == nullptr);
+  std::string png = [self pngData];
+  std::string sixteenBit = png;
+  sixteenBit[8 + 8 + 8] = 16;
+  XCTAssertTrue(gtx::BandedScreenshot::FromData(sixteenBit) == nullptr);
+
+  // Sizes larger than any screen, or than the compressed data can hold.
+  std::string tooWide = png;
+  tooWide.replace(8 + 8, 4, std::string("\x00\x01\x00\x00", 4));
+  XCTAssertTrue(gtx::BandedScreenshot::FromData(tooWide) == nullptr);
+  std::string tooLarge = png;
+  tooLarge.replace(8 + 8, 8, std::string("\x00\x00\x40\x00\x00\x00\x08\x00", 8));
+  XCTAssertTrue(gtx::BandedScreenshot::FromData(tooLarge) == nullptr);
+
+  // Corrupt the compressed data past its first rows.
+  std::string corrupt = png;
+  const size_t idat = corrupt.find("IDAT");
+  for (size_t i = idat + 200; i < idat + 400; i++) {
+    corrupt[i] = static_cast<char>(0xff);
+  }
+  std::unique_ptr<gtx::BandedScreenshot> screenshot =
+      gtx::BandedScreenshot::FromData(corrupt, kGTXTestBandHeight);
+  XCTAssertTrue(screenshot != nullptr);
+  gtx::ScreenshotRows rows = screenshot->Rows(kGTXTestImageHeight - 1, kGTXTestImageHeight);
+  XCTAssertFalse(screenshot->ok());
+  XCTAssertEqual(rows.image().pixels[0].alpha, 0);
+}
+
+- (void)testSwatchesAndLuminanceMatchDecodedImage {
+  std::string png = [self pngData];
+  std::unique_ptr<gtx::BandedScreenshot> screenshot =
+      gtx::BandedScreenshot::FromData(png, kGTXTestBandHeight, 3);
+  gtx::Image image(_pixels.data(), kGTXTestImageWidth, kGTXTestImageHeight);
+  const gtx::Rect rects[] = {gtx::Rect(0, 10, 50, 10), gtx::Rect(3.5f, 7.25f, 30, 41),
+                             gtx::Rect(-10, -10, 30, 30), gtx::Rect(40, 90, 30, 30),
+                             gtx::Rect(0, 0, kGTXTestImageWidth, kGTXTestImageHeight)};
+  for (const gtx::Rect &rect : rects) {
+    gtx::ContrastSwatch expected = gtx::ContrastSwatch::Extract(image, rect);
+    gtx::ContrastSwatch swatch = gtx::ContrastSwatch::Extract(*screenshot, rect);
+    XCTAssertTrue(swatch.foreground() == expected.foreground());
+    XCTAssertTrue(swatch.background() == expected.background());
+  }
+  gtx::LuminancePlane expected = gtx::LuminancePlane::FromImage(image, 1);
+  XCTAssertTrue(gtx::LuminancePlane::FromBandedScreenshot(*screenshot, 4).values() ==
+                expected.values());
+}
+
+- (void)testContrastCheckDecodesOnlyBandsUnderElement {
+  std::string png = [self pngData];
+  std::unique_ptr<gtx::BandedScreenshot> screenshot =
+      gtx::BandedScreenshot::FromData(png, kGTXTestBandHeight);
+  gtx::Parameters params;
+  params.set_screenshot(gtx::Image(nullptr, kGTXTestImageWidth, kGTXTestImageHeight));
+  params.set_banded_screenshot(screenshot.get());
+  params.set_device_bounds(gtx::Rect(0, 0, kGTXTestImageWidth, kGTXTestImageHeight));
+  UIElementProto element;
+  element.set_is_ax_element(true);
+  element.set_ax_traits(static_cast<uint64_t>(gtx::ElementTrait::kStaticText));
+  RectProto *frame = element.mutable_ax_frame();
+  frame->mutable_origin()->set_x(0);
+  frame->mutable_origin()->set_y(10);
+  frame->mutable_size()->set_width(kGTXTestImageWidth);
+  frame->mutable_size()->set_height(10);
+  gtx::ContrastCheck check;
+  XCTAssertFalse(check.CheckElement(element, params).has_value());
+  XCTAssertEqual(screenshot->decoded_band_count(), 2);
+}
+
+#pragma mark - Private Methods
+
+// Returns the pixels encoded as an RGBA PNG, cycling through the filter types
+// row by row, in two IDAT chunks.
+- (std::string)pngData {
+  const size_t stride = kGTXTestImageWidth * 4;
+  std::vector<unsigned char> raw;
+  std::vector<unsigned char> previous(stride, 0);
+  for (int y = 0; y < kGTXTestImageHeight; y++) {
+    const unsigned char *row =
+        reinterpret_cast<const unsigned char *>(_pixels.data() + y * kGTXTestImageWidth);
+    const int filter = y % 5;
+    raw.push_back(static_cast<unsigned char>(filter));
+    for (size_t i = 0; i < stride; i++) {
+      int a = i >= 4 ? row[i - 4] : 0;
+      int b = previous[i];
+      int c = i >= 4 ? previous[i - 4] : 0;
+      int predictor = 0;
+      if (filter == 1) {
+        predictor = a;
+      } else if (filter == 2) {
+        predictor = b;
+      } else if (filter == 3) {
+        predictor = (a + b) / 2;
+      } else if (filter == 4) {
+        int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+        predictor = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+      }
+      raw.push_back(static_cast<unsigned char>(row[i] - predictor));
+    }
+    memcpy(previous.data(), row, stride);
+  }
+  uLongf compressedSize = compressBound(raw.size());
+  std::string compressed(compressedSize, '\0');
+  compress(reinterpret_cast<Bytef *>(&compressed[0]), &compressedSize, raw.data(), raw.size());
+  compressed.resize(compressedSize);
+
+  std::string png("\x89PNG\r\n\x1a\n", 8);
+  std::string header;
+  [self appendBigEndian:kGTXTestImageWidth to:&header];
+  [self appendBigEndian:kGTXTestImageHeight to:&header];
+  header += std::string("\x08\x06\x00\x00\x00", 5);
+  [self appendChunk:"IHDR" data:header to:&png];
+  const size_t half = compressed.size() / 2;
+  [self appendChunk:"IDAT" data:compressed.substr(0, half) to:&png];
+  [self appendChunk:"IDAT" data:compressed.substr(half) to:&png];
+  [self appendChunk:"IEND" data:"" to:&png];
+  return png;
+}
+
+- (void)appendBigEndian:(uint32_t)value to:(std::string *)bytes {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    bytes->push_back(static_cast<char>(value >> shift));
+  }
+}
+
+- (void)appendChunk:(const char *)type data:(const std::string &)data to:(std::string *)png {
+  [self appendBigEndian:static_cast<uint32_t>(data.size()) to:png];
+  std::string typeAndData = std::string(type) + data;
+  png->append(typeAndData);
+  uLong crc = crc32(0L, reinterpret_cast<const Bytef *>(typeAndData.data()),
+                    static_cast<uInt>(typeAndData.size()));
+  [self appendBigEndian:static_cast<uint32_t>(crc) to:png];
+}
+
+- (void)assertRows:(const gtx::ScreenshotRows &)rows equalPixelsFromRow:(int)firstRow {
+  XCTAssertEqual(rows.first_row(), firstRow);
+  XCTAssertEqual(rows.image().width, kGTXTestImageWidth);
+  const gtx::Pixel *expected = _pixels.data() + firstRow * kGTXTestImageWidth;
+  for (int i = 0; i < rows.image().width * rows.image().height; i++) {
+    XCTAssertTrue(rows.image().pixels[i] == expected[i]);
+  }
+}
+
+@end
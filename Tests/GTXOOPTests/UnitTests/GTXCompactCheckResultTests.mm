@@ -0,0 +1,147 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include "check.h"
+
+#import <XCTest/XCTest.h>
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "proto_serialization.h"
+#include "typedefs.h"
+#include "gtxtest_always_failing_check.h"
+#include "gtxtest_synthetic_hierarchy.h"
+#include "evaluation_options.h"
+#include "parameters.h"
+#include "toolkit.h"
+
+static const int kGTXTestScreenCount = 3;
+static const int kGTXTestElementCount = 300;
+
+@interface GTXCompactCheckResultTests : XCTestCase
+@end
+
+@implementation GTXCompactCheckResultTests
+
+- (void)testCompactResultsExpandToCheckElementsResults {
+  std::unique_ptr<gtx::Toolkit> toolkit = gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  std::unique_ptr<gtx::Check> check =
+      std::make_unique<gtxtest::GTXTestAlwaysFailingCheck>("AlwaysFailing");
+  toolkit->RegisterCheck(check);
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.element_count = kGTXTestElementCount;
+  gtxtest::GTXTestSyntheticHierarchyGenerator generator(options);
+  for (int i = 0; i < kGTXTestScreenCount; i++) {
+    gtxtest::GTXTestSyntheticScreen screen = generator.GenerateScreen();
+    std::vector<CheckResultProto> expected =
+        toolkit->CheckElements(screen.hierarchy(), screen.parameters());
+    std::vector<gtx::CompactCheckResult> results =
+        toolkit->CheckElementsCompact(screen.hierarchy(), screen.parameters());
+    XCTAssertGreaterThan(expected.size(), 0u);
+    XCTAssertEqual(results.size(), expected.size());
+    for (size_t j = 0; j < results.size() && j < expected.size(); j++) {
+      const gtx::CompactCheckResult &result = results[j];
+      XCTAssertEqual(result.result_id, expected[j].result_id());
+      XCTAssertEqual(result.element_id,
+                     screen.hierarchy().elements(result.element_index).id());
+      CheckResultProto proto =
+          toolkit->ToCheckResultProto(result, screen.hierarchy(), screen.parameters());
+      XCTAssertTrue(gtx::SerializeProto(proto) == gtx::SerializeProto(expected[j]));
+    }
+  }
+}
+
+- (void)testCountsMatchResults {
+  std::unique_ptr<gtx::Toolkit> toolkit = gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.element_count = kGTXTestElementCount;
+  gtxtest::GTXTestSyntheticHierarchyGenerator generator(options);
+  gtx::CheckResultCounts aggregate;
+  std::vector<gtx::CompactCheckResult> all_results;
+  for (int i = 0; i < kGTXTestScreenCount; i++) {
+    gtxtest::GTXTestSyntheticScreen screen = generator.GenerateScreen();
+    gtx::CheckResultCounts counts =
+        toolkit->CountCheckResults(screen.hierarchy(), screen.parameters());
+    std::vector<gtx::CompactCheckResult> results =
+        toolkit->CheckElementsCompact(screen.hierarchy(), screen.parameters());
+    XCTAssertEqual(counts.total(), static_cast<int64_t>(results.size()));
+    XCTAssertEqual(counts.check_count(),
+                   static_cast<int>(toolkit->registered_check_count()));
+    aggregate.Add(counts);
+    all_results.insert(all_results.end(), results.begin(), results.end());
+  }
+  XCTAssertEqual(aggregate.total(), static_cast<int64_t>(all_results.size()));
+  for (size_t i = 0; i < toolkit->registered_check_count(); i++) {
+    int64_t check_count = 0;
+    std::vector<int64_t> result_id_counts;
+    for (const gtx::CompactCheckResult &result : all_results) {
+      if (result.check_index != static_cast<int32_t>(i)) {
+        continue;
+      }
+      check_count++;
+      if (result.result_id >= static_cast<int>(result_id_counts.size())) {
+        result_id_counts.resize(result.result_id + 1);
+      }
+      result_id_counts[result.result_id]++;
+    }
+    XCTAssertGreaterThan(check_count, 0);
+    XCTAssertEqual(aggregate.Count(static_cast<int>(i)), check_count);
+    for (size_t j = 0; j < result_id_counts.size(); j++) {
+      XCTAssertEqual(aggregate.Count(static_cast<int>(i), static_cast<int>(j)),
+                     result_id_counts[j]);
+    }
+  }
+  XCTAssertEqual(aggregate.Count(-1), 0);
+  XCTAssertEqual(aggregate.Count(0, 1000), 0);
+}
+
+- (void)testCountsOfNegativeIdsAreInvalid {
+  gtx::CheckResultCounts counts;
+  counts.Record(0, 2);
+  counts.Record(0, -1);
+  counts.Record(-1, 0);
+  XCTAssertEqual(counts.total(), 1);
+  XCTAssertEqual(counts.invalid_count(), 2);
+  XCTAssertEqual(counts.check_count(), 1);
+  XCTAssertEqual(counts.Count(0), 1);
+  XCTAssertEqual(counts.Count(0, -1), 0);
+  XCTAssertEqual(counts.Count(-1, 0), 0);
+  gtx::CheckResultCounts aggregate;
+  aggregate.Add(counts);
+  XCTAssertEqual(aggregate.total(), 1);
+  XCTAssertEqual(aggregate.invalid_count(), 2);
+}
+
+- (void)testCompactEvaluationSkipsInvisibleElements {
+  std::unique_ptr<gtx::Toolkit> toolkit = gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  toolkit->set_skips_invisible_elements(true);
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.element_count = kGTXTestElementCount;
+  gtxtest::GTXTestSyntheticScreen screen =
+      gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateScreen();
+  std::vector<CheckResultProto> expected =
+      toolkit->CheckElements(screen.hierarchy(), screen.parameters());
+  gtx::CheckResultCounts counts =
+      toolkit->CountCheckResults(screen.hierarchy(), screen.parameters());
+  XCTAssertEqual(counts.total(), static_cast<int64_t>(expected.size()));
+}
+
+@end
@@ -0,0 +1,186 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "contrast_swatch.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <vector>
+
+#include <abseil/absl/types/optional.h>
+#include "typedefs.h"
+#include "check.h"
+#include "contrast_check.h"
+#include "element_trait.h"
+#include "gtx_types.h"
+#include "palette_image.h"
+#include "parameters.h"
+#include "rle_image.h"
+#include "toolkit.h"
+#include "gtxtest_synthetic_hierarchy.h"
+
+static const int kGTXTestImageSize = 128;
+static const int kGTXTestStride = 4;
+
+@interface GTXContrastApproximationTests : XCTestCase
+@end
+
+@implementation GTXContrastApproximationTests {
+  std::vector<gtx::Pixel> _pixels;
+}
+
+- (void)setUp {
+  [super setUp];
+  _pixels.assign(kGTXTestImageSize * kGTXTestImageSize, [self colorWithShade:255]);
+}
+
+- (void)testEstimateMatchesExtractOfAllEncodings {
+  [self fillRect:gtx::Rect(10, 10, 60, 30) withShade:0];
+  gtx::Image image = [self rgbaImage];
+  gtx::Rect bounds(0, 0, kGTXTestImageSize, kGTXTestImageSize);
+  gtx::ContrastSwatch expected = gtx::ContrastSwatch::Extract(image, bounds);
+  absl::optional<gtx::ContrastSwatch> estimate =
+      gtx::ContrastSwatch::Estimate(image, bounds, kGTXTestStride);
+  XCTAssertTrue(estimate.has_value());
+  [self assertSwatch:*estimate equals:expected];
+  estimate = gtx::ContrastSwatch::Estimate(gtx::PaletteImage::Encode(image), bounds,
+                                           kGTXTestStride);
+  XCTAssertTrue(estimate.has_value());
+  [self assertSwatch:*estimate equals:expected];
+  estimate =
+      gtx::ContrastSwatch::Estimate(gtx::RleImage::Encode(image), bounds, kGTXTestStride);
+  XCTAssertTrue(estimate.has_value());
+  [self assertSwatch:*estimate equals:expected];
+}
+
+- (void)testEstimateOfSmallSampleIsNotDecisive {
+  [self fillRect:gtx::Rect(0, 0, 8, 4) withShade:0];
+  XCTAssertFalse(gtx::ContrastSwatch::Estimate([self rgbaImage], gtx::Rect(0, 0, 8, 8),
+                                               kGTXTestStride)
+                     .has_value());
+}
+
+- (void)testEstimateWithRivalOfForegroundIsNotDecisive {
+  // Two colors of about the same area compete for the foreground.
+  [self fillRect:gtx::Rect(0, 0, 64, 20) withShade:0];
+  [self fillRect:gtx::Rect(64, 0, 64, 16) withShade:128];
+  gtx::Rect bounds(0, 0, kGTXTestImageSize, kGTXTestImageSize);
+  XCTAssertFalse(
+      gtx::ContrastSwatch::Estimate([self rgbaImage], bounds, kGTXTestStride).has_value());
+}
+
+- (void)testColorsOfEqualCountDoNotDependOnEncoding {
+  [self fillRect:gtx::Rect(0, 0, 64, 16) withShade:0];
+  [self fillRect:gtx::Rect(64, 0, 64, 16) withShade:128];
+  gtx::Image image = [self rgbaImage];
+  gtx::Rect bounds(0, 0, kGTXTestImageSize, kGTXTestImageSize);
+  gtx::ContrastSwatch expected = gtx::ContrastSwatch::Extract(image, bounds);
+  [self assertSwatch:gtx::ContrastSwatch::Extract(gtx::PaletteImage::Encode(image), bounds)
+              equals:expected];
+  [self assertSwatch:gtx::ContrastSwatch::Extract(gtx::RleImage::Encode(image), bounds)
+              equals:expected];
+}
+
+- (void)testSwatchOfSubImageWithoutPixelsIsEmpty {
+  [self fillRect:gtx::Rect(0, 0, 64, 16) withShade:0];
+  gtx::Image image = [self rgbaImage];
+  gtx::Rect outside(0, kGTXTestImageSize, 10, 10);
+  gtx::Rect empty(10, 10, 0, 0);
+  XCTAssertFalse(gtx::ContrastSwatch::Extract(image, gtx::Rect(0, 0, 10, 10)).empty());
+  XCTAssertTrue(gtx::ContrastSwatch::Extract(image, outside).empty());
+  XCTAssertTrue(gtx::ContrastSwatch::Extract(image, empty).empty());
+  XCTAssertTrue(gtx::ContrastSwatch::Extract(gtx::PaletteImage::Encode(image), outside).empty());
+  XCTAssertTrue(gtx::ContrastSwatch::Extract(gtx::RleImage::Encode(image), outside).empty());
+  XCTAssertTrue(gtx::ContrastSwatch::Extract(gtx::Image(), empty).empty());
+}
+
+- (void)testCheckPassesTextOutsideScreenshot {
+  gtx::Parameters params;
+  params.set_screenshot([self rgbaImage]);
+  params.set_device_bounds(gtx::Rect(0, 0, kGTXTestImageSize, kGTXTestImageSize));
+  UIElementProto element;
+  element.set_id(1);
+  element.set_is_ax_element(true);
+  element.set_ax_traits(static_cast<uint64_t>(gtx::ElementTrait::kStaticText));
+  element.mutable_ax_frame()->mutable_origin()->set_y(kGTXTestImageSize);
+  element.mutable_ax_frame()->mutable_size()->set_width(20);
+  element.mutable_ax_frame()->mutable_size()->set_height(20);
+  gtx::ContrastCheck check;
+  XCTAssertFalse(check.CheckElement(element, params).has_value());
+  gtx::CompactCheckResult result;
+  XCTAssertFalse(check.CheckElementCompact(element, params, &result));
+  element.mutable_ax_frame()->mutable_origin()->set_y(0);
+  // The text, in the top left corner, is black on white.
+  [self fillRect:gtx::Rect(0, 0, 20, 20) withShade:255];
+  [self fillRect:gtx::Rect(2, 2, 10, 5) withShade:0];
+  XCTAssertFalse(check.CheckElement(element, params).has_value());
+  [self fillRect:gtx::Rect(2, 2, 10, 5) withShade:250];
+  XCTAssertTrue(check.CheckElement(element, params).has_value());
+}
+
+- (void)testApproximateCheckFindsSameResults {
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.element_count = 500;
+  gtxtest::GTXTestSyntheticScreen screen =
+      gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateScreen();
+  gtx::Parameters params = screen.parameters();
+  gtx::Toolkit exactToolkit;
+  std::unique_ptr<gtx::Check> exactCheck = std::make_unique<gtx::ContrastCheck>();
+  exactToolkit.RegisterCheck(exactCheck);
+  gtx::Toolkit approximateToolkit;
+  std::unique_ptr<gtx::Check> approximateCheck =
+      std::make_unique<gtx::ContrastCheck>(gtx::ContrastApproximation());
+  approximateToolkit.RegisterCheck(approximateCheck);
+  std::vector<CheckResultProto> expected = exactToolkit.CheckElements(screen.hierarchy(), params);
+  std::vector<CheckResultProto> results =
+      approximateToolkit.CheckElements(screen.hierarchy(), params);
+  XCTAssertGreaterThan(expected.size(), 0ul);
+  XCTAssertEqual(results.size(), expected.size());
+  for (size_t i = 0; i < results.size() && i < expected.size(); i++) {
+    XCTAssertEqual(results[i].hierarchy_source_id(), expected[i].hierarchy_source_id());
+  }
+}
+
+#pragma mark - Private Methods
+
+- (gtx::Pixel)colorWithShade:(int)shade {
+  gtx::Pixel pixel;
+  pixel.red = static_cast<unsigned char>(shade);
+  pixel.green = static_cast<unsigned char>(shade);
+  pixel.blue = static_cast<unsigned char>(shade);
+  pixel.alpha = 255;
+  return pixel;
+}
+
+- (void)fillRect:(const gtx::Rect &)rect withShade:(int)shade {
+  for (int y = rect.origin.y; y < rect.GetMaxY(); y++) {
+    for (int x = rect.origin.x; x < rect.GetMaxX(); x++) {
+      _pixels[x + y * kGTXTestImageSize] = [self colorWithShade:shade];
+    }
+  }
+}
+
+- (gtx::Image)rgbaImage {
+  return gtx::Image(_pixels.data(), kGTXTestImageSize, kGTXTestImageSize);
+}
+
+- (void)assertSwatch:(gtx::ContrastSwatch)swatch equals:(gtx::ContrastSwatch)expected {
+  XCTAssertTrue(swatch.foreground() == expected.foreground());
+  XCTAssertTrue(swatch.background() == expected.background());
+}
+
+@end
@@ -0,0 +1,187 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "corpus_replay.h"
+
+#import <XCTest/XCTest.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "typedefs.h"
+#include "gtxtest_synthetic_hierarchy.h"
+#include "record_stream.h"
+
+static const int kGTXTestElementCount = 50;
+
+@interface GTXCorpusReplayTests : XCTestCase
+@end
+
+@implementation GTXCorpusReplayTests {
+  std::string _path;
+}
+
+- (void)setUp {
+  [super setUp];
+  NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"corpus.gtxr"];
+  _path = path.UTF8String;
+}
+
+- (void)tearDown {
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  [fileManager removeItemAtPath:@(_path.c_str()) error:nil];
+  [fileManager removeItemAtPath:@((_path + ".screenshots").c_str()) error:nil];
+  [super tearDown];
+}
+
+// Writes a record stream of @c count synthetic hierarchies to @c _path. If
+// @c withScreenshots is true, also writes their screenshots next to it.
+- (void)writeCorpusWithCount:(int)count screenshots:(bool)withScreenshots {
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.element_count = kGTXTestElementCount;
+  gtxtest::GTXTestSyntheticHierarchyGenerator generator(options);
+  std::unique_ptr<gtx::RecordWriter> writer =
+      gtx::RecordWriter::Create(_path, gtx::RecordType::kEvaluation);
+  std::string screenshotDirectory = _path + ".screenshots";
+  if (withScreenshots) {
+    [[NSFileManager defaultManager] createDirectoryAtPath:@(screenshotDirectory.c_str())
+                              withIntermediateDirectories:YES
+                                               attributes:nil
+                                                    error:nil];
+  }
+  for (int i = 0; i < count; i++) {
+    gtxtest::GTXTestSyntheticScreen screen = generator.GenerateScreen();
+    AccessibilityEvaluationProto evaluation;
+    *evaluation.mutable_hierarchy() = screen.hierarchy();
+    XCTAssertTrue(writer->WriteEvaluation(evaluation));
+    if (withScreenshots) {
+      gtx::Image screenshot = screen.screenshot();
+      std::ofstream file(screenshotDirectory + "/" + std::to_string(i) + ".rgba",
+                         std::ios::binary);
+      file.write(reinterpret_cast<const char *>(screenshot.pixels),
+                 screenshot.width * screenshot.height * sizeof(gtx::Pixel));
+    }
+  }
+  XCTAssertTrue(writer->Close());
+}
+
+- (void)testReplayCountsHierarchiesAndElements {
+  [self writeCorpusWithCount:5 screenshots:false];
+  gtx::ReplayOptions options;
+  options.threads = 2;
+  gtx::ReplayReport report = gtx::CorpusReplay::Create(options)->Replay({_path});
+  XCTAssertEqual(report.hierarchies, 5);
+  XCTAssertEqual(report.elements, 5 * kGTXTestElementCount);
+  XCTAssertEqual(report.screenshots, 0);
+  XCTAssertGreaterThan(report.results, 0);
+  XCTAssertTrue(report.errors.empty());
+  XCTAssertLessThanOrEqual(report.p50_latency_nanoseconds, report.p99_latency_nanoseconds);
+  XCTAssertLessThanOrEqual(report.p99_latency_nanoseconds, report.max_latency_nanoseconds);
+  XCTAssertGreaterThan(report.max_latency_nanoseconds, 0);
+}
+
+- (void)testReplayReadsScreenshotsNextToRecordStream {
+  [self writeCorpusWithCount:3 screenshots:true];
+  gtx::ReplayOptions options;
+  options.threads = 1;
+  gtx::ReplayReport report = gtx::CorpusReplay::Create(options)->Replay({_path});
+  XCTAssertEqual(report.hierarchies, 3);
+  XCTAssertEqual(report.screenshots, 3);
+  XCTAssertTrue(report.errors.empty());
+}
+
+- (void)testEvaluationPathsProduceSameResults {
+  [self writeCorpusWithCount:4 screenshots:true];
+  gtx::ReplayOptions options;
+  options.threads = 2;
+  gtx::ReplayReport protoReport = gtx::CorpusReplay::Create(options)->Replay({_path});
+  options.evaluation_path = gtx::ReplayEvaluationPath::kHierarchyTable;
+  gtx::ReplayReport tableReport = gtx::CorpusReplay::Create(options)->Replay({_path});
+  XCTAssertEqual(protoReport.results, tableReport.results);
+}
+
+- (void)testScreenshotEncodingsProduceSameResults {
+  [self writeCorpusWithCount:4 screenshots:true];
+  gtx::ReplayOptions options;
+  options.threads = 2;
+  gtx::ReplayReport rgbaReport = gtx::CorpusReplay::Create(options)->Replay({_path});
+  options.screenshot_encoding = gtx::ReplayScreenshotEncoding::kPalette;
+  gtx::ReplayReport paletteReport = gtx::CorpusReplay::Create(options)->Replay({_path});
+  XCTAssertEqual(paletteReport.screenshots, 4);
+  XCTAssertEqual(rgbaReport.results, paletteReport.results);
+  options.screenshot_encoding = gtx::ReplayScreenshotEncoding::kRunLength;
+  gtx::ReplayReport rleReport = gtx::CorpusReplay::Create(options)->Replay({_path});
+  XCTAssertEqual(rleReport.screenshots, 4);
+  XCTAssertEqual(rgbaReport.results, rleReport.results);
+}
+
+- (void)testPreloadedCorpusIsRepeated {
+  [self writeCorpusWithCount:4 screenshots:false];
+  gtx::ReplayOptions options;
+  options.threads = 2;
+  gtx::ReplayReport once = gtx::CorpusReplay::Create(options)->Replay({_path});
+  options.preloads_corpus = true;
+  options.repeat_count = 3;
+  gtx::ReplayReport repeated = gtx::CorpusReplay::Create(options)->Replay({_path});
+  XCTAssertEqual(repeated.hierarchies, 12);
+  XCTAssertEqual(repeated.results, 3 * once.results);
+}
+
+- (void)testCheckNamesSelectChecks {
+  [self writeCorpusWithCount:2 screenshots:false];
+  gtx::ReplayOptions options;
+  options.threads = 1;
+  gtx::ReplayReport all = gtx::CorpusReplay::Create(options)->Replay({_path});
+  options.check_names = {"NoLabelCheck"};
+  gtx::ReplayReport noLabel = gtx::CorpusReplay::Create(options)->Replay({_path});
+  XCTAssertGreaterThan(noLabel.results, 0);
+  XCTAssertLessThan(noLabel.results, all.results);
+}
+
+- (void)testUnknownCheckIsRejected {
+  gtx::ReplayOptions options;
+  options.check_names = {"NoSuchCheck"};
+  XCTAssertTrue(gtx::CorpusReplay::Create(options) == nullptr);
+}
+
+- (void)testUnreadableInputIsReported {
+  {
+    std::ofstream file(_path, std::ios::binary);
+    file << "not an evaluation";
+  }
+  gtx::ReplayOptions options;
+  options.threads = 1;
+  gtx::ReplayReport report = gtx::CorpusReplay::Create(options)->Replay({_path});
+  XCTAssertEqual(report.hierarchies, 0);
+  XCTAssertEqual(report.errors.size(), 1);
+}
+
+- (void)testDeviceBoundsFallBackToScreenshotSize {
+  AccessibilityHierarchyProto hierarchy;
+  DisplayMetricsProto *metrics = hierarchy.mutable_device_state()->mutable_display_metrics();
+  metrics->set_screen_scale(2);
+  gtx::Rect bounds = gtx::DeviceBoundsOfHierarchy(hierarchy, 200, 100);
+  XCTAssertEqual(bounds.size.width, 100);
+  XCTAssertEqual(bounds.size.height, 50);
+  metrics->set_screen_width(320);
+  metrics->set_screen_height(480);
+  bounds = gtx::DeviceBoundsOfHierarchy(hierarchy, 200, 100);
+  XCTAssertEqual(bounds.size.width, 320);
+  XCTAssertEqual(bounds.size.height, 480);
+}
+
+@end
@@ -0,0 +1,164 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "evaluation_metrics.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <string>
+
+#include "proto_serialization.h"
+#include "typedefs.h"
+#include "hierarchy_table.h"
+#include "toolkit.h"
+#include "gtxtest_always_failing_check.h"
+#include "gtxtest_always_passing_check.h"
+
+@interface GTXEvaluationMetricsTests : XCTestCase
+@end
+
+@implementation GTXEvaluationMetricsTests {
+  AccessibilityHierarchyProto _hierarchy;
+  gtx::Parameters _params;
+}
+
+- (void)setUp {
+  [super setUp];
+  // A container with two accessibility elements.
+  UIElementProto *container = _hierarchy.add_elements();
+  container->set_id(0);
+  container->add_child_ids(1);
+  container->add_child_ids(2);
+  for (int id = 1; id <= 2; id++) {
+    UIElementProto *element = _hierarchy.add_elements();
+    element->set_id(id);
+    element->set_parent_id(0);
+    element->set_is_ax_element(true);
+  }
+}
+
+// Returns a toolkit with a passing and a failing check recording into
+// @c metrics.
+- (std::unique_ptr<gtx::Toolkit>)toolkitWithMetrics:
+    (gtx::EvaluationMetrics *)metrics {
+  auto toolkit = std::make_unique<gtx::Toolkit>();
+  std::unique_ptr<gtx::Check> passing_check =
+      std::make_unique<gtxtest::GTXTestAlwaysPassingCheck>("passing");
+  toolkit->RegisterCheck(passing_check);
+  toolkit->set_metrics(metrics);
+  // Checks registered after the metrics are set are recorded too.
+  std::unique_ptr<gtx::Check> failing_check =
+      std::make_unique<gtxtest::GTXTestAlwaysFailingCheck>("failing");
+  toolkit->RegisterCheck(failing_check);
+  return toolkit;
+}
+
+- (void)testCheckElementsRecordsInvocationsSkipsAndFailures {
+  gtx::EvaluationMetrics metrics;
+  [self toolkitWithMetrics:&metrics]->CheckElements(_hierarchy, _params);
+  gtx::EvaluationMetricsSnapshot snapshot = metrics.Snapshot();
+  XCTAssertEqual(snapshot.checks.size(), 2);
+  XCTAssertTrue(snapshot.checks[0].check_name == "passing");
+  XCTAssertEqual(snapshot.checks[0].invocations, 2);
+  XCTAssertEqual(snapshot.checks[0].skips, 1);
+  XCTAssertEqual(snapshot.checks[0].failures, 0);
+  XCTAssertTrue(snapshot.checks[1].check_name == "failing");
+  XCTAssertEqual(snapshot.checks[1].invocations, 2);
+  XCTAssertEqual(snapshot.checks[1].skips, 1);
+  XCTAssertEqual(snapshot.checks[1].failures, 2);
+  uint64_t histogram_count = 0;
+  for (uint64_t count : snapshot.checks[1].latency_histogram) {
+    histogram_count += count;
+  }
+  XCTAssertEqual(histogram_count, 2);
+  XCTAssertLessThanOrEqual(snapshot.checks[1].max_nanoseconds,
+                           snapshot.checks[1].total_nanoseconds);
+}
+
+- (void)testCheckElementsInTableRecordsSameCounters {
+  gtx::EvaluationMetrics metrics;
+  [self toolkitWithMetrics:&metrics]->CheckElements(
+      gtx::HierarchyTable::FromProto(_hierarchy), _params);
+  gtx::EvaluationMetricsSnapshot snapshot = metrics.Snapshot();
+  XCTAssertEqual(snapshot.checks.size(), 2);
+  XCTAssertEqual(snapshot.checks[1].invocations, 2);
+  XCTAssertEqual(snapshot.checks[1].skips, 1);
+  XCTAssertEqual(snapshot.checks[1].failures, 2);
+}
+
+- (void)testPhasesAreTimedOnlyIfEnabled {
+  gtx::EvaluationMetrics metrics;
+  [self toolkitWithMetrics:&metrics]->CheckElements(_hierarchy, _params);
+  gtx::EvaluationMetricsSnapshot snapshot = metrics.Snapshot();
+  XCTAssertEqual(snapshot.phases.size(), gtx::kEvaluationPhaseCount);
+  XCTAssertEqual(
+      snapshot.phases[static_cast<int>(gtx::EvaluationPhase::kCheck)].count,
+      1);
+  XCTAssertEqual(
+      snapshot.phases[static_cast<int>(gtx::EvaluationPhase::kParse)].count,
+      0);
+
+  gtx::EvaluationMetrics metrics_without_phases(/*times_phases=*/false);
+  [self toolkitWithMetrics:&metrics_without_phases]->CheckElements(_hierarchy,
+                                                                   _params);
+  XCTAssertTrue(metrics_without_phases.Snapshot().phases.empty());
+}
+
+- (void)testToolkitWithoutMetricsRecordsNothing {
+  gtx::EvaluationMetrics metrics;
+  std::unique_ptr<gtx::Toolkit> toolkit = [self toolkitWithMetrics:&metrics];
+  toolkit->set_metrics(nullptr);
+  toolkit->CheckElements(_hierarchy, _params);
+  for (const gtx::CheckMetricsSnapshot &check : metrics.Snapshot().checks) {
+    XCTAssertEqual(check.invocations, 0);
+    XCTAssertEqual(check.skips, 0);
+  }
+}
+
+- (void)testSnapshotExportsToProto {
+  gtx::EvaluationMetrics metrics;
+  [self toolkitWithMetrics:&metrics]->CheckElements(_hierarchy, _params);
+  EvaluationMetricsProto proto = metrics.Snapshot().ToProto();
+  EvaluationMetricsProto parsed;
+  XCTAssertTrue(gtx::ParseProto(gtx::SerializeProto(proto), &parsed));
+  XCTAssertEqual(parsed.checks_size(), 2);
+  XCTAssertTrue(parsed.checks(1).check_name() == "failing");
+  XCTAssertEqual(parsed.checks(1).failures(), 2);
+  XCTAssertEqual(parsed.checks(1).latency_histogram_size(),
+                 gtx::kLatencyBucketCount);
+  XCTAssertEqual(parsed.latency_bucket_bounds_nanoseconds_size(),
+                 gtx::kLatencyBucketCount - 1);
+  XCTAssertEqual(parsed.phases_size(), gtx::kEvaluationPhaseCount);
+  XCTAssertTrue(parsed.phases(2).phase() == "check");
+}
+
+- (void)testSnapshotExportsToPrometheusText {
+  gtx::EvaluationMetrics metrics;
+  [self toolkitWithMetrics:&metrics]->CheckElements(_hierarchy, _params);
+  std::string text = metrics.Snapshot().ToPrometheusText();
+  XCTAssertNotEqual(
+      text.find("gtx_check_failures_total{check=\"failing\"} 2\n"),
+      std::string::npos);
+  XCTAssertNotEqual(
+      text.find(
+          "gtx_check_latency_seconds_bucket{check=\"failing\",le=\"+Inf\"} 2\n"),
+      std::string::npos);
+  XCTAssertNotEqual(text.find("gtx_phase_runs_total{phase=\"check\"} 1\n"),
+                    std::string::npos);
+}
+
+@end
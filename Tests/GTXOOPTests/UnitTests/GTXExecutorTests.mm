@@ -0,0 +1,70 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "executor.h"
+
+#import <XCTest/XCTest.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+@interface GTXExecutorTests : XCTestCase
+@end
+
+@implementation GTXExecutorTests
+
+- (void)testThreadPoolStartsRequestedThreads {
+  gtx::ThreadPoolExecutor executor(3);
+  XCTAssertEqual(executor.thread_count(), 3);
+  XCTAssertGreaterThan(gtx::ThreadPoolExecutor(0).thread_count(), 0);
+}
+
+- (void)testThreadPoolRunsScheduledTasksBeforeDestruction {
+  std::atomic<int> count{0};
+  {
+    gtx::ThreadPoolExecutor executor(2);
+    for (int i = 0; i < 100; i++) {
+      executor.Execute([&count] { count++; });
+    }
+  }
+  XCTAssertEqual(count.load(), 100);
+}
+
+- (void)testThreadPoolRunsTasksOnItsThreads {
+  std::mutex mutex;
+  std::set<std::thread::id> thread_ids;
+  {
+    gtx::ThreadPoolExecutor executor(2);
+    for (int i = 0; i < 20; i++) {
+      executor.Execute([&mutex, &thread_ids] {
+        std::lock_guard<std::mutex> lock(mutex);
+        thread_ids.insert(std::this_thread::get_id());
+      });
+    }
+  }
+  XCTAssertGreaterThan(thread_ids.size(), 0ul);
+  XCTAssertLessThanOrEqual(thread_ids.size(), 2ul);
+  XCTAssertEqual(thread_ids.count(std::this_thread::get_id()), 0ul);
+}
+
+- (void)testDefaultExecutorIsShared {
+  XCTAssertTrue(gtx::ThreadPoolExecutor::Default() == gtx::ThreadPoolExecutor::Default());
+}
+
+@end
@@ -0,0 +1,139 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "hierarchy_snapshot.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "accessibility_hierarchy_searching.h"
+#include "metadata_map.h"
+#include "typedefs.h"
+#include "element_trait.h"
+#include "toolkit.h"
+
+@interface GTXHierarchySnapshotTests : XCTestCase
+@end
+
+@implementation GTXHierarchySnapshotTests {
+  AccessibilityEvaluationProto _evaluation;
+}
+
+- (void)setUp {
+  [super setUp];
+  UIElementProto parent;
+  parent.set_id(0);
+  parent.set_is_ax_element(true);
+  parent.set_ax_label("Parent");
+  parent.add_class_names_hierarchy("UIView");
+  UIElementProto child;
+  child.set_id(1);
+  child.set_is_ax_element(true);
+  child.set_ax_traits(static_cast<uint64_t>(gtx::ElementTrait::kButton));
+  child.mutable_ax_frame()->mutable_size()->set_width(10);
+  child.mutable_ax_frame()->mutable_size()->set_height(10);
+  child.add_class_names_hierarchy("UIView");
+  child.add_class_names_hierarchy("UIButton");
+  child.set_alpha(0.5);
+  gtx::AddElementAsChildToParent(child, parent);
+
+  _evaluation = AccessibilityEvaluationProto();
+  AccessibilityHierarchyProto *hierarchy = _evaluation.mutable_hierarchy();
+  hierarchy->mutable_device_state()->set_ios_version("14.0");
+  *hierarchy->add_elements() = parent;
+  *hierarchy->add_elements() = child;
+
+  CheckResultProto *result = _evaluation.add_results();
+  result->set_source_check_class("NoLabelCheck");
+  result->set_result_id(1);
+  result->set_hierarchy_source_id(1);
+  gtx::MetadataMap metadata;
+  metadata.SetString("key", "value");
+  metadata.SetFloat("ratio", 4.5);
+  metadata.SetIntList("ids", {1, 2, 3});
+  result->set_metadata(metadata.ToProto());
+}
+
+- (void)testSnapshotIsReadInPlace {
+  std::string bytes = gtx::SnapshotFromEvaluation(_evaluation);
+  absl::optional<gtx::HierarchySnapshot> snapshot =
+      gtx::HierarchySnapshot::FromBuffer(bytes.data(), bytes.size());
+
+  XCTAssertTrue(snapshot.has_value());
+  XCTAssertEqual(snapshot->elements().size(), 2);
+  const gtx::SnapshotElement &child = snapshot->elements()[1];
+  XCTAssertEqual(child.id, 1);
+  XCTAssertTrue(child.has(gtx::SnapshotElement::kParentId));
+  XCTAssertEqual(child.parent_id, 0);
+  XCTAssertEqual(child.ax_frame.width, 10);
+  XCTAssertEqual(snapshot->StringList(child.class_names_hierarchy).size(), 2);
+  XCTAssertTrue(snapshot->String(snapshot->elements()[0].ax_label) == "Parent");
+  XCTAssertEqual(snapshot->Int32s(snapshot->elements()[0].child_ids)[0], 1);
+  XCTAssertEqual(snapshot->results().size(), 1);
+}
+
+- (void)testSnapshotConvertsBackToEvaluation {
+  std::string bytes = gtx::SnapshotFromEvaluation(_evaluation);
+  absl::optional<gtx::HierarchySnapshot> snapshot =
+      gtx::HierarchySnapshot::FromBuffer(bytes.data(), bytes.size());
+  AccessibilityEvaluationProto evaluation = snapshot->ToEvaluationProto();
+
+  XCTAssertEqual(evaluation.hierarchy().elements_size(), 2);
+  XCTAssertTrue(evaluation.hierarchy().device_state().ios_version() == "14.0");
+  const UIElementProto &child = evaluation.hierarchy().elements(1);
+  XCTAssertEqual(child.alpha(), 0.5);
+  XCTAssertFalse(child.has_ax_label());
+  XCTAssertTrue(child.class_names_hierarchy(1) == "UIButton");
+  gtx::MetadataMap metadata = gtx::MetadataMap::FromProto(evaluation.results(0).metadata());
+  XCTAssertTrue(*metadata.GetString("key") == "value");
+  XCTAssertEqual(*metadata.GetFloat("ratio"), 4.5);
+  XCTAssertEqual(metadata.GetIntList("ids")->size(), 3);
+  // Converting back and forth produces the same bytes.
+  XCTAssertTrue(gtx::SnapshotFromEvaluation(evaluation) == bytes);
+}
+
+- (void)testInvalidSnapshotIsRejected {
+  std::string bytes = gtx::SnapshotFromEvaluation(_evaluation);
+  std::string wrongMagic = bytes;
+  wrongMagic[0] = 'X';
+  std::string truncated = bytes.substr(0, bytes.size() / 2);
+
+  XCTAssertFalse(gtx::HierarchySnapshot::FromBuffer(wrongMagic.data(), wrongMagic.size()));
+  XCTAssertFalse(gtx::HierarchySnapshot::FromBuffer(truncated.data(), truncated.size()));
+  XCTAssertFalse(gtx::HierarchySnapshot::FromBuffer(bytes.data(), 8));
+}
+
+- (void)testToolkitChecksSnapshotLikeHierarchy {
+  std::unique_ptr<gtx::Toolkit> toolkit = gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  gtx::Parameters params;
+  std::string bytes = gtx::SnapshotFromHierarchy(_evaluation.hierarchy());
+  absl::optional<gtx::HierarchySnapshot> snapshot =
+      gtx::HierarchySnapshot::FromBuffer(bytes.data(), bytes.size());
+
+  std::vector<CheckResultProto> expected = toolkit->CheckElements(_evaluation.hierarchy(), params);
+  std::vector<CheckResultProto> actual = toolkit->CheckElements(*snapshot, params);
+  XCTAssertEqual(actual.size(), 2);
+  XCTAssertEqual(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); i++) {
+    XCTAssertEqual(actual[i].hierarchy_source_id(), expected[i].hierarchy_source_id());
+    XCTAssertEqual(actual[i].result_id(), expected[i].result_id());
+  }
+}
+
+@end
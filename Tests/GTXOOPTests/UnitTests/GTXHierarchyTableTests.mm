@@ -0,0 +1,125 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "hierarchy_table.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <vector>
+
+#include "accessibility_hierarchy_searching.h"
+#include "typedefs.h"
+#include "element_trait.h"
+#include "gtx_types.h"
+#include "toolkit.h"
+#include "gtxtest_always_failing_check.h"
+
+namespace {
+
+// Sets the accessibility frame of @c element to the given rect.
+void SetFrame(UIElementProto &element, float x, float y, float width, float height) {
+  RectProto *frame = element.mutable_ax_frame();
+  frame->mutable_origin()->set_x(x);
+  frame->mutable_origin()->set_y(y);
+  frame->mutable_size()->set_width(width);
+  frame->mutable_size()->set_height(height);
+}
+
+}  // namespace
+
+@interface GTXHierarchyTableTests : XCTestCase
+@end
+
+@implementation GTXHierarchyTableTests {
+  AccessibilityHierarchyProto _hierarchy;
+  gtx::Parameters _params;
+}
+
+- (void)setUp {
+  [super setUp];
+  UIElementProto parent;
+  parent.set_id(0);
+  parent.set_is_ax_element(true);
+  parent.set_ax_label("Parent.");
+  parent.set_ax_traits(static_cast<uint64_t>(gtx::ElementTrait::kButton));
+  SetFrame(parent, 0, 0, 100, 100);
+  UIElementProto child;
+  child.set_id(1);
+  child.set_is_ax_element(true);
+  child.set_ax_traits(static_cast<uint64_t>(gtx::ElementTrait::kButton));
+  SetFrame(child, 10, 20, 30, 40);
+  gtx::AddElementAsChildToParent(child, parent);
+  _hierarchy = AccessibilityHierarchyProto();
+  *_hierarchy.add_elements() = parent;
+  *_hierarchy.add_elements() = child;
+  _params = gtx::Parameters();
+}
+
+- (void)testTableContainsElementProperties {
+  gtx::HierarchyTable table = gtx::HierarchyTable::FromProto(_hierarchy);
+
+  XCTAssertEqual(table.size(), 2);
+  XCTAssertEqual(table.ids()[1], 1);
+  XCTAssertEqual(table.parent_ids()[1], 0);
+  XCTAssertTrue(table.HasFlag(1, gtx::HierarchyTable::kHasParentId));
+  XCTAssertFalse(table.HasFlag(0, gtx::HierarchyTable::kHasParentId));
+  XCTAssertEqual(table.ax_frames()[1].x, 10);
+  XCTAssertEqual(table.ax_frames()[1].height, 40);
+  XCTAssertTrue(table.ax_label(0) == "Parent.");
+  XCTAssertTrue(table.ax_label(1).empty());
+  XCTAssertEqual(table.child_ids(0).size(), 1);
+  XCTAssertEqual(table.child_ids(0)[0], 1);
+  XCTAssertTrue(table.child_ids(1).empty());
+  XCTAssertTrue(table.IsButtonElement(1));
+  XCTAssertFalse(table.IsStaticTextElement(1));
+}
+
+- (void)testTableOfEmptyHierarchyIsEmpty {
+  gtx::HierarchyTable table = gtx::HierarchyTable::FromProto(AccessibilityHierarchyProto());
+
+  XCTAssertEqual(table.size(), 0);
+}
+
+- (void)testDefaultChecksReturnSameResultsForTableAndProto {
+  std::unique_ptr<gtx::Toolkit> toolkit = gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  gtx::HierarchyTable table = gtx::HierarchyTable::FromProto(_hierarchy);
+
+  std::vector<CheckResultProto> protoResults = toolkit->CheckElements(_hierarchy, _params);
+  std::vector<CheckResultProto> tableResults = toolkit->CheckElements(table, _params);
+  XCTAssertEqual(protoResults.size(), 3);
+  XCTAssertEqual(tableResults.size(), protoResults.size());
+  for (size_t i = 0; i < protoResults.size(); i++) {
+    XCTAssertTrue(tableResults[i].source_check_class() == protoResults[i].source_check_class());
+    XCTAssertEqual(tableResults[i].hierarchy_source_id(), protoResults[i].hierarchy_source_id());
+    XCTAssertEqual(tableResults[i].result_id(), protoResults[i].result_id());
+  }
+}
+
+- (void)testChecksWithoutTableSupportFallBackToCheckElement {
+  gtx::Toolkit toolkit;
+  std::unique_ptr<gtx::Check> failingCheck =
+      std::make_unique<gtxtest::GTXTestAlwaysFailingCheck>(std::string("alwaysFailing"));
+  toolkit.RegisterCheck(failingCheck);
+  _hierarchy.mutable_elements(0)->set_is_ax_element(false);
+  gtx::HierarchyTable table = gtx::HierarchyTable::FromProto(_hierarchy);
+
+  std::vector<CheckResultProto> results = toolkit.CheckElements(table, _params);
+  XCTAssertEqual(results.size(), 1);
+  XCTAssertEqual(results[0].hierarchy_source_id(), 1);
+}
+
+@end
@@ -0,0 +1,160 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "hierarchy_visibility.h"
+
+#import <XCTest/XCTest.h>
+
+#include "accessibility_hierarchy_searching.h"
+#include "gtx_types.h"
+#include "typedefs.h"
+
+namespace {
+
+// Sets the accessibility frame of @c element to the given rect.
+void SetFrame(UIElementProto &element, float x, float y, float width, float height) {
+  RectProto *frame = element.mutable_ax_frame();
+  frame->mutable_origin()->set_x(x);
+  frame->mutable_origin()->set_y(y);
+  frame->mutable_size()->set_width(width);
+  frame->mutable_size()->set_height(height);
+}
+
+}  // namespace
+
+@interface GTXHierarchyVisibilityTests : XCTestCase
+@end
+
+@implementation GTXHierarchyVisibilityTests {
+  UIElementProto _parent;
+  UIElementProto _child;
+  gtx::Rect _screenBounds;
+}
+
+- (void)setUp {
+  [super setUp];
+  _parent = UIElementProto();
+  _parent.set_id(0);
+  SetFrame(_parent, 0, 0, 100, 100);
+  _child = UIElementProto();
+  _child.set_id(1);
+  SetFrame(_child, 50, 50, 100, 100);
+  gtx::AddElementAsChildToParent(_child, _parent);
+  _screenBounds = gtx::Rect(0, 0, 320, 480);
+}
+
+- (AccessibilityHierarchyProto)hierarchy {
+  AccessibilityHierarchyProto hierarchy;
+  *hierarchy.add_elements() = _parent;
+  *hierarchy.add_elements() = _child;
+  return hierarchy;
+}
+
+- (void)testElementsOnScreenAreVisible {
+  gtx::HierarchyVisibility visibility([self hierarchy], _screenBounds);
+
+  XCTAssertTrue(visibility.IsElementAtIndexVisible(0));
+  XCTAssertTrue(visibility.IsElementAtIndexVisible(1));
+  XCTAssertEqual(visibility.VisibilityOfElementAtIndex(1).visible_rect.size.width, 100);
+}
+
+- (void)testChildOfHiddenParentIsNotVisible {
+  _parent.set_hidden(true);
+  gtx::HierarchyVisibility visibility([self hierarchy], _screenBounds);
+
+  XCTAssertFalse(visibility.IsElementAtIndexVisible(0));
+  XCTAssertFalse(visibility.IsElementAtIndexVisible(1));
+}
+
+- (void)testChildOfTransparentParentIsNotVisible {
+  _parent.set_alpha(0);
+  gtx::HierarchyVisibility visibility([self hierarchy], _screenBounds);
+
+  XCTAssertFalse(visibility.IsElementAtIndexVisible(1));
+}
+
+- (void)testEffectiveAlphaIsProductOfAncestorAlphas {
+  _parent.set_alpha(0.5);
+  _child.set_alpha(0.5);
+  gtx::HierarchyVisibility visibility([self hierarchy], _screenBounds);
+
+  XCTAssertEqualWithAccuracy(visibility.VisibilityOfElementAtIndex(1).effective_alpha, 0.25,
+                             0.0001);
+  XCTAssertTrue(visibility.IsElementAtIndexVisible(1));
+}
+
+- (void)testChildIsClippedByParentClippingToBounds {
+  _parent.set_clips_to_bounds(true);
+  gtx::HierarchyVisibility visibility([self hierarchy], _screenBounds);
+
+  gtx::Rect visibleRect = visibility.VisibilityOfElementAtIndex(1).visible_rect;
+  XCTAssertEqual(visibleRect.origin.x, 50);
+  XCTAssertEqual(visibleRect.origin.y, 50);
+  XCTAssertEqual(visibleRect.size.width, 50);
+  XCTAssertEqual(visibleRect.size.height, 50);
+}
+
+- (void)testChildOutsideOfClippingParentIsNotVisible {
+  _parent.set_clips_to_bounds(true);
+  SetFrame(_child, 200, 200, 10, 10);
+  gtx::HierarchyVisibility visibility([self hierarchy], _screenBounds);
+
+  XCTAssertTrue(visibility.IsElementAtIndexVisible(0));
+  XCTAssertFalse(visibility.IsElementAtIndexVisible(1));
+}
+
+- (void)testOffScreenElementIsNotVisible {
+  SetFrame(_child, 400, 500, 10, 10);
+  gtx::HierarchyVisibility visibility([self hierarchy], _screenBounds);
+
+  XCTAssertFalse(visibility.IsElementAtIndexVisible(1));
+}
+
+- (void)testEmptyScreenBoundsDoNotClipElements {
+  SetFrame(_child, 400, 500, 10, 10);
+  gtx::HierarchyVisibility visibility([self hierarchy], gtx::Rect());
+
+  XCTAssertTrue(visibility.IsElementAtIndexVisible(1));
+}
+
+- (void)testElementWithoutFrameIsVisible {
+  _child.clear_ax_frame();
+  gtx::HierarchyVisibility visibility([self hierarchy], _screenBounds);
+
+  XCTAssertTrue(visibility.IsElementAtIndexVisible(1));
+}
+
+- (void)testChildrenListedBeforeParentsAreClipped {
+  _parent.set_clips_to_bounds(true);
+  SetFrame(_child, 200, 200, 10, 10);
+  AccessibilityHierarchyProto hierarchy;
+  *hierarchy.add_elements() = _child;
+  *hierarchy.add_elements() = _parent;
+  gtx::HierarchyVisibility visibility(hierarchy, _screenBounds);
+
+  XCTAssertFalse(visibility.IsElementAtIndexVisible(0));
+  XCTAssertTrue(visibility.IsElementAtIndexVisible(1));
+}
+
+- (void)testElementsInCycleAreEvaluated {
+  gtx::AddElementAsChildToParent(_parent, _child);
+  gtx::HierarchyVisibility visibility([self hierarchy], _screenBounds);
+
+  XCTAssertTrue(visibility.IsElementAtIndexVisible(0));
+  XCTAssertTrue(visibility.IsElementAtIndexVisible(1));
+}
+
+@end
@@ -0,0 +1,157 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "image_buffer.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtx_types.h"
+#include "luminance_plane.h"
+#include "parameters.h"
+
+static const int kGTXTestImageWidth = 100;
+static const int kGTXTestImageHeight = 100;
+static const int kGTXTestThreadCount = 4;
+
+@interface GTXImageBufferTests : XCTestCase
+@end
+
+@implementation GTXImageBufferTests
+
+- (void)testCopiesSharePixels {
+  gtx::ImageBuffer buffer = gtx::ImageBuffer::Allocate(kGTXTestImageWidth, kGTXTestImageHeight);
+  XCTAssertFalse(buffer.empty());
+  XCTAssertEqual(buffer.use_count(), 1);
+  {
+    gtx::ImageBuffer copy = buffer;
+    XCTAssertEqual(copy.pixels(), buffer.pixels());
+    XCTAssertEqual(buffer.use_count(), 2);
+    gtx::ImageBuffer moved = std::move(copy);
+    XCTAssertTrue(copy.empty());
+    XCTAssertEqual(buffer.use_count(), 2);
+  }
+  XCTAssertEqual(buffer.use_count(), 1);
+  gtx::Image image = buffer.image();
+  XCTAssertEqual(image.width, kGTXTestImageWidth);
+  XCTAssertEqual(image.height, kGTXTestImageHeight);
+  XCTAssertTrue(image.pixels == buffer.pixels());
+  XCTAssertTrue(gtx::ImageBuffer::Allocate(0, kGTXTestImageHeight).empty());
+  XCTAssertEqual(gtx::ImageBuffer().use_count(), 0);
+}
+
+- (void)testPoolReusesReleasedBuffersOfTheSameSizeClass {
+  gtx::ImageBufferPool pool;
+  gtx::Pixel *pixels = nullptr;
+  {
+    gtx::ImageBuffer buffer = pool.Acquire(kGTXTestImageWidth, kGTXTestImageHeight);
+    pixels = buffer.pixels();
+    XCTAssertEqual(pool.retained_bytes(), 0u);
+  }
+  XCTAssertGreaterThan(pool.retained_bytes(), 0u);
+  // Slightly smaller, but in the same size class.
+  for (int i = 0; i < 100; i++) {
+    gtx::ImageBuffer buffer = pool.Acquire(kGTXTestImageWidth - 1, kGTXTestImageHeight);
+    XCTAssertTrue(buffer.pixels() == pixels);
+  }
+  XCTAssertEqual(pool.allocation_count(), 1);
+  XCTAssertEqual(pool.reuse_count(), 100);
+
+  gtx::ImageBuffer larger = pool.Acquire(kGTXTestImageWidth * 2, kGTXTestImageHeight);
+  XCTAssertEqual(pool.allocation_count(), 2);
+  XCTAssertTrue(pool.Acquire(-1, kGTXTestImageHeight).empty());
+}
+
+- (void)testPoolFreesBuffersBeyondItsLimit {
+  const size_t bytes = kGTXTestImageWidth * kGTXTestImageHeight * sizeof(gtx::Pixel);
+  gtx::ImageBufferPool pool(bytes * 3 / 2);
+  {
+    gtx::ImageBuffer first = pool.Acquire(kGTXTestImageWidth, kGTXTestImageHeight);
+    gtx::ImageBuffer second = pool.Acquire(kGTXTestImageWidth, kGTXTestImageHeight);
+  }
+  XCTAssertGreaterThanOrEqual(pool.retained_bytes(), bytes);
+  XCTAssertLessThanOrEqual(pool.retained_bytes(), bytes * 3 / 2);
+}
+
+- (void)testBuffersOutliveTheirPool {
+  gtx::ImageBuffer buffer;
+  {
+    gtx::ImageBufferPool pool;
+    buffer = pool.Acquire(kGTXTestImageWidth, kGTXTestImageHeight);
+  }
+  buffer.pixels()[kGTXTestImageWidth * kGTXTestImageHeight - 1].red = 1;
+  XCTAssertEqual(buffer.use_count(), 1);
+}
+
+- (void)testParametersShareScreenshotAcrossConcurrentEvaluations {
+  gtx::ImageBufferPool pool;
+  gtx::Parameters params;
+  {
+    gtx::ImageBuffer buffer = pool.Acquire(kGTXTestImageWidth, kGTXTestImageHeight);
+    for (int i = 0; i < kGTXTestImageWidth * kGTXTestImageHeight; i++) {
+      buffer.pixels()[i] = {static_cast<unsigned char>(i), 128, 64, 255};
+    }
+    params.set_screenshot(buffer);
+  }
+  params.set_device_bounds(gtx::Rect(0, 0, kGTXTestImageWidth, kGTXTestImageHeight));
+  XCTAssertEqual(params.screenshot_buffer().use_count(), 1);
+  std::vector<float> luminances(kGTXTestThreadCount);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kGTXTestThreadCount; i++) {
+    gtx::Parameters copy = params;
+    threads.emplace_back([copy, i, &luminances] {
+      luminances[i] = copy.luminance_plane()->MeanLuminance(
+          gtx::Rect(0, 0, kGTXTestImageWidth, kGTXTestImageHeight));
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (float luminance : luminances) {
+    XCTAssertEqual(luminance, luminances[0]);
+  }
+  XCTAssertEqual(params.screenshot_buffer().use_count(), 1);
+  XCTAssertEqual(pool.retained_bytes(), 0u);
+
+  // Replacing the screenshot releases the buffer to the pool.
+  params.set_screenshot(gtx::Image(nullptr, 0, 0));
+  XCTAssertTrue(params.screenshot_buffer().empty());
+  XCTAssertGreaterThan(pool.retained_bytes(), 0u);
+}
+
+- (void)testPooledBufferLuminancePlaneIsSharedAndNotReused {
+  gtx::ImageBufferPool pool;
+  const gtx::Rect bounds(0, 0, kGTXTestImageWidth, kGTXTestImageHeight);
+  for (unsigned char shade : {0, 255}) {
+    gtx::ImageBuffer buffer = pool.Acquire(kGTXTestImageWidth, kGTXTestImageHeight);
+    for (int i = 0; i < kGTXTestImageWidth * kGTXTestImageHeight; i++) {
+      buffer.pixels()[i] = {shade, shade, shade, 255};
+    }
+    gtx::Parameters params;
+    params.set_screenshot(buffer);
+    // Copied before the plane is computed, and still sharing it.
+    gtx::Parameters copy = params;
+    const gtx::LuminancePlane *plane = params.luminance_plane();
+    XCTAssertTrue(copy.luminance_plane() == plane);
+    XCTAssertEqual(plane->MeanLuminance(bounds), shade / 255.0f);
+  }
+  XCTAssertEqual(pool.reuse_count(), 1);
+}
+
+@end
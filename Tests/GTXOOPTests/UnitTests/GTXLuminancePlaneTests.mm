@@ -0,0 +1,149 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "luminance_plane.h"
+
+#import <XCTest/XCTest.h>
+
+#include <math.h>
+
+#include <functional>
+#include <vector>
+
+#include "executor.h"
+#include "gtx_types.h"
+#include "palette_image.h"
+#include "parameters.h"
+#include "rle_image.h"
+
+static const int kGTXTestImageWidth = 40;
+static const int kGTXTestImageHeight = 300;
+
+// Accepts tasks without ever running them, as a saturated executor would.
+class GTXTestDroppingExecutor : public gtx::Executor {
+ public:
+  void Execute(std::function<void()> task) override { task_count_++; }
+
+  int task_count() const { return task_count_; }
+
+ private:
+  int task_count_ = 0;
+};
+
+@interface GTXLuminancePlaneTests : XCTestCase
+@end
+
+@implementation GTXLuminancePlaneTests {
+  std::vector<gtx::Pixel> _pixels;
+}
+
+- (void)setUp {
+  [super setUp];
+  // Horizontal bands of a few colors, with a gradient in every tenth row.
+  _pixels.resize(kGTXTestImageWidth * kGTXTestImageHeight);
+  for (int y = 0; y < kGTXTestImageHeight; y++) {
+    for (int x = 0; x < kGTXTestImageWidth; x++) {
+      gtx::Pixel &pixel = _pixels[x + y * kGTXTestImageWidth];
+      int shade = y % 10 == 0 ? x * 6 : (y / 10) * 8 % 256;
+      pixel.red = static_cast<unsigned char>(shade);
+      pixel.green = static_cast<unsigned char>(255 - shade);
+      pixel.blue = static_cast<unsigned char>(shade / 2);
+      pixel.alpha = 255;
+    }
+  }
+}
+
+- (void)testLuminanceMatchesColorLuminance {
+  gtx::LuminancePlane plane = gtx::LuminancePlane::FromImage([self rgbaImage], 1);
+  XCTAssertEqual(plane.width(), kGTXTestImageWidth);
+  XCTAssertEqual(plane.height(), kGTXTestImageHeight);
+  for (int y = 0; y < kGTXTestImageHeight; y++) {
+    for (int x = 0; x < kGTXTestImageWidth; x++) {
+      float expected = _pixels[x + y * kGTXTestImageWidth].Luminance();
+      XCTAssertLessThan(fabsf(plane.LuminanceAt(x, y) - expected), 2.0f / 65535);
+    }
+  }
+}
+
+- (void)testThreadsAndEncodingsProduceSamePlane {
+  gtx::Image image = [self rgbaImage];
+  gtx::LuminancePlane expected = gtx::LuminancePlane::FromImage(image, 1);
+  XCTAssertTrue(gtx::LuminancePlane::FromImage(image, 4).values() == expected.values());
+  gtx::PaletteImage paletteImage = gtx::PaletteImage::Encode(image);
+  XCTAssertTrue(gtx::LuminancePlane::FromPaletteImage(paletteImage, 4).values() ==
+                expected.values());
+  gtx::RleImage rleImage = gtx::RleImage::Encode(image);
+  XCTAssertTrue(gtx::LuminancePlane::FromRleImage(rleImage, 4).values() == expected.values());
+}
+
+- (void)testExecutorTasksProduceSamePlane {
+  gtx::Image image = [self rgbaImage];
+  gtx::LuminancePlane expected = gtx::LuminancePlane::FromImage(image);
+  gtx::Rect rect(3, 5, 30, 250);
+  gtx::ThreadPoolExecutor executor(2);
+  gtx::LuminancePlane plane = gtx::LuminancePlane::FromImage(image, 4, &executor);
+  XCTAssertTrue(plane.values() == expected.values());
+  XCTAssertEqual(plane.MeanLuminance(rect), expected.MeanLuminance(rect));
+  // The calling thread computes the rows of tasks that do not start.
+  GTXTestDroppingExecutor droppingExecutor;
+  plane = gtx::LuminancePlane::FromRleImage(gtx::RleImage::Encode(image), 4, &droppingExecutor);
+  XCTAssertEqual(droppingExecutor.task_count(), 3);
+  XCTAssertTrue(plane.values() == expected.values());
+  XCTAssertEqual(plane.MeanLuminance(rect), expected.MeanLuminance(rect));
+}
+
+- (void)testMeanLuminanceMatchesMeanOfPixels {
+  gtx::LuminancePlane plane = gtx::LuminancePlane::FromImage([self rgbaImage], 4);
+  const gtx::Rect rects[] = {gtx::Rect(0, 0, kGTXTestImageWidth, kGTXTestImageHeight),
+                             gtx::Rect(3, 5, 10, 20), gtx::Rect(2.5, 9.5, 4, 1),
+                             gtx::Rect(30, 290, 20, 20)};
+  for (const gtx::Rect &rect : rects) {
+    double sum = 0;
+    int count = 0;
+    for (int y = floorf(rect.origin.y); y < ceilf(rect.GetMaxY()) && y < kGTXTestImageHeight;
+         y++) {
+      for (int x = floorf(rect.origin.x); x < ceilf(rect.GetMaxX()) && x < kGTXTestImageWidth;
+           x++) {
+        sum += plane.LuminanceAt(x, y);
+        count++;
+      }
+    }
+    XCTAssertLessThan(fabs(plane.MeanLuminance(rect) - sum / count), 1e-5);
+  }
+  XCTAssertEqual(plane.MeanLuminance(gtx::Rect(100, 0, 10, 10)), 0.0f);
+}
+
+- (void)testParametersShareLuminancePlaneUntilScreenshotChanges {
+  gtx::Parameters params;
+  XCTAssertTrue(params.luminance_plane() == nullptr);
+  params.set_screenshot([self rgbaImage]);
+  const gtx::LuminancePlane *plane = params.luminance_plane();
+  XCTAssertTrue(plane != nullptr);
+  XCTAssertTrue(params.luminance_plane() == plane);
+  gtx::Parameters copy = params;
+  XCTAssertTrue(copy.luminance_plane() == plane);
+  copy.set_screenshot(gtx::Image(nullptr, 0, 0));
+  XCTAssertTrue(copy.luminance_plane() == nullptr);
+  XCTAssertTrue(params.luminance_plane() == plane);
+}
+
+#pragma mark - Private Methods
+
+- (gtx::Image)rgbaImage {
+  return gtx::Image(_pixels.data(), kGTXTestImageWidth, kGTXTestImageHeight);
+}
+
+@end
@@ -0,0 +1,116 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "palette_image.h"
+
+#import <XCTest/XCTest.h>
+
+#include <vector>
+
+#include "contrast_swatch.h"
+#include "gtx_types.h"
+
+@interface GTXPaletteImageTests : XCTestCase
+@end
+
+@implementation GTXPaletteImageTests
+
+- (void)testImageWithFewColorsUsesEightBitIndices {
+  std::vector<gtx::Pixel> pixels = [self pixelsWithColorCount:3 pixelCount:100];
+  gtx::PaletteImage image = gtx::PaletteImage::Encode(gtx::Image(pixels.data(), 10, 10));
+  XCTAssertTrue(image.encoding() == gtx::PaletteImage::Encoding::kIndexed8);
+  XCTAssertEqual(image.palette().size(), 3ul);
+  XCTAssertEqual(image.indices8().size(), 100ul);
+  XCTAssertLessThan(image.ByteSize(), pixels.size() * sizeof(gtx::Pixel) / 3);
+  [self assertImage:image hasPixels:pixels];
+}
+
+- (void)testImageWithHundredsOfColorsUsesSixteenBitIndices {
+  std::vector<gtx::Pixel> pixels = [self pixelsWithColorCount:300 pixelCount:1000];
+  gtx::PaletteImage image = gtx::PaletteImage::Encode(gtx::Image(pixels.data(), 100, 10));
+  XCTAssertTrue(image.encoding() == gtx::PaletteImage::Encoding::kIndexed16);
+  XCTAssertEqual(image.palette().size(), 300ul);
+  XCTAssertEqual(image.indices16().size(), 1000ul);
+  [self assertImage:image hasPixels:pixels];
+}
+
+- (void)testImageWithTooManyColorsFallsBackToRgba {
+  const int colorCount = gtx::PaletteImage::kMaxPaletteSize + 1;
+  std::vector<gtx::Pixel> pixels = [self pixelsWithColorCount:colorCount pixelCount:colorCount];
+  gtx::PaletteImage image =
+      gtx::PaletteImage::Encode(gtx::Image(pixels.data(), colorCount, 1));
+  XCTAssertTrue(image.encoding() == gtx::PaletteImage::Encoding::kRgba);
+  XCTAssertTrue(image.palette().empty());
+  XCTAssertTrue(image.RgbaImage().pixels != nullptr);
+  [self assertImage:image hasPixels:pixels];
+}
+
+- (void)testImageWithoutPixelsIsEmpty {
+  gtx::PaletteImage image = gtx::PaletteImage::Encode(gtx::Image(nullptr, 0, 0));
+  XCTAssertEqual(image.width(), 0);
+  XCTAssertEqual(image.ByteSize(), 0ul);
+}
+
+- (void)testSwatchOfPaletteImageMatchesSwatchOfPixels {
+  // A background of color 0, a rectangle of color 1 and a line of color 2.
+  const int width = 20, height = 20;
+  std::vector<gtx::Pixel> colors = [self pixelsWithColorCount:3 pixelCount:3];
+  std::vector<gtx::Pixel> pixels(width * height, colors[0]);
+  for (int y = 4; y < 12; y++) {
+    for (int x = 4; x < 12; x++) {
+      pixels[x + y * width] = colors[1];
+    }
+  }
+  for (int x = 0; x < width; x++) {
+    pixels[x + 15 * width] = colors[2];
+  }
+  gtx::Image rgba(pixels.data(), width, height);
+  gtx::PaletteImage image = gtx::PaletteImage::Encode(rgba);
+  const gtx::Rect rects[] = {gtx::Rect(0, 0, width, height), gtx::Rect(2, 2, 12, 12),
+                             gtx::Rect(0, 14, 10, 3), gtx::Rect(5, 5, 3, 3)};
+  for (const gtx::Rect &rect : rects) {
+    gtx::ContrastSwatch expected = gtx::ContrastSwatch::Extract(rgba, rect);
+    gtx::ContrastSwatch swatch = gtx::ContrastSwatch::Extract(image, rect);
+    XCTAssertTrue(swatch.background() == expected.background());
+    XCTAssertTrue(swatch.foreground() == expected.foreground());
+  }
+  gtx::ContrastSwatch swatch = gtx::ContrastSwatch::Extract(image, rects[1]);
+  XCTAssertTrue(swatch.background() == colors[0]);
+  XCTAssertTrue(swatch.foreground() == colors[1]);
+}
+
+#pragma mark - Private Methods
+
+// Returns @c pixelCount opaque pixels cycling through @c colorCount distinct colors.
+- (std::vector<gtx::Pixel>)pixelsWithColorCount:(int)colorCount pixelCount:(int)pixelCount {
+  std::vector<gtx::Pixel> pixels(pixelCount);
+  for (int i = 0; i < pixelCount; i++) {
+    int color = i % colorCount;
+    pixels[i].red = static_cast<unsigned char>(color >> 16);
+    pixels[i].green = static_cast<unsigned char>(color >> 8);
+    pixels[i].blue = static_cast<unsigned char>(color);
+    pixels[i].alpha = 255;
+  }
+  return pixels;
+}
+
+- (void)assertImage:(const gtx::PaletteImage &)image hasPixels:(const std::vector<gtx::Pixel> &)pixels {
+  for (size_t i = 0; i < pixels.size(); i++) {
+    XCTAssertEqual(image.PackedColorAt(static_cast<int>(i)), pixels[i].PackedColor());
+  }
+}
+
+@end
@@ -0,0 +1,214 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "record_stream.h"
+
+#import <XCTest/XCTest.h>
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "metadata_map.h"
+#include "proto_serialization.h"
+#include "typedefs.h"
+#include "toolkit.h"
+
+@interface GTXRecordStreamTests : XCTestCase
+@end
+
+@implementation GTXRecordStreamTests {
+  std::string _path;
+}
+
+- (void)setUp {
+  [super setUp];
+  NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"records.gtxr"];
+  _path = path.UTF8String;
+}
+
+- (void)tearDown {
+  [[NSFileManager defaultManager] removeItemAtPath:@(_path.c_str()) error:nil];
+  [super tearDown];
+}
+
+// Returns an evaluation of a hierarchy with a single element labeled with
+// @c index.
+- (AccessibilityEvaluationProto)evaluationWithIndex:(int)index {
+  AccessibilityEvaluationProto evaluation;
+  UIElementProto *element = evaluation.mutable_hierarchy()->add_elements();
+  element->set_id(0);
+  element->set_is_ax_element(true);
+  element->set_ax_label(std::to_string(index));
+  element->mutable_ax_frame()->mutable_size()->set_width(10);
+  element->mutable_ax_frame()->mutable_size()->set_height(10);
+  return evaluation;
+}
+
+- (void)writeRecordCount:(int)count compress:(bool)compress {
+  gtx::RecordWriterOptions options;
+  options.block_size = 256;
+  options.compress = compress;
+  std::unique_ptr<gtx::RecordWriter> writer =
+      gtx::RecordWriter::Create(_path, gtx::RecordType::kEvaluation, options);
+  for (int i = 0; i < count; i++) {
+    XCTAssertTrue(writer->WriteEvaluation([self evaluationWithIndex:i]));
+  }
+  XCTAssertTrue(writer->Close());
+}
+
+- (void)testSerializedProtoParsesToSameProto {
+  AccessibilityEvaluationProto evaluation = [self evaluationWithIndex:1];
+  CheckResultProto *result = evaluation.add_results();
+  result->set_result_id(-1);
+  gtx::MetadataMap metadata;
+  metadata.SetIntList("ids", {1, -2});
+  metadata.SetDouble("ratio", 2.5);
+  result->set_metadata(metadata.ToProto());
+  std::string bytes = gtx::SerializeProto(evaluation);
+
+  AccessibilityEvaluationProto parsed;
+  XCTAssertTrue(gtx::ParseProto(bytes, &parsed));
+  XCTAssertTrue(parsed.hierarchy().elements(0).ax_label() == "1");
+  XCTAssertEqual(parsed.results(0).result_id(), -1);
+  gtx::MetadataMap parsedMetadata = gtx::MetadataMap::FromProto(parsed.results(0).metadata());
+  XCTAssertEqual((*parsedMetadata.GetIntList("ids"))[1], -2);
+  XCTAssertEqual(*parsedMetadata.GetDouble("ratio"), 2.5);
+  XCTAssertTrue(gtx::SerializeProto(parsed) == bytes);
+  XCTAssertFalse(gtx::ParseProto(bytes.substr(0, bytes.size() - 1), &parsed));
+}
+
+- (void)testRecordsAreReadInOrder {
+  for (bool compress : {false, true}) {
+    [self writeRecordCount:50 compress:compress];
+    std::unique_ptr<gtx::RecordReader> reader = gtx::RecordReader::Open(_path);
+
+    XCTAssertEqual(*reader->record_count(), 50);
+    AccessibilityEvaluationProto evaluation;
+    int count = 0;
+    while (reader->ReadEvaluation(&evaluation)) {
+      XCTAssertTrue(evaluation.hierarchy().elements(0).ax_label() == std::to_string(count));
+      count++;
+    }
+    XCTAssertEqual(count, 50);
+    XCTAssertTrue(reader->ok());
+  }
+}
+
+- (void)testSeekToRecord {
+  [self writeRecordCount:50 compress:true];
+  std::unique_ptr<gtx::RecordReader> reader = gtx::RecordReader::Open(_path);
+  AccessibilityEvaluationProto evaluation;
+
+  XCTAssertTrue(reader->SeekToRecord(37));
+  XCTAssertTrue(reader->ReadEvaluation(&evaluation));
+  XCTAssertTrue(evaluation.hierarchy().elements(0).ax_label() == "37");
+  XCTAssertTrue(reader->SeekToRecord(2));
+  XCTAssertTrue(reader->ReadEvaluation(&evaluation));
+  XCTAssertTrue(evaluation.hierarchy().elements(0).ax_label() == "2");
+  XCTAssertFalse(reader->SeekToRecord(51));
+}
+
+- (void)testStreamWithoutIndexIsReadSequentially {
+  [self writeRecordCount:50 compress:false];
+  std::ifstream input(_path, std::ios::binary);
+  std::stringstream contents;
+  contents << input.rdbuf();
+  input.close();
+  std::string bytes = contents.str();
+  std::ofstream(_path, std::ios::binary | std::ios::trunc) << bytes.substr(0, bytes.size() / 2);
+
+  std::unique_ptr<gtx::RecordReader> reader = gtx::RecordReader::Open(_path);
+  XCTAssertFalse(reader->record_count().has_value());
+  std::string record;
+  int count = 0;
+  while (reader->ReadRecord(&record)) {
+    count++;
+  }
+  XCTAssertTrue(reader->ok());
+  XCTAssertGreaterThan(count, 0);
+  XCTAssertLessThan(count, 50);
+  XCTAssertTrue(reader->SeekToRecord(5));
+}
+
+- (void)testCorruptBlockIsReported {
+  [self writeRecordCount:50 compress:false];
+  std::fstream file(_path, std::ios::binary | std::ios::in | std::ios::out);
+  file.seekp(40);
+  file.put('X');
+  file.close();
+
+  std::unique_ptr<gtx::RecordReader> reader = gtx::RecordReader::Open(_path);
+  std::string record;
+  while (reader->ReadRecord(&record)) {
+  }
+  XCTAssertFalse(reader->ok());
+}
+
+- (void)testToolkitChecksEvaluationsInStream {
+  [self writeRecordCount:10 compress:true];
+  std::string outputPath = _path + ".out";
+  std::unique_ptr<gtx::RecordReader> reader = gtx::RecordReader::Open(_path);
+  std::unique_ptr<gtx::RecordWriter> writer =
+      gtx::RecordWriter::Create(outputPath, gtx::RecordType::kEvaluation);
+  std::unique_ptr<gtx::Toolkit> toolkit = gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  gtx::Parameters params;
+
+  XCTAssertTrue(toolkit->CheckEvaluations(*reader, params, *writer));
+  XCTAssertTrue(writer->Close());
+  std::unique_ptr<gtx::RecordReader> output = gtx::RecordReader::Open(outputPath);
+  AccessibilityEvaluationProto evaluation;
+  int count = 0;
+  while (output->ReadEvaluation(&evaluation)) {
+    // The elements are too small to be tapped.
+    XCTAssertGreaterThan(evaluation.results_size(), 0);
+    count++;
+  }
+  XCTAssertEqual(count, 10);
+  [[NSFileManager defaultManager] removeItemAtPath:@(outputPath.c_str()) error:nil];
+}
+
+- (void)testToolkitChecksEvaluationsWithParametersOfEachEvaluation {
+  [self writeRecordCount:10 compress:false];
+  std::string outputPath = _path + ".out";
+  std::unique_ptr<gtx::RecordReader> reader = gtx::RecordReader::Open(_path);
+  std::unique_ptr<gtx::RecordWriter> writer =
+      gtx::RecordWriter::Create(outputPath, gtx::RecordType::kEvaluation);
+  std::unique_ptr<gtx::Toolkit> toolkit = gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  std::vector<int> indices;
+  auto params_provider = [&indices](int evaluation_index,
+                                    const AccessibilityEvaluationProto &evaluation) {
+    indices.push_back(evaluation_index);
+    // The label of the only element of each evaluation is its index.
+    XCTAssertEqual(evaluation.hierarchy().elements(0).ax_label(),
+                   std::to_string(evaluation_index));
+    gtx::Parameters params;
+    params.set_device_bounds(gtx::Rect(0, 0, 100, 100));
+    return params;
+  };
+
+  XCTAssertTrue(toolkit->CheckEvaluations(*reader, params_provider, *writer));
+  XCTAssertTrue(writer->Close());
+  XCTAssertEqual(indices.size(), 10u);
+  for (size_t i = 0; i < indices.size(); i++) {
+    XCTAssertEqual(indices[i], static_cast<int>(i));
+  }
+  [[NSFileManager defaultManager] removeItemAtPath:@(outputPath.c_str()) error:nil];
+}
+
+@end
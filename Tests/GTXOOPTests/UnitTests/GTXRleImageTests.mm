@@ -0,0 +1,123 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "rle_image.h"
+
+#import <XCTest/XCTest.h>
+
+#include <utility>
+#include <vector>
+
+#include "contrast_swatch.h"
+#include "gtx_types.h"
+
+static const int kGTXTestImageWidth = 20;
+static const int kGTXTestImageHeight = 20;
+
+@interface GTXRleImageTests : XCTestCase
+@end
+
+@implementation GTXRleImageTests {
+  std::vector<gtx::Pixel> _colors;
+  std::vector<gtx::Pixel> _pixels;
+}
+
+- (void)setUp {
+  [super setUp];
+  // A background of color 0, a rectangle of color 1 and a line of color 2.
+  _colors = {[self pixelWithRed:255 green:255 blue:255], [self pixelWithRed:255 green:255 blue:0],
+             [self pixelWithRed:0 green:0 blue:0]};
+  _pixels.assign(kGTXTestImageWidth * kGTXTestImageHeight, _colors[0]);
+  for (int y = 4; y < 12; y++) {
+    for (int x = 4; x < 12; x++) {
+      _pixels[x + y * kGTXTestImageWidth] = _colors[1];
+    }
+  }
+  for (int x = 0; x < kGTXTestImageWidth; x++) {
+    _pixels[x + 15 * kGTXTestImageWidth] = _colors[2];
+  }
+}
+
+- (void)testRowsAreEncodedAsRuns {
+  gtx::RleImage image = gtx::RleImage::Encode([self rgbaImage]);
+  XCTAssertEqual(image.width(), kGTXTestImageWidth);
+  XCTAssertEqual(image.height(), kGTXTestImageHeight);
+  // One run per row, except for the three runs of the rows of the rectangle.
+  XCTAssertEqual(image.run_count(), static_cast<size_t>(kGTXTestImageHeight + 2 * 8));
+  XCTAssertEqual(image.RowEnd(5) - image.RowBegin(5), 3);
+  XCTAssertEqual(image.RowBegin(5)[1].start, 4);
+  XCTAssertLessThan(image.ByteSize(), _pixels.size() * sizeof(gtx::Pixel) / 4);
+  for (int y = 0; y < kGTXTestImageHeight; y++) {
+    for (int x = 0; x < kGTXTestImageWidth; x++) {
+      XCTAssertEqual(image.PackedColorAt(x, y),
+                     _pixels[x + y * kGTXTestImageWidth].PackedColor());
+    }
+  }
+}
+
+- (void)testRunsInRangeAreClippedAndSpanRows {
+  gtx::RleImage image = gtx::RleImage::Encode([self rgbaImage]);
+  std::vector<std::pair<int32_t, int>> runs;
+  // From the middle of the rectangle in row 11 to the start of row 12.
+  image.ForEachRunInRange(11 * kGTXTestImageWidth + 6, 12 * kGTXTestImageWidth + 3,
+                          [&runs](int32_t packedColor, int length) {
+                            runs.emplace_back(packedColor, length);
+                          });
+  XCTAssertEqual(runs.size(), 3ul);
+  XCTAssertTrue(runs[0] == std::make_pair(_colors[1].PackedColor(), 6));
+  XCTAssertTrue(runs[1] == std::make_pair(_colors[0].PackedColor(), 8));
+  XCTAssertTrue(runs[2] == std::make_pair(_colors[0].PackedColor(), 3));
+}
+
+- (void)testSwatchOfRunsMatchesSwatchOfPixels {
+  gtx::Image rgba = [self rgbaImage];
+  gtx::RleImage image = gtx::RleImage::Encode(rgba);
+  const gtx::Rect rects[] = {
+      gtx::Rect(0, 0, kGTXTestImageWidth, kGTXTestImageHeight), gtx::Rect(2, 2, 12, 12),
+      gtx::Rect(0, 14, 10, 3), gtx::Rect(5, 5, 3, 3), gtx::Rect(2.5, 3.5, 10.5, 6),
+      gtx::Rect(14, 13, 10, 4)};
+  for (const gtx::Rect &rect : rects) {
+    gtx::ContrastSwatch expected = gtx::ContrastSwatch::Extract(rgba, rect);
+    gtx::ContrastSwatch swatch = gtx::ContrastSwatch::Extract(image, rect);
+    XCTAssertTrue(swatch.background() == expected.background());
+    XCTAssertTrue(swatch.foreground() == expected.foreground());
+  }
+}
+
+- (void)testImageWithoutPixelsIsEmpty {
+  gtx::RleImage image = gtx::RleImage::Encode(gtx::Image(nullptr, 0, 0));
+  XCTAssertEqual(image.width(), 0);
+  XCTAssertEqual(image.run_count(), 0ul);
+}
+
+#pragma mark - Private Methods
+
+- (gtx::Image)rgbaImage {
+  return gtx::Image(_pixels.data(), kGTXTestImageWidth, kGTXTestImageHeight);
+}
+
+- (gtx::Pixel)pixelWithRed:(unsigned char)red
+                     green:(unsigned char)green
+                      blue:(unsigned char)blue {
+  gtx::Pixel pixel;
+  pixel.red = red;
+  pixel.green = green;
+  pixel.blue = blue;
+  pixel.alpha = 255;
+  return pixel;
+}
+
+@end
@@ -0,0 +1,231 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "sampling.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "typedefs.h"
+#include "element_trait.h"
+#include "evaluation_options.h"
+#include "gtx_types.h"
+#include "parameters.h"
+#include "toolkit.h"
+#include "gtxtest_always_failing_check.h"
+#include "gtxtest_synthetic_hierarchy.h"
+
+@interface GTXSamplingTests : XCTestCase
+@end
+
+@implementation GTXSamplingTests {
+  gtx::Parameters _params;
+}
+
+- (void)setUp {
+  [super setUp];
+  _params.set_device_bounds(gtx::Rect(0, 0, 100, 100));
+}
+
+- (void)testVisibleAreaScorerScoresFractionOfScreen {
+  UIElementProto element;
+  [self setFrame:gtx::Rect(50, 50, 100, 100) ofElement:&element];
+  XCTAssertEqual(gtx::VisibleAreaScorer()(element, _params), 0.25);
+  [self setFrame:gtx::Rect(200, 200, 10, 10) ofElement:&element];
+  XCTAssertEqual(gtx::VisibleAreaScorer()(element, _params), 0.0);
+}
+
+- (void)testInteractivityScorerPrefersInteractiveTraits {
+  UIElementProto button = [self elementWithTrait:gtx::ElementTrait::kButton];
+  UIElementProto text = [self elementWithTrait:gtx::ElementTrait::kStaticText];
+  XCTAssertEqual(gtx::InteractivityScorer()(button, _params), 1.0);
+  XCTAssertEqual(gtx::InteractivityScorer()(text, _params), 0.0);
+}
+
+- (void)testNoveltyScorerPrefersElementsMissingFromPreviousRun {
+  AccessibilityHierarchyProto previous;
+  *previous.add_elements() = [self elementWithTrait:gtx::ElementTrait::kButton];
+  UIElementProto seen = previous.elements(0);
+  UIElementProto changed = seen;
+  changed.set_ax_label("changed");
+  gtx::ElementScorer scorer = gtx::NoveltyScorer(gtx::ElementFingerprints(previous));
+  XCTAssertEqual(scorer(seen, _params), 0.0);
+  XCTAssertEqual(scorer(changed, _params), 1.0);
+}
+
+- (void)testFingerprintIgnoresSubpointFrameChanges {
+  UIElementProto element = [self elementWithTrait:gtx::ElementTrait::kButton];
+  UIElementProto moved = element;
+  [self setFrame:gtx::Rect(10.2, 10, 20, 20) ofElement:&element];
+  [self setFrame:gtx::Rect(10.3, 10, 20, 20) ofElement:&moved];
+  XCTAssertEqual(gtx::ElementFingerprint(element), gtx::ElementFingerprint(moved));
+  [self setFrame:gtx::Rect(12, 10, 20, 20) ofElement:&moved];
+  XCTAssertFalse(gtx::ElementFingerprint(element) == gtx::ElementFingerprint(moved));
+}
+
+- (void)testTraitStratifierUsesMostSpecificTrait {
+  UIElementProto element;
+  element.set_ax_traits(static_cast<uint64_t>(gtx::ElementTrait::kButton |
+                                              gtx::ElementTrait::kImage));
+  XCTAssertEqual(gtx::TraitStratifier()(element), "button");
+  element.set_ax_traits(0);
+  XCTAssertEqual(gtx::TraitStratifier()(element), "other");
+}
+
+- (void)testPlanTakesHighestScoringElementOfEachStratumFirst {
+  AccessibilityHierarchyProto hierarchy;
+  [self addElements:3 withTrait:gtx::ElementTrait::kButton toHierarchy:&hierarchy];
+  [self addElements:2 withTrait:gtx::ElementTrait::kImage toHierarchy:&hierarchy];
+  [self addElements:1 withTrait:gtx::ElementTrait::kStaticText toHierarchy:&hierarchy];
+  gtx::SamplingPlan plan = gtx::SamplingPlan::Create(
+      hierarchy, {0, 1, 2, 3, 4, 5}, _params, [self optionsScoringByIndex]);
+  // Scores are the element indices, so each stratum starts with its last element.
+  std::vector<int> expected = {5, 4, 2, 1, 3, 0};
+  XCTAssertTrue(plan.element_indices == expected);
+  std::vector<std::string> expectedNames = {"button", "image", "static_text"};
+  XCTAssertTrue(plan.stratum_names == expectedNames);
+  std::vector<int> expectedSizes = {3, 2, 1};
+  XCTAssertTrue(plan.stratum_sizes == expectedSizes);
+}
+
+- (void)testPlanSamplesStrataInProportionToTheirSize {
+  AccessibilityHierarchyProto hierarchy;
+  [self addElements:8 withTrait:gtx::ElementTrait::kButton toHierarchy:&hierarchy];
+  [self addElements:2 withTrait:gtx::ElementTrait::kImage toHierarchy:&hierarchy];
+  std::vector<int> candidates;
+  for (int i = 0; i < 10; i++) {
+    candidates.push_back(i);
+  }
+  gtx::SamplingPlan plan =
+      gtx::SamplingPlan::Create(hierarchy, candidates, _params, [self optionsScoringByIndex]);
+  XCTAssertEqual(plan.element_indices.size(), 10ul);
+  int buttons = 0;
+  for (int i = 0; i < 5; i++) {
+    if (plan.element_indices[i] < 8) {
+      buttons++;
+    }
+  }
+  XCTAssertEqual(buttons, 4);
+}
+
+- (void)testSampledEvaluationHonorsElementBudget {
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.element_count = 500;
+  AccessibilityHierarchyProto hierarchy =
+      gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateHierarchy();
+  gtx::Toolkit toolkit;
+  std::unique_ptr<gtx::Check> check =
+      std::make_unique<gtxtest::GTXTestAlwaysFailingCheck>(std::string("alwaysFailing"));
+  toolkit.RegisterCheck(check);
+  gtx::SamplingOptions sampling;
+  sampling.max_elements = 50;
+  gtx::SampledEvaluationResult result = toolkit.CheckElementsSampled(hierarchy, _params, sampling);
+  XCTAssertTrue(result.status == gtx::EvaluationStatus::kComplete);
+  XCTAssertEqual(result.results.size(), 50ul);
+  XCTAssertEqual(result.coverage.evaluated_count, 50);
+  XCTAssertEqual(result.coverage.element_count, 500);
+  XCTAssertGreaterThan(result.coverage.candidate_count, 50);
+  XCTAssertLessThan(result.coverage.candidate_count, 500);
+  XCTAssertGreaterThan(result.coverage.ScoreFraction(), result.coverage.CandidateFraction());
+  int strataEvaluated = 0;
+  for (const gtx::StratumCoverage &stratum : result.coverage.strata) {
+    XCTAssertGreaterThan(stratum.evaluated_count, 0);
+    strataEvaluated += stratum.evaluated_count;
+  }
+  XCTAssertEqual(strataEvaluated, 50);
+  for (size_t i = 1; i < result.results.size(); i++) {
+    XCTAssertLessThan(result.results[i - 1].hierarchy_source_id(),
+                      result.results[i].hierarchy_source_id());
+  }
+}
+
+- (void)testUnboundedSampledEvaluationMatchesCheckElements {
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.element_count = 300;
+  gtxtest::GTXTestSyntheticScreen screen =
+      gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateScreen();
+  gtx::Parameters params = screen.parameters();
+  std::unique_ptr<gtx::Toolkit> toolkit = gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  std::vector<CheckResultProto> expected = toolkit->CheckElements(screen.hierarchy(), params);
+  gtx::SampledEvaluationResult result =
+      toolkit->CheckElementsSampled(screen.hierarchy(), params, gtx::SamplingOptions());
+  XCTAssertTrue(result.status == gtx::EvaluationStatus::kComplete);
+  XCTAssertEqual(result.coverage.CandidateFraction(), 1.0);
+  XCTAssertEqual(result.results.size(), expected.size());
+  for (size_t i = 0; i < std::min(result.results.size(), expected.size()); i++) {
+    XCTAssertEqual(result.results[i].hierarchy_source_id(), expected[i].hierarchy_source_id());
+    XCTAssertEqual(result.results[i].source_check_class(), expected[i].source_check_class());
+  }
+}
+
+- (void)testSampledEvaluationStopsAtDeadline {
+  AccessibilityHierarchyProto hierarchy;
+  [self addElements:10 withTrait:gtx::ElementTrait::kButton toHierarchy:&hierarchy];
+  gtx::Toolkit toolkit;
+  std::unique_ptr<gtx::Check> check =
+      std::make_unique<gtxtest::GTXTestAlwaysFailingCheck>(std::string("alwaysFailing"));
+  toolkit.RegisterCheck(check);
+  gtx::SamplingOptions sampling = gtx::SamplingOptions::WithTimeout(std::chrono::seconds(-1));
+  gtx::SampledEvaluationResult result = toolkit.CheckElementsSampled(hierarchy, _params, sampling);
+  XCTAssertTrue(result.status == gtx::EvaluationStatus::kDeadlineExceeded);
+  XCTAssertTrue(result.results.empty());
+  XCTAssertEqual(result.coverage.evaluated_count, 0);
+  XCTAssertEqual(result.coverage.candidate_count, 10);
+}
+
+#pragma mark - Private Methods
+
+- (void)setFrame:(const gtx::Rect &)frame ofElement:(UIElementProto *)element {
+  RectProto *axFrame = element->mutable_ax_frame();
+  axFrame->mutable_origin()->set_x(frame.origin.x);
+  axFrame->mutable_origin()->set_y(frame.origin.y);
+  axFrame->mutable_size()->set_width(frame.size.width);
+  axFrame->mutable_size()->set_height(frame.size.height);
+}
+
+- (UIElementProto)elementWithTrait:(gtx::ElementTrait)trait {
+  UIElementProto element;
+  element.set_is_ax_element(true);
+  element.set_ax_label("label");
+  element.set_ax_traits(static_cast<uint64_t>(trait));
+  [self setFrame:gtx::Rect(0, 0, 10, 10) ofElement:&element];
+  return element;
+}
+
+// Appends @c count accessibility elements with @c trait, whose ids are their indices.
+- (void)addElements:(int)count
+          withTrait:(gtx::ElementTrait)trait
+        toHierarchy:(AccessibilityHierarchyProto *)hierarchy {
+  for (int i = 0; i < count; i++) {
+    UIElementProto *element = hierarchy->add_elements();
+    *element = [self elementWithTrait:trait];
+    element->set_id(hierarchy->elements_size() - 1);
+  }
+}
+
+// Returns sampling options that score elements by their id.
+- (gtx::SamplingOptions)optionsScoringByIndex {
+  gtx::SamplingOptions options;
+  options.scorer = [](const UIElementProto &element, const gtx::Parameters &params) {
+    return static_cast<double>(element.id());
+  };
+  return options;
+}
+
+@end
@@ -0,0 +1,136 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "scratch_arena.h"
+
+#import <XCTest/XCTest.h>
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "typedefs.h"
+#include "gtxtest_synthetic_hierarchy.h"
+#include "check.h"
+#include "contrast_check.h"
+#include "parameters.h"
+#include "toolkit.h"
+
+static const size_t kGTXTestChunkSize = 256;
+
+@interface GTXScratchArenaTests : XCTestCase
+@end
+
+@implementation GTXScratchArenaTests
+
+- (void)testAllocationsAreAlignedAndSpanChunks {
+  gtx::ScratchArena arena(kGTXTestChunkSize);
+  void *first = arena.Allocate(1, 1);
+  void *aligned = arena.Allocate(8, 8);
+  XCTAssertEqual(reinterpret_cast<uintptr_t>(aligned) % 8, 0u);
+  XCTAssertTrue(aligned != first);
+  XCTAssertEqual(arena.chunk_allocation_count(), 1);
+  // Too large for the rest of the first chunk.
+  arena.Allocate(kGTXTestChunkSize, 16);
+  XCTAssertEqual(arena.chunk_allocation_count(), 2);
+  XCTAssertGreaterThanOrEqual(arena.bytes_allocated(), kGTXTestChunkSize + 9);
+}
+
+- (void)testResetKeepsMemoryInOneChunk {
+  gtx::ScratchArena arena(kGTXTestChunkSize);
+  for (int i = 0; i < 20; i++) {
+    arena.Allocate(100);
+  }
+  const int64_t chunk_allocation_count = arena.chunk_allocation_count();
+  XCTAssertGreaterThan(chunk_allocation_count, 1);
+  arena.Reset();
+  XCTAssertEqual(arena.bytes_allocated(), 0u);
+  XCTAssertEqual(arena.chunk_allocation_count(), chunk_allocation_count + 1);
+  // The same allocations now fit in the single chunk.
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 20; i++) {
+      arena.Allocate(100);
+    }
+    arena.Reset();
+  }
+  XCTAssertEqual(arena.chunk_allocation_count(), chunk_allocation_count + 1);
+}
+
+- (void)testAllocatorUsesCurrentArena {
+  gtx::ScratchArena arena;
+  XCTAssertTrue(gtx::ScratchArena::Current() == nullptr);
+  {
+    gtx::ScopedScratchArena scoped_arena(&arena);
+    XCTAssertTrue(gtx::ScratchArena::Current() == &arena);
+    gtx::ScratchVector<int> values;
+    for (int i = 0; i < 100; i++) {
+      values.push_back(i);
+    }
+    XCTAssertTrue(values.get_allocator().arena() == &arena);
+    XCTAssertGreaterThanOrEqual(arena.bytes_allocated(), 100 * sizeof(int));
+  }
+  XCTAssertTrue(gtx::ScratchArena::Current() == nullptr);
+  gtx::ScratchVector<int> heap_values(10, 1);
+  XCTAssertTrue(heap_values.get_allocator().arena() == nullptr);
+}
+
+- (void)testPoolReusesResetArenas {
+  gtx::ScratchArenaPool pool;
+  gtx::ScratchArena *pooled_arena = nullptr;
+  {
+    gtx::ScopedScratchArena scoped_arena(&pool);
+    pooled_arena = gtx::ScratchArena::Current();
+    XCTAssertTrue(pooled_arena != nullptr);
+    pooled_arena->Allocate(100);
+    {
+      // Nested evaluations keep the arena of the outer one.
+      gtx::ScopedScratchArena nested_arena(&pool);
+      XCTAssertTrue(gtx::ScratchArena::Current() == pooled_arena);
+    }
+    XCTAssertEqual(pooled_arena->bytes_allocated(), 100u);
+  }
+  XCTAssertTrue(gtx::ScratchArena::Current() == nullptr);
+  std::unique_ptr<gtx::ScratchArena> arena = pool.Acquire();
+  XCTAssertTrue(arena.get() == pooled_arena);
+  XCTAssertEqual(arena->bytes_allocated(), 0u);
+}
+
+- (void)testToolkitEvaluatesChecksInScratchArena {
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.seed = 3;
+  options.element_count = 100;
+  gtxtest::GTXTestSyntheticScreen screen =
+      gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateScreen();
+  gtx::Toolkit toolkit;
+  std::unique_ptr<gtx::Check> check = std::make_unique<gtx::ContrastCheck>();
+  toolkit.RegisterCheck(check);
+  std::vector<CheckResultProto> expected = toolkit.CheckElements(screen.hierarchy(), screen.parameters());
+  XCTAssertTrue(gtx::ScratchArena::Current() == nullptr);
+
+  gtx::ScratchArena arena;
+  gtx::ScopedScratchArena scoped_arena(&arena);
+  std::vector<CheckResultProto> results =
+      toolkit.CheckElements(screen.hierarchy(), screen.parameters());
+  XCTAssertGreaterThan(arena.bytes_allocated(), 0u);
+  XCTAssertEqual(results.size(), expected.size());
+  for (size_t i = 0; i < results.size(); i++) {
+    XCTAssertEqual(results[i].hierarchy_source_id(), expected[i].hierarchy_source_id());
+    XCTAssertEqual(results[i].result_id(), expected[i].result_id());
+  }
+}
+
+@end
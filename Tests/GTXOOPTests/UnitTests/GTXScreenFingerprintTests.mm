@@ -0,0 +1,189 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "screen_fingerprint.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "typedefs.h"
+#include "evaluation_options.h"
+#include "gtx_types.h"
+#include "palette_image.h"
+#include "parameters.h"
+#include "rle_image.h"
+#include "toolkit.h"
+#include "gtxtest_always_failing_check.h"
+#include "gtxtest_synthetic_hierarchy.h"
+
+static const int kGTXTestElementCount = 200;
+
+@interface GTXScreenFingerprintTests : XCTestCase
+@end
+
+@implementation GTXScreenFingerprintTests
+
+- (void)testSameScreenHasSameFingerprint {
+  gtxtest::GTXTestSyntheticScreen screen = [self screenWithSeed:1];
+  gtxtest::GTXTestSyntheticScreen copy = [self screenWithSeed:1];
+  gtx::ScreenFingerprint fingerprint =
+      gtx::ScreenFingerprint::Compute(screen.hierarchy(), screen.parameters());
+  gtx::ScreenFingerprint copyFingerprint =
+      gtx::ScreenFingerprint::Compute(copy.hierarchy(), copy.parameters());
+  XCTAssertTrue(fingerprint.has_image);
+  XCTAssertEqual(fingerprint.structure_hash, copyFingerprint.structure_hash);
+  XCTAssertEqual(fingerprint.image_hash, copyFingerprint.image_hash);
+  XCTAssertTrue(gtx::ScreenFingerprintTolerance().Matches(fingerprint, copyFingerprint));
+}
+
+- (void)testSmallChangesMatchWithinTolerance {
+  gtxtest::GTXTestSyntheticScreen screen = [self screenWithSeed:1];
+  gtx::ScreenFingerprint fingerprint =
+      gtx::ScreenFingerprint::Compute(screen.hierarchy(), screen.parameters());
+
+  // Move an element and change a few pixels.
+  AccessibilityHierarchyProto hierarchy = screen.hierarchy();
+  UIElementProto *element = hierarchy.mutable_elements(kGTXTestElementCount / 2);
+  element->mutable_ax_frame()->mutable_origin()->set_x(element->ax_frame().origin().x() + 20);
+  gtx::Image screenshot = screen.screenshot();
+  for (int x = 0; x < 10; x++) {
+    screenshot.pixels[x + 10 * screenshot.width].red ^= 0xff;
+  }
+  gtx::Parameters params = screen.parameters();
+  gtx::ScreenFingerprint changed = gtx::ScreenFingerprint::Compute(hierarchy, params);
+  XCTAssertTrue(gtx::ScreenFingerprintTolerance().Matches(fingerprint, changed));
+}
+
+- (void)testDifferentScreensDoNotMatch {
+  gtxtest::GTXTestSyntheticScreen screen = [self screenWithSeed:1];
+  gtxtest::GTXTestSyntheticScreen other = [self screenWithSeed:2];
+  gtx::ScreenFingerprint fingerprint =
+      gtx::ScreenFingerprint::Compute(screen.hierarchy(), screen.parameters());
+  gtx::ScreenFingerprint otherFingerprint =
+      gtx::ScreenFingerprint::Compute(other.hierarchy(), other.parameters());
+  XCTAssertGreaterThan(gtx::HammingDistance(fingerprint.structure_hash,
+                                            otherFingerprint.structure_hash),
+                       gtx::ScreenFingerprintTolerance().max_structure_distance);
+  XCTAssertFalse(gtx::ScreenFingerprintTolerance().Matches(fingerprint, otherFingerprint));
+
+  // A screen without a screenshot never matches one with a screenshot.
+  gtx::Parameters noScreenshot;
+  gtx::ScreenFingerprint structureOnly =
+      gtx::ScreenFingerprint::Compute(screen.hierarchy(), noScreenshot);
+  XCTAssertFalse(structureOnly.has_image);
+  XCTAssertFalse(gtx::ScreenFingerprintTolerance().Matches(fingerprint, structureOnly));
+}
+
+- (void)testEncodedScreenshotsHaveSameFingerprint {
+  gtxtest::GTXTestSyntheticScreen screen = [self screenWithSeed:1];
+  gtx::ScreenFingerprint fingerprint =
+      gtx::ScreenFingerprint::Compute(screen.hierarchy(), screen.parameters());
+  gtx::PaletteImage paletteImage = gtx::PaletteImage::Encode(screen.screenshot());
+  gtx::RleImage rleImage = gtx::RleImage::Encode(screen.screenshot());
+  gtx::Parameters paletteParams;
+  paletteParams.set_palette_screenshot(&paletteImage);
+  gtx::Parameters rleParams;
+  rleParams.set_rle_screenshot(&rleImage);
+  gtx::ScreenFingerprint paletteFingerprint =
+      gtx::ScreenFingerprint::Compute(screen.hierarchy(), paletteParams);
+  gtx::ScreenFingerprint rleFingerprint =
+      gtx::ScreenFingerprint::Compute(screen.hierarchy(), rleParams);
+  XCTAssertTrue(paletteFingerprint.has_image);
+  XCTAssertEqual(paletteFingerprint.image_hash, fingerprint.image_hash);
+  XCTAssertTrue(rleFingerprint.has_image);
+  XCTAssertEqual(rleFingerprint.image_hash, fingerprint.image_hash);
+}
+
+- (void)testIndexDiscardsLeastRecentlyUsedScreen {
+  gtx::RecentScreenIndex index(2);
+  gtx::ScreenFingerprint first = [self fingerprintWithStructureHash:0];
+  gtx::ScreenFingerprint second = [self fingerprintWithStructureHash:0xffff];
+  gtx::ScreenFingerprint third = [self fingerprintWithStructureHash:0xffff0000];
+  index.Insert(first, [self resultWithElementCount:1]);
+  index.Insert(second, [self resultWithElementCount:2]);
+  gtx::EvaluationResult result;
+  XCTAssertTrue(index.Find(first, &result));
+  XCTAssertEqual(result.element_count, 1);
+  index.Insert(third, [self resultWithElementCount:3]);
+  XCTAssertEqual(index.size(), 2ul);
+  XCTAssertFalse(index.Find(second, &result));
+  XCTAssertTrue(index.Find(third, &result));
+  XCTAssertEqual(result.element_count, 3);
+
+  // A fingerprint a bit away from the first matches it.
+  XCTAssertTrue(index.Find([self fingerprintWithStructureHash:0x3], &result));
+  XCTAssertEqual(result.element_count, 1);
+  XCTAssertEqual(index.hit_count(), 3ul);
+  XCTAssertEqual(index.miss_count(), 1ul);
+}
+
+- (void)testToolkitReusesResultsOfRecentScreen {
+  gtxtest::GTXTestSyntheticScreen screen = [self screenWithSeed:1];
+  gtx::Parameters params = screen.parameters();
+  gtx::Toolkit toolkit;
+  std::unique_ptr<gtx::Check> check =
+      std::make_unique<gtxtest::GTXTestAlwaysFailingCheck>(std::string("alwaysFailing"));
+  toolkit.RegisterCheck(check);
+  gtx::RecentScreenIndex index;
+  bool reused = true;
+  gtx::EvaluationResult first = toolkit.CheckElements(
+      screen.hierarchy(), params, gtx::EvaluationOptions(), &index, &reused);
+  XCTAssertFalse(reused);
+  XCTAssertEqual(index.size(), 1ul);
+  gtx::EvaluationResult second = toolkit.CheckElements(
+      screen.hierarchy(), params, gtx::EvaluationOptions(), &index, &reused);
+  XCTAssertTrue(reused);
+  XCTAssertEqual(second.results.size(), first.results.size());
+  XCTAssertEqual(second.elements_evaluated, first.elements_evaluated);
+
+  // Cancelled evaluations are incomplete, and are not added.
+  gtxtest::GTXTestSyntheticScreen other = [self screenWithSeed:2];
+  gtx::CancellationToken token;
+  token.Cancel();
+  gtx::EvaluationOptions cancelled;
+  cancelled.cancellation_token = &token;
+  gtx::EvaluationResult incomplete = toolkit.CheckElements(
+      other.hierarchy(), other.parameters(), cancelled, &index, &reused);
+  XCTAssertFalse(reused);
+  XCTAssertFalse(incomplete.complete());
+  XCTAssertEqual(index.size(), 1ul);
+}
+
+#pragma mark - Private Methods
+
+- (gtxtest::GTXTestSyntheticScreen)screenWithSeed:(uint64_t)seed {
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.seed = seed;
+  options.element_count = kGTXTestElementCount;
+  return gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateScreen();
+}
+
+- (gtx::ScreenFingerprint)fingerprintWithStructureHash:(uint64_t)structureHash {
+  gtx::ScreenFingerprint fingerprint;
+  fingerprint.structure_hash = structureHash;
+  return fingerprint;
+}
+
+- (gtx::EvaluationResult)resultWithElementCount:(int)elementCount {
+  gtx::EvaluationResult result;
+  result.element_count = elementCount;
+  return result;
+}
+
+@end
@@ -18,6 +18,10 @@
 
 #import <XCTest/XCTest.h>
 
+#include <string>
+
+#include <abseil/absl/strings/string_view.h>
+
 @interface GTXStringUtilsTests : XCTestCase
 @end
 
@@ -39,4 +43,12 @@
   XCTAssertEqual(gtx::TrimWhitespace("    text    "), "text");
 }
 
+- (void)testTrimWhitespaceViewDoesNotCopy {
+  std::string str = " \t text with spaces\n ";
+  absl::string_view trimmed = gtx::TrimWhitespaceView(str);
+  XCTAssertEqual(trimmed, "text with spaces");
+  XCTAssertTrue(trimmed.data() == str.data() + 3);
+  XCTAssertTrue(gtx::TrimWhitespaceView("   ").empty());
+}
+
 @end
@@ -0,0 +1,99 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "gtxtest_synthetic_hierarchy.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "typedefs.h"
+#include "toolkit.h"
+
+@interface GTXSyntheticHierarchyTests : XCTestCase
+@end
+
+@implementation GTXSyntheticHierarchyTests
+
+- (void)testGeneratesRequestedNumberOfElements {
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.element_count = 5000;
+  AccessibilityHierarchyProto hierarchy =
+      gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateHierarchy();
+  XCTAssertEqual(hierarchy.elements_size(), 5000);
+  for (int i = 0; i < hierarchy.elements_size(); i++) {
+    XCTAssertEqual(hierarchy.elements(i).id(), i);
+  }
+}
+
+- (void)testGeneratesSameHierarchyForSameSeed {
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.seed = 42;
+  AccessibilityHierarchyProto first =
+      gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateHierarchy();
+  AccessibilityHierarchyProto second =
+      gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateHierarchy();
+  XCTAssertEqual(first.elements_size(), second.elements_size());
+  for (int i = 0; i < first.elements_size(); i++) {
+    XCTAssertTrue(first.elements(i).ax_label() == second.elements(i).ax_label());
+    XCTAssertEqual(first.elements(i).ax_traits(), second.elements(i).ax_traits());
+    XCTAssertTrue(first.elements(i).child_ids() == second.elements(i).child_ids());
+    XCTAssertEqual(first.elements(i).ax_frame().origin().x(),
+                   second.elements(i).ax_frame().origin().x());
+  }
+}
+
+- (void)testChildrenReferToTheirParent {
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.max_depth = 3;
+  options.max_fan_out = 4;
+  AccessibilityHierarchyProto hierarchy =
+      gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateHierarchy();
+  // At most 1 + 4 + 16 + 64 elements fit in a hierarchy of depth 3.
+  XCTAssertLessThanOrEqual(hierarchy.elements_size(), 85);
+  for (const UIElementProto &element : hierarchy.elements()) {
+    for (int child_id : element.child_ids()) {
+      XCTAssertEqual(hierarchy.elements(child_id).parent_id(), element.id());
+    }
+  }
+}
+
+- (void)testScreenFailsEachDefaultCheck {
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.element_count = 300;
+  gtxtest::GTXTestSyntheticScreen screen =
+      gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateScreen();
+  gtx::Image screenshot = screen.screenshot();
+  XCTAssertEqual(screenshot.width, 780);
+  XCTAssertEqual(screenshot.height, 1688);
+  gtx::Parameters params = screen.parameters();
+  std::vector<CheckResultProto> results =
+      gtx::Toolkit::ToolkitWithAllDefaultChecks()->CheckElements(
+          screen.hierarchy(), params);
+  std::set<std::string> failed_checks;
+  for (const CheckResultProto &result : results) {
+    failed_checks.insert(result.source_check_class());
+  }
+  XCTAssertTrue(failed_checks ==
+                (std::set<std::string>{"AccessibilityLabelNotPunctuatedCheck",
+                                       "ContrastCheck", "MinimumTappableAreaCheck",
+                                       "NoLabelCheck"}));
+}
+
+@end
@@ -0,0 +1,137 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "tile_hash_map.h"
+
+#import <XCTest/XCTest.h>
+
+#include <vector>
+
+#include "gtx_types.h"
+
+static const int kGTXTestImageWidth = 100;
+static const int kGTXTestImageHeight = 70;
+static const int kGTXTestTileSize = 32;
+
+@interface GTXTileHashMapTests : XCTestCase
+@end
+
+@implementation GTXTileHashMapTests {
+  std::vector<gtx::Pixel> _pixels;
+}
+
+- (void)setUp {
+  [super setUp];
+  // A gradient, so that every tile differs from the others.
+  _pixels.resize(kGTXTestImageWidth * kGTXTestImageHeight);
+  for (int y = 0; y < kGTXTestImageHeight; y++) {
+    for (int x = 0; x < kGTXTestImageWidth; x++) {
+      gtx::Pixel &pixel = _pixels[x + y * kGTXTestImageWidth];
+      pixel.red = static_cast<unsigned char>(x * 2);
+      pixel.green = static_cast<unsigned char>(y * 3);
+      pixel.blue = static_cast<unsigned char>(x + y);
+      pixel.alpha = 255;
+    }
+  }
+}
+
+- (void)testDimensionsIncludePartialEdgeTiles {
+  gtx::TileHashMap map = gtx::TileHashMap::FromImage([self rgbaImage], kGTXTestTileSize);
+  XCTAssertEqual(map.width(), kGTXTestImageWidth);
+  XCTAssertEqual(map.height(), kGTXTestImageHeight);
+  XCTAssertEqual(map.columns(), 4);
+  XCTAssertEqual(map.rows(), 3);
+  XCTAssertNotEqual(map.TileHash(0, 0), map.TileHash(1, 0));
+  XCTAssertNotEqual(map.TileHash(3, 2), map.TileHash(2, 2));
+}
+
+- (void)testImageWithoutPixelsHasEmptyMap {
+  gtx::TileHashMap map = gtx::TileHashMap::FromImage(
+      gtx::Image(nullptr, kGTXTestImageWidth, kGTXTestImageHeight), kGTXTestTileSize);
+  XCTAssertEqual(map.width(), 0);
+  XCTAssertEqual(map.height(), 0);
+  XCTAssertEqual(map.columns(), 0);
+  XCTAssertEqual(map.rows(), 0);
+
+  // Every tile of an image with pixels changed since a screenshot without them.
+  gtx::TileHashMap current = gtx::TileHashMap::FromImage([self rgbaImage], kGTXTestTileSize);
+  XCTAssertFalse(current.IsIdentical(map));
+  std::vector<gtx::Rect> changedRects = current.ChangedRects(map);
+  XCTAssertEqual(changedRects.size(), 1u);
+  [self assertRect:changedRects[0]
+            equals:gtx::Rect(0, 0, kGTXTestImageWidth, kGTXTestImageHeight)];
+}
+
+- (void)testSameImageIsUnchanged {
+  gtx::TileHashMap previous = gtx::TileHashMap::FromImage([self rgbaImage], kGTXTestTileSize);
+  gtx::TileHashMap current = gtx::TileHashMap::FromImage([self rgbaImage], kGTXTestTileSize);
+  XCTAssertTrue(current.IsIdentical(previous));
+  XCTAssertTrue(current.ChangedRects(previous).empty());
+  XCTAssertTrue(current.IsRectUnchanged(
+      previous, gtx::Rect(0, 0, kGTXTestImageWidth, kGTXTestImageHeight)));
+}
+
+- (void)testChangedPixelChangesOnlyItsTile {
+  gtx::TileHashMap previous = gtx::TileHashMap::FromImage([self rgbaImage], kGTXTestTileSize);
+  _pixels[40 + 35 * kGTXTestImageWidth].alpha = 0;
+  gtx::TileHashMap current = gtx::TileHashMap::FromImage([self rgbaImage], kGTXTestTileSize);
+  XCTAssertFalse(current.IsIdentical(previous));
+  std::vector<gtx::Rect> changedRects = current.ChangedRects(previous);
+  XCTAssertEqual(changedRects.size(), 1u);
+  [self assertRect:changedRects[0] equals:gtx::Rect(32, 32, 32, 32)];
+  XCTAssertFalse(current.IsRectUnchanged(previous, gtx::Rect(60, 60, 10, 5)));
+  XCTAssertTrue(current.IsRectUnchanged(previous, gtx::Rect(0, 0, 32, 64)));
+  XCTAssertTrue(current.IsRectUnchanged(previous, gtx::Rect(64.5f, 0, 35, 70)));
+}
+
+- (void)testAdjacentChangedTilesAreMerged {
+  gtx::TileHashMap previous = gtx::TileHashMap::FromImage([self rgbaImage], kGTXTestTileSize);
+  // Change tiles 1 to 3 of the bottom row, the last of which is partial.
+  for (int x = 40; x < kGTXTestImageWidth; x += 30) {
+    _pixels[x + 68 * kGTXTestImageWidth].red ^= 1;
+  }
+  _pixels[99 + 69 * kGTXTestImageWidth].red ^= 1;
+  gtx::TileHashMap current = gtx::TileHashMap::FromImage([self rgbaImage], kGTXTestTileSize);
+  std::vector<gtx::Rect> changedRects = current.ChangedRects(previous);
+  XCTAssertEqual(changedRects.size(), 1u);
+  [self assertRect:changedRects[0] equals:gtx::Rect(32, 64, 68, 6)];
+}
+
+- (void)testDifferentTilesChangeWholeImage {
+  gtx::TileHashMap previous = gtx::TileHashMap::FromImage([self rgbaImage], 16);
+  gtx::TileHashMap current = gtx::TileHashMap::FromImage([self rgbaImage], kGTXTestTileSize);
+  XCTAssertFalse(current.IsIdentical(previous));
+  XCTAssertFalse(current.IsRectUnchanged(previous, gtx::Rect(0, 0, 1, 1)));
+  std::vector<gtx::Rect> changedRects = current.ChangedRects(previous);
+  XCTAssertEqual(changedRects.size(), 1u);
+  [self assertRect:changedRects[0]
+            equals:gtx::Rect(0, 0, kGTXTestImageWidth, kGTXTestImageHeight)];
+}
+
+#pragma mark - Private Methods
+
+- (gtx::Image)rgbaImage {
+  return gtx::Image(_pixels.data(), kGTXTestImageWidth, kGTXTestImageHeight);
+}
+
+- (void)assertRect:(const gtx::Rect &)rect equals:(const gtx::Rect &)expected {
+  XCTAssertEqual(rect.origin.x, expected.origin.x);
+  XCTAssertEqual(rect.origin.y, expected.origin.y);
+  XCTAssertEqual(rect.size.width, expected.size.width);
+  XCTAssertEqual(rect.size.height, expected.size.height);
+}
+
+@end
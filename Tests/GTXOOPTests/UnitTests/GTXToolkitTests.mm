@@ -20,14 +20,61 @@
 #include "metadata_map.h"
 #include "typedefs.h"
 #include "check.h"
+#include "contrast_check.h"
+#include "evaluation_options.h"
+#include "executor.h"
 #include "gtx_types.h"
+#include "hierarchy_table.h"
 #include "localized_strings_manager.h"
 #include "toolkit.h"
 #include "gtxtest_always_failing_check.h"
 #include "gtxtest_always_passing_check.h"
+#include "gtxtest_synthetic_hierarchy.h"
 
 #pragma mark - Test Classes
 
+// Runs tasks on the calling thread, as an executor supplied by a host could.
+class GTXTestInlineExecutor : public gtx::Executor {
+ public:
+  void Execute(std::function<void()> task) override {
+    executed_count_++;
+    task();
+  }
+
+  int executed_count() const { return executed_count_; }
+
+ private:
+  int executed_count_ = 0;
+};
+
+// Fails every element, and cancels a token when it checks the element with a
+// given id.
+class GTXTestCancellingCheck : public gtxtest::GTXTestAlwaysFailingCheck {
+ public:
+  GTXTestCancellingCheck(const gtx::CancellationToken &token, int element_id)
+      : GTXTestAlwaysFailingCheck("cancelling"), token_(token), element_id_(element_id) {}
+
+  absl::optional<CheckResultProto> CheckElement(const UIElementProto &element,
+                                                const gtx::Parameters &params) const override {
+    if (element.id() == element_id_) {
+      token_.Cancel();
+    }
+    return GTXTestAlwaysFailingCheck::CheckElement(element, params);
+  }
+
+ private:
+  mutable gtx::CancellationToken token_;
+  int element_id_;
+};
+
+// A GTXTestCancellingCheck that claims to read the screenshot.
+class GTXTestCancellingImageCheck : public GTXTestCancellingCheck {
+ public:
+  using GTXTestCancellingCheck::GTXTestCancellingCheck;
+
+  gtx::CheckCostClass CostClass() const override { return gtx::CheckCostClass::kImage; }
+};
+
 @interface GTXToolkitTests : XCTestCase
 @end
 
@@ -162,6 +209,38 @@
   XCTAssertEqual(results.front().source_check_class(), expected);
 }
 
+- (void)testToolkitArrayAPIChecksInvisibleElementsByDefault {
+  gtx::Toolkit toolkit;
+  toolkit.RegisterCheck(_failingCheck1);
+  _element1.set_hidden(true);
+  AccessibilityHierarchyProto elements;
+  *elements.add_elements() = _element1;
+  XCTAssertEqual(toolkit.CheckElements(elements, _params).size(), 1ul);
+}
+
+- (void)testToolkitArrayAPISkipsInvisibleElementsWhenEnabled {
+  gtx::Toolkit toolkit;
+  toolkit.RegisterCheck(_failingCheck1);
+  toolkit.set_skips_invisible_elements(true);
+  _element1.set_hidden(true);
+  _element2.set_alpha(0);
+  AccessibilityHierarchyProto elements;
+  *elements.add_elements() = _element1;
+  *elements.add_elements() = _element2;
+  XCTAssertTrue(toolkit.CheckElements(elements, _params).empty());
+}
+
+- (void)testToolkitArrayAPIChecksVisibleElementsWhenSkippingInvisibleElements {
+  gtx::Toolkit toolkit;
+  toolkit.RegisterCheck(_failingCheck1);
+  toolkit.set_skips_invisible_elements(true);
+  _element1.set_hidden(true);
+  AccessibilityHierarchyProto elements;
+  *elements.add_elements() = _element1;
+  *elements.add_elements() = _element2;
+  XCTAssertEqual(toolkit.CheckElements(elements, _params).size(), 1ul);
+}
+
 - (void)testRegisterCheckWithEqualCheckNamesReturnsFalse {
   gtx::Toolkit toolkit;
   // Toolkit takes ownership of Checks, so the same instance can't be used. Construct a new instance
@@ -172,4 +251,203 @@
   XCTAssertEqual(toolkit.RegisterCheck(duplicatePassingCheck1), false);
 }
 
+- (void)testCheckElementsWithoutDeadlineIsComplete {
+  gtx::Toolkit toolkit;
+  toolkit.RegisterCheck(_failingCheck1);
+  AccessibilityHierarchyProto elements = [self hierarchyWithElementCount:3];
+  gtx::EvaluationResult result =
+      toolkit.CheckElements(elements, _params, gtx::EvaluationOptions());
+  XCTAssertTrue(result.complete());
+  XCTAssertEqual(result.elements_evaluated, 3);
+  XCTAssertEqual(result.element_count, 3);
+  XCTAssertEqual(result.results.size(), 3ul);
+}
+
+- (void)testCheckElementsStopsAtExpiredDeadline {
+  gtx::Toolkit toolkit;
+  toolkit.RegisterCheck(_failingCheck1);
+  AccessibilityHierarchyProto elements = [self hierarchyWithElementCount:3];
+  gtx::EvaluationOptions options = gtx::EvaluationOptions::WithTimeout(std::chrono::seconds(-1));
+  gtx::EvaluationResult result = toolkit.CheckElements(elements, _params, options);
+  XCTAssertTrue(result.status == gtx::EvaluationStatus::kDeadlineExceeded);
+  XCTAssertEqual(result.elements_evaluated, 0);
+  XCTAssertTrue(result.results.empty());
+
+  result = toolkit.CheckElements(gtx::HierarchyTable::FromProto(elements), _params, options);
+  XCTAssertTrue(result.status == gtx::EvaluationStatus::kDeadlineExceeded);
+  XCTAssertEqual(result.elements_evaluated, 0);
+  XCTAssertTrue(result.results.empty());
+}
+
+- (void)testCheckElementsCompletesBeforeDistantDeadline {
+  gtx::Toolkit toolkit;
+  toolkit.RegisterCheck(_failingCheck1);
+  AccessibilityHierarchyProto elements = [self hierarchyWithElementCount:100];
+  gtx::EvaluationOptions options = gtx::EvaluationOptions::WithTimeout(std::chrono::hours(1));
+  XCTAssertTrue(toolkit.CheckElements(elements, _params, options).complete());
+  gtx::EvaluationResult result =
+      toolkit.CheckElements(gtx::HierarchyTable::FromProto(elements), _params, options);
+  XCTAssertTrue(result.complete());
+  XCTAssertEqual(result.elements_evaluated, 100);
+  XCTAssertEqual(result.results.size(), 100ul);
+}
+
+- (void)testCheckElementsStopsWhenCancelledDuringEvaluation {
+  const int elementCount = 200;
+  AccessibilityHierarchyProto elements = [self hierarchyWithElementCount:elementCount];
+  for (bool useTable : {false, true}) {
+    gtx::CancellationToken token;
+    std::unique_ptr<gtx::Check> check = std::make_unique<GTXTestCancellingCheck>(token, 10);
+    gtx::Toolkit toolkit;
+    toolkit.RegisterCheck(check);
+    gtx::EvaluationOptions options;
+    options.cancellation_token = &token;
+    gtx::EvaluationResult result =
+        useTable ? toolkit.CheckElements(gtx::HierarchyTable::FromProto(elements), _params, options)
+                 : toolkit.CheckElements(elements, _params, options);
+    XCTAssertTrue(result.status == gtx::EvaluationStatus::kCancelled);
+    XCTAssertGreaterThan(result.elements_evaluated, 10);
+    XCTAssertLessThan(result.elements_evaluated, elementCount);
+    XCTAssertEqual(result.element_count, elementCount);
+    // Partial results cover exactly the elements evaluated.
+    XCTAssertEqual((int)result.results.size(), result.elements_evaluated);
+    XCTAssertEqual(result.results.back().hierarchy_source_id(), result.elements_evaluated - 1);
+  }
+}
+
+- (void)testEvaluationStatusNames {
+  XCTAssertEqual(std::string(gtx::EvaluationStatusName(gtx::EvaluationStatus::kComplete)),
+                 "complete");
+  XCTAssertEqual(std::string(gtx::EvaluationStatusName(gtx::EvaluationStatus::kDeadlineExceeded)),
+                 "deadline_exceeded");
+  XCTAssertEqual(std::string(gtx::EvaluationStatusName(gtx::EvaluationStatus::kCancelled)),
+                 "cancelled");
+}
+
+- (void)testCheckElementsAsyncReturnsSameResultsAsCheckElements {
+  gtx::Toolkit toolkit;
+  toolkit.RegisterCheck(_failingCheck1);
+  toolkit.RegisterCheck(_passingCheck1);
+  AccessibilityHierarchyProto elements = [self hierarchyWithElementCount:20];
+  std::vector<std::future<gtx::EvaluationResult>> futures;
+  for (int i = 0; i < 4; i++) {
+    futures.push_back(toolkit.CheckElementsAsync(elements, _params));
+  }
+  std::vector<CheckResultProto> expected = toolkit.CheckElements(elements, _params);
+  for (std::future<gtx::EvaluationResult> &future : futures) {
+    gtx::EvaluationResult result = future.get();
+    XCTAssertTrue(result.complete());
+    XCTAssertEqual(result.results.size(), expected.size());
+  }
+}
+
+- (void)testCheckElementsAsyncRunsOnSuppliedExecutor {
+  gtx::Toolkit toolkit;
+  toolkit.RegisterCheck(_failingCheck1);
+  GTXTestInlineExecutor executor;
+  int resultCount = -1;
+  toolkit.CheckElementsAsync([self hierarchyWithElementCount:5], _params, gtx::EvaluationOptions(),
+                             &executor, [&resultCount](gtx::EvaluationResult result) {
+                               resultCount = static_cast<int>(result.results.size());
+                             });
+  XCTAssertEqual(executor.executed_count(), 1);
+  XCTAssertEqual(resultCount, 5);
+}
+
+- (void)testCheckElementsAsyncHonorsCancellation {
+  gtx::Toolkit toolkit;
+  toolkit.RegisterCheck(_failingCheck1);
+  gtx::CancellationToken token;
+  token.Cancel();
+  gtx::EvaluationOptions options;
+  options.cancellation_token = &token;
+  gtx::ThreadPoolExecutor executor(1);
+  gtx::EvaluationResult result =
+      toolkit.CheckElementsAsync([self hierarchyWithElementCount:5], _params, options, &executor)
+          .get();
+  XCTAssertTrue(result.status == gtx::EvaluationStatus::kCancelled);
+  XCTAssertTrue(result.results.empty());
+}
+
+- (void)testContrastCheckIsImageCheck {
+  XCTAssertTrue(gtx::ContrastCheck().CostClass() == gtx::CheckCostClass::kImage);
+  XCTAssertTrue(_failingCheck1->CostClass() == gtx::CheckCostClass::kMetadata);
+}
+
+- (void)testImageCheckExecutorReturnsSameResultsInSameOrder {
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.element_count = 300;
+  gtxtest::GTXTestSyntheticScreen screen =
+      gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateScreen();
+  gtx::Parameters params = screen.parameters();
+  std::unique_ptr<gtx::Toolkit> toolkit = gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  std::vector<CheckResultProto> expected = toolkit->CheckElements(screen.hierarchy(), params);
+
+  gtx::ThreadPoolExecutor executor(3);
+  toolkit->set_image_check_executor(&executor, 4);
+  for (int i = 0; i < 3; i++) {
+    std::vector<CheckResultProto> results = toolkit->CheckElements(screen.hierarchy(), params);
+    XCTAssertEqual(results.size(), expected.size());
+    for (size_t j = 0; j < std::min(results.size(), expected.size()); j++) {
+      XCTAssertEqual(results[j].hierarchy_source_id(), expected[j].hierarchy_source_id());
+      XCTAssertEqual(results[j].source_check_class(), expected[j].source_check_class());
+    }
+  }
+}
+
+- (void)testImageCheckExecutorStopsWhenCancelled {
+  const int elementCount = 100;
+  gtx::CancellationToken token;
+  std::unique_ptr<gtx::Check> check = std::make_unique<GTXTestCancellingImageCheck>(token, 10);
+  gtx::Toolkit toolkit;
+  toolkit.RegisterCheck(_passingCheck1);
+  toolkit.RegisterCheck(check);
+  GTXTestInlineExecutor executor;
+  toolkit.set_image_check_executor(&executor, 1);
+  gtx::EvaluationOptions options;
+  options.cancellation_token = &token;
+  // Image checks only run on screenshots with pixels.
+  gtx::Pixel pixel = {0, 0, 0, 255};
+  gtx::Parameters params = _params;
+  params.set_screenshot(gtx::Image(&pixel, 1, 1));
+  gtx::EvaluationResult result =
+      toolkit.CheckElements([self hierarchyWithElementCount:elementCount], params, options);
+  XCTAssertTrue(result.status == gtx::EvaluationStatus::kCancelled);
+  XCTAssertGreaterThan(result.elements_evaluated, 10);
+  XCTAssertLessThan(result.elements_evaluated, elementCount);
+  XCTAssertEqual((int)result.results.size(), result.elements_evaluated);
+}
+
+- (void)testImageChecksDoNotRunWithoutScreenshotPixels {
+  std::unique_ptr<gtx::Check> check = std::make_unique<GTXTestCancellingImageCheck>(
+      gtx::CancellationToken(), -1);
+  gtx::Toolkit toolkit;
+  toolkit.RegisterCheck(_failingCheck1);
+  toolkit.RegisterCheck(check);
+  AccessibilityHierarchyProto hierarchy = [self hierarchyWithElementCount:10];
+  std::vector<CheckResultProto> results = toolkit.CheckElements(hierarchy, _params);
+  XCTAssertEqual(results.size(), 10u);
+  XCTAssertEqual(toolkit.CheckElements(gtx::HierarchyTable::FromProto(hierarchy), _params).size(),
+                 10u);
+  XCTAssertEqual(toolkit.CountCheckResults(hierarchy, _params).Count(1), 0);
+
+  gtx::Pixel pixel = {0, 0, 0, 255};
+  gtx::Parameters params = _params;
+  params.set_screenshot(gtx::Image(&pixel, 1, 1));
+  XCTAssertEqual(toolkit.CheckElements(hierarchy, params).size(), 20u);
+}
+
+#pragma mark - Private Methods
+
+// Returns a hierarchy of @c count accessibility elements whose ids are their indices.
+- (AccessibilityHierarchyProto)hierarchyWithElementCount:(int)count {
+  AccessibilityHierarchyProto hierarchy;
+  for (int i = 0; i < count; i++) {
+    UIElementProto *element = hierarchy.add_elements();
+    *element = _element1;
+    element->set_id(i);
+  }
+  return hierarchy;
+}
+
 @end
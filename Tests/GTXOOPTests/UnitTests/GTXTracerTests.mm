@@ -0,0 +1,168 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "tracer.h"
+
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "typedefs.h"
+#include "hierarchy_table.h"
+#include "toolkit.h"
+#include "gtxtest_always_failing_check.h"
+#include "gtxtest_always_passing_check.h"
+#include "gtxtest_synthetic_hierarchy.h"
+
+@interface GTXTracerTests : XCTestCase
+@end
+
+@implementation GTXTracerTests {
+  AccessibilityHierarchyProto _hierarchy;
+  gtx::Parameters _params;
+}
+
+- (void)setUp {
+  [super setUp];
+  // A container with two accessibility elements.
+  UIElementProto *container = _hierarchy.add_elements();
+  container->set_id(0);
+  container->add_child_ids(1);
+  container->add_child_ids(2);
+  for (int id = 1; id <= 2; id++) {
+    UIElementProto *element = _hierarchy.add_elements();
+    element->set_id(id);
+    element->set_parent_id(0);
+    element->set_is_ax_element(true);
+  }
+}
+
+// Returns a toolkit with a passing and a failing check recording into
+// @c tracer.
+- (std::unique_ptr<gtx::Toolkit>)toolkitWithTracer:(gtx::Tracer *)tracer {
+  auto toolkit = std::make_unique<gtx::Toolkit>();
+  std::unique_ptr<gtx::Check> passing_check =
+      std::make_unique<gtxtest::GTXTestAlwaysPassingCheck>("passing");
+  toolkit->RegisterCheck(passing_check);
+  toolkit->set_tracer(tracer);
+  // Checks registered after the tracer is set are traced too.
+  std::unique_ptr<gtx::Check> failing_check =
+      std::make_unique<gtxtest::GTXTestAlwaysFailingCheck>("failing");
+  toolkit->RegisterCheck(failing_check);
+  return toolkit;
+}
+
+// Returns the number of occurrences of @c needle in @c haystack.
+- (int)countOf:(const std::string &)needle in:(const std::string &)haystack {
+  int count = 0;
+  for (size_t position = haystack.find(needle); position != std::string::npos;
+       position = haystack.find(needle, position + needle.size())) {
+    count++;
+  }
+  return count;
+}
+
+- (void)testCheckElementsRecordsHierarchyChunkAndCheckSpans {
+  gtx::TracerOptions options;
+  options.min_check_span_nanoseconds = 0;
+  gtx::Tracer tracer(options);
+  [self toolkitWithTracer:&tracer]->CheckElements(_hierarchy, _params);
+  std::string json = tracer.ToTraceEventJSON();
+  XCTAssertEqual([self countOf:"\"name\":\"CheckElements\"" in:json], 1);
+  XCTAssertEqual([self countOf:"\"name\":\"CheckChunk\"" in:json], 1);
+  XCTAssertEqual([self countOf:"\"name\":\"passing\"" in:json], 2);
+  XCTAssertEqual([self countOf:"\"name\":\"failing\"" in:json], 2);
+  XCTAssertNotEqual(json.find("\"args\":{\"elements\":3}"), std::string::npos);
+  XCTAssertNotEqual(json.find("\"dropped_spans\":\"0\""), std::string::npos);
+}
+
+- (void)testChecksBelowThresholdAreNotTraced {
+  gtx::TracerOptions options;
+  options.min_check_span_nanoseconds = UINT64_MAX;
+  gtx::Tracer tracer(options);
+  [self toolkitWithTracer:&tracer]->CheckElements(_hierarchy, _params);
+  std::string json = tracer.ToTraceEventJSON();
+  XCTAssertEqual([self countOf:"\"name\":\"CheckElements\"" in:json], 1);
+  XCTAssertEqual([self countOf:"\"cat\":\"check\"" in:json], 0);
+}
+
+- (void)testCheckElementsInTableTracesEachCheckBatch {
+  gtx::Tracer tracer;
+  [self toolkitWithTracer:&tracer]->CheckElements(
+      gtx::HierarchyTable::FromProto(_hierarchy), _params);
+  std::string json = tracer.ToTraceEventJSON();
+  XCTAssertEqual([self countOf:"\"name\":\"CheckElementsInTable\"" in:json],
+                 1);
+  XCTAssertEqual([self countOf:"\"cat\":\"check\"" in:json], 2);
+}
+
+- (void)testSwatchExtractionIsTracedThroughCurrentTracer {
+  gtxtest::GTXTestSyntheticHierarchyOptions options;
+  options.element_count = 50;
+  gtxtest::GTXTestSyntheticScreen screen =
+      gtxtest::GTXTestSyntheticHierarchyGenerator(options).GenerateScreen();
+  gtx::Tracer tracer;
+  std::unique_ptr<gtx::Toolkit> toolkit =
+      gtx::Toolkit::ToolkitWithAllDefaultChecks();
+  toolkit->set_tracer(&tracer);
+  toolkit->CheckElements(screen.hierarchy(), screen.parameters());
+  XCTAssertTrue(gtx::Tracer::Current() == nullptr);
+  std::string json = tracer.ToTraceEventJSON();
+  XCTAssertGreaterThan(
+      [self countOf:"\"name\":\"ContrastSwatch::Extract\"" in:json], 0);
+}
+
+- (void)testThreadsRecordIntoSeparateBuffers {
+  gtx::Tracer tracer;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&tracer] {
+      for (int span = 0; span < 2000; span++) {
+        gtx::ScopedTraceSpan scoped_span(&tracer, "span", "test");
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  std::string json = tracer.ToTraceEventJSON();
+  XCTAssertEqual([self countOf:"\"name\":\"thread_name\"" in:json], 4);
+  XCTAssertEqual([self countOf:"\"name\":\"span\"" in:json], 8000);
+}
+
+- (void)testSpansBeyondLimitAreDropped {
+  gtx::TracerOptions options;
+  options.max_spans_per_thread = 10;
+  gtx::Tracer tracer(options);
+  for (int span = 0; span < 15; span++) {
+    gtx::ScopedTraceSpan scoped_span(&tracer, "span", "test");
+  }
+  std::string json = tracer.ToTraceEventJSON();
+  XCTAssertEqual([self countOf:"\"name\":\"span\"" in:json], 10);
+  XCTAssertNotEqual(json.find("\"dropped_spans\":\"5\""), std::string::npos);
+}
+
+- (void)testNamesAreEscaped {
+  gtx::Tracer tracer;
+  tracer.AddSpan(tracer.InternName("a\"b\\c"), "test", 0, 0);
+  XCTAssertNotEqual(tracer.ToTraceEventJSON().find("\"a\\\"b\\\\c\""),
+                    std::string::npos);
+}
+
+@end
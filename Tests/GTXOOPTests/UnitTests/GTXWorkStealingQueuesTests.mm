@@ -0,0 +1,87 @@
+//
+// Copyright 2021 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "work_stealing_queues.h"
+
+#import <XCTest/XCTest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+@interface GTXWorkStealingQueuesTests : XCTestCase
+@end
+
+@implementation GTXWorkStealingQueuesTests
+
+- (void)testItemsAreBalancedByCost {
+  gtx::WorkStealingQueues queues(2, {0, 1, 2, 3}, {8, 4, 3, 1});
+  XCTAssertEqual(queues.InitialCost(0), 8ul);
+  XCTAssertEqual(queues.InitialCost(1), 8ul);
+}
+
+- (void)testQueuesPopMostExpensiveItemsFirst {
+  gtx::WorkStealingQueues queues(1, {0, 1, 2}, {1, 3, 2});
+  int item;
+  XCTAssertTrue(queues.Pop(0, &item));
+  XCTAssertEqual(item, 1);
+  XCTAssertTrue(queues.Pop(0, &item));
+  XCTAssertEqual(item, 2);
+  XCTAssertTrue(queues.Pop(0, &item));
+  XCTAssertEqual(item, 0);
+  XCTAssertFalse(queues.Pop(0, &item));
+}
+
+- (void)testEmptyQueueStealsFromOthers {
+  gtx::WorkStealingQueues queues(2, {0, 1, 2}, {5, 2, 2});
+  int item;
+  // Queue 1 holds items 1 and 2; after they are taken, it steals item 0.
+  XCTAssertTrue(queues.Pop(1, &item));
+  XCTAssertTrue(queues.Pop(1, &item));
+  XCTAssertTrue(queues.Pop(1, &item));
+  XCTAssertEqual(item, 0);
+  XCTAssertEqual(queues.stolen_count(), 1);
+  XCTAssertFalse(queues.Pop(0, &item));
+}
+
+- (void)testConcurrentPopsRemoveEachItemOnce {
+  const int itemCount = 1000;
+  std::vector<int> items(itemCount);
+  std::vector<uint64_t> costs(itemCount);
+  for (int i = 0; i < itemCount; i++) {
+    items[i] = i;
+    costs[i] = i % 7 + 1;
+  }
+  gtx::WorkStealingQueues queues(4, items, costs);
+  std::vector<std::atomic<int>> popCounts(itemCount);
+  std::vector<std::thread> threads;
+  for (int queue = 0; queue < 4; queue++) {
+    threads.emplace_back([&queues, &popCounts, queue] {
+      int item;
+      while (queues.Pop(queue, &item)) {
+        popCounts[item]++;
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (int i = 0; i < itemCount; i++) {
+    XCTAssertEqual(popCounts[i].load(), 1);
+  }
+}
+
+@end